@@ -0,0 +1,135 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "histogram.h"
+
+#define AT_CMD_MAX_LEN          96
+#define AT_RESP_MAX_LEN         384
+#define AT_RX_BUF_LEN           512     /* longest line the engine frames */
+#define AT_QUEUE_DEPTH          8
+#define AT_URC_MAX_SUBSCRIBERS  8
+#define AT_IDLE_POLL_MS         5       /* URC polling while the modem is awake */
+#define AT_SLEEP_POLL_MS        1000    /* ... and while it sleeps, so the MCU can sleep too */
+#define AT_STATS_COMMANDS       20      /* commands with their own latency histogram, the rest share one */
+#define AT_STATS_NAME_LEN       12
+
+#define AT_ENGINE_TASK_STACK_SIZE  (4096)
+#define AT_ENGINE_TASK_PRIORITY    (3)
+
+#define AT_CTRL_Z  0x1A
+
+typedef enum {
+    AT_PENDING,
+    AT_OK,
+    AT_ERROR,
+    AT_TIMEOUT,
+    AT_QUEUE_FULL
+} AtResult;
+
+struct AtRequest_t;
+typedef void (*AtDoneCallback)(AtRequest_t* req, void* ctx);
+typedef void (*AtLineCallback)(const char* line, size_t len, void* ctx);
+
+/*
+ * One queued AT exchange. The storage is owned by the caller and must stay
+ * valid until the request completes (result != AT_PENDING).
+ */
+struct AtRequest_t {
+    char cmd[AT_CMD_MAX_LEN];     /* command without the leading "AT" */
+    const uint8_t* payload;       /* optional data sent once the '>' prompt arrives */
+    size_t payloadLen;
+    bool payloadCtrlZ;            /* terminate payload with Ctrl+Z (SMS text) */
+    uint32_t timeoutMs;
+    AtLineCallback onLine;        /* optional: stream information lines instead of buffering */
+    const char* bodyPrefix;       /* optional: lines after an information line with this prefix are
+                                     message text up to the next blank line, never result codes (+CMGL:) */
+    AtDoneCallback onDone;        /* optional: completion callback, runs in the engine task */
+    void* ctx;
+    char resp[AT_RESP_MAX_LEN];   /* information lines, '\n' separated */
+    size_t respLen;
+    volatile AtResult result;
+    uint32_t latencyUs;
+    TaskHandle_t waiter;
+};
+
+/* Latency of one command, keyed by its name up to '=' or '?' ("AT+CGNSINF", "AT+CMGS") */
+struct AtCommandStats_t {
+    char name[AT_STATS_NAME_LEN];
+    uint32_t errors;
+    uint32_t timeouts;
+    Histogram_t latency;          /* sent to final result code */
+};
+
+/*
+ * Non-blocking AT command layer. A single engine task owns the modem stream:
+ * it sends queued requests one at a time, frames every received line and
+ * routes it either to the active request or to the URC subscribers.
+ * Blocking helpers park only the calling task, using its task notification.
+ */
+class AtEngine {
+public:
+    AtEngine(Stream& stream, HardwareSerial& serialMon);
+
+    bool begin();
+    bool subscribe(const char* prefix, AtLineCallback cb, void* ctx);
+
+    static void prepare(AtRequest_t* req, uint32_t timeoutMs, const char* fmt, ...)
+        __attribute__((format(printf, 3, 4)));
+    bool submit(AtRequest_t* req);
+    AtResult exec(AtRequest_t* req);
+    AtResult command(AtRequest_t* req, uint32_t timeoutMs, const char* fmt, ...)
+        __attribute__((format(printf, 4, 5)));
+
+    static const char* findLine(const AtRequest_t* req, const char* prefix, size_t* len);
+
+    void setIdlePoll(uint32_t ms);
+    void expectEcho();
+    void service(TickType_t wait);
+
+    void getTotals(AtCommandStats_t* totals);
+    void printStats(Print& out);
+
+protected:
+    struct UrcSubscriber_t {
+        const char* prefix;
+        size_t prefixLen;
+        AtLineCallback cb;
+        void* ctx;
+    };
+
+    static void taskEntry(void* pvParameters);
+    void run();
+    void start(AtRequest_t* req);
+    void finish(AtResult result);
+    void pump();
+    void handleLine(const char* line, size_t len);
+    bool dispatchUrc(const char* line, size_t len);
+    void appendResponse(const char* line, size_t len);
+    void record(const AtRequest_t* req, AtResult result);
+
+    Stream& stream;
+    HardwareSerial& serialMon;
+    QueueHandle_t queue;
+    portMUX_TYPE subscriberLock;
+    UrcSubscriber_t subscribers[AT_URC_MAX_SUBSCRIBERS];
+    volatile uint8_t subscriberCount;
+
+    volatile uint32_t idlePollMs;
+    AtRequest_t* active;
+    uint32_t activeStartUs;
+    bool payloadSent;
+    bool inBody;                  /* between a bodyPrefix line and the blank line ending its text */
+    /* Cleared once ATE0 is acknowledged: until then lines starting with "AT" are the command echo */
+    volatile bool echoOn;
+    /* Received bytes; complete lines are handed out in place, the partial tail is kept */
+    char rxBuf[AT_RX_BUF_LEN];
+    size_t rxLen;
+    bool rxDiscard;
+
+    /* Written by the engine task only; the lock keeps readers from seeing half an update */
+    portMUX_TYPE statsLock;
+    AtCommandStats_t commandStats[AT_STATS_COMMANDS + 1];    /* last entry: everything else */
+    uint8_t commandCount;
+};
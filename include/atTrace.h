@@ -0,0 +1,146 @@
+#pragma once
+#include <Arduino.h>
+
+#ifndef AT_TRACE_CAPTURE
+#define AT_TRACE_CAPTURE 0
+#endif
+#ifndef MODEM_TRACE_REPLAY
+#define MODEM_TRACE_REPLAY 0
+#endif
+#ifndef AT_TRACE_REPLAY_REALTIME
+#define AT_TRACE_REPLAY_REALTIME 1
+#endif
+
+/*
+ * Binary AT trace layout:
+ *   "ATR1" magic, then records of
+ *   [hdr: bit7 = direction (1 host->modem), bits0-6 = length - 1]
+ *   [LEB128 microseconds since the previous record]
+ *   [length bytes]
+ * Bytes in the same direction arriving within AT_TRACE_COALESCE_US share a record.
+ *
+ * dump() sends the trace in the frame layout of trackExport.h, so a log line
+ * printed by another task is skipped and a damaged chunk is caught:
+ *   AT_TRACE_FRAME_DATA frames: seq = offset in the trace, up to AT_TRACE_DUMP_CHUNK bytes
+ *   EXPORT_TYPE_END frame: seq = trace length, aux = 1 if the capture overflowed
+ */
+#define AT_TRACE_MAGIC         "ATR1"
+#define AT_TRACE_MAGIC_LEN     4
+#define AT_TRACE_BUF_LEN       (16 * 1024)
+#define AT_TRACE_COALESCE_US   5000
+#define AT_TRACE_RECORD_MAX    128
+#define AT_TRACE_DIR_TX        0x80
+#define AT_TRACE_DUMP_CHUNK    256
+#define AT_TRACE_FRAME_DATA    'A'
+
+#define AT_REPLAY_MAX_COMMANDS 16
+
+struct AtReplayCommandStats_t {
+    char name[16];            /* command without "AT" and parameters */
+    uint32_t count;
+    uint32_t totalUs;         /* host line to final result code */
+    uint32_t maxUs;
+};
+
+struct AtReplayStats_t {
+    bool finished;
+    uint32_t elapsedUs;
+    uint32_t traceUs;         /* offset of the last record reached */
+    uint32_t bytesToModem;
+    uint32_t bytesFromModem;
+    uint32_t divergences;     /* host bytes that differ from the capture */
+    uint8_t commandCount;
+    AtReplayCommandStats_t commands[AT_REPLAY_MAX_COMMANDS];
+};
+
+/*
+ * Pass-through stream, in the spirit of StreamDebugger, that records every
+ * byte in both directions with microsecond timestamps into a RAM trace.
+ * Capture stops when the buffer is full.
+ */
+class AtTraceStream : public Stream {
+public:
+    explicit AtTraceStream(Stream& inner);
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t readBytes(char* buf, size_t len) override;
+    using Stream::readBytes;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t len) override;
+    void flush() override;
+    using Print::write;
+
+    void clear();
+    size_t size() const;
+    bool overflowed() const;
+    void dump(Print& out);
+
+protected:
+    void record(uint8_t dir, const uint8_t* data, size_t len);
+
+    Stream& inner;
+    uint8_t buf[AT_TRACE_BUF_LEN];
+    volatile size_t committed;   /* end of the last closed record */
+    size_t recStart;             /* start of the open record */
+    size_t writePos;             /* end of the open record */
+    size_t recLen;
+    uint8_t recDir;
+    uint32_t lastUs;
+    bool started;
+    bool full;
+};
+
+/*
+ * Stream that plays a captured trace back as the modem. Modem output is
+ * released once the host has written everything that preceded it in the
+ * trace, and in real-time mode not before its original time offset.
+ */
+class AtTraceReplay : public Stream {
+public:
+    AtTraceReplay(const uint8_t* trace, size_t len, bool realtime);
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t len) override;
+    using Print::write;
+
+    bool finished() const;
+    void getStats(AtReplayStats_t* stats);
+    void printReport(Print& out);
+
+protected:
+    void nextRecord();
+    bool released();
+    void onHostLine();
+    void onModemLine();
+
+    const uint8_t* trace;
+    size_t traceLen;
+    size_t pos;
+    bool realtime;
+
+    /* Current record */
+    uint8_t recDir;
+    size_t recRemaining;
+    uint64_t recOffsetUs;
+    bool done;
+
+    uint32_t startUs;
+    bool started;
+    uint32_t bytesToModem;
+    uint32_t bytesFromModem;
+    uint32_t divergences;
+
+    char hostLine[32];
+    size_t hostLineLen;
+    char modemLine[16];
+    size_t modemLineLen;
+    int pendingCommand;
+    uint32_t commandStartUs;
+    AtReplayCommandStats_t commands[AT_REPLAY_MAX_COMMANDS];
+    uint8_t commandCount;
+};
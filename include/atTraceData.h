@@ -0,0 +1,11 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * AT trace replayed by MODEM_TRACE_REPLAY builds.
+ * Replace with a capture converted by: python tools/at_trace.py capture.log --header include/atTraceData.h
+ * The default trace only holds the magic, so the replay finishes immediately.
+ */
+static const uint8_t atTraceData[] = {
+    'A', 'T', 'R', '1'
+};
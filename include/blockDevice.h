@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define BLOCK_DEVICE_PATH_MAX  48
+
+/*
+ * Fixed-size block storage used by the position log. Writes replace a whole
+ * block; a write interrupted by power loss may leave that block torn, which
+ * the log detects with its CRCs.
+ */
+class BlockDevice {
+public:
+    virtual ~BlockDevice() {}
+
+    virtual bool open() = 0;
+    virtual bool read(uint32_t block, uint8_t* buf) = 0;
+    virtual bool write(uint32_t block, const uint8_t* buf) = 0;
+    virtual bool sync() = 0;
+    virtual size_t blockSize() const = 0;
+    virtual uint32_t blockCount() const = 0;
+};
+
+/*
+ * Block device on top of a stdio file: an SD card or flash file system
+ * mounted in the ESP-IDF VFS on target (e.g. "/sd/fixlog.bin"), or a
+ * plain file on the host. Blocks past the end of the file read as zeros.
+ */
+class FileBlockDevice : public BlockDevice {
+public:
+    FileBlockDevice(const char* path, size_t blockSize, uint32_t blockCount);
+    ~FileBlockDevice();
+
+    bool open() override;
+    bool read(uint32_t block, uint8_t* buf) override;
+    bool write(uint32_t block, const uint8_t* buf) override;
+    bool sync() override;
+    size_t blockSize() const override;
+    uint32_t blockCount() const override;
+
+protected:
+    char path[BLOCK_DEVICE_PATH_MAX];
+    size_t size;
+    uint32_t count;
+    FILE* file;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "modemMgr.h"
+
+#define BOOT_STATE_MAGIC        0x31544F42UL   /* "BOT1" */
+/* System clock readings before this are not UTC: not set since power-on */
+#define BOOT_CLOCK_VALID_UNIX   1577836800UL   /* 2020-01-01 */
+/* Saved fixes older than this are no use to the receiver */
+#define BOOT_FIX_MAX_AGE_S      (7UL * 24 * 60 * 60)
+
+/*
+ * State kept in RTC slow memory, which survives deep sleep but not power loss.
+ * It is updated as things change, so it is current whenever the ESP32 goes down.
+ */
+struct BootState_t {
+    uint32_t magic;
+    uint32_t wakeCount;        /* boots since the last power-on */
+    bool modemOn;              /* modem left powered when the ESP32 went down */
+    uint32_t modemBaud;        /* rate the modem UART was last running at */
+    uint8_t regStatus;         /* last RegStatus seen by cellularTask */
+    bool haveFix;
+    uint32_t fixUtc;           /* UTC of the last fix, seconds since 1970 */
+    GnssRecord_t fix;
+    uint32_t lastSmsReadyMs;   /* boot-to-SMS-ready time of the previous boot, 0 if never */
+};
+
+/*
+ * Fast-boot bookkeeping on top of a BootState_t in RTC memory. On a wake
+ * from deep sleep it hands back the modem rate and power state, registration
+ * and the last fix, whose age comes from the system clock the RTC keeps running.
+ */
+class BootState {
+public:
+    explicit BootState(BootState_t& rtc);
+
+    bool begin();
+    bool restored() const;
+    uint32_t modemBaud() const;
+    bool modemWasOn() const;
+    RegStatus registration();
+    bool lastFix(GnssRecord_t* rec, uint32_t* ageS) const;
+
+    void modemStarted(uint32_t baud);
+    void modemPoweredOff();
+    void setRegistration(RegStatus status);
+    void fixAcquired(const GnssRecord_t& rec);
+    bool smsReady();
+
+    void printStats(Print& out);
+
+protected:
+    BootState_t& rtc;
+    BootState_t saved;         /* copy taken at boot, before this boot updates rtc */
+    bool warm;
+    bool modemKept;
+    uint32_t smsReadyMs;
+    portMUX_TYPE lock;
+};
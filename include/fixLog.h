@@ -0,0 +1,99 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include "blockDevice.h"
+#include "gnssParser.h"
+
+#define FIX_LOG_BLOCK_LEN       512      /* one SD sector per segment */
+#define FIX_LOG_QUEUE_DEPTH     32       /* fixes buffered in RAM ahead of the writer */
+#define FIX_LOG_FLUSH_MS        120000   /* oldest unwritten fix is flushed after this long */
+
+#define FIX_LOG_TASK_STACK_SIZE  (4096)
+#define FIX_LOG_TASK_PRIORITY    (1)
+
+/* Fix as stored in the log, 24 bytes */
+struct __attribute__((packed)) FixLogRecord_t {
+    uint32_t utc;             /* seconds since 1970-01-01, 0 is a flush marker in the queue */
+    int32_t latE6;
+    int32_t lonE6;
+    int32_t altitudeCm;
+    uint16_t speedKmhX100;
+    uint16_t courseX100;
+    uint16_t hdopX100;
+    uint8_t satsUsed;
+    uint8_t flags;
+};
+
+/*
+ * Segment layout, one block each:
+ *   header:  magic "FLG1", sequence number, CRC-16 of the first 8 bytes
+ *   records: 0xA5, length, FixLogRecord_t, CRC-16 of length + record
+ * Segments are written whole and in sequence order around the device.
+ * Recovery takes the valid header with the highest sequence and keeps its
+ * records up to the first one whose frame or CRC does not check.
+ */
+#define FIX_LOG_MAGIC           0x31474C46UL   /* "FLG1" */
+#define FIX_LOG_HEADER_LEN      12
+#define FIX_LOG_RECORD_SYNC     0xA5
+#define FIX_LOG_FRAME_LEN       (2 + sizeof(FixLogRecord_t) + 2)
+#define FIX_LOG_RECORDS_PER_BLOCK  ((FIX_LOG_BLOCK_LEN - FIX_LOG_HEADER_LEN) / FIX_LOG_FRAME_LEN)
+
+struct FixLogStats_t {
+    uint32_t logged;          /* fixes accepted from gpsTask */
+    uint32_t dropped;         /* fixes lost because the RAM buffer was full */
+    uint32_t recovered;       /* records found in the open segment at boot */
+    uint32_t flushes;         /* block writes */
+    uint32_t payloadBytes;    /* record bytes handed to the log */
+    uint32_t deviceBytes;     /* bytes written to the device, including rewrites of open segments */
+    uint32_t flushTotalUs;
+    uint32_t flushMaxUs;
+    uint32_t errors;
+};
+
+/*
+ * Append-only position log. gpsTask hands fixes over through a queue and
+ * never waits; a low-priority task packs them into segments and writes a
+ * segment when it is full or FIX_LOG_FLUSH_MS after its first unwritten fix.
+ */
+class FixLog {
+public:
+    explicit FixLog(BlockDevice& dev);
+
+    bool begin();
+    bool append(const GnssRecord_t& rec);
+    void requestFlush();
+    bool idle();
+
+    bool seqRange(uint32_t* oldest, uint32_t* newest);
+    bool readSegment(uint32_t seq, uint8_t* block, uint16_t* records);
+
+    void getStats(FixLogStats_t* stats);
+    void printStats(Print& out);
+
+protected:
+    static void taskEntry(void* pvParameters);
+    void run();
+    bool recover();
+    void openSegment(uint32_t block, uint32_t seq);
+    void addRecord(const FixLogRecord_t& rec);
+    void flushSegment();
+
+    BlockDevice& dev;
+    QueueHandle_t queue;
+    SemaphoreHandle_t devLock;    /* device access and segBlock/segSeq, against readSegment() */
+    portMUX_TYPE statsLock;
+    FixLogStats_t stats;
+
+    /* Segment being filled, owned by the log task */
+    uint8_t segment[FIX_LOG_BLOCK_LEN];
+    uint32_t segBlock;
+    uint32_t segSeq;
+    uint16_t segRecords;
+    uint16_t segWritten;      /* records already on the device */
+    uint32_t dirtySinceMs;
+};
+
+/* CRC-16/CCITT-FALSE of the log frames, shared with the serial export */
+uint16_t Crc16(const uint8_t* data, size_t len, uint16_t crc = 0xFFFF);
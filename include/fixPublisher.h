@@ -0,0 +1,32 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "modemMgr.h"
+
+/* Consistent copy of the latest published fix */
+struct FixSnapshot_t {
+    uint32_t sequence;        /* number of fixes published so far, 0 if none */
+    uint32_t ageMs;           /* time since the fix was received by the modem manager */
+    GnssSample_t sample;
+};
+
+/*
+ * Single-writer, multi-reader seqlock holding the latest fix. gpsTask publishes
+ * on core 0; any task on either core reads a consistent snapshot without taking
+ * a lock or the radio. A reader that overlaps a publish simply copies again.
+ */
+class FixPublisher {
+public:
+    FixPublisher();
+
+    void publish(const GnssSample_t& sample);
+    bool read(FixSnapshot_t* snap) const;
+    uint32_t sequence() const;
+
+protected:
+    static const size_t WORDS = (sizeof(GnssSample_t) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    /* Odd while a publish is in progress; twice the number of fixes otherwise */
+    std::atomic<uint32_t> seq;
+    std::atomic<uint32_t> words[WORDS];
+};
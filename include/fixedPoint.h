@@ -0,0 +1,22 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * Integer trigonometry and roots shared by the geofence, the track filter,
+ * the trip meter and the GNSS scheduler. Angles are in degrees * 100, results
+ * in Q15 unless noted; none of them allocates.
+ */
+
+/*
+ * Metres per degree of latitude on a sphere of the Earth's mean radius. The
+ * same digits are centimetres per 1e-6 degree times 10000.
+ */
+#define FIXED_M_PER_DEG_LAT      111195
+
+/* cos(latitude) is held at 0.01 near the poles, so longitude steps stay finite */
+#define FIXED_LON_SCALE_MIN_Q15  328
+
+int32_t FixedSinX100(int32_t deg);
+uint32_t FixedIsqrt64(uint64_t v);
+uint16_t FixedLonScaleQ15(int32_t latE6);
+uint32_t FixedDistanceCm(int32_t latA, int32_t lonA, int32_t latB, int32_t lonB);
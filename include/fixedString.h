@@ -0,0 +1,106 @@
+#pragma once
+#include <Arduino.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdio.h>
+
+/* Longest console line FixedPrintf formats without truncating */
+#define FIXED_PRINTF_MAX_LEN  192
+
+/*
+ * String with its capacity fixed at compile time, for use on the stack or as
+ * a member instead of Arduino String: it never touches the heap. Appends that
+ * do not fit are truncated and remembered by truncated().
+ */
+template <size_t N>
+class FixedString {
+public:
+    FixedString() : len(0), overflow(false) {
+        buf[0] = '\0';
+    }
+
+    FixedString(const char* s) : len(0), overflow(false) {
+        buf[0] = '\0';
+        append(s);
+    }
+
+    FixedString& operator=(const char* s) {
+        clear();
+        return append(s);
+    }
+
+    void clear() {
+        len = 0;
+        overflow = false;
+        buf[0] = '\0';
+    }
+
+    FixedString& append(const char* s) {
+        size_t n = strlen(s);
+        if (n > N - 1 - len) {
+            n = N - 1 - len;
+            overflow = true;
+        }
+        memcpy(buf + len, s, n);
+        len += n;
+        buf[len] = '\0';
+        return *this;
+    }
+
+    FixedString& appendf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, fmt);
+        appendv(fmt, args);
+        va_end(args);
+        return *this;
+    }
+
+    FixedString& appendv(const char* fmt, va_list args) {
+        int n = vsnprintf(buf + len, N - len, fmt, args);
+        if (n < 0) {
+            buf[len] = '\0';
+            overflow = true;
+        } else if ((size_t)n >= N - len) {
+            len = N - 1;
+            overflow = true;
+        } else {
+            len += (size_t)n;
+        }
+        return *this;
+    }
+
+    const char* c_str() const {
+        return buf;
+    }
+
+    size_t length() const {
+        return len;
+    }
+
+    static size_t capacity() {
+        return N - 1;
+    }
+
+    bool truncated() const {
+        return overflow;
+    }
+
+private:
+    char buf[N];
+    size_t len;
+    bool overflow;
+};
+
+/*
+ * @brief printf to a Print through a stack buffer. Print::printf() allocates on
+ *        the heap for lines of 64 characters or more; this truncates instead.
+ */
+inline size_t FixedPrintf(Print& out, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+inline size_t FixedPrintf(Print& out, const char* fmt, ...) {
+    FixedString<FIXED_PRINTF_MAX_LEN> line;
+    va_list args;
+    va_start(args, fmt);
+    line.appendv(fmt, args);
+    va_end(args);
+    return out.write((const uint8_t*)line.c_str(), line.length());
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+/*
+ * Fence budget. Polygon vertices come from a shared pool and are stored as
+ * 16-bit offsets from the fence origin, so a polygon may span up to about
+ * 0.3 degrees (30 km) in each direction.
+ */
+#define GEOFENCE_MAX_FENCES        32       /* one bit each in the grid masks */
+#define GEOFENCE_MAX_VERTICES      256
+#define GEOFENCE_MAX_POLY_VERTICES 16
+#define GEOFENCE_MAX_RADIUS_M      30000
+#define GEOFENCE_NAME_LEN          12
+#define GEOFENCE_NVS_NAMESPACE     "fence1"
+
+/* Coordinates are held in 1e-5 degree steps, like the track history */
+#define GEOFENCE_COORD_QUANT       10
+
+/*
+ * Grid index: cells of 2^GEOFENCE_GRID_SHIFT steps (about 1.3 km) hashed into
+ * GEOFENCE_GRID_BUCKETS masks. A fence covering more than GEOFENCE_GRID_MAX_CELLS
+ * cells is checked on every fix instead.
+ */
+#define GEOFENCE_GRID_SHIFT        11
+#define GEOFENCE_GRID_BUCKETS      64
+#define GEOFENCE_GRID_MAX_CELLS    16
+
+/* Hysteresis: a zone is left only this far outside its edge, and after this many fixes in a row */
+#define GEOFENCE_MARGIN_M          20
+#define GEOFENCE_CONFIRM_FIXES     2
+
+typedef enum {
+    GEOFENCE_CIRCLE,
+    GEOFENCE_POLYGON
+} GeofenceShape;
+
+/* One fence as stored in NVS: 32 bytes plus 4 per polygon vertex */
+struct GeofenceDef_t {
+    char name[GEOFENCE_NAME_LEN];
+    uint8_t shape;
+    uint8_t vertexCount;          /* polygon */
+    uint16_t firstVertex;         /* polygon: index into the vertex pool */
+    uint16_t radiusQ;             /* circle: radius in steps of latitude */
+    uint16_t lonScaleQ15;         /* cos(latitude) in Q15: longitude steps to latitude steps */
+    int32_t originLatQ;           /* circle: centre; polygon: south-west corner of its bounding box */
+    int32_t originLonQ;
+    int16_t spanLatQ;             /* polygon: bounding box size */
+    int16_t spanLonQ;
+};
+
+/* Polygon vertex, offset from its fence origin */
+struct GeofenceVertex_t {
+    int16_t latQ;
+    int16_t lonQ;
+};
+
+struct GeofenceEvent_t {
+    char name[GEOFENCE_NAME_LEN];
+    bool entered;                 /* false: left */
+};
+
+struct GeofenceStats_t {
+    uint32_t evaluations;
+    uint32_t candidates;          /* fences tested exactly, summed over evaluations */
+    uint32_t evalTotalUs;
+    uint32_t evalMaxUs;
+    uint32_t entered;
+    uint32_t left;
+};
+
+/*
+ * Circular and polygonal zones checked against every accepted fix. A coarse
+ * grid of fence bitmasks keeps the exact tests to the few fences near the
+ * fix; point-in-polygon and circle distances use integer arithmetic only.
+ * A zone is entered at its edge but only left GEOFENCE_MARGIN_M beyond it,
+ * and either change has to hold for GEOFENCE_CONFIRM_FIXES fixes, so GNSS
+ * jitter along an edge does not raise alerts. The first fix after boot or
+ * after a fence is added sets its state without an event.
+ * gpsTask evaluates, cellularTask edits; both are serialised by a mutex.
+ * Fences are kept in NVS and survive reboots.
+ */
+class Geofence {
+public:
+    Geofence();
+
+    bool begin();
+    bool addCircle(const char* name, int32_t latE6, int32_t lonE6, uint32_t radiusM);
+    bool addPolygon(const char* name, const int32_t* latE6, const int32_t* lonE6, uint8_t count);
+    bool remove(const char* name);
+    uint8_t count();
+
+    size_t evaluate(int32_t latE6, int32_t lonE6, GeofenceEvent_t* events, size_t max);
+
+    void list(char* out, size_t max);
+    void getStats(GeofenceStats_t* stats);
+    void printStats(Print& out);
+
+protected:
+    int find(const char* name) const;
+    bool add(const GeofenceDef_t& def, const GeofenceVertex_t* vertices);
+    void removeAt(uint8_t idx);
+    void rebuildIndex();
+    void persist();
+    static uint8_t bucket(int32_t cellLat, int32_t cellLon);
+    bool insideCircle(const GeofenceDef_t& f, int32_t latQ, int32_t lonQ, bool wasInside) const;
+    bool insidePolygon(const GeofenceDef_t& f, int32_t latQ, int32_t lonQ, bool wasInside) const;
+
+    GeofenceDef_t fences[GEOFENCE_MAX_FENCES];
+    GeofenceVertex_t vertices[GEOFENCE_MAX_VERTICES];
+    uint8_t fenceCount;
+    uint16_t vertexCount;
+
+    /* Index and state, rebuilt from the definitions */
+    int32_t boxMinLatQ[GEOFENCE_MAX_FENCES];      /* bounding box including the margin */
+    int32_t boxMaxLatQ[GEOFENCE_MAX_FENCES];
+    int32_t boxMinLonQ[GEOFENCE_MAX_FENCES];
+    int32_t boxMaxLonQ[GEOFENCE_MAX_FENCES];
+    uint32_t grid[GEOFENCE_GRID_BUCKETS];
+    uint32_t wideMask;            /* fences too large for the grid */
+    uint32_t knownMask;           /* state set by at least one fix */
+    uint32_t insideMask;
+    uint8_t streak[GEOFENCE_MAX_FENCES];          /* fixes in a row disagreeing with the state */
+
+    GeofenceStats_t stats;
+    bool persistent;              /* begin() was called: changes are saved to NVS */
+    SemaphoreHandle_t lock;
+};
+
+const char* GeofenceParsePoint(const char* text, int32_t* latE6, int32_t* lonE6);
@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/* Number of comma separated fields in a SIM7070G +CGNSINF / +UGNSINF report */
+#define GNSS_CGNSINF_FIELDS   21
+/* Longest +CGNSINF line the modem emits, prefix included */
+#define GNSS_CGNSINF_MAX_LEN  160
+
+/* Fixed-point scales used by GnssRecord_t */
+#define GNSS_COORD_SCALE      1000000L   /* degrees * 1e6 */
+
+/*
+ * Decoded +CGNSINF report. All fractional values are stored as scaled
+ * integers so the record can be filled without floating point or heap use.
+ */
+struct GnssRecord_t {
+    bool     runStatus;       /* GNSS engine powered */
+    bool     fixValid;        /* fix status reported by the modem */
+    uint8_t  fixMode;         /* reserved by SIM7070G, kept for completeness */
+    uint16_t year;
+    uint8_t  month;
+    uint8_t  day;
+    uint8_t  hour;
+    uint8_t  minute;
+    uint8_t  second;
+    uint16_t millisecond;
+    int32_t  latE6;           /* latitude, degrees * 1e6 */
+    int32_t  lonE6;           /* longitude, degrees * 1e6 */
+    int32_t  altitudeCm;      /* MSL altitude, centimetres */
+    uint16_t speedKmhX100;    /* speed over ground, km/h * 100 */
+    uint16_t courseX100;      /* course over ground, degrees * 100 */
+    uint16_t hdopX100;
+    uint16_t pdopX100;
+    uint8_t  satsInView;
+    uint8_t  satsUsed;        /* GPS + GLONASS satellites used in the fix */
+};
+
+/*
+ * Parse a +CGNSINF (or +UGNSINF) report in place. The "+CGNSINF:" prefix is
+ * optional and trailing CR/LF are ignored. Returns false, leaving the record
+ * cleared, if the line is truncated or any field is malformed.
+ */
+bool GnssParseCgnsinf(const char* line, size_t len, GnssRecord_t* rec);
+
+/*
+ * Convert the UTC date and time of a record to seconds since 1970-01-01.
+ * Returns false if the record carries no plausible date (no fix yet).
+ */
+bool GnssRecordUnixTime(const GnssRecord_t* rec, uint32_t* unixTime);
@@ -0,0 +1,91 @@
+#pragma once
+#include <Arduino.h>
+#include "gnssParser.h"
+#include "histogram.h"
+#include "modemMgr.h"
+
+/* Acquisition interval bounds */
+#define GNSS_INTERVAL_MIN_MS          (5000)
+#define GNSS_INTERVAL_MOVING_MAX_MS   (60000)
+#define GNSS_INTERVAL_PARKED_MIN_MS   (30000)
+#define GNSS_INTERVAL_PARKED_MAX_MS   (600000)
+#define GNSS_INTERVAL_FAILED_MS       (120000)
+
+/* Moving: aim for one fix every GNSS_TARGET_SPACING_M, tighter on turns */
+#define GNSS_TARGET_SPACING_M         (60)
+#define GNSS_TURN_DEG                 (30)
+/* Parked: slower than this and within the radius of the previous fix */
+#define GNSS_PARKED_SPEED_KMH_X100    (300)
+#define GNSS_PARKED_RADIUS_M          (25)
+
+/* Leave the receiver powered between fixes when the next one is due this soon */
+#define GNSS_KEEP_ON_MAX_MS           (20000)
+
+/* Fix accepted once it is this good, or any valid fix after the grace period */
+#define GNSS_ACCEPT_HDOP_X100         (200)
+#define GNSS_ACCEPT_MIN_SATS          (5)
+#define GNSS_ACCEPT_GRACE_PCT         (60)
+
+/* Ephemeris age up to which a restart is hot, and search time allowed per start mode */
+#define GNSS_HOT_MAX_AGE_MS           (2UL * 60 * 60 * 1000)
+#define GNSS_SEARCH_HOT_MS            (30000)
+#define GNSS_SEARCH_WARM_MS           (90000)
+#define GNSS_SEARCH_COLD_MS           (300000)
+
+struct GnssTtffStats_t {
+    uint32_t searches;
+    uint32_t fixes;
+    uint32_t timeouts;
+    Histogram_t ttff;         /* search start to accepted fix */
+};
+
+/*
+ * Picks when gpsTask acquires the next fix and when a search may stop.
+ * Speed, course change and displacement from the previous fix set the
+ * interval: seconds while riding, backing off to minutes while parked.
+ * The expected start mode follows from how old the last fix is (restored
+ * across deep sleep by BootState), and time-to-first-fix is recorded per
+ * start mode.
+ */
+class GnssScheduler {
+public:
+    GnssScheduler();
+
+    void restore(const GnssRecord_t& rec, uint32_t ageMs, uint32_t nowMs, bool receiverKept);
+    void receiverReset();
+
+    GnssStartMode beginSearch(uint32_t nowMs, bool tracking);
+    bool acceptable(const GnssRecord_t& rec, uint32_t nowMs) const;
+    bool searchExpired(uint32_t nowMs) const;
+    void fixAccepted(const GnssRecord_t& rec, uint32_t nowMs);
+    void searchFailed(uint32_t nowMs);
+    void extendInterval(uint32_t ms);
+
+    uint32_t nextIntervalMs() const;
+    uint32_t pollIntervalMs() const;
+    bool keepReceiverOn() const;
+    bool parked() const;
+
+    void getStats(GnssStartMode mode, GnssTtffStats_t* stats) const;
+    void printStats(Print& out) const;
+
+protected:
+    uint32_t searchBudgetMs() const;
+
+    bool haveFix;
+    uint32_t lastFixMs;
+    int32_t lastLatE6;
+    int32_t lastLonE6;
+    uint16_t lastCourseX100;
+    bool ephemerisLost;       /* modem power cycled since the last fix: no hot start */
+
+    uint32_t searchStartMs;
+    GnssStartMode searchMode;
+    bool searching;
+    bool tracking;
+
+    uint32_t intervalMs;
+    bool isParked;
+    bool turning;             /* course changed at the last fix */
+    GnssTtffStats_t ttff[GNSS_START_HOT + 1];
+};
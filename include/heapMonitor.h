@@ -0,0 +1,91 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*
+ * Counting heap allocations needs the allocator wrapped at link time:
+ *   -DHEAP_ALLOC_TRACKING=1 -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc
+ * (the ttgo-t-sim7070g-heapcheck environment). free() is not wrapped: only allocations are
+ * counted. Heap levels are reported either way.
+ */
+#ifndef HEAP_ALLOC_TRACKING
+#define HEAP_ALLOC_TRACKING 0
+#endif
+/* Stop in configASSERT() on a heap allocation in a steady-state task iteration */
+#ifndef HEAP_ASSERT_STEADY
+#define HEAP_ASSERT_STEADY 0
+#endif
+
+#define HEAP_WATCHED_TASKS    6
+#define HEAP_SAMPLES          24        /* heap level history */
+#define HEAP_SAMPLE_PERIOD_MS 300000    /* 24 samples cover 2 hours */
+#define HEAP_WARMUP_MS        60000     /* allocations before this are start-up, not steady state */
+
+struct HeapSample_t {
+    uint32_t uptimeS;
+    uint32_t freeBytes;
+    uint32_t minFreeBytes;    /* low-water mark since boot */
+    uint32_t largestBlock;    /* largest allocatable block */
+};
+
+struct HeapTaskStats_t {
+    const char* name;
+    TaskHandle_t task;
+    uint32_t allocs;          /* malloc/calloc/realloc calls made by the task */
+    uint32_t iterations;      /* steady-state loop iterations checked */
+    uint32_t dirtyIterations; /* of those, iterations that allocated */
+};
+
+/*
+ * Heap level and allocation monitor. sample() records free heap, low-water
+ * mark and largest free block periodically, so fragmentation can be followed
+ * over weeks of uptime. Tasks that must not allocate once running register
+ * with watchTask() and bracket each loop iteration with a HeapLoopCheck.
+ * The stack high-water mark of every registered task is reported as well.
+ */
+class HeapMonitor {
+public:
+    HeapMonitor();
+
+    static int watchTask(const char* name);
+    static uint32_t taskAllocs(int slot);
+    static void loopChecked(int slot, bool allocated);
+    static void countAlloc();
+    static uint8_t watchedTasks();
+    static const char* taskName(int slot);
+    static uint32_t stackFree(int slot);
+
+    void sample(uint32_t nowMs);
+    void printStats(Print& out);
+
+    static void read(HeapSample_t* s, uint32_t nowMs);
+    static uint8_t fragmentation(const HeapSample_t& s);
+
+protected:
+
+    static HeapTaskStats_t tasks[HEAP_WATCHED_TASKS];
+    static volatile uint8_t taskCount;
+    static volatile uint32_t totalAllocs;
+
+    HeapSample_t samples[HEAP_SAMPLES];
+    uint8_t sampleHead;
+    uint8_t sampleCount;
+    uint32_t lastSampleMs;
+};
+
+/*
+ * One loop iteration of a watched task: counts its allocations in steady state.
+ */
+class HeapLoopCheck {
+public:
+    explicit HeapLoopCheck(int slot) : slot(slot), start(HeapMonitor::taskAllocs(slot)) {}
+
+    ~HeapLoopCheck() {
+        HeapMonitor::loopChecked(slot, HeapMonitor::taskAllocs(slot) != start);
+    }
+
+private:
+    int slot;
+    uint32_t start;
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <Arduino.h>
+
+/*
+ * Bucket 0 counts 0 ms, bucket i counts [2^(i-1), 2^i) ms, the last bucket
+ * everything from 2^(HISTOGRAM_BUCKETS-2) ms (about 4.4 minutes) up.
+ */
+#define HISTOGRAM_BUCKETS  20
+
+/*
+ * Fixed-size latency distribution in milliseconds. Recording is a few
+ * instructions and never allocates; percentiles are read back as the upper
+ * edge of the bucket they fall in, so they are exact to within a factor of two.
+ */
+struct Histogram_t {
+    uint32_t count;
+    uint32_t totalMs;
+    uint32_t minMs;
+    uint32_t maxMs;
+    uint32_t buckets[HISTOGRAM_BUCKETS];
+};
+
+void HistogramAdd(Histogram_t* h, uint32_t ms);
+void HistogramMerge(Histogram_t* dst, const Histogram_t& src);
+uint32_t HistogramAvg(const Histogram_t& h);
+uint32_t HistogramPercentile(const Histogram_t& h, uint8_t pct);
+void HistogramPrint(Print& out, const char* label, const Histogram_t& h);
@@ -1,8 +1,11 @@
 #pragma once
 #include <Arduino.h>
-#define TINY_GSM_MODEM_SIM7070
-#define TINY_GSM_RX_BUFFER 1024
-#include <TinyGsmClient.h>
+#include <freertos/semphr.h>
+#include "gnssParser.h"
+#include "atEngine.h"
+#include "smsInbox.h"
+#include "modemUart.h"
+#include "fixedString.h"
 
 #define SerialMon Serial
 #define SerialAT Serial1
@@ -12,39 +15,124 @@
 #define MODEM_PIN_TX      27
 #define MODEM_PIN_RX      26
 #define MODEM_PWR_PIN     4
+/* Line that goes low when the sleeping modem has a URC or SMS. RI is not routed to the ESP32
+ * on the T-SIM7070G, so the start bit of the URC itself on RX serves as the ring */
+#define MODEM_PIN_RI      MODEM_PIN_RX
+
+/* Rate requested with AT+IPR once the modem answers, and the rates probed when it does not */
+#define MODEM_UART_TARGET_BAUD      921600
+#define MODEM_UART_BAUD_CANDIDATES  { MODEM_UART_TARGET_BAUD, 115200, 57600, MODEM_UART_BAUD }
+#define MODEM_UART_SWITCH_DELAY_MS  100
+/* AT+IPR attempts to bring the modem back from a rate the link does not carry */
+#define MODEM_UART_FALLBACK_ATTEMPTS 8
+/* After DTR goes low the modem answers AT within this */
+#define MODEM_WAKE_MS               50
+/* AT probe before the power key at boot: a modem kept on answers well within this */
+#define MODEM_BOOT_PROBE_MS         300
+
+class NetworkState;
+
+#define MODEM_IMEI_LEN    15
+
+/* MQTT session settings for the modem's client */
+struct MqttConfig_t {
+    const char* host;
+    uint16_t port;
+    const char* clientId;
+    const char* user;         /* NULL or "": no login */
+    const char* password;
+    const char* caFile;       /* CA certificate in the modem's file system; NULL for plain TCP */
+    uint16_t keepAliveS;
+};
+
+/* Registration, <stat> of +CREG/+CEREG; REG_NO_RESULT when nothing is known */
+typedef enum {
+    REG_NO_RESULT = -1,
+    REG_UNREGISTERED = 0,
+    REG_OK_HOME = 1,
+    REG_SEARCHING = 2,
+    REG_DENIED = 3,
+    REG_UNKNOWN = 4,
+    REG_OK_ROAMING = 5
+} RegStatus;
+
+/* GNSS receiver restart modes, from slowest to fastest time-to-first-fix */
+typedef enum {
+    GNSS_START_COLD,
+    GNSS_START_WARM,
+    GNSS_START_HOT
+} GnssStartMode;
+
+/* Timestamped result of a single +CGNSINF exchange or +UGNSINF report */
+struct GnssSample_t {
+    bool valid;               /* report parsed and modem reports a fix */
+    uint32_t timestampMs;     /* millis() when the report was received */
+    GnssRecord_t record;
+};
 
 class ModemMgr {
 public:
-    ModemMgr(TinyGsm& modem, HardwareSerial& serialMon, HardwareSerial& serialAT, int pwrPin, int dtrPin);
+    ModemMgr(AtEngine& at, ModemTransport* transport, HardwareSerial& serialMon, int pwrPin, int dtrPin);
     
     /* General SIM7070G modem functions */
     void init();
     void powerOn();
     void powerOff();
     void restart();
+    bool start(uint32_t baud);
     bool test();
     void awake();
+    void sleep();
+    bool sleepConfigure();
+    bool psmConfigure(bool enable, const char* periodicTau, const char* activeTime);
+    bool edrxConfigure(bool enable, const char* cycle);
+    bool negotiateBaud(uint32_t baud);
+    void uartBenchmark(uint16_t rounds);
+    uint32_t getBaud() const;
 
     /* SIM7070G GPS functions */
     void GpsEnable();
     void GpsDisable();
-    bool GpsGetFix();
-    void GpsGetLatLon(float* lat, float* lon);
+    bool GpsRestart(GnssStartMode mode);
+    bool GpsGetRecord(GnssRecord_t* rec);
+    bool GpsSample(GnssSample_t* sample);
+    bool GpsSetUrcReport(uint8_t intervalSec);
+    bool GpsReadUrc(GnssSample_t* sample, uint32_t timeoutMs);
 
     /* SIM7070G SIM card functions */
     bool isSimReady();
-    String simGetSignalQuality();
+    int simGetSignalQuality();
     bool simSetNetworkMode(int mode);
-    RegStatus simGetRegistrationStatus();
-    String simReadMessage();
-    void simSendMessage(const String& number, const String& message);
-    String simGetOperator();
+    RegStatus simGetRegistrationStatus(NetworkState& net);
+    bool simRefreshNetworkState(NetworkState& net, int mode);
+    bool simEnableNewMessageIndication();
+    int simFetchMessages(SmsInbox& inbox);
+    AtResult simSendMessage(const char* number, const char* message, int* messageRef, int* cmsError);
+    bool simGetOperator(char* name, size_t max);
+    bool simGetImei(char* imei, size_t max);
+
+    /* SIM7070G data functions: PDP context and built-in MQTT client */
+    bool dataAttach(const char* apn);
+    bool mqttConnect(const MqttConfig_t& config);
+    bool mqttPublish(const char* topic, const uint8_t* payload, size_t len, uint8_t qos);
+    void mqttDisconnect();
 
 protected:
-    TinyGsm& modem;
+    static void onGnssUrc(const char* line, size_t len, void* ctx);
+
+    bool probe(uint8_t attempts, uint32_t timeoutMs);
+    bool verifyBaud();
+    bool findBaud();
+
+    AtEngine& at;
+    ModemTransport* transport;
     HardwareSerial& serialMon;
-    HardwareSerial& serialAT;
     int pwrPin;
     int dtrPin;
+
+    /* Latest +UGNSINF report, written by the AT engine task */
+    portMUX_TYPE gnssUrcLock;
+    GnssSample_t gnssUrcSample;
+    SemaphoreHandle_t gnssUrcReady;
 };
 
@@ -0,0 +1,48 @@
+#pragma once
+#include <Arduino.h>
+
+/* IDF driver RX ring buffer, filled from the UART interrupt */
+#define MODEM_UART_RX_BUFFER_LEN  4096
+
+/*
+ * Byte stream to the modem whose host-side baud rate can be changed at run
+ * time, so the modem manager can follow an AT+IPR switch.
+ */
+class ModemTransport : public Stream {
+public:
+    virtual bool setBaud(uint32_t baud) = 0;
+    virtual uint32_t getBaud() const = 0;
+    /* DTR as driven by the host; a real UART leaves it to its GPIO */
+    virtual void setDtr(bool high) { (void)high; }
+};
+
+/*
+ * Modem UART. Received bytes are moved by the UART interrupt into the driver's
+ * ring buffer and handed out in bulk through readBytes(), so the AT engine
+ * drains a whole response per call instead of one byte at a time.
+ */
+class ModemUart : public ModemTransport {
+public:
+    ModemUart(HardwareSerial& serial, int rxPin, int txPin);
+
+    void begin(uint32_t baud);
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t readBytes(char* buf, size_t len) override;
+    using Stream::readBytes;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t len) override;
+    void flush() override;
+    using Print::write;
+
+    bool setBaud(uint32_t baud) override;
+    uint32_t getBaud() const override;
+
+protected:
+    HardwareSerial& serial;
+    int rxPin;
+    int txPin;
+    uint32_t baud;
+};
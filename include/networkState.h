@@ -0,0 +1,66 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "atEngine.h"
+#include "modemMgr.h"
+
+#define NET_OPERATOR_MAX_LEN  24
+
+/* Access technology, <AcT> of +CREG/+CEREG */
+typedef enum {
+    NET_ACT_UNKNOWN = -1,
+    NET_ACT_GSM = 0,
+    NET_ACT_EGPRS = 3,
+    NET_ACT_CATM = 7,
+    NET_ACT_NBIOT = 9
+} NetAccessTech;
+
+struct NetworkStats_t {
+    uint32_t refreshes;       /* full re-queries of SIM, mode, registration and operator */
+    uint32_t urcs;            /* +CREG/+CEREG/+CPIN indications applied */
+    uint32_t invalidations;   /* errors that forced a refresh */
+};
+
+/*
+ * Cached SIM and network registration state. SIM status, network mode and
+ * operator are queried once by ModemMgr::simRefreshNetworkState(); after
+ * that +CREG (2G) and +CEREG (LTE-M / NB-IoT) indications keep registration
+ * current without polling. An error on the cellular side calls invalidate(),
+ * which makes the next iteration query everything again.
+ */
+class NetworkState {
+public:
+    NetworkState();
+
+    bool begin(AtEngine& at);
+    bool needsRefresh() const;
+    void invalidate();
+    void restore(RegStatus status);
+
+    void parseUrc(const char* line, size_t len);
+    void parseRegistration(bool eps, const char* text, size_t len, bool urc);
+    void setSimReady(bool ready);
+    void setOperator(const char* name);
+    void refreshed();
+
+    bool simReady() const;
+    RegStatus registration() const;
+    bool registered() const;
+    NetAccessTech accessTech() const;
+    void getOperator(char* out, size_t max);
+
+    void getStats(NetworkStats_t* stats);
+    void printStats(Print& out);
+
+protected:
+    static void onUrc(const char* line, size_t len, void* ctx);
+
+    portMUX_TYPE lock;
+    volatile bool valid;
+    volatile bool sim;
+    volatile RegStatus cregStatus;    /* circuit-switched, 2G */
+    volatile RegStatus ceregStatus;   /* EPS, LTE-M / NB-IoT */
+    volatile NetAccessTech act;
+    char operatorName[NET_OPERATOR_MAX_LEN];
+    NetworkStats_t stats;
+};
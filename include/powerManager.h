@@ -0,0 +1,111 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "modemMgr.h"
+#include "rfArbiter.h"
+
+/*
+ * Current model, microamps at the battery. Modem figures from the SIM7070G
+ * hardware design guide (LTE-M, registered), ESP32 at its default clock with
+ * WiFi and Bluetooth off. Only used for the energy estimate.
+ */
+#define POWER_MODEM_ACTIVE_UA   10000   /* UART awake, DRX 1.28 s, averaged over the odd transmission */
+#define POWER_MODEM_SLEEP_UA    1200    /* AT+CSCLK=1 and DTR high */
+#define POWER_MODEM_EDRX_UA     400     /* sleep with a 20 s eDRX cycle */
+#define POWER_MODEM_PSM_UA      10
+#define POWER_GNSS_UA           31000   /* receiver tracking, on top of the modem state */
+#define POWER_MCU_ACTIVE_UA     22000
+#define POWER_MCU_SLEEP_UA      800     /* light sleep with timer, GPIO and UART wake-up */
+#define POWER_BOARD_UA          600     /* regulators, charger and idle SD card */
+/* 18650 cell in the board's holder */
+#define POWER_BATTERY_MAH       3000
+
+/* Light sleep length: the RTOS tick stops, so a task timing out inside a sleep runs up to this late */
+#define POWER_LIGHT_SLEEP_MAX_MS  2000
+#define POWER_LIGHT_SLEEP_MIN_MS  20
+/* Console input wakes the MCU after this many edges; the first character is lost */
+#define POWER_CONSOLE_WAKE_EDGES  3
+
+/* A modem that refused AT+CSCLK is asked again this often */
+#define POWER_CONFIG_RETRY_MS   30000
+
+typedef enum {
+    MODEM_POWER_ACTIVE,       /* DTR low: AT traffic possible */
+    MODEM_POWER_SLEEP,        /* DTR high, paged every DRX cycle */
+    MODEM_POWER_EDRX,         /* DTR high, eDRX accepted */
+    MODEM_POWER_PSM,          /* DTR high, PSM accepted: unreachable until the periodic update */
+    MODEM_POWER_STATES
+} ModemPowerState;
+
+struct PowerStats_t {
+    uint64_t modemMs[MODEM_POWER_STATES];
+    uint64_t gnssMs;          /* receiver on */
+    uint64_t mcuSleepMs;      /* light sleep, as measured around each sleep */
+    uint64_t totalMs;
+    uint32_t modemWakes;
+    uint32_t mcuSleeps;
+    uint32_t rings;           /* modem sleep periods in which its RX (ring) line went low */
+};
+
+/*
+ * Puts the modem and the ESP32 to sleep whenever nobody needs them. The
+ * modem is awake while gpsTask or cellularTask holds or waits for the radio
+ * (RfArbiter busy hook), otherwise DTR lets it sleep, with eDRX or PSM
+ * negotiated with the network on top. While the modem sleeps and the caller
+ * has nothing queued, lightSleep() enters ESP32 light sleep explicitly with
+ * esp_light_sleep_start() until a timer, the modem's RX line or console input
+ * wakes it. The ring line is the RX line, so the first falling edge of a
+ * modem sleep period counts as its one ring and asks cellularTask to read the
+ * SIM, in case the +CMTI was lost while the modem or the MCU woke up. Time
+ * per state is measured at each transition, light sleep around each sleep,
+ * and turned into an energy estimate with the current model.
+ */
+class PowerManager {
+public:
+    PowerManager(ModemMgr& modem, AtEngine& at, RfArbiter& arbiter);
+
+    bool begin(bool lightSleep);
+    void setNetworkSaving(const char* edrxCycle, const char* psmPeriodicTau, const char* psmActiveTime);
+
+    bool configDue(uint32_t nowMs);
+    bool configureModem();
+    void modemRestarted();
+    void setGnss(bool on);
+    bool takeRing();
+    uint32_t lightSleep(uint32_t maxMs);
+
+    static void onRadioBusy(void* ctx);
+    static void ring(void* ctx);
+
+    void getStats(PowerStats_t* stats);
+    static uint32_t averageUa(const PowerStats_t& stats);
+    void printStats(Print& out);
+
+protected:
+    void update();
+    void accountLocked(uint32_t nowMs);
+
+    ModemMgr& modem;
+    AtEngine& at;
+    RfArbiter& arbiter;
+    const char* edrxCycle;        /* NULL: eDRX off */
+    const char* psmPeriodicTau;   /* NULL: PSM off */
+    const char* psmActiveTime;
+
+    SemaphoreHandle_t lock;
+    bool lightSleepOn;
+    bool sleepReady;              /* AT+CSCLK=1 accepted since the last power cycle */
+    bool edrxOn;
+    bool psmOn;
+    bool gnssOn;
+    uint32_t lastConfigMs;
+    bool configTried;
+    ModemPowerState modemState;
+    uint32_t lastAccountMs;
+    volatile bool ringPending;    /* set from the ring interrupt */
+    volatile bool rang;           /* this modem sleep period was counted as a ring */
+    volatile uint32_t ringCount;
+
+    PowerStats_t stats;
+};
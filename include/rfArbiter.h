@@ -0,0 +1,76 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "histogram.h"
+
+/* Users of the shared SIM7070G RF front end */
+typedef enum {
+    RF_CLIENT_GNSS,
+    RF_CLIENT_CELLULAR,
+    RF_CLIENT_COUNT,
+    RF_CLIENT_NONE = RF_CLIENT_COUNT
+} RfClient;
+
+/* Called after every grant and release, outside the arbiter lock */
+typedef void (*RfBusyHook)(void* ctx);
+
+/* Slice priorities, higher value wins */
+#define RF_PRIO_CELL_BACKGROUND  (1)
+#define RF_PRIO_GNSS             (2)
+#define RF_PRIO_SMS_REPLY        (3)
+
+/* Granularity at which a slice owner notices an overdue waiter */
+#define RF_PREEMPT_POLL_MS       (100)
+
+struct RfClientStats_t {
+    uint32_t grants;
+    uint32_t preemptions;
+    Histogram_t wait;         /* acquire() to grant */
+    Histogram_t hold;         /* grant to release() */
+};
+
+/*
+ * Hands the radio to GNSS or cellular in time slices. A waiter with a higher
+ * priority, or one whose deadline has passed, asks the current owner to yield;
+ * the owner gives the radio up at its next clean boundary (waitPreempt()).
+ * On release the radio goes to the most overdue waiter, otherwise to the
+ * highest priority one, ties broken by earliest deadline.
+ */
+class RfArbiter {
+public:
+    RfArbiter();
+
+    bool begin();
+    bool acquire(RfClient client, uint8_t priority, uint32_t deadlineMs);
+    void release(RfClient client);
+    bool yieldRequested(RfClient client);
+    bool waitPreempt(RfClient client, TickType_t ticks);
+    bool busy();
+    void setBusyHook(RfBusyHook hook, void* ctx);
+
+    void getStats(RfClient client, RfClientStats_t* stats);
+    void printStats(Print& out);
+
+protected:
+    struct RfRequest_t {
+        bool waiting;
+        uint8_t priority;
+        uint32_t deadlineMs;
+        uint32_t waitStartMs;
+    };
+
+    bool outranksOwnerLocked(const RfRequest_t* req, uint32_t now) const;
+    RfClient pickNextLocked(uint32_t now) const;
+    void grantLocked(RfClient client, uint32_t now);
+
+    portMUX_TYPE lock;
+    SemaphoreHandle_t grantSem[RF_CLIENT_COUNT];
+    SemaphoreHandle_t preemptSem[RF_CLIENT_COUNT];
+    RfRequest_t requests[RF_CLIENT_COUNT];
+    RfClientStats_t stats[RF_CLIENT_COUNT];
+    RfClient owner;
+    uint32_t grantedAtMs;
+    RfBusyHook busyHook;
+    void* busyHookCtx;
+};
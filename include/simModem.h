@@ -0,0 +1,186 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "modemUart.h"
+
+#ifndef MODEM_SIMULATED
+#define MODEM_SIMULATED 0
+#endif
+
+#define SIM_MODEM_OUT_BUF_LEN     2048
+#define SIM_MODEM_SEGMENTS        16
+#define SIM_MODEM_CMD_MAX_LEN     128
+#define SIM_MODEM_LATENCY_RULES   8
+#define SIM_MODEM_SMS_SLOTS       8
+#define SIM_MODEM_FIX_SCRIPT_LEN  32
+#define SIM_MODEM_PAYLOAD_LEN     512  /* longest SMS text or MQTT publish */
+#define SIM_MODEM_DEFAULT_LATENCY_MS  20
+#define SIM_MODEM_POWER_ON_BAUD       9600
+#define SIM_MODEM_BIT_ERROR_PERIOD    8    /* above the link limit, one byte in N is corrupted on average */
+#define SIM_MODEM_BIT_ERROR_SEED      0x2545F491UL
+#define SIM_MODEM_IMEI                "869951030070700"
+
+#define SIM_SCENARIO_TASK_STACK_SIZE  (3072)
+#define SIM_SCENARIO_TASK_PRIORITY    (1)
+
+struct SimModemStats_t {
+    uint32_t exchanges;          /* AT commands answered */
+    uint32_t bytesIn;            /* bytes written by the host */
+    uint32_t bytesOut;           /* bytes delivered to the host */
+    uint32_t smsRequests;        /* SMS injected by the scenario */
+    uint32_t smsReplies;         /* replies sent back to a requester */
+    uint32_t replyLatencyMinMs;
+    uint32_t replyLatencyMaxMs;
+    uint32_t replyLatencyTotalMs;
+    uint32_t wireInUs;           /* time the host bytes spent on the UART */
+    uint32_t wireOutUs;          /* time the modem bytes spent on the UART */
+    uint32_t garbledBytes;       /* bytes lost to a host/modem baud mismatch */
+    uint32_t mqttSessions;       /* MQTT connections accepted by the stand-in broker */
+    uint32_t mqttPublishes;
+    uint32_t mqttBytes;          /* publish payload bytes */
+    uint32_t sleepDrops;         /* command lines sent while the modem slept, lost */
+    uint32_t rings;              /* ring pulses raised while asleep */
+};
+
+/*
+ * Scriptable SIM7070G stand-in behind the Stream interface the AT engine uses.
+ * It answers the commands the firmware issues with configurable per-command
+ * latency, plays back a fix/no-fix script for +CGNSINF and keeps a small SIM
+ * SMS store so request-to-reply time can be measured without the board's modem.
+ * Its MQTT client (+SMCONN/+SMPUB) doubles as a local broker stand-in that logs
+ * every publish; setDataLink(false) drops the session as a lost bearer would.
+ * After AT+CSCLK=1 it sleeps while DTR is high: command lines are lost, and
+ * a new SMS pulses the ring callback in place of the RI line.
+ * Bytes take their 8N1 wire time at the modem's baud rate, which AT+IPR changes;
+ * while the host UART runs at a different rate the bytes arrive garbled.
+ */
+class SimModem : public ModemTransport {
+public:
+    explicit SimModem(Print& log);
+
+    /* Stream interface */
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t readBytes(char* buf, size_t len) override;
+    using Stream::readBytes;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t len) override;
+    using Print::write;
+
+    /* Host UART side of the link */
+    bool setBaud(uint32_t baud) override;
+    uint32_t getBaud() const override;
+    void setDtr(bool high) override;
+
+    /* Scenario control */
+    bool setLatency(const char* cmdPrefix, uint32_t ms);
+    void setFixScript(const char* script);
+    void setTrack(int32_t latE6, int32_t lonE6, int32_t stepLatE6, int32_t stepLonE6, uint16_t speedKmhX100);
+    void setRegistration(int status);
+    void setLinkLimit(uint32_t maxBaud);
+    void setDataLink(bool up);
+    bool injectSms(const char* sender, const char* text);
+    void failSms(uint8_t count);
+    void startScenario(uint32_t smsPeriodMs, uint8_t burst, const char* sender);
+    void setRingCallback(void (*cb)(void* ctx), void* ctx);
+
+    void getStats(SimModemStats_t* stats);
+    void printStats(Print& out);
+
+protected:
+    struct Segment_t {
+        uint16_t len;            /* bytes not yet read */
+        uint16_t total;
+        uint32_t releaseUs;      /* first byte on the wire */
+        uint32_t byteUs;         /* wire time per byte */
+        uint32_t baud;           /* modem rate the segment was sent at */
+    };
+    struct LatencyRule_t {
+        char prefix[16];
+        uint32_t ms;
+    };
+    struct StoredSms_t {
+        bool used;
+        bool read;
+        char sender[24];
+        char text[161];
+        uint32_t injectedMs;
+    };
+
+    static void scenarioTask(void* pvParameters);
+
+    static uint32_t byteTimeUs(uint32_t baud);
+    bool noiseHit();
+
+    void handleCommand(const char* cmd, uint32_t inputUs);
+    void handlePayload(uint32_t inputUs);
+    void handlePublish(uint32_t inputUs);
+    uint32_t latencyFor(const char* cmd) const;
+    size_t deliverable();
+    uint8_t take();
+    void respond(uint32_t delayUs, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+    void emit(uint32_t delayUs, const char* data, size_t len);
+    size_t formatGnss(char* out, size_t max, bool fix);
+
+    Print& log;
+    portMUX_TYPE lock;
+
+    /* Modem -> host bytes, released per segment once their latency elapsed */
+    uint8_t outBuf[SIM_MODEM_OUT_BUF_LEN];
+    size_t outHead;
+    size_t outTail;
+    size_t outUsed;
+    Segment_t segments[SIM_MODEM_SEGMENTS];
+    uint8_t segHead;
+    uint8_t segCount;
+    uint32_t wireFreeUs;
+
+    /* UART rates: host side set by setBaud(), modem side by AT+IPR */
+    uint32_t hostBaud;
+    uint32_t modemBaud;
+    uint32_t linkLimitBaud;
+    uint32_t lineNoise;       /* xorshift state picking the bytes corrupted above the link limit */
+
+    /* Host -> modem command assembly */
+    char cmdBuf[SIM_MODEM_CMD_MAX_LEN];
+    size_t cmdLen;
+    uint32_t cmdWireUs;
+    bool payloadMode;
+    char payloadNumber[24];
+    char payloadTopic[32];
+    char payloadBuf[SIM_MODEM_PAYLOAD_LEN + 1];
+    size_t payloadLen;
+    size_t payloadExpect;     /* +SMPUB length; 0 for SMS text ended by Ctrl+Z */
+
+    LatencyRule_t latencyRules[SIM_MODEM_LATENCY_RULES];
+    uint8_t latencyRuleCount;
+
+    char fixScript[SIM_MODEM_FIX_SCRIPT_LEN + 1];
+    uint8_t fixScriptPos;
+    bool gnssOn;
+    int32_t latE6;
+    int32_t lonE6;
+    int32_t stepLatE6;
+    int32_t stepLonE6;
+    uint16_t speedKmhX100;
+    int regStatus;
+    uint8_t cregMode;         /* <n> of AT+CREG / AT+CEREG: 0 silent, 1 <stat>, 2 with location and AcT */
+    uint8_t ceregMode;
+    bool dataLink;            /* bearer available; false refuses PDP and MQTT */
+    bool pdpActive;
+    bool mqttSession;
+    volatile bool dtrHigh;
+    bool sleepEnabled;        /* AT+CSCLK=1 */
+    void (*ringCb)(void* ctx);
+    void* ringCtx;
+
+    StoredSms_t sms[SIM_MODEM_SMS_SLOTS];
+    uint8_t messageRef;
+    uint8_t smsFailures;      /* AT+CMGS attempts still to be refused */
+
+    SimModemStats_t stats;
+    uint32_t scenarioPeriodMs;
+    uint8_t scenarioBurst;
+    const char* scenarioSender;
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "atEngine.h"
+
+#define SMS_INBOX_DEPTH      8
+#define SMS_TEXT_MAX_LEN     160
+#define SMS_NUMBER_MAX_LEN   24
+
+struct SmsMessage_t {
+    uint16_t index;                        /* storage index on the SIM */
+    char sender[SMS_NUMBER_MAX_LEN];
+    char text[SMS_TEXT_MAX_LEN + 1];
+    uint32_t receivedMs;                   /* millis() when read from the SIM */
+};
+
+/*
+ * Fixed-size ring of received SMS. New-message indications (+CMTI) only
+ * raise a pending flag; the cellular task then reads every stored message
+ * with one AT+CMGL pass, which feeds the ring through parseListLine().
+ */
+class SmsInbox {
+public:
+    SmsInbox();
+
+    bool begin(AtEngine& at);
+    bool hasPending() const;
+    bool waitPending(TickType_t ticks);
+    void clearPending();
+    void requestFetch();
+
+    void beginListing();
+    void parseListLine(const char* line, size_t len);
+    bool endListing();
+    uint8_t listedIndexes(uint16_t* indexes, uint8_t max) const;
+
+    bool pop(SmsMessage_t* msg);
+    uint8_t count() const;
+
+protected:
+    static void onCmti(const char* line, size_t len, void* ctx);
+
+    SmsMessage_t ring[SMS_INBOX_DEPTH];
+    volatile uint8_t head;
+    volatile uint8_t tail;
+    volatile uint8_t used;
+
+    /* State of the AT+CMGL pass in progress */
+    SmsMessage_t* listing;
+    bool listOverflow;
+    uint8_t listStart;
+    uint8_t listCount;
+
+    volatile bool pending;
+    SemaphoreHandle_t pendingSem;
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "smsInbox.h"
+
+#define SMS_OUTBOX_SLOTS        12       /* queued and recently finished replies */
+#define SMS_COALESCE_WINDOW_MS  30000    /* a repeat request this soon after its reply is answered by it */
+#define SMS_SEND_BATCH          3        /* replies sent per radio grant */
+#define SMS_MAX_ATTEMPTS        4
+#define SMS_RETRY_MIN_MS        10000    /* doubled after each failed attempt */
+#define SMS_RETRY_MAX_MS        120000
+
+/* Coalescing tags: replies to the same number with the same tag merge, 0 never does */
+#define SMS_TAG_NONE            0        /* also used for geofence alerts, queued by gpsTask */
+#define SMS_TAG_LOCATION        1
+#define SMS_TAG_STATS           2
+#define SMS_TAG_TRIP            3
+#define SMS_TAG_HISTORY         16       /* + part number */
+
+/* +CMS ERROR code for a timed-out attempt */
+#define SMS_ERROR_TIMEOUT       (-1)
+
+typedef enum {
+    SMS_OUT_FREE,
+    SMS_OUT_QUEUED,
+    SMS_OUT_SENT,
+    SMS_OUT_FAILED
+} SmsOutState;
+
+struct SmsOutMessage_t {
+    SmsOutState state;
+    uint8_t tag;
+    uint8_t attempts;
+    uint16_t coalesced;                    /* duplicate requests merged into this reply */
+    int16_t messageRef;                    /* <mr> from +CMGS, -1 until sent */
+    int16_t error;                         /* last +CMS ERROR code, SMS_ERROR_TIMEOUT, or 0 */
+    uint32_t seq;                          /* queue order */
+    uint32_t requestedMs;                  /* first request, kept when coalesced */
+    uint32_t nextTryMs;
+    uint32_t doneMs;
+    char number[SMS_NUMBER_MAX_LEN];
+    char text[SMS_TEXT_MAX_LEN + 1];
+};
+
+struct SmsOutboxStats_t {
+    uint32_t requested;
+    uint32_t coalesced;                    /* requests merged into a queued or recent reply */
+    uint32_t dropped;                      /* requests refused with every slot queued */
+    uint32_t sent;
+    uint32_t retries;
+    uint32_t failed;                       /* given up after SMS_MAX_ATTEMPTS or a permanent error */
+    uint32_t latencyMinMs;                 /* request to +CMGS confirmation */
+    uint32_t latencyMaxMs;
+    uint32_t latencyTotalMs;
+};
+
+/*
+ * Outbound SMS queue. cellularTask queues replies as it reads requests and
+ * sends up to SMS_SEND_BATCH of them per radio grant, so a burst of requests
+ * cannot hold the modem. A reply to the same number and tag as one still
+ * queued replaces its text; one delivered within SMS_COALESCE_WINDOW_MS
+ * answers the repeat request. Failed attempts retry with backoff; the slot
+ * keeps the message reference, attempts and latency for the SMS report.
+ */
+class SmsOutbox {
+public:
+    SmsOutbox();
+
+    bool enqueue(const char* number, uint8_t tag, const char* text, uint32_t nowMs);
+    bool due(uint32_t nowMs);
+
+    SmsOutMessage_t* next(uint32_t nowMs);
+    void sent(SmsOutMessage_t* msg, int messageRef, uint32_t nowMs);
+    void failed(SmsOutMessage_t* msg, int error, uint32_t nowMs);
+
+    void getStats(SmsOutboxStats_t* stats);
+    void printStats(Print& out);
+
+protected:
+    static bool permanentError(int error);
+    SmsOutMessage_t* find(const char* number, uint8_t tag, uint32_t nowMs);
+    SmsOutMessage_t* allocate();
+
+    portMUX_TYPE lock;
+    SmsOutMessage_t slots[SMS_OUTBOX_SLOTS];
+    uint32_t nextSeq;
+    SmsOutboxStats_t stats;
+};
@@ -1,4 +1,23 @@
 #include "modemMgr.h"
+#include "fixedString.h"
+#include "heapMonitor.h"
+#include "rfArbiter.h"
+#include "simModem.h"
+#include "atTrace.h"
+#include "fixPublisher.h"
+#include "trackStore.h"
+#include "trackCodec.h"
+#include "fixLog.h"
+#include "gnssScheduler.h"
+#include "bootState.h"
+#include "networkState.h"
+#include "smsOutbox.h"
+#include "uplink.h"
+#include "geofence.h"
+#include "trackFilter.h"
+#include "powerManager.h"
+#include "tripMeter.h"
+#include "trackExport.h"
 
 typedef enum {
     GPS_MODEM_TEST,
@@ -10,16 +29,48 @@ typedef enum {
 } GpsFixType;
 
 struct sysGpsData_t {
-    float latitude;
-    float longitude;
-    bool gps_fix_acquired;
+    bool gps_fix_acquired;    /* gpsTask state, not for other tasks */
     GpsFixType gpsFixStatus;
+    FixPublisher lastFix;     /* latest fix, readable from any task without the radio */
+    GnssScheduler schedule;   /* acquisition intervals and TTFF, gpsTask state */
+    TrackFilter filter;       /* smoothed position, updated by gpsTask, estimates for any task */
 };
 
+/* GNSS sampling: 0 polls +CGNSINF, >0 lets the modem push +UGNSINF every N seconds */
+#define GPS_URC_REPORT_INTERVAL_S  (0)
+#define GPS_URC_WAIT_MS            (3000)
+
 /* SMS text sent to target phone number: "GPS_MAP_URL" + "," + "latitude","longitude" */
 /* i.e.: "http://www.google.com/maps/place/20.558853,-103.428903" */
 #define GPS_MAP_URL "http://www.google.com/maps/place/"
 #define SMS_REQ_LOCATION "LOCATION"
+/* A LOCATION reply this long after the fix, while riding, gives the filter's estimate for now */
+#define LOCATION_PREDICT_AFTER_MS     (5000)
+
+/* While riding a steady line, fixes are spaced as far as the filter's estimate stays within this */
+#define TRACK_FILTER_STRETCH_ERROR_M  (40)
+
+/* "HISTORY [n]" returns the last n track points: a map link to the newest, then
+ * compact text (see trackCodec.h), about 20 points in the first SMS and 30 in each further one */
+#define SMS_REQ_HISTORY               "HISTORY"
+#define SMS_HISTORY_DEFAULT_POINTS    (40)
+#define SMS_HISTORY_MAX_POINTS        (120)
+#define SMS_HISTORY_MAX_MESSAGES      (5)
+
+/* Geofence commands, replied to with the fence list:
+ *   "FENCE" lists fences with their state (in/out),
+ *   "FENCE ADD name lat,lon radius_m" adds or replaces a circle,
+ *   "FENCE ADD name lat,lon lat,lon lat,lon ..." a polygon (as many vertices as fit in one SMS),
+ *   "FENCE DEL name" removes one.
+ * Entering or leaving a zone sends an alert to the configured number. */
+#define SMS_REQ_FENCE                 "FENCE"
+#define GEOFENCE_EVENTS_PER_FIX       (4)
+
+/* "STATS" returns one SMS of performance counters; STATS on the serial console prints them in full */
+#define SMS_REQ_STATS                 "STATS"
+
+/* "TRIP" returns the trip in progress (or the last one) and the totals since boot */
+#define SMS_REQ_TRIP                  "TRIP"
 
 /* freeRTOS tasks priorities and stack sizes */
 #define GPS_TASK_STACK_SIZE  (4096)
@@ -28,16 +79,83 @@ struct sysGpsData_t {
 #define GPS_TASK_PRIORITY    (2)
 #define SMS_TASK_PRIORITY    (1)
 
+/* Serial console rate; EXPORT may run a transfer faster */
+#define SERIAL_MON_BAUD      (115200)
+
+/* While unregistered, registration is re-queried this often in case an indication was missed */
+#define NET_REG_POLL_MS      (30000)
+/* cellularTask wakes this often without an SMS, for reply retries and the uplink timer */
+#define CELL_IDLE_POLL_MS    (1000)
+
+/* Power saving: the modem sleeps (DTR) between radio slices, and the ESP32 light sleeps while it
+ * does and no task has queued work. On top, eDRX makes the network page the modem once per cycle,
+ * so SMS replies may take one cycle longer. PSM (NULL: off) leaves it unreachable until the
+ * periodic update. */
+#define POWER_MCU_LIGHT_SLEEP  (1)
+#define POWER_EDRX_CYCLE       "0010"       /* 20.48 s; NULL: off */
+#define POWER_PSM_PERIODIC_TAU NULL         /* e.g. "00100001", 1 h */
+#define POWER_PSM_ACTIVE_TIME  "00000101"   /* 10 s */
+
+/* Batched position uplink over LTE-M data, through the modem's MQTT client. Off until a
+ * broker of your own is set: host, user name and password are all required. The session
+ * runs over TLS, checked against the CA certificate stored in the modem's file system
+ * (customer directory, AT+CFSWFILE) as UPLINK_TLS_CA_FILE; set UPLINK_TLS to 0 for a
+ * broker without it. Client ID and topic carry the modem's IMEI.
+ * AT commands are limited to AT_CMD_MAX_LEN: keep host, credentials and topic short. */
+#ifndef UPLINK_ENABLED
+#define UPLINK_ENABLED       (0)
+#endif
+#define UPLINK_APN           ""        /* "" keeps the APN configured in the modem */
+#define UPLINK_BROKER_HOST   ""        /* e.g. "mqtt.example.net" */
+#define UPLINK_BROKER_USER   ""
+#define UPLINK_BROKER_PASS   ""
+#define UPLINK_TLS           (1)
+#define UPLINK_TLS_CA_FILE   "ca.crt"
+#define UPLINK_BROKER_PORT   (UPLINK_TLS ? 8883 : 1883)
+#define UPLINK_CLIENT_ID_FMT "bike-%s"          /* %s: IMEI */
+#define UPLINK_TOPIC_FMT     "bike/%s/track"
+#define UPLINK_QOS           (1)
+#define UPLINK_KEEPALIVE_S   (600)     /* outlasts a GNSS slice; the modem sends the pings */
+
+/* Radio slice deadlines: how long each side may be kept waiting before it pre-empts the other */
+#define GPS_RF_DEADLINE_MS   (60000)
+#define CELL_RF_DEADLINE_MS  (30000)
+#define SMS_RF_DEADLINE_MS   (0)
+
+/* Position log on the board's micro SD slot, mounted in the VFS at /sd */
+#define FIX_LOG_ENABLED      (1)
+#define FIX_LOG_PATH         "/sd/fixlog.bin"
+#define FIX_LOG_BLOCKS       (2048)    /* 1 MB, about 34800 fixes */
+#define SD_PIN_MISO          2
+#define SD_PIN_MOSI          15
+#define SD_PIN_SCLK          14
+#define SD_PIN_CS            13
+
 #define TASK_CORE_0 (0)
 #define TASK_CORE_1 (1)
 
 struct sysCellData_t {
-    String target_number;
-    String msg_txt_sms;
-    String msg_lat_buf;
-    String msg_lon_buf;
+    FixedString<SMS_NUMBER_MAX_LEN> target_number;
+    FixedString<SMS_TEXT_MAX_LEN + 1> msg_txt_sms;
+    FixedString<16> msg_lat_buf;
+    FixedString<16> msg_lon_buf;
 };
 
+/* Simulated modem scenario (MODEM_SIMULATED builds): fix script, LOCATION request period,
+ * requests per burst (repeats are coalesced) and failed sends before the first reply goes out */
+#define SIM_SCENARIO_FIX_SCRIPT      "00001"
+#define SIM_SCENARIO_SMS_PERIOD_MS   (45000)
+#define SIM_SCENARIO_SMS_BURST       (2)
+#define SIM_SCENARIO_SMS_FAILURES    (1)
+/* Highest rate the simulated wiring carries cleanly, 0 for no limit (exercises the AT+IPR fallback) */
+#define SIM_SCENARIO_LINK_LIMIT_BAUD (0)
+
+/* Time +CGNSINF exchanges before and after the AT+IPR switch */
+#ifndef MODEM_UART_BENCHMARK
+#define MODEM_UART_BENCHMARK         (0)
+#endif
+#define MODEM_UART_BENCHMARK_ROUNDS  (20)
+
 #define USER_BLUE_LED_PIN 12
 #define TURN_OFF_LED() digitalWrite(USER_BLUE_LED_PIN, HIGH)
 #define TURN_ON_LED()  digitalWrite(USER_BLUE_LED_PIN, LOW)
@@ -45,6 +163,19 @@ struct sysCellData_t {
 
 struct sysAppData_t {
     ModemMgr* modemMgr;
+    RfArbiter* rfArbiter;
+    PowerManager* power;
+    SmsInbox* smsInbox;
+    SmsOutbox* smsOutbox;
+    NetworkState* netState;
+    Uplink* uplink;
+    TrackStore* trackStore;
+    Geofence* geofence;
+    TripMeter* tripMeter;
+    FixLog* fixLog;
+    TrackExport* trackExport;
+    BootState* bootState;
+    HeapMonitor* heapMonitor;
     sysGpsData_t* gpsData;
     sysCellData_t* cellData;
 };
@@ -0,0 +1,30 @@
+#pragma once
+#include <Arduino.h>
+#include "trackStore.h"
+
+/*
+ * Compact track text for SMS. Values are zigzag varints written in base 41
+ * with two 41-symbol halves of an 82-symbol alphabet: low digits come from
+ * the continuation half, the last (most significant) digit from the terminal
+ * half. All symbols are single GSM 03.38 septets, so a message keeps its
+ * 160 characters; basE91 would need '[', '^', '{', '~' and '`', which are
+ * escaped or missing in the GSM alphabet.
+ *
+ * Layout, newest point first so the oldest fall off when space runs out:
+ *   TRACK_CODEC_MARK <utc> <lat> <lon> { <dt> <dlat> <dlon> }
+ * utc counts seconds from TRACK_EPOCH_UNIX, lat/lon are 1e-5 degrees, dt is
+ * the (unsigned) step back in time and dlat/dlon the step to the older point.
+ * A moving bike costs about 5 characters per point. tools/track_decode.py
+ * turns the text back into points.
+ */
+#define TRACK_CODEC_MARK     "T1"
+#define TRACK_CODEC_RADIX    41
+
+size_t TrackEncodeCompact(const TrackPoint_t* points, size_t count, char* out, size_t max);
+
+/*
+ * Plain decimal track text, for readers without the decoder: the oldest
+ * point absolute as "YYMMDDhhmmss lat,lon", then ";dt,dlat,dlon" steps in
+ * seconds and 1e-5 degrees. Used for the uplink's MQTT payload.
+ */
+size_t TrackFormatDecimal(const TrackPoint_t* points, size_t count, char* out, size_t max);
@@ -0,0 +1,87 @@
+#pragma once
+#include <Arduino.h>
+#include "trackStore.h"
+#include "fixLog.h"
+
+/*
+ * Frame on the wire, little-endian:
+ *   0xA5 0x5A, type, seq (4), length (2), aux (2), CRC-16 of type..aux (2)
+ *   payload (length bytes), CRC-16 of the payload (2)
+ * The header CRC lets the receiver trust the length before waiting for the
+ * payload, and skip a log line printed by another task by looking for the
+ * next sync bytes. Sequence numbers are those of the stored blocks.
+ */
+#define EXPORT_SYNC0            0xA5
+#define EXPORT_SYNC1            0x5A
+#define EXPORT_HEADER_LEN       13
+#define EXPORT_TRAILER_LEN      2
+#define EXPORT_TYPE_START       'S'     /* seq: first to be sent; payload: newest seq (4) */
+#define EXPORT_TYPE_TRACK       'T'     /* TrackBlock_t data; aux: points */
+#define EXPORT_TYPE_LOG         'L'     /* fix log segment as on the device, up to its last valid record; aux: records */
+#define EXPORT_TYPE_MISSING     'M'     /* seq overwritten or never written: nothing to resume */
+#define EXPORT_TYPE_END         'E'     /* seq: where to resume; aux: 1 if stopped early */
+
+/* A transfer may run the console faster; the host follows after the text acknowledgement */
+#define EXPORT_MAX_BAUD         921600
+#define EXPORT_BAUD_SETTLE_MS   100
+
+typedef enum {
+    EXPORT_SOURCE_TRACK,
+    EXPORT_SOURCE_LOG
+} ExportSource;
+
+struct ExportStats_t {
+    ExportSource source;
+    bool running;
+    bool stopped;             /* ended by EXPORT STOP */
+    uint32_t baud;
+    uint32_t fromSeq;
+    uint32_t toSeq;
+    uint32_t nextSeq;         /* resume point once finished */
+    uint32_t frames;
+    uint32_t missing;
+    uint32_t bytes;           /* on the wire, framing included */
+    uint32_t startMs;
+    uint32_t elapsedMs;
+    uint32_t holdMaxUs;       /* longest hold of the track lock or the log device */
+};
+
+/*
+ * Bulk export of the stored track or fix log on the serial console, one
+ * stored block per frame. Track blocks are written from TrackStore's RAM in
+ * place: the lock is held only to compute the CRC, and a block recycled
+ * while it is on the wire fails the receiver's check. Log segments are read
+ * one at a time from the device, between writes of the log task. Resuming
+ * is restarting from a sequence number. Runs in the loop task, one frame per
+ * poll(); UART writes block the loop task only, so gpsTask and cellularTask
+ * keep their share of the CPU while the link runs flat out.
+ */
+class TrackExport {
+public:
+    TrackExport(HardwareSerial& port, uint32_t consoleBaud, TrackStore& track, FixLog& log);
+
+    bool start(ExportSource source, uint32_t fromSeq, uint32_t baud);
+    void stop();
+    bool poll();
+    bool running() const;
+
+    void printStats(Print& out);
+
+protected:
+    void writeFrame(uint8_t type, uint32_t seq, uint16_t aux, const uint8_t* payload, uint16_t len, uint16_t crc);
+    bool sendTrack(uint32_t seq);
+    bool sendLog(uint32_t seq);
+    void finish();
+    void noteHold(uint32_t startUs);
+
+    HardwareSerial& port;
+    uint32_t consoleBaud;
+    TrackStore& track;
+    FixLog& log;
+    ExportStats_t stats;
+    bool stopRequested;
+    uint8_t segment[FIX_LOG_BLOCK_LEN];
+};
+
+/* Frame header for the layout above, CRC included; also frames the AT trace dump */
+void ExportFrameHeader(uint8_t* header, uint8_t type, uint32_t seq, uint16_t aux, uint16_t len);
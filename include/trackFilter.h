@@ -0,0 +1,102 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "gnssParser.h"
+
+/* Measurement noise: position sigma is HDOP times the range error, never below the floor */
+#define TRACK_FILTER_UERE_CM          400
+#define TRACK_FILTER_POS_SIGMA_MIN_CM 200
+#define TRACK_FILTER_VEL_SIGMA_CMS    50        /* Doppler speed over ground */
+#define TRACK_FILTER_VEL_MIN_KMH_X100 200       /* course is noise below this: measured as standing still */
+/* Process noise: white acceleration of a bike, cm/s^2 */
+#define TRACK_FILTER_ACCEL_CMS2       25
+
+/* A fix is rejected further from the prediction than this many sigmas plus the distance a
+ * manoeuvre (a turn, braking) can add over the gap, or further from the last estimate than a bike goes */
+#define TRACK_FILTER_GATE_SIGMA       4
+#define TRACK_FILTER_MANEUVER_CMS2    200
+#define TRACK_FILTER_MAX_SPEED_CMS    2000      /* 72 km/h */
+/* After this many rejections in a row the filter restarts at the fix: the bike really moved */
+#define TRACK_FILTER_RESET_AFTER      3
+/* Longer gaps restart the filter; estimates are extrapolated up to TRACK_FILTER_PREDICT_MAX_MS */
+#define TRACK_FILTER_MAX_GAP_MS       600000
+#define TRACK_FILTER_PREDICT_MAX_MS   60000
+/* The origin of the local frame follows the bike once it is this far away */
+#define TRACK_FILTER_REANCHOR_CM      500000
+
+typedef enum {
+    TRACK_FILTER_ACCEPTED,
+    TRACK_FILTER_REJECTED,
+    TRACK_FILTER_RESTARTED    /* first fix, long gap or repeated rejections */
+} TrackFilterResult;
+
+/* Position predicted for a given time */
+struct TrackEstimate_t {
+    int32_t latE6;
+    int32_t lonE6;
+    uint32_t sigmaM;          /* one-sigma horizontal error */
+    uint32_t sinceFixMs;      /* extrapolated over this long */
+};
+
+struct TrackFilterStats_t {
+    uint32_t updates;
+    uint32_t rejected;
+    uint32_t restarts;
+    uint32_t updateTotalUs;
+    uint32_t updateMaxUs;
+    uint32_t correctionTotalCm;   /* distance between raw and filtered positions, summed */
+};
+
+/*
+ * Constant-velocity Kalman filter over GNSS samples, one position/velocity
+ * pair per axis in a local east/north frame in centimetres. Integer
+ * arithmetic only: gains are Q16, covariances 64-bit. Each sample updates
+ * with its position (noise from HDOP) and with the velocity from speed and
+ * course. A sample outside the gate or implying an impossible speed is
+ * rejected as multipath. Between fixes, estimate() extrapolates for up to
+ * TRACK_FILTER_PREDICT_MAX_MS and reports how far off that may be.
+ * gpsTask updates; any task may read an estimate.
+ */
+class TrackFilter {
+public:
+    TrackFilter();
+
+    TrackFilterResult update(const GnssRecord_t& rec, uint32_t nowMs, int32_t* latE6, int32_t* lonE6);
+    bool estimate(uint32_t nowMs, TrackEstimate_t* est);
+    uint32_t horizonMs(uint32_t maxErrorM);
+
+    void getStats(TrackFilterStats_t* stats);
+    void printStats(Print& out);
+
+protected:
+    struct Axis_t {
+        int32_t pos;          /* cm from the origin */
+        int32_t vel;          /* cm/s */
+        int64_t p00;          /* cm^2 */
+        int64_t p01;          /* cm^2/s */
+        int64_t p11;          /* cm^2/s^2 */
+    };
+
+    struct State_t {
+        bool valid;
+        uint32_t timeMs;
+        int32_t originLatE6;
+        int32_t originLonE6;
+        uint16_t lonScaleQ15;
+        uint8_t rejectedInRow;
+        Axis_t east;
+        Axis_t north;
+    };
+
+    static void predict(Axis_t* a, uint32_t dtMs);
+    static void updatePosition(Axis_t* a, int32_t z, int64_t r);
+    static void updateVelocity(Axis_t* a, int32_t z, int64_t r);
+    static void restart(State_t* s, const GnssRecord_t& rec, uint32_t nowMs);
+    static void toLocal(const State_t& s, int32_t latE6, int32_t lonE6, int64_t* east, int64_t* north);
+    static void toGlobal(const State_t& s, int32_t east, int32_t north, int32_t* latE6, int32_t* lonE6);
+    static void measuredVelocity(const GnssRecord_t& rec, int32_t* east, int32_t* north);
+
+    portMUX_TYPE lock;
+    State_t state;
+    TrackFilterStats_t stats;
+};
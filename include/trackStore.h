@@ -0,0 +1,81 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "gnssParser.h"
+
+/*
+ * Track history budget: TRACK_BLOCKS blocks of TRACK_BLOCK_LEN bytes in RAM,
+ * each mirrored to one NVS blob. A moving bike costs 4-5 bytes per point,
+ * so the default 8 KB holds roughly 1800 points.
+ */
+#define TRACK_BLOCK_LEN         256
+#define TRACK_BLOCKS            32
+#define TRACK_NVS_NAMESPACE     "track1"
+
+/* Coordinates are stored in 1e-5 degree steps (about 1.1 m) */
+#define TRACK_COORD_QUANT       10
+/* Points closer than this to the previous one are dropped unless TRACK_MAX_GAP_S passed */
+#define TRACK_MIN_MOVE_Q        2
+#define TRACK_MAX_GAP_S         600
+/* Head block is written to NVS every N points, and whenever it fills up */
+#define TRACK_PERSIST_EVERY     8
+
+/* Track timestamps count seconds from 2020-01-01 00:00:00 UTC */
+#define TRACK_EPOCH_UNIX        1577836800UL
+
+struct TrackPoint_t {
+    uint32_t utc;             /* seconds since TRACK_EPOCH_UNIX */
+    int32_t latE6;            /* degrees * 1e6, quantized to TRACK_COORD_QUANT */
+    int32_t lonE6;
+};
+
+/*
+ * One storage block: an absolute key point followed by varint deltas, so
+ * blocks decode independently and the oldest can be overwritten whole.
+ */
+struct TrackBlock_t {
+    uint32_t seq;             /* block sequence number, 0 if unused */
+    uint16_t used;            /* bytes of data in use */
+    uint16_t points;
+    uint8_t data[TRACK_BLOCK_LEN - 8];
+};
+
+/*
+ * Delta-encoded ring of past fixes that survives reboots. gpsTask appends,
+ * other tasks read the most recent points or whole blocks in place; all are
+ * serialised by a mutex.
+ */
+class TrackStore {
+public:
+    TrackStore();
+
+    bool begin();
+    bool append(const GnssRecord_t& rec);
+    size_t latest(TrackPoint_t* out, size_t max);
+
+    bool seqRange(uint32_t* oldest, uint32_t* newest);
+    const TrackBlock_t* lockBlock(uint32_t seq);
+    void unlockBlock();
+
+    static bool recordTime(const GnssRecord_t& rec, uint32_t* utc);
+
+protected:
+    static size_t decodeBlock(const TrackBlock_t* blk, TrackPoint_t* out, size_t skip, size_t max);
+    bool appendPoint(uint32_t utc, int32_t latQ, int32_t lonQ);
+    void startBlock();
+    void persist(uint8_t idx);
+
+    TrackBlock_t blocks[TRACK_BLOCKS];
+    uint8_t head;             /* block currently being filled */
+    uint32_t nextSeq;
+    uint8_t unsaved;          /* points appended since the head block was persisted */
+
+    /* Last appended point, quantized, for delta encoding */
+    bool haveLast;
+    uint32_t lastUtc;
+    int32_t lastLatQ;
+    int32_t lastLonQ;
+
+    SemaphoreHandle_t lock;
+};
@@ -0,0 +1,86 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "gnssParser.h"
+
+/* Standing still: slower than this and within the radius of the first fix at the spot */
+#define TRIP_STOP_SPEED_KMH_X100  300
+#define TRIP_STOP_RADIUS_M        30
+/* A standstill counts as a stop after this long, and ends the trip after this long */
+#define TRIP_STOP_MIN_MS          60000
+#define TRIP_END_DWELL_MS         300000
+/* Shorter trips are GNSS drift or the bike being moved around, and are forgotten */
+#define TRIP_MIN_DISTANCE_M       200
+/* Moving time credited for one fix gap at most: the receiver may have been off */
+#define TRIP_MAX_GAP_MS           120000
+
+/* One trip, in progress or finished */
+struct TripSummary_t {
+    bool active;              /* in progress */
+    bool stopped;             /* in progress and standing still at the last fix */
+    uint16_t startUtcMin;     /* minute of the UTC day the bike set off */
+    uint16_t endUtcMin;       /* finished: arrival at the final stop; in progress: last fix */
+    uint16_t stops;
+    uint16_t maxSpeedKmhX100;
+    uint32_t startMs;
+    uint32_t endMs;           /* finished: arrival; in progress: last fix */
+    uint32_t stillSinceMs;    /* stopped: arrival at the current spot */
+    uint32_t distanceM;
+    uint32_t movingMs;
+    uint32_t stoppedMs;       /* stops already left, summed */
+};
+
+struct TripTotals_t {
+    uint32_t trips;           /* finished since boot */
+    uint32_t distanceM;
+    uint32_t movingMs;
+    uint16_t maxSpeedKmhX100;
+    uint32_t updates;
+    uint32_t updateTotalUs;
+    uint32_t updateMaxUs;
+};
+
+/*
+ * Motion analytics over the accepted fixes, in constant memory: distance
+ * (equirectangular, cosine from the sine table), moving time, average and
+ * maximum speed, stops with their dwell time, and trips from the first
+ * moving fix to a standstill of TRIP_END_DWELL_MS. Distance only grows
+ * while moving, so jitter at a standstill adds nothing. gpsTask updates
+ * once per fix; the summaries are kept ready for any task to copy.
+ */
+class TripMeter {
+public:
+    TripMeter();
+
+    void update(const GnssRecord_t& rec, uint32_t nowMs);
+
+    bool current(TripSummary_t* trip);
+    bool last(TripSummary_t* trip);
+    void getTotals(TripTotals_t* totals);
+    void printStats(Print& out);
+
+protected:
+    void finishTrip();
+
+    /* gpsTask only */
+    bool haveFix;
+    int32_t lastLatE6;
+    int32_t lastLonE6;
+    uint32_t lastMs;
+    bool still;               /* standing still at the last fix */
+    int32_t anchorLatE6;      /* first fix at the current spot */
+    int32_t anchorLonE6;
+    uint32_t anchorMs;
+    uint16_t anchorUtcMin;
+    uint32_t tripCm;          /* distance of the trip in progress */
+    TripSummary_t trip;
+
+    /* Published after every update */
+    portMUX_TYPE lock;
+    TripSummary_t currentTrip;
+    TripSummary_t lastTrip;
+    bool haveLast;
+    TripTotals_t totals;
+};
+
+size_t TripFormat(char* out, size_t max, const TripSummary_t& trip, uint32_t nowMs);
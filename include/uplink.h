@@ -0,0 +1,68 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "atEngine.h"
+#include "trackStore.h"
+
+#define UPLINK_QUEUE_DEPTH     64       /* fixes waiting for upload; the oldest is dropped when full */
+#define UPLINK_BATCH_POINTS    16       /* publish once this many fixes are queued */
+#define UPLINK_MAX_DELAY_MS    120000   /* or once the oldest queued fix has waited this long */
+#define UPLINK_PAYLOAD_MAX     512
+#define UPLINK_BATCH_MAX_POINTS  40     /* more than fit in UPLINK_PAYLOAD_MAX */
+#define UPLINK_RETRY_MIN_MS    5000
+#define UPLINK_RETRY_MAX_MS    300000
+
+struct UplinkPoint_t {
+    TrackPoint_t point;
+    uint32_t queuedMs;        /* millis() when gpsTask queued it */
+};
+
+struct UplinkStats_t {
+    uint32_t queued;          /* fixes accepted from gpsTask */
+    uint32_t dropped;         /* fixes pushed out of a full queue */
+    uint32_t published;       /* fixes delivered to the broker */
+    uint32_t batches;         /* publishes */
+    uint32_t payloadBytes;
+    uint32_t connects;        /* sessions opened */
+    uint32_t failures;        /* failed connects or publishes */
+};
+
+/*
+ * Batched position uplink. gpsTask queues fixes without waiting; cellularTask
+ * publishes them in batches, as the decimal delta text of TrackFormatDecimal,
+ * over the modem's MQTT client once enough have queued or the oldest is old
+ * enough. The session stays open between batches and across GNSS slices;
+ * failures back off exponentially from UPLINK_RETRY_MIN_MS.
+ */
+class Uplink {
+public:
+    Uplink();
+
+    bool begin(AtEngine& at);
+    bool enqueue(const GnssRecord_t& rec);
+
+    bool due(uint32_t nowMs);
+    size_t nextBatch(char* out, size_t max, uint32_t* lastSeq);
+    void published(uint32_t lastSeq, size_t bytes);
+    void failed(uint32_t nowMs);
+
+    bool connected() const;
+    void setConnected(bool up);
+
+    void getStats(UplinkStats_t* stats);
+    void printStats(Print& out);
+
+protected:
+    static void onSessionUrc(const char* line, size_t len, void* ctx);
+
+    portMUX_TYPE lock;
+    UplinkPoint_t ring[UPLINK_QUEUE_DEPTH];
+    uint8_t head;             /* oldest queued fix */
+    uint8_t used;
+    uint32_t headSeq;         /* sequence number of ring[head] */
+
+    volatile bool session;
+    uint32_t retryAtMs;
+    uint32_t backoffMs;
+    UplinkStats_t stats;
+};
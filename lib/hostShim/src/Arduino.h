@@ -0,0 +1,124 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+/*
+ * Host stand-in for the parts of the Arduino-ESP32 core the firmware
+ * modules use, for the native test environment. Time is the host's
+ * monotonic clock; pins and interrupts do nothing.
+ */
+
+#define HIGH            1
+#define LOW             0
+#define INPUT           0
+#define OUTPUT          1
+#define FALLING         2
+#define SERIAL_8N1      0x800001c
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+long random(long min, long max);
+
+#define constrain(x, lo, hi)    ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+
+inline void pinMode(int, int) {}
+inline void digitalWrite(int, int) {}
+inline int digitalRead(int) {
+    return 0;
+}
+inline void attachInterruptArg(int, void (*)(void*), void*, int) {}
+inline void detachInterrupt(int) {}
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t len) {
+        size_t n = 0;
+        while (len--) {
+            n += write(*buf++);
+        }
+        return n;
+    }
+    size_t write(const char* s) {
+        return write((const uint8_t*)s, strlen(s));
+    }
+    virtual void flush() {}
+    size_t print(const char* s) {
+        return write(s);
+    }
+    size_t println(const char* s = "") {
+        return write(s) + write("\n");
+    }
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual size_t readBytes(char* buf, size_t len) {
+        size_t n = 0;
+        while (n < len) {
+            int c = read();
+            if (c < 0) {
+                break;
+            }
+            buf[n++] = (char)c;
+        }
+        return n;
+    }
+    virtual size_t readBytes(uint8_t* buf, size_t len) {
+        return readBytes((char*)buf, len);
+    }
+    void setTimeout(unsigned long) {}
+};
+
+/* Console on stdout; the modem UART reads nothing */
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int rxPin = -1, int txPin = -1);
+    void end() {}
+    void updateBaudRate(unsigned long baud);
+    unsigned long baudRate();
+    size_t setRxBufferSize(size_t len) {
+        return len;
+    }
+    int available() override {
+        return 0;
+    }
+    int read() override {
+        return -1;
+    }
+    size_t read(uint8_t*, size_t) {
+        return 0;
+    }
+    int peek() override {
+        return -1;
+    }
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t len) override;
+    using Print::write;
+    int availableForWrite() {
+        return 128;
+    }
+    operator bool() {
+        return true;
+    }
+
+protected:
+    unsigned long baud = 0;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
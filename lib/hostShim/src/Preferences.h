@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/* NVS stand-in: one in-memory key/value store per process, kept across begin()/end() */
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false);
+    void end() {}
+    size_t getBytes(const char* key, void* buf, size_t len);
+    size_t putBytes(const char* key, const void* buf, size_t len);
+    size_t getBytesLength(const char* key);
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+    size_t putUInt(const char* key, uint32_t value);
+    bool getBool(const char* key, bool defaultValue = false);
+    size_t putBool(const char* key, bool value);
+    bool remove(const char* key);
+    bool clear();
+
+    /* Host only: forget everything, between tests */
+    static void wipe();
+
+protected:
+    char ns[16];
+};
@@ -0,0 +1,7 @@
+#pragma once
+#include "esp_err.h"
+
+#define UART_NUM_0 0
+#define UART_NUM_1 1
+
+esp_err_t uart_set_wakeup_threshold(int uart, int edges);
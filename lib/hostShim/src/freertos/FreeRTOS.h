@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * Single-threaded FreeRTOS stand-in: tests drive the modules from one
+ * thread, so locks always succeed and tasks are never started. Queues and
+ * binary semaphores keep their contents and never block, unless a test set
+ * a block hook: then every timed wait runs the hook until it is satisfied or
+ * times out, so a module waiting on a task the test pumps (the AT engine)
+ * works in the same thread. A yield gives the host thread's time slice
+ * away, for lock-free code run on real threads.
+ */
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef void* SemaphoreHandle_t;
+typedef void* QueueHandle_t;
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+typedef int portMUX_TYPE;
+
+#define pdTRUE                          1
+#define pdFALSE                         0
+#define pdPASS                          1
+#define pdFAIL                          0
+#define portMAX_DELAY                   0xffffffffu
+#define portTICK_PERIOD_MS              1
+#define pdMS_TO_TICKS(ms)               ((TickType_t)(ms))
+#define portMUX_INITIALIZER_UNLOCKED    0
+#define portENTER_CRITICAL(mux)         ((void)(mux))
+#define portEXIT_CRITICAL(mux)          ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux)     ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux)      ((void)(mux))
+#define configASSERT(x)                 ((void)(x))
+#define configSTACK_DEPTH_TYPE          uint32_t
+#define taskYIELD()                     vPortYield()
+#define eSetBits                        1
+#define eIncrement                      2
+
+void vPortYield();
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* arg, UBaseType_t prio,
+                       TaskHandle_t* handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t prio, TaskHandle_t* handle, BaseType_t core);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+BaseType_t xTaskCatchUpTicks(TickType_t ticks);
+
+/* Host only: runs in place of blocking, with the hook's own waits left plain; NULL removes it */
+typedef void (*HostBlockHook)(void* ctx);
+void hostSetBlockHook(HostBlockHook hook, void* ctx);
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
@@ -0,0 +1,357 @@
+#include <chrono>
+#include <deque>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Arduino.h"
+#include "Preferences.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_heap_caps.h"
+#include "esp_sleep.h"
+#include "driver/gpio.h"
+#include "driver/uart.h"
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+
+static std::chrono::steady_clock::time_point bootTime = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+    return (unsigned long)(uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - bootTime).count();
+}
+
+unsigned long micros() {
+    return (unsigned long)(uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - bootTime).count();
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+long random(long min, long max) {
+    return (max > min) ? min + rand() % (max - min) : min;
+}
+
+size_t Print::printf(const char* fmt, ...) {
+    char buf[512];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (n < 0) {
+        return 0;
+    }
+    return write((const uint8_t*)buf, ((size_t)n < sizeof(buf)) ? (size_t)n : sizeof(buf) - 1);
+}
+
+void HardwareSerial::begin(unsigned long baud, uint32_t, int, int) {
+    this->baud = baud;
+}
+
+void HardwareSerial::updateBaudRate(unsigned long baud) {
+    this->baud = baud;
+}
+
+unsigned long HardwareSerial::baudRate() {
+    return baud;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t len) {
+    return fwrite(buf, 1, len, stdout);
+}
+
+/* NVS */
+
+static std::map<std::string, std::vector<uint8_t> >& nvs() {
+    static std::map<std::string, std::vector<uint8_t> > store;
+    return store;
+}
+
+bool Preferences::begin(const char* name, bool) {
+    snprintf(ns, sizeof(ns), "%s", name);
+    return true;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t len) {
+    std::map<std::string, std::vector<uint8_t> >::iterator it = nvs().find(std::string(ns) + "/" + key);
+    if (it == nvs().end()) {
+        return 0;
+    }
+    size_t n = (it->second.size() < len) ? it->second.size() : len;
+    memcpy(buf, it->second.data(), n);
+    return n;
+}
+
+size_t Preferences::putBytes(const char* key, const void* buf, size_t len) {
+    nvs()[std::string(ns) + "/" + key].assign((const uint8_t*)buf, (const uint8_t*)buf + len);
+    return len;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    std::map<std::string, std::vector<uint8_t> >::iterator it = nvs().find(std::string(ns) + "/" + key);
+    return (it == nvs().end()) ? 0 : it->second.size();
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+    uint32_t v = defaultValue;
+    getBytes(key, &v, sizeof(v));
+    return v;
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+bool Preferences::getBool(const char* key, bool defaultValue) {
+    uint8_t v = defaultValue ? 1 : 0;
+    getBytes(key, &v, sizeof(v));
+    return v != 0;
+}
+
+size_t Preferences::putBool(const char* key, bool value) {
+    uint8_t v = value ? 1 : 0;
+    return putBytes(key, &v, sizeof(v));
+}
+
+bool Preferences::remove(const char* key) {
+    return nvs().erase(std::string(ns) + "/" + key) > 0;
+}
+
+bool Preferences::clear() {
+    std::string prefix = std::string(ns) + "/";
+    for (std::map<std::string, std::vector<uint8_t> >::iterator it = nvs().begin(); it != nvs().end();) {
+        if (it->first.compare(0, prefix.size(), prefix) == 0) {
+            nvs().erase(it++);
+        } else {
+            ++it;
+        }
+    }
+    return true;
+}
+
+void Preferences::wipe() {
+    nvs().clear();
+}
+
+/* FreeRTOS */
+
+struct HostQueue {
+    size_t length;
+    size_t itemSize;
+    std::deque<std::vector<uint8_t> > items;
+};
+
+/* Binary semaphores count gives; mutexes are this one placeholder */
+struct HostSemaphore {
+    bool binary;
+    bool given;
+};
+
+static HostSemaphore hostMutex = { false, true };
+
+static HostBlockHook blockHook;
+static void* blockHookCtx;
+static bool inBlockHook;
+
+void hostSetBlockHook(HostBlockHook hook, void* ctx) {
+    blockHook = hook;
+    blockHookCtx = ctx;
+}
+
+/* Run the block hook once; false without one, or from inside it */
+static bool runBlockHook() {
+    if (blockHook == NULL || inBlockHook) {
+        return false;
+    }
+    inBlockHook = true;
+    blockHook(blockHookCtx);
+    inBlockHook = false;
+    return true;
+}
+
+/* Whether a wait that started at startMs may go on running the hook */
+static bool keepWaiting(unsigned long startMs, TickType_t ticks) {
+    if (ticks == 0 || (ticks != portMAX_DELAY && millis() - startMs >= ticks * portTICK_PERIOD_MS)) {
+        return false;
+    }
+    if (!runBlockHook()) {
+        return false;
+    }
+    delay(1);
+    return true;
+}
+
+void vPortYield() {
+    std::this_thread::yield();
+}
+
+void vTaskDelay(TickType_t ticks) {
+    unsigned long startMs = millis();
+    while (keepWaiting(startMs, ticks)) {
+    }
+    unsigned long spent = millis() - startMs;
+    if (spent < ticks * portTICK_PERIOD_MS) {
+        delay(ticks * portTICK_PERIOD_MS - spent);
+    }
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)(millis() / portTICK_PERIOD_MS);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t* handle) {
+    /* Tests drive the modules themselves: no task is started */
+    if (handle != NULL) {
+        *handle = NULL;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg, UBaseType_t prio,
+                                   TaskHandle_t* handle, BaseType_t) {
+    return xTaskCreate(fn, name, stack, arg, prio, handle);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    static int mainTask;
+    return &mainTask;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) {
+    return 0;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) {
+    /* No notification ever arrives: the caller polls its condition, one hook run per call */
+    runBlockHook();
+    return 0;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t) {
+    return pdPASS;
+}
+
+BaseType_t xTaskCatchUpTicks(TickType_t) {
+    /* Ticks follow the host clock */
+    return pdFALSE;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return &hostMutex;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    HostSemaphore* sem = new HostSemaphore;
+    sem->binary = true;
+    sem->given = false;
+    return sem;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t handle, TickType_t ticks) {
+    HostSemaphore* sem = static_cast<HostSemaphore*>(handle);
+    if (!sem->binary) {
+        return pdTRUE;
+    }
+    unsigned long startMs = millis();
+    while (!sem->given && keepWaiting(startMs, ticks)) {
+    }
+    bool given = sem->given;
+    sem->given = false;
+    return given ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t handle) {
+    static_cast<HostSemaphore*>(handle)->given = true;
+    return pdTRUE;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    HostQueue* q = new HostQueue;
+    q->length = length;
+    q->itemSize = itemSize;
+    return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t handle, const void* item, TickType_t) {
+    HostQueue* q = static_cast<HostQueue*>(handle);
+    if (q->items.size() >= q->length) {
+        return pdFALSE;
+    }
+    q->items.push_back(std::vector<uint8_t>((const uint8_t*)item, (const uint8_t*)item + q->itemSize));
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t handle, void* item, TickType_t ticks) {
+    HostQueue* q = static_cast<HostQueue*>(handle);
+    unsigned long startMs = millis();
+    while (q->items.empty() && keepWaiting(startMs, ticks)) {
+    }
+    if (q->items.empty()) {
+        return pdFALSE;
+    }
+    memcpy(item, q->items.front().data(), q->itemSize);
+    q->items.pop_front();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t handle) {
+    return (UBaseType_t) static_cast<HostQueue*>(handle)->items.size();
+}
+
+/* ESP-IDF */
+
+static uint64_t sleepTimerUs;
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t us) {
+    sleepTimerUs = us;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup(void) {
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_uart_wakeup(int) {
+    return ESP_OK;
+}
+
+esp_err_t esp_light_sleep_start(void) {
+    /* Only the timer wakes the host */
+    std::this_thread::sleep_for(std::chrono::microseconds(sleepTimerUs));
+    return ESP_OK;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void) {
+    return ESP_SLEEP_WAKEUP_TIMER;
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t, gpio_int_type_t) {
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_disable(gpio_num_t) {
+    return ESP_OK;
+}
+
+esp_err_t uart_set_wakeup_threshold(int, int) {
+    return ESP_OK;
+}
+
+size_t heap_caps_get_free_size(uint32_t) {
+    return 200000;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t) {
+    return 180000;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t) {
+    return 110000;
+}
@@ -0,0 +1,538 @@
+#include <stdarg.h>
+#include <string.h>
+#include "atEngine.h"
+#include "fixedString.h"
+#include "heapMonitor.h"
+
+/*
+ * @brief Classify a line as a final result code.
+ * @return AT_OK, AT_ERROR, or AT_PENDING if the line is not a final result.
+ */
+static AtResult finalResult(const char* line, size_t len) {
+    if (len == 2 && memcmp(line, "OK", 2) == 0) {
+        return AT_OK;
+    }
+    if ((len == 5 && memcmp(line, "ERROR", 5) == 0) ||
+        (len >= 10 && memcmp(line, "+CME ERROR", 10) == 0) ||
+        (len >= 10 && memcmp(line, "+CMS ERROR", 10) == 0)) {
+        return AT_ERROR;
+    }
+    return AT_PENDING;
+}
+
+/*
+ * @brief Check whether a received line starts with prefix; NULL matches nothing.
+ */
+static bool hasPrefix(const char* line, size_t len, const char* prefix) {
+    if (prefix == NULL) {
+        return false;
+    }
+    size_t n = strlen(prefix);
+    return len >= n && memcmp(line, prefix, n) == 0;
+}
+
+/*
+ * @brief Check whether an information line answers the given command,
+ *        i.e. "+CEREG: ..." for "+CEREG?" or "+CMGS: ..." for "+CMGS=...".
+ */
+static bool isResponseTo(const char* cmd, const char* line, size_t len) {
+    if (cmd[0] != '+') {
+        return false;
+    }
+    size_t i = 0;
+    while (cmd[i] != '\0' && cmd[i] != '=' && cmd[i] != '?') {
+        if (i >= len || line[i] != cmd[i]) {
+            return false;
+        }
+        i++;
+    }
+    return i < len && line[i] == ':';
+}
+
+/*
+ * @brief Check whether cmd is a set command, "+CEREG=2" but not "+CEREG=?". Its own
+ *        prefix arriving meanwhile is usually a URC: a set command rarely answers with one.
+ */
+static bool isSetCommand(const char* cmd) {
+    const char* eq = strchr(cmd, '=');
+    return eq != NULL && eq[1] != '?';
+}
+
+/*
+ * @brief AtEngine constructor
+ * @paramin stream Stream connected to the modem AT port
+ * @paramin serialMon Reference to Serial monitor
+ */
+AtEngine::AtEngine(Stream& stream, HardwareSerial& serialMon)
+    : stream(stream), serialMon(serialMon), queue(NULL), subscriberLock(portMUX_INITIALIZER_UNLOCKED),
+      subscriberCount(0), idlePollMs(AT_IDLE_POLL_MS), active(NULL), activeStartUs(0), payloadSent(false),
+      inBody(false), echoOn(true), rxLen(0), rxDiscard(false),
+      statsLock(portMUX_INITIALIZER_UNLOCKED), commandCount(0) {
+    memset(commandStats, 0, sizeof(commandStats));
+    strcpy(commandStats[AT_STATS_COMMANDS].name, "other");
+}
+
+/*
+ * @brief Create the request queue and start the engine task.
+ * @return true if the engine is running.
+ */
+bool AtEngine::begin() {
+    if (queue != NULL) {
+        return true;
+    }
+    queue = xQueueCreate(AT_QUEUE_DEPTH, sizeof(AtRequest_t*));
+    if (queue == NULL) {
+        serialMon.println("Failed to create AT queue");
+        return false;
+    }
+    if (xTaskCreate(taskEntry, "AtEngine", AT_ENGINE_TASK_STACK_SIZE, this, AT_ENGINE_TASK_PRIORITY, NULL) != pdPASS) {
+        serialMon.println("Failed to start AT engine task");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * @brief Register a handler for unsolicited result codes starting with prefix.
+ * @paramin prefix Line prefix, e.g. "+CMTI:". Must have static storage.
+ * @paramin cb Handler, runs in the engine task and must not issue blocking AT commands.
+ * @paramin ctx Opaque pointer passed back to the handler.
+ * @return false if the subscriber table is full.
+ */
+bool AtEngine::subscribe(const char* prefix, AtLineCallback cb, void* ctx) {
+    bool added = false;
+    portENTER_CRITICAL(&subscriberLock);
+    if (subscriberCount < AT_URC_MAX_SUBSCRIBERS) {
+        UrcSubscriber_t* sub = &subscribers[subscriberCount];
+        sub->prefix = prefix;
+        sub->prefixLen = strlen(prefix);
+        sub->cb = cb;
+        sub->ctx = ctx;
+        subscriberCount++;
+        added = true;
+    }
+    portEXIT_CRITICAL(&subscriberLock);
+    if (!added) {
+        serialMon.println("URC subscriber table full");
+    }
+    return added;
+}
+
+static void vprepare(AtRequest_t* req, uint32_t timeoutMs, const char* fmt, va_list args) {
+    vsnprintf(req->cmd, sizeof(req->cmd), fmt, args);
+    req->payload = NULL;
+    req->payloadLen = 0;
+    req->payloadCtrlZ = false;
+    req->timeoutMs = timeoutMs;
+    req->onLine = NULL;
+    req->bodyPrefix = NULL;
+    req->onDone = NULL;
+    req->ctx = NULL;
+    req->respLen = 0;
+    req->resp[0] = '\0';
+    req->result = AT_PENDING;
+    req->latencyUs = 0;
+    req->waiter = NULL;
+}
+
+/*
+ * @brief Reset a request and format its command.
+ * @paramout req Request to initialise.
+ * @paramin timeoutMs Time allowed for the final result code.
+ * @paramin fmt printf style command without the leading "AT".
+ */
+void AtEngine::prepare(AtRequest_t* req, uint32_t timeoutMs, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vprepare(req, timeoutMs, fmt, args);
+    va_end(args);
+}
+
+/*
+ * @brief Queue a request without blocking.
+ *        Completion is signalled through req->result, req->onDone and req->waiter.
+ * @return false if the queue is full.
+ */
+bool AtEngine::submit(AtRequest_t* req) {
+    req->result = AT_PENDING;
+    req->respLen = 0;
+    req->resp[0] = '\0';
+    if (queue == NULL || xQueueSend(queue, &req, 0) != pdTRUE) {
+        req->result = AT_QUEUE_FULL;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * @brief Queue a request and park the calling task until it completes.
+ *        Uses the caller's task notification; must not be called from a URC handler.
+ * @return Final result of the exchange.
+ */
+AtResult AtEngine::exec(AtRequest_t* req) {
+    req->waiter = xTaskGetCurrentTaskHandle();
+    if (!submit(req)) {
+        serialMon.println("AT queue full");
+        return AT_QUEUE_FULL;
+    }
+    while (req->result == AT_PENDING) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    }
+    return req->result;
+}
+
+/*
+ * @brief Format, queue and wait for a command.
+ * @paramout req Request storage, holds the response on return.
+ * @paramin timeoutMs Time allowed for the final result code.
+ * @paramin fmt printf style command without the leading "AT".
+ * @return Final result of the exchange.
+ */
+AtResult AtEngine::command(AtRequest_t* req, uint32_t timeoutMs, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vprepare(req, timeoutMs, fmt, args);
+    va_end(args);
+    return exec(req);
+}
+
+/*
+ * @brief Find a response line starting with prefix.
+ * @paramin req Completed request.
+ * @paramin prefix Line prefix, e.g. "+CSQ:".
+ * @paramout len Length of the text following the prefix, up to the end of the line.
+ * @return Pointer to the text after the prefix and any blanks, or NULL if absent.
+ */
+const char* AtEngine::findLine(const AtRequest_t* req, const char* prefix, size_t* len) {
+    size_t prefixLen = strlen(prefix);
+    const char* p = req->resp;
+    const char* end = req->resp + req->respLen;
+    while (p < end) {
+        const char* eol = (const char*)memchr(p, '\n', (size_t)(end - p));
+        if (eol == NULL) {
+            eol = end;
+        }
+        if ((size_t)(eol - p) >= prefixLen && memcmp(p, prefix, prefixLen) == 0) {
+            const char* text = p + prefixLen;
+            while (text < eol && *text == ' ') {
+                ++text;
+            }
+            *len = (size_t)(eol - text);
+            return text;
+        }
+        p = eol + 1;
+    }
+    return NULL;
+}
+
+/*
+ * @brief How often the idle engine looks for URCs. A queued request is picked up at once whatever the period.
+ * @paramin ms AT_IDLE_POLL_MS while the modem may talk, longer while it sleeps.
+ */
+void AtEngine::setIdlePoll(uint32_t ms) {
+    idlePollMs = ms;
+}
+
+/*
+ * @brief The modem echoes commands again, as after power-on, until the next ATE0 is acknowledged.
+ */
+void AtEngine::expectEcho() {
+    echoOn = true;
+}
+
+void AtEngine::taskEntry(void* pvParameters) {
+    static_cast<AtEngine*>(pvParameters)->run();
+}
+
+/*
+ * @brief Engine task: the only reader and writer of the modem stream.
+ */
+void AtEngine::run() {
+    int heapSlot = HeapMonitor::watchTask("AT engine");
+    for (;;) {
+        HeapLoopCheck heapCheck(heapSlot);
+        service((stream.available() > 0) ? 0 : pdMS_TO_TICKS(idlePollMs));
+    }
+}
+
+/*
+ * @brief One pass of the engine loop: pick up a queued request while idle, move the
+ *        exchange on and time it out. The engine task calls it; a host test without
+ *        tasks calls it from its own loop.
+ * @paramin wait Time to wait for a request while no exchange is active.
+ */
+void AtEngine::service(TickType_t wait) {
+    if (active == NULL) {
+        AtRequest_t* next = NULL;
+        if (xQueueReceive(queue, &next, wait) == pdTRUE) {
+            start(next);
+        }
+    }
+    pump();
+    if (active != NULL) {
+        if ((uint32_t)(micros() - activeStartUs) >= active->timeoutMs * 1000UL) {
+            FixedPrintf(serialMon, "AT%s timed out\n", active->cmd);
+            finish(AT_TIMEOUT);
+        } else if (stream.available() <= 0) {
+            vTaskDelay(1);
+        }
+    }
+}
+
+/*
+ * @brief Send a request to the modem and make it the active exchange.
+ */
+void AtEngine::start(AtRequest_t* req) {
+    active = req;
+    payloadSent = false;
+    inBody = false;
+    activeStartUs = micros();
+    stream.write((const uint8_t*)"AT", 2);
+    stream.write((const uint8_t*)req->cmd, strlen(req->cmd));
+    stream.write((const uint8_t*)"\r\n", 2);
+    stream.flush();
+}
+
+/*
+ * @brief Complete the active request and signal its owner.
+ */
+void AtEngine::finish(AtResult result) {
+    AtRequest_t* req = active;
+    active = NULL;
+    req->latencyUs = micros() - activeStartUs;
+    record(req, result);
+    if (result == AT_OK && strcmp(req->cmd, "E0") == 0) {
+        echoOn = false;
+    }
+    TaskHandle_t waiter = req->waiter;
+    AtDoneCallback cb = req->onDone;
+    void* ctx = req->ctx;
+    req->result = result;
+    if (cb != NULL) {
+        cb(req, ctx);
+    }
+    if (waiter != NULL) {
+        xTaskNotifyGive(waiter);
+    }
+}
+
+/*
+ * @brief Add a finished exchange to its command's latency histogram. Engine task only.
+ */
+void AtEngine::record(const AtRequest_t* req, AtResult result) {
+    char name[AT_STATS_NAME_LEN] = "AT";
+    size_t n = strcspn(req->cmd, "=?");
+    if (n > sizeof(name) - 3) {
+        n = sizeof(name) - 3;
+    }
+    memcpy(name + 2, req->cmd, n);
+    name[n + 2] = '\0';
+    AtCommandStats_t* s = &commandStats[AT_STATS_COMMANDS];
+    for (uint8_t i = 0; i < commandCount; ++i) {
+        if (strcmp(commandStats[i].name, name) == 0) {
+            s = &commandStats[i];
+            break;
+        }
+    }
+    portENTER_CRITICAL(&statsLock);
+    if (s == &commandStats[AT_STATS_COMMANDS] && commandCount < AT_STATS_COMMANDS) {
+        s = &commandStats[commandCount++];
+        strcpy(s->name, name);
+    }
+    HistogramAdd(&s->latency, req->latencyUs / 1000);
+    if (result == AT_ERROR) {
+        s->errors++;
+    } else if (result == AT_TIMEOUT) {
+        s->timeouts++;
+    }
+    portEXIT_CRITICAL(&statsLock);
+}
+
+/*
+ * @brief Drain received bytes in bulk, frame them into lines and answer '>' prompts.
+ *        Lines are passed to handleLine() straight from the receive buffer.
+ */
+void AtEngine::pump() {
+    for (;;) {
+        int avail = stream.available();
+        if (avail <= 0) {
+            break;
+        }
+        if (rxLen == sizeof(rxBuf)) {
+            /* No terminator in a full buffer: deliver what fits, drop the rest of the line */
+            serialMon.println("AT line too long, truncated");
+            handleLine(rxBuf, rxLen);
+            rxLen = 0;
+            rxDiscard = true;
+        }
+        size_t room = sizeof(rxBuf) - rxLen;
+        size_t n = stream.readBytes(rxBuf + rxLen, ((size_t)avail < room) ? (size_t)avail : room);
+        if (n == 0) {
+            break;
+        }
+        size_t scan = rxLen;
+        rxLen += n;
+
+        size_t lineStart = 0;
+        const char* eol;
+        while ((eol = (const char*)memchr(rxBuf + scan, '\n', rxLen - scan)) != NULL) {
+            size_t lineEnd = (size_t)(eol - rxBuf);
+            size_t len = lineEnd - lineStart;
+            if (len > 0 && rxBuf[lineStart + len - 1] == '\r') {
+                len--;
+            }
+            if (rxDiscard) {
+                rxDiscard = false;
+            } else if (len > 0 || inBody) {
+                handleLine(rxBuf + lineStart, len);
+            }
+            lineStart = lineEnd + 1;
+            scan = lineStart;
+        }
+
+        /* Data prompt has no line terminator: "> " */
+        if (lineStart < rxLen && rxBuf[lineStart] == '>' && !rxDiscard &&
+            active != NULL && active->payload != NULL && !payloadSent) {
+            stream.write(active->payload, active->payloadLen);
+            if (active->payloadCtrlZ) {
+                stream.write((uint8_t)AT_CTRL_Z);
+            }
+            stream.flush();
+            payloadSent = true;
+            lineStart++;
+        }
+
+        /* Keep only the unterminated tail */
+        if (rxDiscard) {
+            rxLen = 0;
+        } else if (lineStart > 0) {
+            rxLen -= lineStart;
+            memmove(rxBuf, rxBuf + lineStart, rxLen);
+        }
+    }
+}
+
+/*
+ * @brief Route one received line to the active request or to URC subscribers.
+ */
+void AtEngine::handleLine(const char* line, size_t len) {
+    if (inBody && active != NULL) {
+        /* Message text: whatever it says, it is not echo, a result code or a URC */
+        if (len == 0) {
+            inBody = false;
+            return;
+        }
+        if (!hasPrefix(line, len, active->bodyPrefix)) {
+            appendResponse(line, len);
+            return;
+        }
+        inBody = false;
+    }
+    /* Skip blank lines and the remainder of a data prompt */
+    size_t i = 0;
+    while (i < len && line[i] == ' ') {
+        i++;
+    }
+    if (i == len) {
+        return;
+    }
+    if (active != NULL) {
+        /* Command echo, until ATE0 has been applied */
+        if (echoOn && len >= 2 && line[0] == 'A' && line[1] == 'T') {
+            return;
+        }
+        AtResult result = finalResult(line, len);
+        if (result != AT_PENDING) {
+            if (result == AT_ERROR) {
+                appendResponse(line, len);
+            }
+            finish(result);
+            return;
+        }
+        /* A set command's answer ("+CMGS: 12") goes to subscribers first: "+CEREG: 1"
+         * during AT+CEREG=2 is the indication, not the answer */
+        bool response = isResponseTo(active->cmd, line, len) && !isSetCommand(active->cmd);
+        if (response || !dispatchUrc(line, len)) {
+            appendResponse(line, len);
+            inBody = hasPrefix(line, len, active->bodyPrefix);
+        }
+        return;
+    }
+    if (!dispatchUrc(line, len)) {
+        serialMon.print("Unsolicited: ");
+        serialMon.write((const uint8_t*)line, len);
+        serialMon.println();
+    }
+}
+
+/*
+ * @brief Hand a line to the first subscriber whose prefix matches.
+ * @return true if a subscriber consumed the line.
+ */
+bool AtEngine::dispatchUrc(const char* line, size_t len) {
+    uint8_t count = subscriberCount;
+    for (uint8_t i = 0; i < count; ++i) {
+        const UrcSubscriber_t* sub = &subscribers[i];
+        if (len >= sub->prefixLen && memcmp(line, sub->prefix, sub->prefixLen) == 0) {
+            sub->cb(line, len, sub->ctx);
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * @brief Store an information line in the active request, or stream it to its line callback.
+ */
+void AtEngine::appendResponse(const char* line, size_t len) {
+    if (active->onLine != NULL) {
+        active->onLine(line, len, active->ctx);
+        return;
+    }
+    size_t room = sizeof(active->resp) - active->respLen;
+    /* Keep space for the separator and terminator */
+    if (room < 2) {
+        return;
+    }
+    if (active->respLen > 0) {
+        active->resp[active->respLen++] = '\n';
+        room--;
+    }
+    size_t n = (len < room - 1) ? len : room - 1;
+    memcpy(active->resp + active->respLen, line, n);
+    active->respLen += n;
+    active->resp[active->respLen] = '\0';
+}
+
+/*
+ * @brief All commands together: merged latency histogram, errors and timeouts.
+ */
+void AtEngine::getTotals(AtCommandStats_t* totals) {
+    memset(totals, 0, sizeof(*totals));
+    strcpy(totals->name, "all");
+    portENTER_CRITICAL(&statsLock);
+    for (uint8_t i = 0; i <= AT_STATS_COMMANDS; ++i) {
+        totals->errors += commandStats[i].errors;
+        totals->timeouts += commandStats[i].timeouts;
+        HistogramMerge(&totals->latency, commandStats[i].latency);
+    }
+    portEXIT_CRITICAL(&statsLock);
+}
+
+/*
+ * @brief Print the latency histogram, errors and timeouts of each command sent so far.
+ */
+void AtEngine::printStats(Print& out) {
+    for (uint8_t i = 0; i <= AT_STATS_COMMANDS; ++i) {
+        AtCommandStats_t s;
+        portENTER_CRITICAL(&statsLock);
+        s = commandStats[i];
+        portEXIT_CRITICAL(&statsLock);
+        if (s.latency.count == 0) {
+            continue;
+        }
+        FixedString<AT_STATS_NAME_LEN + 24> label;
+        label.appendf("%s (%u err, %u timeout)", s.name, (unsigned)s.errors, (unsigned)s.timeouts);
+        HistogramPrint(out, label.c_str(), s.latency);
+    }
+}
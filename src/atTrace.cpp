@@ -0,0 +1,355 @@
+#include <string.h>
+#include "atTrace.h"
+#include "fixedString.h"
+#include "trackExport.h"
+
+/*
+ * @brief AtTraceStream constructor
+ * @paramin inner Stream connected to the modem (UART or simulator)
+ */
+AtTraceStream::AtTraceStream(Stream& inner)
+    : inner(inner), committed(0), recStart(0), writePos(0), recLen(0), recDir(0), lastUs(0), started(false), full(false) {}
+
+int AtTraceStream::available() {
+    return inner.available();
+}
+
+int AtTraceStream::read() {
+    int c = inner.read();
+    if (c >= 0) {
+        uint8_t b = (uint8_t)c;
+        record(0, &b, 1);
+    }
+    return c;
+}
+
+int AtTraceStream::peek() {
+    return inner.peek();
+}
+
+size_t AtTraceStream::readBytes(char* data, size_t len) {
+    size_t n = inner.readBytes(data, len);
+    record(0, (const uint8_t*)data, n);
+    return n;
+}
+
+size_t AtTraceStream::write(uint8_t c) {
+    record(AT_TRACE_DIR_TX, &c, 1);
+    return inner.write(c);
+}
+
+size_t AtTraceStream::write(const uint8_t* data, size_t len) {
+    record(AT_TRACE_DIR_TX, data, len);
+    return inner.write(data, len);
+}
+
+void AtTraceStream::flush() {
+    inner.flush();
+}
+
+/*
+ * @brief Discard the captured trace and start a new one.
+ */
+void AtTraceStream::clear() {
+    started = false;
+    full = false;
+    committed = 0;
+    recStart = 0;
+    writePos = 0;
+    recLen = 0;
+}
+
+/*
+ * @brief Size of the dumpable part of the trace in bytes.
+ */
+size_t AtTraceStream::size() const {
+    return committed;
+}
+
+bool AtTraceStream::overflowed() const {
+    return full;
+}
+
+/*
+ * @brief Write the trace as CRC-checked frames between "AT-TRACE <len>" and "AT-TRACE END" lines.
+ *        The record still being written is left out.
+ */
+void AtTraceStream::dump(Print& out) {
+    /* One write per frame: other tasks' output can only fall between frames */
+    uint8_t frame[EXPORT_HEADER_LEN + AT_TRACE_DUMP_CHUNK + EXPORT_TRAILER_LEN];
+    size_t len = committed;
+    FixedPrintf(out, "AT-TRACE %u\n", (unsigned)len);
+    for (size_t off = 0; off < len; off += AT_TRACE_DUMP_CHUNK) {
+        uint16_t n = (uint16_t)((len - off < AT_TRACE_DUMP_CHUNK) ? len - off : AT_TRACE_DUMP_CHUNK);
+        ExportFrameHeader(frame, AT_TRACE_FRAME_DATA, (uint32_t)off, 0, n);
+        memcpy(frame + EXPORT_HEADER_LEN, buf + off, n);
+        uint16_t crc = Crc16(buf + off, n);
+        frame[EXPORT_HEADER_LEN + n] = (uint8_t)crc;
+        frame[EXPORT_HEADER_LEN + n + 1] = (uint8_t)(crc >> 8);
+        out.write(frame, EXPORT_HEADER_LEN + n + EXPORT_TRAILER_LEN);
+    }
+    uint16_t crc = Crc16(NULL, 0);
+    ExportFrameHeader(frame, EXPORT_TYPE_END, (uint32_t)len, full ? 1 : 0, 0);
+    frame[EXPORT_HEADER_LEN] = (uint8_t)crc;
+    frame[EXPORT_HEADER_LEN + 1] = (uint8_t)(crc >> 8);
+    out.write(frame, EXPORT_HEADER_LEN + EXPORT_TRAILER_LEN);
+    out.println();
+    out.println("AT-TRACE END");
+}
+
+/*
+ * @brief Append bytes to the trace, extending the open record when the
+ *        direction matches and the gap is below AT_TRACE_COALESCE_US.
+ */
+void AtTraceStream::record(uint8_t dir, const uint8_t* data, size_t len) {
+    if (full) {
+        return;
+    }
+    uint32_t now = micros();
+    if (!started) {
+        memcpy(buf, AT_TRACE_MAGIC, AT_TRACE_MAGIC_LEN);
+        committed = AT_TRACE_MAGIC_LEN;
+        recStart = AT_TRACE_MAGIC_LEN;
+        writePos = AT_TRACE_MAGIC_LEN;
+        recLen = 0;
+        lastUs = now;
+        started = true;
+    }
+    size_t w = writePos;
+    for (size_t i = 0; i < len; ++i) {
+        bool append = recLen > 0 && recDir == dir && recLen < AT_TRACE_RECORD_MAX &&
+                      (uint32_t)(now - lastUs) < AT_TRACE_COALESCE_US;
+        if (!append) {
+            /* Header plus the longest varint and one data byte must fit */
+            if (w + 1 + 5 + 1 > sizeof(buf)) {
+                full = true;
+                break;
+            }
+            committed = w;
+            recStart = w;
+            recDir = dir;
+            recLen = 0;
+            uint32_t delta = now - lastUs;
+            lastUs = now;
+            buf[w++] = dir;
+            while (delta >= 0x80) {
+                buf[w++] = (uint8_t)((delta & 0x7F) | 0x80);
+                delta >>= 7;
+            }
+            buf[w++] = (uint8_t)delta;
+        } else if (w >= sizeof(buf)) {
+            full = true;
+            break;
+        }
+        buf[w++] = data[i];
+        recLen++;
+        buf[recStart] = (uint8_t)(dir | (recLen - 1));
+    }
+    writePos = w;
+}
+
+/*
+ * @brief AtTraceReplay constructor
+ * @paramin trace Trace captured by AtTraceStream, starting with the magic
+ * @paramin len Trace length in bytes
+ * @paramin realtime true to keep the original timing, false to replay as fast as possible
+ */
+AtTraceReplay::AtTraceReplay(const uint8_t* trace, size_t len, bool realtime)
+    : trace(trace), traceLen(len), pos(AT_TRACE_MAGIC_LEN), realtime(realtime), recDir(0), recRemaining(0),
+      recOffsetUs(0), done(false), startUs(0), started(false), bytesToModem(0), bytesFromModem(0),
+      divergences(0), hostLineLen(0), modemLineLen(0), pendingCommand(-1), commandStartUs(0), commandCount(0) {
+    if (len < AT_TRACE_MAGIC_LEN || memcmp(trace, AT_TRACE_MAGIC, AT_TRACE_MAGIC_LEN) != 0) {
+        done = true;
+    } else {
+        nextRecord();
+    }
+}
+
+/*
+ * @brief Decode the next record header.
+ */
+void AtTraceReplay::nextRecord() {
+    if (pos >= traceLen) {
+        done = true;
+        return;
+    }
+    uint8_t hdr = trace[pos++];
+    uint32_t delta = 0;
+    uint8_t shift = 0;
+    while (pos < traceLen && shift < 35) {
+        uint8_t b = trace[pos++];
+        delta |= (uint32_t)(b & 0x7F) << shift;
+        shift += 7;
+        if ((b & 0x80) == 0) {
+            break;
+        }
+    }
+    recDir = hdr & AT_TRACE_DIR_TX;
+    recRemaining = (size_t)(hdr & 0x7F) + 1;
+    recOffsetUs += delta;
+    if (pos + recRemaining > traceLen) {
+        done = true;
+    }
+}
+
+/*
+ * @brief Check whether the current modem record may be delivered to the host.
+ */
+bool AtTraceReplay::released() {
+    if (!started) {
+        startUs = micros();
+        started = true;
+    }
+    if (done || recDir == AT_TRACE_DIR_TX) {
+        return false;
+    }
+    return !realtime || (uint64_t)(uint32_t)(micros() - startUs) >= recOffsetUs;
+}
+
+int AtTraceReplay::available() {
+    return released() ? (int)recRemaining : 0;
+}
+
+int AtTraceReplay::read() {
+    if (!released()) {
+        return -1;
+    }
+    uint8_t c = trace[pos++];
+    bytesFromModem++;
+    if (c == '\n') {
+        onModemLine();
+        modemLineLen = 0;
+    } else if (c != '\r' && modemLineLen < sizeof(modemLine) - 1) {
+        modemLine[modemLineLen++] = (char)c;
+    }
+    if (--recRemaining == 0) {
+        nextRecord();
+    }
+    return c;
+}
+
+int AtTraceReplay::peek() {
+    return released() ? trace[pos] : -1;
+}
+
+/*
+ * @brief Consume host bytes against the trace, counting bytes that differ from the capture.
+ */
+size_t AtTraceReplay::write(uint8_t c) {
+    if (!started) {
+        startUs = micros();
+        started = true;
+    }
+    bytesToModem++;
+    if (c == '\r') {
+        onHostLine();
+        hostLineLen = 0;
+    } else if (c != '\n' && hostLineLen < sizeof(hostLine) - 1) {
+        hostLine[hostLineLen++] = (char)c;
+    }
+    if (!done && recDir == AT_TRACE_DIR_TX) {
+        if (trace[pos] != c) {
+            divergences++;
+        }
+        pos++;
+        if (--recRemaining == 0) {
+            nextRecord();
+        }
+    } else {
+        divergences++;
+    }
+    return 1;
+}
+
+size_t AtTraceReplay::write(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        write(data[i]);
+    }
+    return len;
+}
+
+bool AtTraceReplay::finished() const {
+    return done;
+}
+
+/*
+ * @brief Start timing the AT command just written by the host.
+ */
+void AtTraceReplay::onHostLine() {
+    hostLine[hostLineLen] = '\0';
+    if (strncmp(hostLine, "AT", 2) != 0) {
+        return;
+    }
+    char name[sizeof(commands[0].name)];
+    size_t n = 0;
+    for (const char* p = hostLine + 2; *p != '\0' && *p != '=' && *p != '?' && n < sizeof(name) - 1; ++p) {
+        name[n++] = *p;
+    }
+    name[n] = '\0';
+    int idx = -1;
+    for (uint8_t i = 0; i < commandCount; ++i) {
+        if (strcmp(commands[i].name, name) == 0) {
+            idx = i;
+            break;
+        }
+    }
+    if (idx < 0 && commandCount < AT_REPLAY_MAX_COMMANDS) {
+        idx = commandCount++;
+        memset(&commands[idx], 0, sizeof(commands[idx]));
+        strcpy(commands[idx].name, name);
+    }
+    pendingCommand = idx;
+    commandStartUs = micros();
+}
+
+/*
+ * @brief Stop timing the pending command on its final result code.
+ */
+void AtTraceReplay::onModemLine() {
+    modemLine[modemLineLen] = '\0';
+    if (pendingCommand < 0) {
+        return;
+    }
+    if (strcmp(modemLine, "OK") == 0 || strncmp(modemLine, "ERROR", 5) == 0 ||
+        strncmp(modemLine, "+CME ERROR", 10) == 0 || strncmp(modemLine, "+CMS ERROR", 10) == 0) {
+        uint32_t latency = micros() - commandStartUs;
+        AtReplayCommandStats_t* cmd = &commands[pendingCommand];
+        cmd->count++;
+        cmd->totalUs += latency;
+        if (latency > cmd->maxUs) {
+            cmd->maxUs = latency;
+        }
+        pendingCommand = -1;
+    }
+}
+
+/*
+ * @brief Copy replay progress, bytes on the wire and per-command latency.
+ */
+void AtTraceReplay::getStats(AtReplayStats_t* out) {
+    out->finished = done;
+    out->elapsedUs = started ? micros() - startUs : 0;
+    out->traceUs = (uint32_t)recOffsetUs;
+    out->bytesToModem = bytesToModem;
+    out->bytesFromModem = bytesFromModem;
+    out->divergences = divergences;
+    out->commandCount = commandCount;
+    memcpy(out->commands, commands, sizeof(commands));
+}
+
+/*
+ * @brief Print replay progress, bytes on the wire and per-command latency.
+ */
+void AtTraceReplay::printReport(Print& out) {
+    AtReplayStats_t s;
+    getStats(&s);
+    FixedPrintf(out, "AT replay: %s, %u ms elapsed (trace %u ms), %u bytes to modem, %u bytes from modem, "
+                "%u divergent bytes\n", s.finished ? "finished" : "running", (unsigned)(s.elapsedUs / 1000),
+                (unsigned)(s.traceUs / 1000), (unsigned)s.bytesToModem, (unsigned)s.bytesFromModem,
+                (unsigned)s.divergences);
+    for (uint8_t i = 0; i < s.commandCount; ++i) {
+        const AtReplayCommandStats_t* cmd = &s.commands[i];
+        FixedPrintf(out, "  AT%-14s n=%-4u avg %6u us  max %6u us\n", cmd->name, (unsigned)cmd->count,
+                    (unsigned)(cmd->count ? cmd->totalUs / cmd->count : 0), (unsigned)cmd->maxUs);
+    }
+}
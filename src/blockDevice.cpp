@@ -0,0 +1,82 @@
+#include <string.h>
+#include <unistd.h>
+#include "blockDevice.h"
+
+/*
+ * @brief FileBlockDevice constructor
+ * @paramin path File path, including the VFS mount point on target.
+ * @paramin blockSize Bytes per block.
+ * @paramin blockCount Number of blocks; the file grows up to blockSize * blockCount.
+ */
+FileBlockDevice::FileBlockDevice(const char* path, size_t blockSize, uint32_t blockCount)
+    : size(blockSize), count(blockCount), file(NULL) {
+    strncpy(this->path, path, sizeof(this->path) - 1);
+    this->path[sizeof(this->path) - 1] = '\0';
+}
+
+FileBlockDevice::~FileBlockDevice() {
+    if (file != NULL) {
+        fclose(file);
+    }
+}
+
+/*
+ * @brief Open the backing file, creating it if it does not exist.
+ */
+bool FileBlockDevice::open() {
+    if (file != NULL) {
+        return true;
+    }
+    file = fopen(path, "r+b");
+    if (file == NULL) {
+        file = fopen(path, "w+b");
+    }
+    return file != NULL;
+}
+
+bool FileBlockDevice::read(uint32_t block, uint8_t* buf) {
+    if (file == NULL || block >= count) {
+        return false;
+    }
+    if (fseek(file, (long)block * (long)size, SEEK_SET) != 0) {
+        return false;
+    }
+    size_t n = fread(buf, 1, size, file);
+    if (n < size) {
+        /* Beyond the end of the file: never written */
+        memset(buf + n, 0, size - n);
+        clearerr(file);
+    }
+    return true;
+}
+
+bool FileBlockDevice::write(uint32_t block, const uint8_t* buf) {
+    if (file == NULL || block >= count) {
+        return false;
+    }
+    if (fseek(file, (long)block * (long)size, SEEK_SET) != 0) {
+        return false;
+    }
+    return fwrite(buf, 1, size, file) == size;
+}
+
+/*
+ * @brief Push buffered writes down to the medium.
+ */
+bool FileBlockDevice::sync() {
+    if (file == NULL) {
+        return false;
+    }
+    if (fflush(file) != 0) {
+        return false;
+    }
+    return fsync(fileno(file)) == 0;
+}
+
+size_t FileBlockDevice::blockSize() const {
+    return size;
+}
+
+uint32_t FileBlockDevice::blockCount() const {
+    return count;
+}
@@ -0,0 +1,151 @@
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include "bootState.h"
+
+/*
+ * @brief BootState constructor
+ * @paramin rtc State in RTC slow memory (RTC_DATA_ATTR), zeroed by the loader on power-on.
+ */
+BootState::BootState(BootState_t& rtc)
+    : rtc(rtc), warm(false), modemKept(false), smsReadyMs(0), lock(portMUX_INITIALIZER_UNLOCKED) {
+    memset(&saved, 0, sizeof(saved));
+}
+
+/*
+ * @brief Take over the state left by the previous boot, or start fresh after power-on.
+ * @return true if state from before a deep sleep was restored.
+ */
+bool BootState::begin() {
+    warm = (rtc.magic == BOOT_STATE_MAGIC);
+    if (!warm) {
+        memset(&rtc, 0, sizeof(rtc));
+        rtc.magic = BOOT_STATE_MAGIC;
+        rtc.modemBaud = MODEM_UART_BAUD;
+        rtc.regStatus = REG_NO_RESULT;
+    }
+    rtc.wakeCount++;
+    saved = rtc;
+    modemKept = warm && saved.modemOn;
+    return warm;
+}
+
+bool BootState::restored() const {
+    return warm;
+}
+
+/*
+ * @brief Rate to probe the modem at first.
+ */
+uint32_t BootState::modemBaud() const {
+    return saved.modemBaud;
+}
+
+/*
+ * @brief Whether the modem has stayed powered since before this boot.
+ */
+bool BootState::modemWasOn() const {
+    return modemKept;
+}
+
+/*
+ * @brief Last known registration, REG_NO_RESULT once the modem has been powered off.
+ */
+RegStatus BootState::registration() {
+    portENTER_CRITICAL(&lock);
+    RegStatus status = rtc.modemOn ? (RegStatus)rtc.regStatus : REG_NO_RESULT;
+    portEXIT_CRITICAL(&lock);
+    return status;
+}
+
+/*
+ * @brief Last fix from before the deep sleep and its age by the system clock.
+ * @return false if there is none, the clock is not set or the fix is older than BOOT_FIX_MAX_AGE_S.
+ */
+bool BootState::lastFix(GnssRecord_t* rec, uint32_t* ageS) const {
+    time_t now = time(NULL);
+    if (!warm || !saved.haveFix || now < (time_t)BOOT_CLOCK_VALID_UNIX || now < (time_t)saved.fixUtc) {
+        return false;
+    }
+    uint32_t age = (uint32_t)(now - saved.fixUtc);
+    if (age > BOOT_FIX_MAX_AGE_S) {
+        return false;
+    }
+    *rec = saved.fix;
+    *ageS = age;
+    return true;
+}
+
+/*
+ * @brief The modem answers at baud.
+ */
+void BootState::modemStarted(uint32_t baud) {
+    portENTER_CRITICAL(&lock);
+    rtc.modemOn = true;
+    rtc.modemBaud = baud;
+    portEXIT_CRITICAL(&lock);
+}
+
+/*
+ * @brief The modem was power cycled or switched off: registration and receiver data are gone.
+ */
+void BootState::modemPoweredOff() {
+    modemKept = false;
+    portENTER_CRITICAL(&lock);
+    rtc.modemOn = false;
+    rtc.modemBaud = MODEM_UART_BAUD;
+    rtc.regStatus = REG_NO_RESULT;
+    portEXIT_CRITICAL(&lock);
+}
+
+void BootState::setRegistration(RegStatus status) {
+    portENTER_CRITICAL(&lock);
+    rtc.regStatus = (uint8_t)status;
+    portEXIT_CRITICAL(&lock);
+}
+
+/*
+ * @brief Keep the fix and set the system clock from it; the RTC keeps the clock running through deep sleep.
+ */
+void BootState::fixAcquired(const GnssRecord_t& rec) {
+    uint32_t utc;
+    if (!GnssRecordUnixTime(&rec, &utc)) {
+        return;
+    }
+    struct timeval tv = { (time_t)utc, (suseconds_t)rec.millisecond * 1000 };
+    settimeofday(&tv, NULL);
+    portENTER_CRITICAL(&lock);
+    rtc.haveFix = true;
+    rtc.fixUtc = utc;
+    rtc.fix = rec;
+    portEXIT_CRITICAL(&lock);
+}
+
+/*
+ * @brief Record the boot-to-SMS-ready time: modem up, registered, new message indications on.
+ * @return true on the first call of a boot, the one that counts.
+ */
+bool BootState::smsReady() {
+    if (smsReadyMs != 0) {
+        return false;
+    }
+    smsReadyMs = millis();
+    rtc.lastSmsReadyMs = smsReadyMs;
+    return true;
+}
+
+/*
+ * @brief Print boot type and boot-to-SMS-ready time, with the previous boot's for comparison.
+ */
+void BootState::printStats(Print& out) {
+    FixedPrintf(out, "Boot: %s boot #%u, modem %s\n", warm ? "fast" : "cold", (unsigned)saved.wakeCount,
+                modemWasOn() ? "kept on" : "powered up");
+    if (smsReadyMs != 0 && saved.lastSmsReadyMs != 0) {
+        FixedPrintf(out, "Boot: SMS ready after %u ms (previous boot %u ms)\n", (unsigned)smsReadyMs,
+                    (unsigned)saved.lastSmsReadyMs);
+    } else if (smsReadyMs != 0) {
+        FixedPrintf(out, "Boot: SMS ready after %u ms\n", (unsigned)smsReadyMs);
+    } else {
+        out.println("Boot: SMS not ready yet");
+    }
+}
@@ -0,0 +1,361 @@
+#include <string.h>
+#include <freertos/task.h>
+#include "fixLog.h"
+#include "heapMonitor.h"
+#include "fixedString.h"
+
+/*
+ * @brief CRC-16/CCITT-FALSE.
+ * @paramin crc Running value, to continue over several buffers.
+ */
+uint16_t Crc16(const uint8_t* data, size_t len, uint16_t crc) {
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+/*
+ * @brief Check a segment header.
+ * @paramout seq Sequence number of a valid segment.
+ */
+static bool headerValid(const uint8_t* block, uint32_t* seq) {
+    if (get32(block) != FIX_LOG_MAGIC || get16(block + 8) != Crc16(block, 8)) {
+        return false;
+    }
+    *seq = get32(block + 4);
+    return true;
+}
+
+/*
+ * @brief Count the records of a segment up to the first bad frame.
+ */
+static uint16_t validRecords(const uint8_t* block) {
+    uint16_t n = 0;
+    for (; n < FIX_LOG_RECORDS_PER_BLOCK; ++n) {
+        const uint8_t* frame = block + FIX_LOG_HEADER_LEN + n * FIX_LOG_FRAME_LEN;
+        if (frame[0] != FIX_LOG_RECORD_SYNC || frame[1] != sizeof(FixLogRecord_t) ||
+            get16(frame + 2 + sizeof(FixLogRecord_t)) != Crc16(frame + 1, 1 + sizeof(FixLogRecord_t))) {
+            break;
+        }
+    }
+    return n;
+}
+
+/*
+ * @brief FixLog constructor
+ * @paramin dev Block device holding the log, FIX_LOG_BLOCK_LEN bytes per block.
+ */
+FixLog::FixLog(BlockDevice& dev)
+    : dev(dev), queue(NULL), devLock(NULL), statsLock(portMUX_INITIALIZER_UNLOCKED), segBlock(0), segSeq(0),
+      segRecords(0), segWritten(0), dirtySinceMs(0) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+/*
+ * @brief Open the device, recover the log and start the writer task.
+ * @return false if the log is unavailable; append() then drops fixes.
+ */
+bool FixLog::begin() {
+    devLock = xSemaphoreCreateMutex();
+    if (devLock == NULL) {
+        return false;
+    }
+    if (dev.blockSize() != FIX_LOG_BLOCK_LEN || dev.blockCount() == 0 || !dev.open()) {
+        return false;
+    }
+    if (!recover()) {
+        return false;
+    }
+    queue = xQueueCreate(FIX_LOG_QUEUE_DEPTH, sizeof(FixLogRecord_t));
+    if (queue == NULL) {
+        return false;
+    }
+    return xTaskCreate(taskEntry, "FixLog", FIX_LOG_TASK_STACK_SIZE, this, FIX_LOG_TASK_PRIORITY, NULL) == pdPASS;
+}
+
+/*
+ * @brief Find the newest segment and continue after its last valid record.
+ */
+bool FixLog::recover() {
+    bool found = false;
+    uint32_t newestSeq = 0;
+    uint32_t newestBlock = 0;
+    for (uint32_t b = 0; b < dev.blockCount(); ++b) {
+        uint32_t seq;
+        if (!dev.read(b, segment)) {
+            return false;
+        }
+        if (headerValid(segment, &seq) && (!found || seq > newestSeq)) {
+            found = true;
+            newestSeq = seq;
+            newestBlock = b;
+        }
+    }
+    if (!found) {
+        openSegment(0, 1);
+        return true;
+    }
+    dev.read(newestBlock, segment);
+    uint16_t records = validRecords(segment);
+    stats.recovered = records;
+    if (records < FIX_LOG_RECORDS_PER_BLOCK) {
+        /* Keep filling the open segment; anything after a torn record is cleared */
+        size_t end = FIX_LOG_HEADER_LEN + records * FIX_LOG_FRAME_LEN;
+        memset(segment + end, 0, sizeof(segment) - end);
+        segBlock = newestBlock;
+        segSeq = newestSeq;
+        segRecords = records;
+        segWritten = records;
+    } else {
+        openSegment((newestBlock + 1) % dev.blockCount(), newestSeq + 1);
+    }
+    return true;
+}
+
+/*
+ * @brief Start an empty segment in RAM. It reaches the device with its first flush.
+ */
+void FixLog::openSegment(uint32_t block, uint32_t seq) {
+    memset(segment, 0, sizeof(segment));
+    put32(segment, FIX_LOG_MAGIC);
+    put32(segment + 4, seq);
+    put16(segment + 8, Crc16(segment, 8));
+    segBlock = block;
+    segSeq = seq;
+    segRecords = 0;
+    segWritten = 0;
+}
+
+/*
+ * @brief Queue a fix for the log. Never blocks.
+ * @return false if the fix has no valid time or the RAM buffer is full.
+ */
+bool FixLog::append(const GnssRecord_t& rec) {
+    FixLogRecord_t r;
+    uint32_t utc;
+    if (queue == NULL || !GnssRecordUnixTime(&rec, &utc)) {
+        return false;
+    }
+    r.utc = utc;
+    r.latE6 = rec.latE6;
+    r.lonE6 = rec.lonE6;
+    r.altitudeCm = rec.altitudeCm;
+    r.speedKmhX100 = rec.speedKmhX100;
+    r.courseX100 = rec.courseX100;
+    r.hdopX100 = rec.hdopX100;
+    r.satsUsed = rec.satsUsed;
+    r.flags = rec.fixValid ? 1 : 0;
+    bool queued = xQueueSend(queue, &r, 0) == pdTRUE;
+    portENTER_CRITICAL(&statsLock);
+    if (queued) {
+        stats.logged++;
+    } else {
+        stats.dropped++;
+    }
+    portEXIT_CRITICAL(&statsLock);
+    return queued;
+}
+
+/*
+ * @brief Ask the writer to put buffered fixes on the device now, e.g. before power-down.
+ */
+void FixLog::requestFlush() {
+    FixLogRecord_t marker;
+    memset(&marker, 0, sizeof(marker));
+    if (queue != NULL) {
+        xQueueSend(queue, &marker, 0);
+    }
+}
+
+/*
+ * @brief Whether the writer has nothing queued and no device write under way.
+ */
+bool FixLog::idle() {
+    if (queue == NULL) {
+        return true;
+    }
+    if (uxQueueMessagesWaiting(queue) != 0 || xSemaphoreTake(devLock, 0) != pdTRUE) {
+        return false;
+    }
+    xSemaphoreGive(devLock);
+    return true;
+}
+
+void FixLog::taskEntry(void* pvParameters) {
+    static_cast<FixLog*>(pvParameters)->run();
+}
+
+/*
+ * @brief Writer task: batch queued fixes into segments, flush full or aged segments.
+ */
+void FixLog::run() {
+    HeapMonitor::watchTask("fix log");
+    for (;;) {
+        TickType_t wait = portMAX_DELAY;
+        if (segRecords > segWritten) {
+            uint32_t age = millis() - dirtySinceMs;
+            wait = (age >= FIX_LOG_FLUSH_MS) ? 0 : pdMS_TO_TICKS(FIX_LOG_FLUSH_MS - age);
+        }
+        FixLogRecord_t rec;
+        if (xQueueReceive(queue, &rec, wait) == pdTRUE) {
+            if (rec.utc == 0) {
+                flushSegment();
+            } else {
+                addRecord(rec);
+            }
+        } else {
+            flushSegment();
+        }
+    }
+}
+
+/*
+ * @brief Frame a record into the open segment, writing the segment once it is full.
+ */
+void FixLog::addRecord(const FixLogRecord_t& rec) {
+    if (segRecords == FIX_LOG_RECORDS_PER_BLOCK) {
+        /* Previous write of a full segment failed: retry before taking more */
+        flushSegment();
+        if (segRecords == FIX_LOG_RECORDS_PER_BLOCK) {
+            portENTER_CRITICAL(&statsLock);
+            stats.dropped++;
+            portEXIT_CRITICAL(&statsLock);
+            return;
+        }
+    }
+    if (segRecords == segWritten) {
+        dirtySinceMs = millis();
+    }
+    uint8_t* frame = segment + FIX_LOG_HEADER_LEN + segRecords * FIX_LOG_FRAME_LEN;
+    frame[0] = FIX_LOG_RECORD_SYNC;
+    frame[1] = sizeof(FixLogRecord_t);
+    memcpy(frame + 2, &rec, sizeof(rec));
+    put16(frame + 2 + sizeof(rec), Crc16(frame + 1, 1 + sizeof(rec)));
+    segRecords++;
+    portENTER_CRITICAL(&statsLock);
+    stats.payloadBytes += sizeof(rec);
+    portEXIT_CRITICAL(&statsLock);
+    if (segRecords == FIX_LOG_RECORDS_PER_BLOCK) {
+        flushSegment();
+    }
+}
+
+/*
+ * @brief Write the open segment if it holds unwritten records and move on once it is full.
+ */
+void FixLog::flushSegment() {
+    if (segRecords == segWritten) {
+        return;
+    }
+    xSemaphoreTake(devLock, portMAX_DELAY);
+    uint32_t start = micros();
+    bool ok = dev.write(segBlock, segment) && dev.sync();
+    uint32_t elapsed = micros() - start;
+    portENTER_CRITICAL(&statsLock);
+    if (ok) {
+        stats.flushes++;
+        stats.deviceBytes += FIX_LOG_BLOCK_LEN;
+        stats.flushTotalUs += elapsed;
+        if (elapsed > stats.flushMaxUs) {
+            stats.flushMaxUs = elapsed;
+        }
+    } else {
+        stats.errors++;
+    }
+    portEXIT_CRITICAL(&statsLock);
+    if (!ok) {
+        xSemaphoreGive(devLock);
+        /* Keep the records and retry at the next flush */
+        dirtySinceMs = millis();
+        return;
+    }
+    segWritten = segRecords;
+    if (segRecords == FIX_LOG_RECORDS_PER_BLOCK) {
+        openSegment((segBlock + 1) % dev.blockCount(), segSeq + 1);
+    }
+    xSemaphoreGive(devLock);
+}
+
+/*
+ * @brief Sequence numbers of the segments the device can still hold: the open one and
+ *        up to one device lap before it. Any task.
+ * @return false if the log is unavailable.
+ */
+bool FixLog::seqRange(uint32_t* oldest, uint32_t* newest) {
+    if (queue == NULL) {
+        return false;
+    }
+    xSemaphoreTake(devLock, portMAX_DELAY);
+    *newest = segSeq;
+    *oldest = (segSeq > dev.blockCount()) ? segSeq - dev.blockCount() + 1 : 1;
+    xSemaphoreGive(devLock);
+    return true;
+}
+
+/*
+ * @brief Read one segment as it is on the device, between writes of the log task. Any task.
+ * @paramin seq Segment sequence number.
+ * @paramout block FIX_LOG_BLOCK_LEN bytes.
+ * @paramout records Valid records in the segment.
+ * @return false if the segment was overwritten, never written or cannot be read.
+ */
+bool FixLog::readSegment(uint32_t seq, uint8_t* block, uint16_t* records) {
+    if (queue == NULL) {
+        return false;
+    }
+    xSemaphoreTake(devLock, portMAX_DELAY);
+    bool ok = seq <= segSeq && segSeq - seq < dev.blockCount();
+    if (ok) {
+        uint32_t b = (segBlock + dev.blockCount() - (segSeq - seq)) % dev.blockCount();
+        ok = dev.read(b, block);
+    }
+    xSemaphoreGive(devLock);
+    uint32_t found;
+    if (!ok || !headerValid(block, &found) || found != seq) {
+        return false;
+    }
+    *records = validRecords(block);
+    return true;
+}
+
+void FixLog::getStats(FixLogStats_t* out) {
+    portENTER_CRITICAL(&statsLock);
+    *out = stats;
+    portEXIT_CRITICAL(&statsLock);
+}
+
+/*
+ * @brief Print fix counts, write amplification and flush latency.
+ */
+void FixLog::printStats(Print& out) {
+    FixLogStats_t s;
+    getStats(&s);
+    uint32_t amp = s.payloadBytes ? (uint32_t)((uint64_t)s.deviceBytes * 100 / s.payloadBytes) : 0;
+    FixedPrintf(out, "Fix log: %u logged, %u dropped, %u recovered at boot, %u errors\n",
+                (unsigned)s.logged, (unsigned)s.dropped, (unsigned)s.recovered, (unsigned)s.errors);
+    FixedPrintf(out, "Fix log: %u flushes, write amplification %u.%02u, flush avg %u us max %u us\n",
+                (unsigned)s.flushes, (unsigned)(amp / 100), (unsigned)(amp % 100),
+                (unsigned)(s.flushes ? s.flushTotalUs / s.flushes : 0), (unsigned)s.flushMaxUs);
+}
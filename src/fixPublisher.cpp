@@ -0,0 +1,75 @@
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "fixPublisher.h"
+
+/* Copies that may run into a publish before the reader gives up its time slice */
+#define FIX_READ_SPINS  (4)
+
+/*
+ * @brief FixPublisher constructor. Nothing is published until the first fix.
+ */
+FixPublisher::FixPublisher() : seq(0) {
+    for (size_t i = 0; i < WORDS; ++i) {
+        words[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+/*
+ * @brief Publish a new fix. Only one task may call this.
+ * @paramin sample Fix to publish, timestamped by the modem manager.
+ */
+void FixPublisher::publish(const GnssSample_t& sample) {
+    uint32_t buf[WORDS] = {};
+    memcpy(buf, &sample, sizeof(sample));
+    uint32_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    /* Readers that see the new words also see the odd sequence */
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; ++i) {
+        words[i].store(buf[i], std::memory_order_relaxed);
+    }
+    seq.store(s + 2, std::memory_order_release);
+}
+
+/*
+ * @brief Copy the latest fix without blocking the writer.
+ * @paramout snap Snapshot, with the fix age computed now.
+ * @return false if no fix has been published yet.
+ */
+bool FixPublisher::read(FixSnapshot_t* snap) const {
+    uint32_t buf[WORDS];
+    uint32_t before;
+    uint8_t spins = 0;
+    for (;;) {
+        before = seq.load(std::memory_order_acquire);
+        if ((before & 1) == 0) {
+            for (size_t i = 0; i < WORDS; ++i) {
+                buf[i] = words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq.load(std::memory_order_relaxed) == before) {
+                break;
+            }
+        }
+        if (++spins >= FIX_READ_SPINS) {
+            /* Writer was pre-empted mid-publish on its core */
+            spins = 0;
+            taskYIELD();
+        }
+    }
+    if (before == 0) {
+        return false;
+    }
+    memcpy(&snap->sample, buf, sizeof(snap->sample));
+    snap->sequence = before / 2;
+    snap->ageMs = millis() - snap->sample.timestampMs;
+    return true;
+}
+
+/*
+ * @brief Number of fixes published so far. Changes whenever a new fix is available.
+ */
+uint32_t FixPublisher::sequence() const {
+    return seq.load(std::memory_order_acquire) / 2;
+}
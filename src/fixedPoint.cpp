@@ -0,0 +1,78 @@
+#include "fixedPoint.h"
+
+/* sin(0..90 degrees) in Q15, one entry per degree */
+static const uint16_t sineTable[91] = {
+    0, 572, 1144, 1715, 2286, 2856, 3425, 3993, 4560, 5126, 5690, 6252, 6813, 7371, 7927, 8481,
+    9032, 9580, 10126, 10668, 11207, 11743, 12275, 12803, 13328, 13848, 14365, 14876, 15384, 15886, 16384, 16877,
+    17364, 17847, 18324, 18795, 19261, 19720, 20174, 20622, 21063, 21498, 21926, 22348, 22763, 23170, 23571, 23965,
+    24351, 24730, 25102, 25466, 25822, 26170, 26510, 26842, 27166, 27482, 27789, 28088, 28378, 28660, 28932, 29197,
+    29452, 29698, 29935, 30163, 30382, 30592, 30792, 30983, 31164, 31336, 31499, 31651, 31795, 31928, 32052, 32166,
+    32270, 32365, 32449, 32524, 32588, 32643, 32688, 32723, 32748, 32763, 32768
+};
+
+/*
+ * @brief sin() of an angle in degrees * 100, Q15, linearly interpolated.
+ */
+int32_t FixedSinX100(int32_t deg) {
+    deg %= 36000;
+    if (deg < 0) {
+        deg += 36000;
+    }
+    int32_t sign = 1;
+    if (deg >= 18000) {
+        deg -= 18000;
+        sign = -1;
+    }
+    if (deg > 9000) {
+        deg = 18000 - deg;
+    }
+    int32_t i = deg / 100;
+    int32_t frac = deg % 100;
+    int32_t v = sineTable[i] + (i < 90 ? (sineTable[i + 1] - sineTable[i]) * frac / 100 : 0);
+    return sign * v;
+}
+
+/*
+ * @brief Integer square root, rounded down.
+ */
+uint32_t FixedIsqrt64(uint64_t v) {
+    uint64_t bit = 1ULL << 62;
+    uint64_t root = 0;
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+/*
+ * @brief cos(latitude) in Q15 from the sine table, for turning longitude steps into distance.
+ * @paramin latE6 Latitude, degrees * 1e6.
+ */
+uint16_t FixedLonScaleQ15(int32_t latE6) {
+    /* cos(lat) = sin(90 - lat), latitude in degrees * 100 */
+    int32_t c = FixedSinX100(9000 - latE6 / 10000);
+    return (c < FIXED_LON_SCALE_MIN_Q15) ? FIXED_LON_SCALE_MIN_Q15 : (uint16_t)c;
+}
+
+/*
+ * @brief Equirectangular distance: exact enough over the few hundred metres between fixes,
+ *        with cos(latitude) taken at the midpoint.
+ * @paramin latA, lonA First point, degrees * 1e6.
+ * @paramin latB, lonB Second point, degrees * 1e6.
+ * @return Distance in centimetres.
+ */
+uint32_t FixedDistanceCm(int32_t latA, int32_t lonA, int32_t latB, int32_t lonB) {
+    int32_t cosQ15 = FixedLonScaleQ15(latA / 2 + latB / 2);
+    int64_t north = (int64_t)(latB - latA) * FIXED_M_PER_DEG_LAT / 10000;
+    int64_t east = ((int64_t)(lonB - lonA) * FIXED_M_PER_DEG_LAT / 10000 * cosQ15) >> 15;
+    return FixedIsqrt64((uint64_t)(north * north + east * east));
+}
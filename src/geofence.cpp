@@ -0,0 +1,503 @@
+#include <ctype.h>
+#include <string.h>
+#include <Preferences.h>
+#include "geofence.h"
+#include "fixedPoint.h"
+#include "fixedString.h"
+
+/* GEOFENCE_MARGIN_M in steps of latitude */
+static const int32_t marginQ = (int32_t)((uint32_t)GEOFENCE_MARGIN_M * 100000UL / FIXED_M_PER_DEG_LAT);
+
+static const char* const shapeNames[] = {"circle", "polygon"};
+
+static void copyName(char* dst, const char* src) {
+    strncpy(dst, src, GEOFENCE_NAME_LEN - 1);
+    dst[GEOFENCE_NAME_LEN - 1] = '\0';
+}
+
+/*
+ * @brief Geofence constructor
+ */
+Geofence::Geofence() : fenceCount(0), vertexCount(0), wideMask(0), knownMask(0), insideMask(0), persistent(false),
+                       lock(NULL) {
+    memset(fences, 0, sizeof(fences));
+    memset(vertices, 0, sizeof(vertices));
+    memset(grid, 0, sizeof(grid));
+    memset(streak, 0, sizeof(streak));
+    memset(&stats, 0, sizeof(stats));
+}
+
+/*
+ * @brief Load the fences saved in NVS. Changes made from now on are saved.
+ * @return false if the lock could not be created.
+ */
+bool Geofence::begin() {
+    lock = xSemaphoreCreateMutex();
+    if (lock == NULL) {
+        return false;
+    }
+    Preferences prefs;
+    if (prefs.begin(GEOFENCE_NVS_NAMESPACE, true)) {
+        size_t defLen = prefs.getBytes("defs", fences, sizeof(fences));
+        size_t vertLen = prefs.getBytes("verts", vertices, sizeof(vertices));
+        prefs.end();
+        fenceCount = (uint8_t)(defLen / sizeof(GeofenceDef_t));
+        vertexCount = (uint16_t)(vertLen / sizeof(GeofenceVertex_t));
+        for (uint8_t i = 0; i < fenceCount; ++i) {
+            const GeofenceDef_t& f = fences[i];
+            if (f.shape == GEOFENCE_POLYGON && (uint32_t)f.firstVertex + f.vertexCount > vertexCount) {
+                /* Saved halfway: start over rather than test against garbage */
+                fenceCount = 0;
+                vertexCount = 0;
+                break;
+            }
+        }
+    }
+    rebuildIndex();
+    persistent = true;
+    return true;
+}
+
+uint8_t Geofence::bucket(int32_t cellLat, int32_t cellLon) {
+    uint32_t h = (uint32_t)cellLat * 0x9E3779B1u ^ (uint32_t)cellLon * 0x85EBCA77u;
+    return (uint8_t)((h ^ (h >> 16)) % GEOFENCE_GRID_BUCKETS);
+}
+
+int Geofence::find(const char* name) const {
+    for (uint8_t i = 0; i < fenceCount; ++i) {
+        if (strncasecmp(fences[i].name, name, GEOFENCE_NAME_LEN - 1) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * @brief Bounding boxes, grid masks and the wide-fence mask from the definitions. Call with lock held.
+ */
+void Geofence::rebuildIndex() {
+    memset(grid, 0, sizeof(grid));
+    wideMask = 0;
+    for (uint8_t i = 0; i < fenceCount; ++i) {
+        const GeofenceDef_t& f = fences[i];
+        int32_t halfLat = (f.shape == GEOFENCE_CIRCLE) ? f.radiusQ + marginQ : marginQ;
+        int32_t halfLon = (int32_t)((int64_t)halfLat * 32768 / f.lonScaleQ15);
+        boxMinLatQ[i] = f.originLatQ - halfLat;
+        boxMinLonQ[i] = f.originLonQ - halfLon;
+        boxMaxLatQ[i] = f.originLatQ + f.spanLatQ + halfLat;
+        boxMaxLonQ[i] = f.originLonQ + f.spanLonQ + halfLon;
+
+        int32_t cellLat0 = boxMinLatQ[i] >> GEOFENCE_GRID_SHIFT;
+        int32_t cellLat1 = boxMaxLatQ[i] >> GEOFENCE_GRID_SHIFT;
+        int32_t cellLon0 = boxMinLonQ[i] >> GEOFENCE_GRID_SHIFT;
+        int32_t cellLon1 = boxMaxLonQ[i] >> GEOFENCE_GRID_SHIFT;
+        uint32_t bit = 1UL << i;
+        if ((cellLat1 - cellLat0 + 1) * (cellLon1 - cellLon0 + 1) > GEOFENCE_GRID_MAX_CELLS) {
+            wideMask |= bit;
+            continue;
+        }
+        for (int32_t y = cellLat0; y <= cellLat1; ++y) {
+            for (int32_t x = cellLon0; x <= cellLon1; ++x) {
+                grid[bucket(y, x)] |= bit;
+            }
+        }
+    }
+}
+
+/*
+ * @brief Save definitions and vertex pool. Call with lock held.
+ */
+void Geofence::persist() {
+    if (!persistent) {
+        return;
+    }
+    Preferences prefs;
+    if (!prefs.begin(GEOFENCE_NVS_NAMESPACE, false)) {
+        return;
+    }
+    prefs.putBytes("defs", fences, fenceCount * sizeof(GeofenceDef_t));
+    prefs.putBytes("verts", vertices, vertexCount * sizeof(GeofenceVertex_t));
+    prefs.end();
+}
+
+/*
+ * @brief Drop a fence, its vertices and its state, keeping the others in place. Call with lock held.
+ */
+void Geofence::removeAt(uint8_t idx) {
+    const GeofenceDef_t f = fences[idx];
+    if (f.shape == GEOFENCE_POLYGON) {
+        memmove(&vertices[f.firstVertex], &vertices[f.firstVertex + f.vertexCount],
+                (vertexCount - f.firstVertex - f.vertexCount) * sizeof(GeofenceVertex_t));
+        vertexCount = (uint16_t)(vertexCount - f.vertexCount);
+        for (uint8_t i = 0; i < fenceCount; ++i) {
+            if (fences[i].shape == GEOFENCE_POLYGON && fences[i].firstVertex > f.firstVertex) {
+                fences[i].firstVertex = (uint16_t)(fences[i].firstVertex - f.vertexCount);
+            }
+        }
+    }
+    memmove(&fences[idx], &fences[idx + 1], (fenceCount - idx - 1) * sizeof(GeofenceDef_t));
+    memmove(&streak[idx], &streak[idx + 1], (fenceCount - idx - 1) * sizeof(streak[0]));
+    fenceCount--;
+    /* Bits above idx move down one place */
+    uint32_t low = (1UL << idx) - 1;
+    knownMask = (knownMask & low) | ((knownMask >> 1) & ~low);
+    insideMask = (insideMask & low) | ((insideMask >> 1) & ~low);
+}
+
+/*
+ * @brief Add a fence, replacing one of the same name.
+ * @paramin def Definition; firstVertex is assigned here.
+ * @paramin verts Polygon vertices, relative to the origin.
+ * @return false if the fence or vertex pool is full.
+ */
+bool Geofence::add(const GeofenceDef_t& def, const GeofenceVertex_t* verts) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int existing = find(def.name);
+    uint8_t freeFences = (uint8_t)(GEOFENCE_MAX_FENCES - fenceCount + (existing >= 0 ? 1 : 0));
+    uint16_t freeVertices = (uint16_t)(GEOFENCE_MAX_VERTICES - vertexCount +
+                                       (existing >= 0 && fences[existing].shape == GEOFENCE_POLYGON
+                                            ? fences[existing].vertexCount : 0));
+    uint8_t needed = (def.shape == GEOFENCE_POLYGON) ? def.vertexCount : 0;
+    if (freeFences == 0 || needed > freeVertices) {
+        xSemaphoreGive(lock);
+        return false;
+    }
+    if (existing >= 0) {
+        removeAt((uint8_t)existing);
+    }
+    GeofenceDef_t& f = fences[fenceCount];
+    f = def;
+    if (needed > 0) {
+        f.firstVertex = vertexCount;
+        memcpy(&vertices[vertexCount], verts, needed * sizeof(GeofenceVertex_t));
+        vertexCount = (uint16_t)(vertexCount + needed);
+    }
+    /* State unknown until the next fix */
+    uint32_t bit = 1UL << fenceCount;
+    knownMask &= ~bit;
+    insideMask &= ~bit;
+    streak[fenceCount] = 0;
+    fenceCount++;
+    rebuildIndex();
+    persist();
+    xSemaphoreGive(lock);
+    return true;
+}
+
+/*
+ * @brief Add or replace a circular zone.
+ * @paramin radiusM Radius, 1 m to GEOFENCE_MAX_RADIUS_M.
+ */
+bool Geofence::addCircle(const char* name, int32_t latE6, int32_t lonE6, uint32_t radiusM) {
+    if (radiusM == 0 || radiusM > GEOFENCE_MAX_RADIUS_M) {
+        return false;
+    }
+    GeofenceDef_t def;
+    memset(&def, 0, sizeof(def));
+    copyName(def.name, name);
+    def.shape = GEOFENCE_CIRCLE;
+    def.originLatQ = latE6 / GEOFENCE_COORD_QUANT;
+    def.originLonQ = lonE6 / GEOFENCE_COORD_QUANT;
+    def.radiusQ = (uint16_t)((radiusM * 100000UL + FIXED_M_PER_DEG_LAT / 2) / FIXED_M_PER_DEG_LAT);
+    def.lonScaleQ15 = FixedLonScaleQ15(def.originLatQ * 10);
+    return add(def, NULL);
+}
+
+/*
+ * @brief Add or replace a polygonal zone. Edges may not cross; the last vertex joins the first.
+ * @paramin count 3 to GEOFENCE_MAX_POLY_VERTICES vertices.
+ * @return false if the polygon is too large or has too few or too many vertices.
+ */
+bool Geofence::addPolygon(const char* name, const int32_t* latE6, const int32_t* lonE6, uint8_t count) {
+    if (count < 3 || count > GEOFENCE_MAX_POLY_VERTICES) {
+        return false;
+    }
+    int32_t minLat = INT32_MAX, maxLat = INT32_MIN, minLon = INT32_MAX, maxLon = INT32_MIN;
+    for (uint8_t i = 0; i < count; ++i) {
+        int32_t lat = latE6[i] / GEOFENCE_COORD_QUANT;
+        int32_t lon = lonE6[i] / GEOFENCE_COORD_QUANT;
+        if (lat < minLat) {
+            minLat = lat;
+        }
+        if (lat > maxLat) {
+            maxLat = lat;
+        }
+        if (lon < minLon) {
+            minLon = lon;
+        }
+        if (lon > maxLon) {
+            maxLon = lon;
+        }
+    }
+    if (maxLat - minLat > INT16_MAX || maxLon - minLon > INT16_MAX) {
+        return false;
+    }
+    GeofenceDef_t def;
+    memset(&def, 0, sizeof(def));
+    copyName(def.name, name);
+    def.shape = GEOFENCE_POLYGON;
+    def.vertexCount = count;
+    def.originLatQ = minLat;
+    def.originLonQ = minLon;
+    def.spanLatQ = (int16_t)(maxLat - minLat);
+    def.spanLonQ = (int16_t)(maxLon - minLon);
+    def.lonScaleQ15 = FixedLonScaleQ15((minLat + def.spanLatQ / 2) * 10);
+    GeofenceVertex_t verts[GEOFENCE_MAX_POLY_VERTICES];
+    for (uint8_t i = 0; i < count; ++i) {
+        verts[i].latQ = (int16_t)(latE6[i] / GEOFENCE_COORD_QUANT - minLat);
+        verts[i].lonQ = (int16_t)(lonE6[i] / GEOFENCE_COORD_QUANT - minLon);
+    }
+    return add(def, verts);
+}
+
+/*
+ * @brief Delete a fence by name (case-insensitive).
+ * @return false if there is no such fence.
+ */
+bool Geofence::remove(const char* name) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int idx = find(name);
+    if (idx >= 0) {
+        removeAt((uint8_t)idx);
+        rebuildIndex();
+        persist();
+    }
+    xSemaphoreGive(lock);
+    return idx >= 0;
+}
+
+uint8_t Geofence::count() {
+    return fenceCount;
+}
+
+/*
+ * @brief Circle test in latitude steps, longitude scaled by cos(latitude).
+ */
+bool Geofence::insideCircle(const GeofenceDef_t& f, int32_t latQ, int32_t lonQ, bool wasInside) const {
+    int64_t dy = latQ - f.originLatQ;
+    int64_t dx = ((int64_t)(lonQ - f.originLonQ) * f.lonScaleQ15) >> 15;
+    int64_t r = f.radiusQ + (wasInside ? marginQ : 0);
+    return dx * dx + dy * dy <= r * r;
+}
+
+/*
+ * @brief Crossing-number test on the vertex offsets. A point that was inside stays inside
+ *        while it is within the margin of an edge.
+ */
+bool Geofence::insidePolygon(const GeofenceDef_t& f, int32_t latQ, int32_t lonQ, bool wasInside) const {
+    const GeofenceVertex_t* v = &vertices[f.firstVertex];
+    int32_t py = latQ - f.originLatQ;
+    int32_t px = lonQ - f.originLonQ;
+    bool inside = false;
+    for (uint8_t i = 0, j = f.vertexCount - 1; i < f.vertexCount; j = i++) {
+        int32_t yi = v[i].latQ, yj = v[j].latQ;
+        if ((yi > py) != (yj > py)) {
+            /* px < xi + (xj - xi) * (py - yi) / (yj - yi), without the division */
+            int64_t lhs = (int64_t)(px - v[i].lonQ) * (yj - yi);
+            int64_t rhs = (int64_t)(v[j].lonQ - v[i].lonQ) * (py - yi);
+            if ((yj > yi) ? (lhs < rhs) : (lhs > rhs)) {
+                inside = !inside;
+            }
+        }
+    }
+    if (inside || !wasInside) {
+        return inside;
+    }
+    /* Distance to the nearest edge, longitude scaled to latitude steps */
+    int64_t sx = ((int64_t)px * f.lonScaleQ15) >> 15;
+    for (uint8_t i = 0, j = f.vertexCount - 1; i < f.vertexCount; j = i++) {
+        int64_t ax = ((int64_t)v[j].lonQ * f.lonScaleQ15) >> 15;
+        int64_t ay = v[j].latQ;
+        int64_t ex = (((int64_t)v[i].lonQ * f.lonScaleQ15) >> 15) - ax;
+        int64_t ey = v[i].latQ - ay;
+        int64_t qx = sx - ax;
+        int64_t qy = py - ay;
+        int64_t dot = qx * ex + qy * ey;
+        int64_t len2 = ex * ex + ey * ey;
+        if (dot <= 0 || len2 == 0) {
+            if (qx * qx + qy * qy <= (int64_t)marginQ * marginQ) {
+                return true;
+            }
+        } else if (dot >= len2) {
+            int64_t bx = qx - ex, by = qy - ey;
+            if (bx * bx + by * by <= (int64_t)marginQ * marginQ) {
+                return true;
+            }
+        } else {
+            int64_t cross = qx * ey - qy * ex;
+            if (cross < 0) {
+                cross = -cross;
+            }
+            if ((uint64_t)cross <= (uint64_t)marginQ * FixedIsqrt64((uint64_t)len2)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/*
+ * @brief Check a fix against the fences near it and report zones entered or left.
+ *        Runs on every accepted fix in gpsTask.
+ * @paramout events Confirmed changes; further changes are applied but not reported.
+ * @return Number of events.
+ */
+size_t Geofence::evaluate(int32_t latE6, int32_t lonE6, GeofenceEvent_t* events, size_t max) {
+    uint32_t startUs = micros();
+    int32_t latQ = latE6 / GEOFENCE_COORD_QUANT;
+    int32_t lonQ = lonE6 / GEOFENCE_COORD_QUANT;
+    size_t n = 0;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint32_t all = (fenceCount >= 32) ? 0xFFFFFFFFUL : ((1UL << fenceCount) - 1);
+    uint32_t pending = 0;
+    for (uint8_t i = 0; i < fenceCount; ++i) {
+        if (streak[i] != 0) {
+            pending |= 1UL << i;
+        }
+    }
+    /* Near the fix, or whose state may change without the fix being near */
+    uint32_t candidates = grid[bucket(latQ >> GEOFENCE_GRID_SHIFT, lonQ >> GEOFENCE_GRID_SHIFT)] | wideMask |
+                          insideMask | pending | (all & ~knownMask);
+    candidates &= all;
+    uint32_t tested = 0;
+    for (uint32_t m = candidates; m != 0; m &= m - 1) {
+        uint8_t i = (uint8_t)__builtin_ctz(m);
+        uint32_t bit = 1UL << i;
+        bool wasInside = (insideMask & bit) != 0;
+        bool inside = false;
+        if (latQ >= boxMinLatQ[i] && latQ <= boxMaxLatQ[i] && lonQ >= boxMinLonQ[i] && lonQ <= boxMaxLonQ[i]) {
+            tested++;
+            inside = (fences[i].shape == GEOFENCE_CIRCLE) ? insideCircle(fences[i], latQ, lonQ, wasInside)
+                                                          : insidePolygon(fences[i], latQ, lonQ, wasInside);
+        }
+        if (!(knownMask & bit)) {
+            knownMask |= bit;
+            insideMask = inside ? (insideMask | bit) : (insideMask & ~bit);
+            streak[i] = 0;
+        } else if (inside == wasInside) {
+            streak[i] = 0;
+        } else if (++streak[i] >= GEOFENCE_CONFIRM_FIXES) {
+            streak[i] = 0;
+            insideMask ^= bit;
+            if (inside) {
+                stats.entered++;
+            } else {
+                stats.left++;
+            }
+            if (n < max) {
+                copyName(events[n].name, fences[i].name);
+                events[n].entered = inside;
+                n++;
+            }
+        }
+    }
+    uint32_t elapsed = micros() - startUs;
+    stats.evaluations++;
+    stats.candidates += tested;
+    stats.evalTotalUs += elapsed;
+    if (elapsed > stats.evalMaxUs) {
+        stats.evalMaxUs = elapsed;
+    }
+    xSemaphoreGive(lock);
+    return n;
+}
+
+/*
+ * @brief One line per fence for an SMS reply: name, shape, size and state.
+ */
+void Geofence::list(char* out, size_t max) {
+    FixedString<FIXED_PRINTF_MAX_LEN> text;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (fenceCount == 0) {
+        text.append("No fences");
+    }
+    for (uint8_t i = 0; i < fenceCount; ++i) {
+        const GeofenceDef_t& f = fences[i];
+        uint32_t bit = 1UL << i;
+        const char* state = !(knownMask & bit) ? "?" : (insideMask & bit) ? "in" : "out";
+        if (f.shape == GEOFENCE_CIRCLE) {
+            text.appendf("%s%s %um %s", i ? "\n" : "", f.name,
+                         (unsigned)((uint32_t)f.radiusQ * FIXED_M_PER_DEG_LAT / 100000), state);
+        } else {
+            text.appendf("%s%s %up %s", i ? "\n" : "", f.name, (unsigned)f.vertexCount, state);
+        }
+    }
+    xSemaphoreGive(lock);
+    strncpy(out, text.c_str(), max - 1);
+    out[max - 1] = '\0';
+}
+
+void Geofence::getStats(GeofenceStats_t* out) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(lock);
+}
+
+/*
+ * @brief Print evaluation cost, alerts and every fence with its state.
+ */
+void Geofence::printStats(Print& out) {
+    GeofenceStats_t s;
+    getStats(&s);
+    FixedPrintf(out, "Geofence: %u fences, %u/%u vertices, entered %u, left %u\n", (unsigned)fenceCount,
+                (unsigned)vertexCount, (unsigned)GEOFENCE_MAX_VERTICES, (unsigned)s.entered, (unsigned)s.left);
+    FixedPrintf(out, "Geofence: %u fixes checked, avg %u us max %u us, %u.%02u exact tests per fix\n",
+                (unsigned)s.evaluations, (unsigned)(s.evaluations ? s.evalTotalUs / s.evaluations : 0),
+                (unsigned)s.evalMaxUs, (unsigned)(s.evaluations ? s.candidates / s.evaluations : 0),
+                (unsigned)(s.evaluations ? s.candidates * 100 / s.evaluations % 100 : 0));
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < fenceCount; ++i) {
+        const GeofenceDef_t& f = fences[i];
+        uint32_t bit = 1UL << i;
+        FixedPrintf(out, "  %s: %s, %s%s\n", f.name, shapeNames[f.shape], !(knownMask & bit) ? "state unknown" :
+                    (insideMask & bit) ? "inside" : "outside", (wideMask & bit) ? ", checked on every fix" : "");
+    }
+    xSemaphoreGive(lock);
+}
+
+/*
+ * @brief Parse decimal degrees "lat,lon" (up to 6 decimals), e.g. "20.558853,-103.428903".
+ * @return Pointer past the point, or NULL if there is none or it is out of range.
+ */
+static const char* parseDegrees(const char* p, int32_t limit, int32_t* e6) {
+    bool neg = (*p == '-');
+    if (*p == '-' || *p == '+') {
+        p++;
+    }
+    if (!isdigit((unsigned char)*p)) {
+        return NULL;
+    }
+    int32_t whole = 0;
+    while (isdigit((unsigned char)*p) && whole <= limit) {
+        whole = whole * 10 + (*p++ - '0');
+    }
+    int32_t frac = 0;
+    int32_t scale = 1000000;
+    if (*p == '.') {
+        p++;
+        while (isdigit((unsigned char)*p)) {
+            if (scale > 1) {
+                scale /= 10;
+                frac += (*p - '0') * scale;
+            }
+            p++;
+        }
+    }
+    int64_t value = (int64_t)whole * 1000000 + frac;
+    if (value > (int64_t)limit * 1000000) {
+        return NULL;
+    }
+    *e6 = (int32_t)(neg ? -value : value);
+    return p;
+}
+
+const char* GeofenceParsePoint(const char* text, int32_t* latE6, int32_t* lonE6) {
+    while (isspace((unsigned char)*text)) {
+        text++;
+    }
+    const char* p = parseDegrees(text, 90, latE6);
+    if (p == NULL || *p != ',') {
+        return NULL;
+    }
+    return parseDegrees(p + 1, 180, lonE6);
+}
@@ -0,0 +1,311 @@
+#include <string.h>
+#include "gnssParser.h"
+
+/* +CGNSINF field positions (SIM7070 AT Command Manual, AT+CGNSINF) */
+enum {
+    CGNSINF_RUN_STATUS = 0,
+    CGNSINF_FIX_STATUS,
+    CGNSINF_UTC,
+    CGNSINF_LATITUDE,
+    CGNSINF_LONGITUDE,
+    CGNSINF_ALTITUDE,
+    CGNSINF_SPEED,
+    CGNSINF_COURSE,
+    CGNSINF_FIX_MODE,
+    CGNSINF_RESERVED1,
+    CGNSINF_HDOP,
+    CGNSINF_PDOP,
+    CGNSINF_VDOP,
+    CGNSINF_RESERVED2,
+    CGNSINF_SATS_IN_VIEW,
+    CGNSINF_GPS_USED,
+    CGNSINF_GLONASS_USED
+};
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/*
+ * @brief Parse an unsigned decimal field. An empty field yields 0.
+ * @paramin p Field start.
+ * @paramin end One past the field end.
+ * @paramin maxValue Largest accepted value.
+ * @paramout out Parsed value.
+ * @return false on a non-digit character or an out of range value.
+ */
+static bool parseUnsigned(const char* p, const char* end, uint32_t maxValue, uint32_t* out) {
+    uint32_t value = 0;
+    for (; p < end; ++p) {
+        if (!isDigit(*p)) {
+            return false;
+        }
+        value = value * 10 + (uint32_t)(*p - '0');
+        if (value > maxValue) {
+            return false;
+        }
+    }
+    *out = value;
+    return true;
+}
+
+/*
+ * @brief Parse a signed decimal field into a fixed-point integer.
+ *        Digits beyond the requested precision are rounded away. An empty field yields 0.
+ * @paramin p Field start.
+ * @paramin end One past the field end.
+ * @paramin decimals Number of fractional digits kept (value scaled by 10^decimals).
+ * @paramin minValue Smallest accepted scaled value.
+ * @paramin maxValue Largest accepted scaled value.
+ * @paramout out Parsed scaled value.
+ * @return false on a malformed number or an out of range value.
+ */
+static bool parseFixed(const char* p, const char* end, uint8_t decimals,
+                       int32_t minValue, int32_t maxValue, int32_t* out) {
+    if (p == end) {
+        *out = 0;
+        return true;
+    }
+    bool negative = false;
+    if (*p == '-' || *p == '+') {
+        negative = (*p == '-');
+        ++p;
+    }
+    int64_t value = 0;
+    uint8_t intDigits = 0;
+    for (; p < end && isDigit(*p); ++p) {
+        if (++intDigits > 9) {
+            return false;
+        }
+        value = value * 10 + (*p - '0');
+    }
+    uint8_t fracDigits = 0;
+    bool roundUp = false;
+    if (p < end && *p == '.') {
+        ++p;
+        for (; p < end && isDigit(*p); ++p) {
+            if (fracDigits < decimals) {
+                value = value * 10 + (*p - '0');
+                fracDigits++;
+            } else if (fracDigits == decimals) {
+                roundUp = (*p >= '5');
+                fracDigits++;
+            }
+        }
+    }
+    if (p != end || intDigits == 0) {
+        return false;
+    }
+    for (; fracDigits < decimals; ++fracDigits) {
+        value *= 10;
+    }
+    if (roundUp) {
+        value++;
+    }
+    if (negative) {
+        value = -value;
+    }
+    if (value < minValue || value > maxValue) {
+        return false;
+    }
+    *out = (int32_t)value;
+    return true;
+}
+
+/*
+ * @brief Parse the UTC field "yyyyMMddhhmmss.sss". An empty field is accepted.
+ * @paramin p Field start.
+ * @paramin end One past the field end.
+ * @paramout rec Record receiving the date and time.
+ * @return false if the field is present but malformed.
+ */
+static bool parseUtc(const char* p, const char* end, GnssRecord_t* rec) {
+    size_t len = (size_t)(end - p);
+    if (len == 0) {
+        return true;
+    }
+    if (len < 14) {
+        return false;
+    }
+    for (size_t i = 0; i < 14; ++i) {
+        if (!isDigit(p[i])) {
+            return false;
+        }
+    }
+    rec->year   = (uint16_t)((p[0] - '0') * 1000 + (p[1] - '0') * 100 + (p[2] - '0') * 10 + (p[3] - '0'));
+    rec->month  = (uint8_t)((p[4] - '0') * 10 + (p[5] - '0'));
+    rec->day    = (uint8_t)((p[6] - '0') * 10 + (p[7] - '0'));
+    rec->hour   = (uint8_t)((p[8] - '0') * 10 + (p[9] - '0'));
+    rec->minute = (uint8_t)((p[10] - '0') * 10 + (p[11] - '0'));
+    rec->second = (uint8_t)((p[12] - '0') * 10 + (p[13] - '0'));
+    if (rec->month < 1 || rec->month > 12 || rec->day < 1 || rec->day > 31 ||
+        rec->hour > 23 || rec->minute > 59 || rec->second > 60) {
+        return false;
+    }
+    uint16_t ms = 0;
+    if (len > 14) {
+        if (p[14] != '.') {
+            return false;
+        }
+        uint8_t digits = 0;
+        for (const char* q = p + 15; q < end; ++q) {
+            if (!isDigit(*q)) {
+                return false;
+            }
+            if (digits < 3) {
+                ms = (uint16_t)(ms * 10 + (*q - '0'));
+                digits++;
+            }
+        }
+        for (; digits < 3; ++digits) {
+            ms = (uint16_t)(ms * 10);
+        }
+    }
+    rec->millisecond = ms;
+    return true;
+}
+
+/*
+ * @brief Parse a +CGNSINF / +UGNSINF report into a GNSS record without heap allocation.
+ * @paramin line Raw response line, with or without the "+CGNSINF:" prefix.
+ * @paramin len Line length in bytes (no terminator required).
+ * @paramout rec Record to fill. Cleared on failure.
+ * @return true if all mandatory fields were present and well formed.
+ */
+bool GnssParseCgnsinf(const char* line, size_t len, GnssRecord_t* rec) {
+    memset(rec, 0, sizeof(*rec));
+    if (line == NULL) {
+        return false;
+    }
+    const char* p = line;
+    const char* end = line + len;
+
+    /* Trim trailing line terminators and leading blanks */
+    while (end > p && (end[-1] == '\r' || end[-1] == '\n' || end[-1] == ' ')) {
+        --end;
+    }
+    while (p < end && *p == ' ') {
+        ++p;
+    }
+    /* Skip optional "+CGNSINF:" / "+UGNSINF:" prefix */
+    if (p < end && *p == '+') {
+        const char* colon = (const char*)memchr(p, ':', (size_t)(end - p));
+        if (colon == NULL) {
+            return false;
+        }
+        p = colon + 1;
+        while (p < end && *p == ' ') {
+            ++p;
+        }
+    }
+
+    GnssRecord_t out;
+    memset(&out, 0, sizeof(out));
+    uint8_t field = 0;
+    uint32_t gpsUsed = 0;
+    uint32_t glonassUsed = 0;
+    bool ok = true;
+    while (ok) {
+        const char* fieldEnd = p;
+        while (fieldEnd < end && *fieldEnd != ',') {
+            ++fieldEnd;
+        }
+        uint32_t u = 0;
+        int32_t s = 0;
+        switch (field) {
+            case CGNSINF_RUN_STATUS:
+                ok = parseUnsigned(p, fieldEnd, 1, &u) && (fieldEnd > p);
+                out.runStatus = (u == 1);
+                break;
+            case CGNSINF_FIX_STATUS:
+                ok = parseUnsigned(p, fieldEnd, 1, &u);
+                out.fixValid = (u == 1);
+                break;
+            case CGNSINF_UTC:
+                ok = parseUtc(p, fieldEnd, &out);
+                break;
+            case CGNSINF_LATITUDE:
+                ok = parseFixed(p, fieldEnd, 6, -90 * GNSS_COORD_SCALE, 90 * GNSS_COORD_SCALE, &out.latE6);
+                break;
+            case CGNSINF_LONGITUDE:
+                ok = parseFixed(p, fieldEnd, 6, -180 * GNSS_COORD_SCALE, 180 * GNSS_COORD_SCALE, &out.lonE6);
+                break;
+            case CGNSINF_ALTITUDE:
+                ok = parseFixed(p, fieldEnd, 2, -100000000L, 100000000L, &out.altitudeCm);
+                break;
+            case CGNSINF_SPEED:
+                ok = parseFixed(p, fieldEnd, 2, 0, UINT16_MAX, &s);
+                out.speedKmhX100 = (uint16_t)s;
+                break;
+            case CGNSINF_COURSE:
+                ok = parseFixed(p, fieldEnd, 2, 0, 36000, &s);
+                out.courseX100 = (uint16_t)s;
+                break;
+            case CGNSINF_FIX_MODE:
+                ok = parseUnsigned(p, fieldEnd, UINT8_MAX, &u);
+                out.fixMode = (uint8_t)u;
+                break;
+            case CGNSINF_HDOP:
+                ok = parseFixed(p, fieldEnd, 2, 0, UINT16_MAX, &s);
+                out.hdopX100 = (uint16_t)s;
+                break;
+            case CGNSINF_PDOP:
+                ok = parseFixed(p, fieldEnd, 2, 0, UINT16_MAX, &s);
+                out.pdopX100 = (uint16_t)s;
+                break;
+            case CGNSINF_SATS_IN_VIEW:
+                ok = parseUnsigned(p, fieldEnd, UINT8_MAX, &u);
+                out.satsInView = (uint8_t)u;
+                break;
+            case CGNSINF_GPS_USED:
+                ok = parseUnsigned(p, fieldEnd, UINT8_MAX, &gpsUsed);
+                break;
+            case CGNSINF_GLONASS_USED:
+                ok = parseUnsigned(p, fieldEnd, UINT8_MAX, &glonassUsed);
+                break;
+            default:
+                /* Reserved, VDOP, C/N0, HPA and VPA are not kept */
+                break;
+        }
+        field++;
+        if (fieldEnd >= end) {
+            break;
+        }
+        p = fieldEnd + 1;
+    }
+
+    if (!ok || field < GNSS_CGNSINF_FIELDS) {
+        return false;
+    }
+    uint32_t used = gpsUsed + glonassUsed;
+    out.satsUsed = (uint8_t)(used > UINT8_MAX ? UINT8_MAX : used);
+    *rec = out;
+    return true;
+}
+
+/*
+ * @brief Days since 1970-01-01 for a civil date.
+ */
+static long daysFromCivil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    long era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (long)doe - 719468;
+}
+
+/*
+ * @brief Convert the UTC fields of a record to Unix time.
+ * @paramin rec Parsed record.
+ * @paramout unixTime Seconds since 1970-01-01 00:00:00 UTC.
+ * @return false if the date is missing or implausible.
+ */
+bool GnssRecordUnixTime(const GnssRecord_t* rec, uint32_t* unixTime) {
+    if (rec->year < 2020 || rec->month < 1 || rec->month > 12 || rec->day < 1 || rec->day > 31) {
+        return false;
+    }
+    long days = daysFromCivil(rec->year, rec->month, rec->day);
+    *unixTime = (uint32_t)days * 86400UL + rec->hour * 3600UL + rec->minute * 60UL + rec->second;
+    return true;
+}
@@ -0,0 +1,220 @@
+#include <string.h>
+#include "gnssScheduler.h"
+#include "fixedPoint.h"
+
+static const char* const startModeNames[] = {"cold", "warm", "hot"};
+
+/*
+ * @brief Absolute difference between two courses, 0 to 180 degrees * 100.
+ */
+static uint16_t courseDelta(uint16_t a, uint16_t b) {
+    uint16_t d = (a > b) ? (uint16_t)(a - b) : (uint16_t)(b - a);
+    return (d > 18000) ? (uint16_t)(36000 - d) : d;
+}
+
+/*
+ * @brief GnssScheduler constructor
+ */
+GnssScheduler::GnssScheduler()
+    : haveFix(false), lastFixMs(0), lastLatE6(0), lastLonE6(0), lastCourseX100(0), ephemerisLost(false),
+      searchStartMs(0), searchMode(GNSS_START_COLD), searching(false), tracking(false),
+      intervalMs(GNSS_INTERVAL_PARKED_MIN_MS), isParked(false), turning(false) {
+    memset(ttff, 0, sizeof(ttff));
+}
+
+/*
+ * @brief Take over the last fix from before a deep sleep.
+ * @paramin rec Last fix.
+ * @paramin ageMs Age of the fix by the system clock.
+ * @paramin nowMs millis() now.
+ * @paramin receiverKept The modem stayed powered, so the receiver still holds its ephemeris.
+ */
+void GnssScheduler::restore(const GnssRecord_t& rec, uint32_t ageMs, uint32_t nowMs, bool receiverKept) {
+    if (ageMs > GNSS_HOT_MAX_AGE_MS) {
+        /* Only the hot/warm decision depends on it; keep clear of millis() wrap-around */
+        ageMs = GNSS_HOT_MAX_AGE_MS + 1;
+    }
+    haveFix = true;
+    lastFixMs = nowMs - ageMs;
+    lastLatE6 = rec.latE6;
+    lastLonE6 = rec.lonE6;
+    lastCourseX100 = rec.courseX100;
+    ephemerisLost = !receiverKept;
+}
+
+/*
+ * @brief The modem was power cycled: the next start is warm at best.
+ */
+void GnssScheduler::receiverReset() {
+    ephemerisLost = true;
+}
+
+/*
+ * @brief Note the start of a search.
+ * @paramin nowMs Time the receiver was enabled.
+ * @paramin tracking Receiver stayed powered since the last fix; not counted as a time-to-first-fix.
+ * @return Start mode expected from the age of the last fix. A search resumed after
+ *         pre-emption keeps its original start time and mode.
+ */
+GnssStartMode GnssScheduler::beginSearch(uint32_t nowMs, bool tracking) {
+    if (searching) {
+        /* Resumed after pre-emption: same search, same budget */
+        return searchMode;
+    }
+    if (tracking || (haveFix && nowMs - lastFixMs <= GNSS_HOT_MAX_AGE_MS)) {
+        searchMode = (ephemerisLost && !tracking) ? GNSS_START_WARM : GNSS_START_HOT;
+    } else {
+        searchMode = haveFix ? GNSS_START_WARM : GNSS_START_COLD;
+    }
+    searchStartMs = nowMs;
+    searching = true;
+    this->tracking = tracking;
+    if (!tracking) {
+        ttff[searchMode].searches++;
+    }
+    return searchMode;
+}
+
+uint32_t GnssScheduler::searchBudgetMs() const {
+    if (searchMode == GNSS_START_HOT) {
+        return GNSS_SEARCH_HOT_MS;
+    }
+    return (searchMode == GNSS_START_WARM) ? GNSS_SEARCH_WARM_MS : GNSS_SEARCH_COLD_MS;
+}
+
+/*
+ * @brief Decide whether a fix is good enough to end the search.
+ * @return true for a valid fix meeting the HDOP and satellite thresholds, or any
+ *         valid fix once GNSS_ACCEPT_GRACE_PCT of the search budget has passed.
+ */
+bool GnssScheduler::acceptable(const GnssRecord_t& rec, uint32_t nowMs) const {
+    if (!rec.fixValid) {
+        return false;
+    }
+    if (rec.hdopX100 != 0 && rec.hdopX100 <= GNSS_ACCEPT_HDOP_X100 && rec.satsUsed >= GNSS_ACCEPT_MIN_SATS) {
+        return true;
+    }
+    return nowMs - searchStartMs >= searchBudgetMs() / 100 * GNSS_ACCEPT_GRACE_PCT;
+}
+
+bool GnssScheduler::searchExpired(uint32_t nowMs) const {
+    return searching && nowMs - searchStartMs >= searchBudgetMs();
+}
+
+/*
+ * @brief End the search with a fix and pick the interval to the next one.
+ *        Parked: doubling from GNSS_INTERVAL_PARKED_MIN_MS up to GNSS_INTERVAL_PARKED_MAX_MS.
+ *        Moving: the time to cover GNSS_TARGET_SPACING_M at the current speed, halved on a turn.
+ */
+void GnssScheduler::fixAccepted(const GnssRecord_t& rec, uint32_t nowMs) {
+    if (searching && !tracking) {
+        GnssTtffStats_t& s = ttff[searchMode];
+        HistogramAdd(&s.ttff, nowMs - searchStartMs);
+        s.fixes++;
+    }
+    searching = false;
+    ephemerisLost = false;
+
+    /* Position jitter grows with HDOP; don't mistake it for movement */
+    uint32_t radius = GNSS_PARKED_RADIUS_M + (uint32_t)rec.hdopX100 * GNSS_PARKED_RADIUS_M / 100 / 2;
+    bool slow = rec.speedKmhX100 < GNSS_PARKED_SPEED_KMH_X100;
+    bool stayed = !haveFix || FixedDistanceCm(lastLatE6, lastLonE6, rec.latE6, rec.lonE6) / 100 <= radius;
+    if (slow && stayed) {
+        intervalMs = isParked ? intervalMs * 2 : GNSS_INTERVAL_PARKED_MIN_MS;
+        if (intervalMs > GNSS_INTERVAL_PARKED_MAX_MS) {
+            intervalMs = GNSS_INTERVAL_PARKED_MAX_MS;
+        }
+        isParked = true;
+    } else {
+        /* km/h * 100 to m/s is a division by 360 */
+        intervalMs = slow ? GNSS_INTERVAL_MOVING_MAX_MS
+                          : (uint32_t)((uint64_t)GNSS_TARGET_SPACING_M * 360000 / rec.speedKmhX100);
+        turning = !slow && !isParked && haveFix && courseDelta(lastCourseX100, rec.courseX100) >= GNSS_TURN_DEG * 100;
+        if (turning) {
+            intervalMs /= 2;
+        }
+        if (intervalMs < GNSS_INTERVAL_MIN_MS) {
+            intervalMs = GNSS_INTERVAL_MIN_MS;
+        } else if (intervalMs > GNSS_INTERVAL_MOVING_MAX_MS) {
+            intervalMs = GNSS_INTERVAL_MOVING_MAX_MS;
+        }
+        isParked = false;
+    }
+
+    haveFix = true;
+    lastFixMs = nowMs;
+    lastLatE6 = rec.latE6;
+    lastLonE6 = rec.lonE6;
+    lastCourseX100 = rec.courseX100;
+}
+
+/*
+ * @brief End the search without a fix, e.g. indoors; try again after GNSS_INTERVAL_FAILED_MS.
+ */
+void GnssScheduler::searchFailed(uint32_t nowMs) {
+    (void)nowMs;
+    if (searching && !tracking) {
+        ttff[searchMode].timeouts++;
+    }
+    searching = false;
+    intervalMs = GNSS_INTERVAL_FAILED_MS;
+}
+
+/*
+ * @brief Stretch the interval after the last fix while riding a steady line, e.g. as far as
+ *        the track filter can bridge. Never while parked or turning, never past
+ *        GNSS_INTERVAL_MOVING_MAX_MS.
+ * @paramin ms Interval wanted.
+ */
+void GnssScheduler::extendInterval(uint32_t ms) {
+    if (isParked || turning || ms <= intervalMs) {
+        return;
+    }
+    intervalMs = (ms > GNSS_INTERVAL_MOVING_MAX_MS) ? GNSS_INTERVAL_MOVING_MAX_MS : ms;
+}
+
+/*
+ * @brief Time from the last fix to the next search.
+ */
+uint32_t GnssScheduler::nextIntervalMs() const {
+    return intervalMs;
+}
+
+/*
+ * @brief Time between position polls during a search.
+ */
+uint32_t GnssScheduler::pollIntervalMs() const {
+    return (searchMode == GNSS_START_HOT) ? 1000 : 2000;
+}
+
+/*
+ * @brief Whether the receiver should stay powered until the next fix is due.
+ */
+bool GnssScheduler::keepReceiverOn() const {
+    return !isParked && intervalMs <= GNSS_KEEP_ON_MAX_MS;
+}
+
+bool GnssScheduler::parked() const {
+    return isParked;
+}
+
+void GnssScheduler::getStats(GnssStartMode mode, GnssTtffStats_t* stats) const {
+    *stats = ttff[mode];
+}
+
+/*
+ * @brief Print the current interval and time-to-first-fix per start mode.
+ */
+void GnssScheduler::printStats(Print& out) const {
+    FixedPrintf(out, "GNSS schedule: next fix in %u s (%s)\n", (unsigned)(intervalMs / 1000),
+                isParked ? "parked" : "moving");
+    for (int mode = GNSS_START_COLD; mode <= GNSS_START_HOT; ++mode) {
+        const GnssTtffStats_t& s = ttff[mode];
+        if (s.searches == 0) {
+            continue;
+        }
+        FixedPrintf(out, "GNSS %s start: %u searches, %u fixes, %u timeouts\n", startModeNames[mode],
+                    (unsigned)s.searches, (unsigned)s.fixes, (unsigned)s.timeouts);
+        HistogramPrint(out, "  TTFF", s.ttff);
+    }
+}
@@ -0,0 +1,171 @@
+#include <string.h>
+#include <esp_heap_caps.h>
+#include "heapMonitor.h"
+#include "fixedString.h"
+
+HeapTaskStats_t HeapMonitor::tasks[HEAP_WATCHED_TASKS];
+volatile uint8_t HeapMonitor::taskCount = 0;
+volatile uint32_t HeapMonitor::totalAllocs = 0;
+
+#if HEAP_ALLOC_TRACKING
+/* Linker --wrap targets: every allocation in the image passes through here */
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    HeapMonitor::countAlloc();
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+    HeapMonitor::countAlloc();
+    return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    HeapMonitor::countAlloc();
+    return __real_realloc(ptr, size);
+}
+}
+#endif
+
+/*
+ * @brief HeapMonitor constructor
+ */
+HeapMonitor::HeapMonitor() : sampleHead(0), sampleCount(0), lastSampleMs(0) {
+    memset(samples, 0, sizeof(samples));
+}
+
+/*
+ * @brief Count allocations made by the calling task from now on.
+ * @paramin name Task name for the report.
+ * @return Slot for taskAllocs() and HeapLoopCheck, -1 if all slots are taken.
+ */
+int HeapMonitor::watchTask(const char* name) {
+    static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    int slot = -1;
+    portENTER_CRITICAL(&lock);
+    if (taskCount < HEAP_WATCHED_TASKS) {
+        slot = taskCount;
+        tasks[slot].name = name;
+        tasks[slot].task = xTaskGetCurrentTaskHandle();
+        tasks[slot].allocs = 0;
+        tasks[slot].iterations = 0;
+        tasks[slot].dirtyIterations = 0;
+        taskCount = (uint8_t)(slot + 1);
+    }
+    portEXIT_CRITICAL(&lock);
+    return slot;
+}
+
+/*
+ * @brief Allocations made so far by a watched task.
+ */
+uint32_t HeapMonitor::taskAllocs(int slot) {
+    return (slot >= 0) ? tasks[slot].allocs : 0;
+}
+
+/*
+ * @brief Record one loop iteration of a watched task.
+ * @paramin allocated The iteration allocated from the heap.
+ */
+void HeapMonitor::loopChecked(int slot, bool allocated) {
+    if (slot < 0 || millis() < HEAP_WARMUP_MS) {
+        return;
+    }
+    tasks[slot].iterations++;
+    if (allocated) {
+        tasks[slot].dirtyIterations++;
+        configASSERT(!HEAP_ASSERT_STEADY);
+    }
+}
+
+/*
+ * @brief Called by the allocator wrappers. A watched task's counter is only written by that task.
+ */
+void HeapMonitor::countAlloc() {
+    __atomic_fetch_add(&totalAllocs, 1, __ATOMIC_RELAXED);
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    uint8_t count = taskCount;
+    for (uint8_t i = 0; i < count; ++i) {
+        if (tasks[i].task == self) {
+            tasks[i].allocs++;
+            break;
+        }
+    }
+}
+
+uint8_t HeapMonitor::watchedTasks() {
+    return taskCount;
+}
+
+const char* HeapMonitor::taskName(int slot) {
+    return tasks[slot].name;
+}
+
+/*
+ * @brief Least stack a watched task has had left since it started, in bytes.
+ */
+uint32_t HeapMonitor::stackFree(int slot) {
+    return (uint32_t)uxTaskGetStackHighWaterMark(tasks[slot].task);
+}
+
+void HeapMonitor::read(HeapSample_t* s, uint32_t nowMs) {
+    s->uptimeS = nowMs / 1000;
+    s->freeBytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    s->minFreeBytes = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    s->largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+}
+
+/*
+ * @brief Share of free heap unusable for one allocation of the same size, in percent.
+ */
+uint8_t HeapMonitor::fragmentation(const HeapSample_t& s) {
+    return s.freeBytes ? (uint8_t)(100 - (uint64_t)s.largestBlock * 100 / s.freeBytes) : 0;
+}
+
+/*
+ * @brief Record the heap level every HEAP_SAMPLE_PERIOD_MS. Call often, from one task.
+ */
+void HeapMonitor::sample(uint32_t nowMs) {
+    if (sampleCount > 0 && nowMs - lastSampleMs < HEAP_SAMPLE_PERIOD_MS) {
+        return;
+    }
+    lastSampleMs = nowMs;
+    read(&samples[sampleHead], nowMs);
+    sampleHead = (uint8_t)((sampleHead + 1) % HEAP_SAMPLES);
+    if (sampleCount < HEAP_SAMPLES) {
+        sampleCount++;
+    }
+}
+
+/*
+ * @brief Print the heap level now and over time, stack left and allocations per watched task.
+ */
+void HeapMonitor::printStats(Print& out) {
+    HeapSample_t now;
+    read(&now, millis());
+    FixedPrintf(out, "Heap: %u free, low-water %u, largest block %u, fragmentation %u%%\n", (unsigned)now.freeBytes,
+                (unsigned)now.minFreeBytes, (unsigned)now.largestBlock, (unsigned)fragmentation(now));
+    for (uint8_t i = 0; i < sampleCount; ++i) {
+        const HeapSample_t& s = samples[(sampleHead + HEAP_SAMPLES - sampleCount + i) % HEAP_SAMPLES];
+        FixedPrintf(out, "  %6u s: %u free, low-water %u, largest block %u, fragmentation %u%%\n", (unsigned)s.uptimeS,
+                    (unsigned)s.freeBytes, (unsigned)s.minFreeBytes, (unsigned)s.largestBlock,
+                    (unsigned)fragmentation(s));
+    }
+    for (uint8_t i = 0; i < taskCount; ++i) {
+        FixedPrintf(out, "Stack: %s task %u bytes never used\n", tasks[i].name, (unsigned)stackFree(i));
+    }
+    if (!HEAP_ALLOC_TRACKING) {
+        out.println("Heap: allocation counting off (ttgo-t-sim7070g-heapcheck environment)");
+        return;
+    }
+    FixedPrintf(out, "Heap: %u allocations since boot\n", (unsigned)totalAllocs);
+    for (uint8_t i = 0; i < taskCount; ++i) {
+        const HeapTaskStats_t& t = tasks[i];
+        FixedPrintf(out, "Heap: %s task %u allocations, %u of %u steady-state iterations allocated\n", t.name,
+                    (unsigned)t.allocs, (unsigned)t.dirtyIterations, (unsigned)t.iterations);
+    }
+}
@@ -0,0 +1,95 @@
+#include "histogram.h"
+#include "fixedString.h"
+
+static uint8_t bucketOf(uint32_t ms) {
+    uint8_t b = 0;
+    while (ms != 0 && b < HISTOGRAM_BUCKETS - 1) {
+        ms >>= 1;
+        b++;
+    }
+    return b;
+}
+
+/* Largest value counted by a bucket */
+static uint32_t bucketTop(uint8_t b) {
+    return (b == 0) ? 0 : (1UL << b) - 1;
+}
+
+/*
+ * @brief Record one sample.
+ */
+void HistogramAdd(Histogram_t* h, uint32_t ms) {
+    if (h->count == 0 || ms < h->minMs) {
+        h->minMs = ms;
+    }
+    if (ms > h->maxMs) {
+        h->maxMs = ms;
+    }
+    h->count++;
+    h->totalMs += ms;
+    h->buckets[bucketOf(ms)]++;
+}
+
+/*
+ * @brief Add the samples of src to dst.
+ */
+void HistogramMerge(Histogram_t* dst, const Histogram_t& src) {
+    if (src.count == 0) {
+        return;
+    }
+    if (dst->count == 0 || src.minMs < dst->minMs) {
+        dst->minMs = src.minMs;
+    }
+    if (src.maxMs > dst->maxMs) {
+        dst->maxMs = src.maxMs;
+    }
+    dst->count += src.count;
+    dst->totalMs += src.totalMs;
+    for (uint8_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+        dst->buckets[b] += src.buckets[b];
+    }
+}
+
+uint32_t HistogramAvg(const Histogram_t& h) {
+    return h.count ? h.totalMs / h.count : 0;
+}
+
+/*
+ * @brief Value below which pct percent of the samples fall, rounded up to a bucket edge.
+ * @return 0 if nothing was recorded; never more than the largest sample.
+ */
+uint32_t HistogramPercentile(const Histogram_t& h, uint8_t pct) {
+    if (h.count == 0) {
+        return 0;
+    }
+    uint32_t rank = (uint32_t)(((uint64_t)h.count * pct + 99) / 100);
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+        seen += h.buckets[b];
+        if (seen >= rank && seen > 0) {
+            uint32_t top = bucketTop(b);
+            return (b == HISTOGRAM_BUCKETS - 1 || top > h.maxMs) ? h.maxMs : top;
+        }
+    }
+    return h.maxMs;
+}
+
+/*
+ * @brief Print a summary line and the non-empty buckets, labelled by their lower edge.
+ */
+void HistogramPrint(Print& out, const char* label, const Histogram_t& h) {
+    if (h.count == 0) {
+        FixedPrintf(out, "%s: no samples\n", label);
+        return;
+    }
+    FixedPrintf(out, "%s: %u, min %u avg %u p50 %u p90 %u p99 %u max %u ms\n", label, (unsigned)h.count,
+                (unsigned)h.minMs, (unsigned)HistogramAvg(h), (unsigned)HistogramPercentile(h, 50),
+                (unsigned)HistogramPercentile(h, 90), (unsigned)HistogramPercentile(h, 99), (unsigned)h.maxMs);
+    FixedString<FIXED_PRINTF_MAX_LEN> line("   ");
+    for (uint8_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+        if (h.buckets[b] != 0) {
+            line.appendf(" %lu:%u", (unsigned long)(b ? 1UL << (b - 1) : 0), (unsigned)h.buckets[b]);
+        }
+    }
+    out.println(line.c_str());
+}
@@ -2,87 +2,558 @@
 #include <freertos/task.h>
 #include <Arduino.h>
 #include "system.h"
-#include <TinyGsmClient.h>
+#include <SPI.h>
+#include <SD.h>
 
-/* Create modem and GPS manager instances */
-TinyGsm TinyModem(SerialAT);
+/* Modem UART, interrupt-fed RX ring buffer read in bulk by the AT engine */
+ModemUart ModemSerial(SerialAT, MODEM_PIN_RX, MODEM_PIN_TX);
 
-/* Mutex for modem access */
-SemaphoreHandle_t modemMutex;
+#if MODEM_SIMULATED
+/* Simulated SIM7070G in place of the modem UART */
+SimModem SimulatedModem(SerialMon);
+#define MODEM_STREAM SimulatedModem
+#define MODEM_TRANSPORT (&SimulatedModem)
+#elif MODEM_TRACE_REPLAY
+/* Captured AT trace played back as the modem, at a fixed rate */
+#include "atTraceData.h"
+AtTraceReplay ReplayModem(atTraceData, sizeof(atTraceData), AT_TRACE_REPLAY_REALTIME);
+#define MODEM_STREAM ReplayModem
+#define MODEM_TRANSPORT NULL
+#else
+#define MODEM_STREAM ModemSerial
+#define MODEM_TRANSPORT (&ModemSerial)
+#endif
+
+#if AT_TRACE_CAPTURE
+/* Records all AT traffic with timestamps, dumped with the "TRACE" console command */
+AtTraceStream TracedModem(MODEM_STREAM);
+AtEngine ModemAt(TracedModem, SerialMon);
+#else
+/* AT command engine, sole owner of the modem UART */
+AtEngine ModemAt(MODEM_STREAM, SerialMon);
+#endif
+
+/* Modem, registration and last fix, kept through deep sleep for a fast boot */
+RTC_DATA_ATTR static BootState_t rtcBootState;
+
+/* Application data, reachable from the serial console in loop() */
+static sysAppData_t* consoleAppData = NULL;
+
+/*
+ * @brief Append degrees * 1e6 as a decimal number with 6 places, without going through float.
+ */
+template <size_t N>
+static void appendDegrees(FixedString<N>& out, int32_t e6) {
+    uint32_t mag = (e6 < 0) ? (uint32_t)(-(int64_t)e6) : (uint32_t)e6;
+    out.appendf("%s%lu.%06lu", (e6 < 0) ? "-" : "", (unsigned long)(mag / GNSS_COORD_SCALE),
+                (unsigned long)(mag % GNSS_COORD_SCALE));
+}
+
+/*
+ * @brief Check an accepted fix against the geofences and queue an alert for each zone entered or left.
+ *        Runs in gpsTask; the check takes microseconds and sends nothing itself.
+ * @paramin appData Application data.
+ * @paramin rec Accepted fix.
+ */
+static void geofenceCheck(sysAppData_t* appData, const GnssRecord_t& rec) {
+    GeofenceEvent_t events[GEOFENCE_EVENTS_PER_FIX];
+    size_t count = appData->geofence->evaluate(rec.latE6, rec.lonE6, events, GEOFENCE_EVENTS_PER_FIX);
+    for (size_t i = 0; i < count; ++i) {
+        FixedString<SMS_TEXT_MAX_LEN + 1> text;
+        text.appendf("Bike GPS Tracker %s %s: %s", events[i].entered ? "entered" : "left", events[i].name,
+                     GPS_MAP_URL);
+        appendDegrees(text, rec.latE6);
+        text.append(",");
+        appendDegrees(text, rec.lonE6);
+        FixedPrintf(SerialMon, "Geofence %s %s\n", events[i].entered ? "entered" : "left", events[i].name);
+        appData->smsOutbox->enqueue(appData->cellData->target_number.c_str(), SMS_TAG_NONE, text.c_str(), millis());
+    }
+}
 
 /*
  * @brief Main FreeRTOS task for GPS acquisition and reporting.
+ *        The radio is held as one GNSS slice from GPS_MODEM_ENABLE to GPS_MODEM_DISABLE;
+ *        waits inside the slice end early when the cellular side needs the radio.
+ *        GnssScheduler sets the interval between fixes from speed, course and HDOP;
+ *        while riding the receiver may stay powered (and the slice held) between fixes.
  * @paramin pvParameters Pointer to task parameters (unused).
  */
 void gpsTask(void* pvParameters) {
     sysAppData_t* appData = (sysAppData_t*)pvParameters;
+    int heapSlot = HeapMonitor::watchTask("GNSS");
     static GpsFixType gpsState = GPS_MODEM_TEST;
+    bool resumeHot = false;
+    bool receiverOn = false;
+    /* After a fast boot the first search starts from the receiver data kept through deep sleep */
+    bool bootRestart = appData->bootState->restored();
+    GnssScheduler& schedule = appData->gpsData->schedule;
     while (1) {
-        // Before using GNSS functions
-        if (xSemaphoreTake(modemMutex, portMAX_DELAY) == pdTRUE) {
-            switch (gpsState) {
-                case GPS_MODEM_IDLE:
-                    if(appData->gpsData->gps_fix_acquired) {
-                        SerialMon.println("Entering idle state, will reacquire GPS position after interval");
-                        vTaskDelay(pdMS_TO_TICKS(10000));
-                        gpsState = GPS_MODEM_ENABLE;
-                    } else {
-                        SerialMon.println("GPS fix not acquired, staying in idle state");
-                        vTaskDelay(pdMS_TO_TICKS(100));
-                    }
-                break;
-                case GPS_MODEM_TEST:
-                    if (!appData->modemMgr->test()) {
-                        SerialMon.println("Modem test failed: Restarting modem");
-                        appData->modemMgr->restart();
-                    } else {
-                        gpsState = GPS_MODEM_ENABLE;
-                    }
-                    vTaskDelay(pdMS_TO_TICKS(1000));
-                break;
-                case GPS_MODEM_ENABLE:
+        HeapLoopCheck heapCheck(heapSlot);
+        /* Only the states that talk to the modem need the radio; idle waits without it, or
+         * still holds the slice from the last fix while the receiver keeps tracking */
+        if (gpsState != GPS_MODEM_IDLE) {
+            appData->rfArbiter->acquire(RF_CLIENT_GNSS, RF_PRIO_GNSS, GPS_RF_DEADLINE_MS);
+        }
+        TickType_t pause = pdMS_TO_TICKS(100);
+        bool keepRadio = false;
+        switch (gpsState) {
+            case GPS_MODEM_IDLE:
+                FixedPrintf(SerialMon, "Entering idle state, next GPS fix in %u s\n",
+                            (unsigned)(schedule.nextIntervalMs() / 1000));
+                if (!receiverOn) {
+                    appData->rfArbiter->printStats(SerialMon);
+                    schedule.printStats(SerialMon);
+                }
+                pause = pdMS_TO_TICKS(schedule.nextIntervalMs());
+                gpsState = GPS_MODEM_ENABLE;
+                /* Receiver still tracking: keep the slice so the next fix is immediate */
+                keepRadio = receiverOn;
+            break;
+            case GPS_MODEM_TEST:
+                if (!appData->modemMgr->test()) {
+                    SerialMon.println("Modem test failed: Restarting modem");
+                    appData->modemMgr->restart();
+                    appData->bootState->modemPoweredOff();
+                    appData->power->modemRestarted();
+                    schedule.receiverReset();
+                } else {
+#if MODEM_UART_BENCHMARK
+                    appData->modemMgr->uartBenchmark(MODEM_UART_BENCHMARK_ROUNDS);
+#endif
+                    /* Every exchange below is wire-bound at the power-on rate */
+                    appData->modemMgr->negotiateBaud(MODEM_UART_TARGET_BAUD);
+                    appData->bootState->modemStarted(appData->modemMgr->getBaud());
+#if MODEM_UART_BENCHMARK
+                    appData->modemMgr->uartBenchmark(MODEM_UART_BENCHMARK_ROUNDS);
+#endif
+                    gpsState = GPS_MODEM_ENABLE;
+                }
+                pause = pdMS_TO_TICKS(1000);
+            break;
+            case GPS_MODEM_ENABLE: {
+                GnssStartMode mode = schedule.beginSearch(millis(), receiverOn);
+                if (!receiverOn) {
                     appData->modemMgr->GpsEnable();
-                    SerialMon.println("Start GPS positioning!");
-                    if(appData->gpsData->gps_fix_acquired) {
-                        gpsState = GPS_MODEM_FIX_ACQUIRED;
-                    } else {
-                        gpsState = GPS_MODEM_GET_FIX;
+                    if (resumeHot) {
+                        /* Search was pre-empted: ephemeris is still valid, resume with a hot start */
+                        appData->modemMgr->GpsRestart(GNSS_START_HOT);
+                        resumeHot = false;
+                    } else if (bootRestart && mode != GNSS_START_COLD) {
+                        appData->modemMgr->GpsRestart(mode);
                     }
-                    vTaskDelay(pdMS_TO_TICKS(1000));
-                break;
-                case GPS_MODEM_GET_FIX:
-                    if (appData->modemMgr->GpsGetFix()) {
-                        SerialMon.println("GPS fix acquired!");
-                        appData->gpsData->gps_fix_acquired = true;
-                        gpsState = GPS_MODEM_FIX_ACQUIRED;
-                        vTaskDelay(pdMS_TO_TICKS(1000));
-                    } else {
-                        SerialMon.println("Waiting for GPS fix...");
-                        TOGGLE_LED();
-                        vTaskDelay(pdMS_TO_TICKS(2000));
+                    bootRestart = false;
+                }
+                if (GPS_URC_REPORT_INTERVAL_S > 0) {
+                    appData->modemMgr->GpsSetUrcReport(GPS_URC_REPORT_INTERVAL_S);
+                }
+                receiverOn = true;
+                FixedPrintf(SerialMon, "Start GPS positioning! (%s start)\n",
+                            (mode == GNSS_START_HOT) ? "hot" : (mode == GNSS_START_WARM) ? "warm" : "cold");
+                gpsState = GPS_MODEM_GET_FIX;
+                pause = pdMS_TO_TICKS(1000);
+                keepRadio = true;
+            }
+            break;
+            case GPS_MODEM_GET_FIX: {
+                /* One exchange (or one pushed report) yields fix status and position together */
+                GnssSample_t sample;
+                bool fix = (GPS_URC_REPORT_INTERVAL_S > 0)
+                    ? appData->modemMgr->GpsReadUrc(&sample, GPS_URC_WAIT_MS)
+                    : appData->modemMgr->GpsSample(&sample);
+                uint32_t now = millis();
+                bool accepted = fix && schedule.acceptable(sample.record, now);
+                /* The fix log keeps what the receiver said; everything else sees the filtered
+                 * position, and a multipath jump is dropped */
+                GnssRecord_t raw = sample.record;
+                bool jump = accepted && appData->gpsData->filter.update(sample.record, now, &sample.record.latE6,
+                                                                        &sample.record.lonE6) == TRACK_FILTER_REJECTED;
+                if (accepted && !jump) {
+                    SerialMon.println("GPS fix acquired!");
+                    appData->gpsData->lastFix.publish(sample);
+                    appData->trackStore->append(sample.record);
+                    geofenceCheck(appData, sample.record);
+                    appData->tripMeter->update(sample.record, now);
+                    /* Queued for the log task, never waits for the card */
+                    appData->fixLog->append(raw);
+                    appData->bootState->fixAcquired(sample.record);
+                    if (UPLINK_ENABLED) {
+                        appData->uplink->enqueue(sample.record);
+                    }
+                    schedule.fixAccepted(sample.record, now);
+                    schedule.extendInterval(appData->gpsData->filter.horizonMs(TRACK_FILTER_STRETCH_ERROR_M));
+                    appData->gpsData->gps_fix_acquired = true;
+                    gpsState = GPS_MODEM_FIX_ACQUIRED;
+                } else if (schedule.searchExpired(now)) {
+                    SerialMon.println("No GPS fix within the search time, backing off");
+                    schedule.searchFailed(now);
+                    if (GPS_URC_REPORT_INTERVAL_S > 0) {
+                        appData->modemMgr->GpsSetUrcReport(0);
                     }
-                break;
-                case GPS_MODEM_FIX_ACQUIRED:
-                    appData->modemMgr->GpsGetLatLon(&appData->gpsData->latitude, &appData->gpsData->longitude);
-                    SerialMon.println("Latitude: " + String(appData->gpsData->latitude, 6) + ", Longitude: " + String(appData->gpsData->longitude, 6));
                     gpsState = GPS_MODEM_DISABLE;
-                    vTaskDelay(pdMS_TO_TICKS(100));
+                } else {
+                    SerialMon.println(jump ? "GPS fix rejected as a jump, waiting for the next one..."
+                                      : fix ? "GPS fix below quality threshold, refining..." : "Waiting for GPS fix...");
+                    TOGGLE_LED();
+                    pause = pdMS_TO_TICKS((GPS_URC_REPORT_INTERVAL_S > 0) ? 100 : schedule.pollIntervalMs());
+                }
+                keepRadio = true;
+            }
+            break;
+            case GPS_MODEM_FIX_ACQUIRED: {
+                FixSnapshot_t fix;
+                if (appData->gpsData->lastFix.read(&fix)) {
+                    FixedString<48> line("Latitude: ");
+                    appendDegrees(line, fix.sample.record.latE6);
+                    line.append(", Longitude: ");
+                    appendDegrees(line, fix.sample.record.lonE6);
+                    SerialMon.println(line.c_str());
+                }
+                if (GPS_URC_REPORT_INTERVAL_S > 0) {
+                    appData->modemMgr->GpsSetUrcReport(0);
+                }
+                gpsState = schedule.keepReceiverOn() ? GPS_MODEM_IDLE : GPS_MODEM_DISABLE;
+                keepRadio = true;
+            }
+            break;
+            case GPS_MODEM_DISABLE:
+                SerialMon.println("Disabling GPS...");
+                appData->modemMgr->GpsDisable();
+                receiverOn = false;
+                gpsState = GPS_MODEM_IDLE;
+                pause = pdMS_TO_TICKS(1000);
                 break;
-                case GPS_MODEM_DISABLE:
-                    SerialMon.println("Disabling GPS...");
-                    appData->modemMgr->GpsDisable();
+            default:
+                gpsState = GPS_MODEM_TEST;
+                appData->gpsData->gps_fix_acquired = false;
+                break;
+        }
+
+        appData->power->setGnss(receiverOn);
+        if (keepRadio) {
+            if (appData->rfArbiter->waitPreempt(RF_CLIENT_GNSS, pause)) {
+                /* Clean boundary: hand the radio to cellular and resume the search afterwards */
+                SerialMon.println("GNSS slice pre-empted by cellular request");
+                if (GPS_URC_REPORT_INTERVAL_S > 0) {
+                    appData->modemMgr->GpsSetUrcReport(0);
+                }
+                appData->modemMgr->GpsDisable();
+                receiverOn = false;
+                if (gpsState == GPS_MODEM_GET_FIX || gpsState == GPS_MODEM_ENABLE) {
+                    /* Mid-search, or waiting for the next fix with the receiver on */
+                    resumeHot = true;
+                    gpsState = GPS_MODEM_ENABLE;
+                } else {
                     gpsState = GPS_MODEM_IDLE;
-                    vTaskDelay(pdMS_TO_TICKS(1000));
-                    break;
-                default:
-                    gpsState = GPS_MODEM_TEST;
-                    appData->gpsData->gps_fix_acquired = false;
-                    vTaskDelay(pdMS_TO_TICKS(100));
-                    break;
+                }
+                appData->rfArbiter->release(RF_CLIENT_GNSS);
+                vTaskDelay(pdMS_TO_TICKS(100));
             }
-            xSemaphoreGive(modemMutex);
+        } else {
+            appData->rfArbiter->release(RF_CLIENT_GNSS);
+            vTaskDelay(pause);
         }
-        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+}
+
+/*
+ * @brief Match an SMS command, ignoring case and surrounding blanks.
+ * @paramin text SMS text.
+ * @paramin cmd Command keyword, e.g. SMS_REQ_LOCATION.
+ * @return Pointer to the command arguments (possibly empty), or NULL if the text is another command.
+ */
+static const char* smsMatchCommand(const char* text, const char* cmd) {
+    while (isspace((unsigned char)*text)) {
+        text++;
+    }
+    size_t n = strlen(cmd);
+    if (strncasecmp(text, cmd, n) != 0 || (text[n] != '\0' && !isspace((unsigned char)text[n]))) {
+        return NULL;
+    }
+    text += n;
+    while (isspace((unsigned char)*text)) {
+        text++;
+    }
+    return text;
+}
+
+/*
+ * @brief Answer a HISTORY request with the most recent track points, packed into as few SMS as possible.
+ *        The first SMS starts with a map link to the newest point; older points follow, newest first.
+ * @paramin appData Application data.
+ * @paramin number Recipient.
+ * @paramin requested Number of points asked for, 0 for SMS_HISTORY_DEFAULT_POINTS.
+ * @paramin requestedMs millis() when the request was read.
+ */
+static void smsSendHistory(sysAppData_t* appData, const char* number, int requested, uint32_t requestedMs) {
+    static TrackPoint_t points[SMS_HISTORY_MAX_POINTS];
+    size_t wanted = (requested > 0) ? (size_t)requested : SMS_HISTORY_DEFAULT_POINTS;
+    if (wanted > SMS_HISTORY_MAX_POINTS) {
+        wanted = SMS_HISTORY_MAX_POINTS;
+    }
+    size_t count = appData->trackStore->latest(points, wanted);
+    if (count == 0) {
+        appData->smsOutbox->enqueue(number, SMS_TAG_HISTORY, "No track history yet", requestedMs);
+        return;
+    }
+    char text[SMS_TEXT_MAX_LEN + 1];
+    const TrackPoint_t* newest = &points[count - 1];
+    long latQ = newest->latE6 / TRACK_COORD_QUANT;
+    long lonQ = newest->lonE6 / TRACK_COORD_QUANT;
+    int prefix = snprintf(text, sizeof(text), "%s%s%ld.%05ld,%s%ld.%05ld ", GPS_MAP_URL,
+                          latQ < 0 ? "-" : "", labs(latQ) / 100000, labs(latQ) % 100000,
+                          lonQ < 0 ? "-" : "", labs(lonQ) / 100000, labs(lonQ) % 100000);
+    /* Each message packs the newest points still unsent; the oldest are left out past the message limit */
+    size_t left = count;
+    for (uint8_t msg = 0; left > 0 && msg < SMS_HISTORY_MAX_MESSAGES; ++msg) {
+        size_t skip = (msg == 0) ? (size_t)prefix : 0;
+        size_t packed = TrackEncodeCompact(points, left, text + skip, sizeof(text) - skip);
+        if (packed == 0) {
+            break;
+        }
+        /* A reply still queued or just sent answers a repeated request */
+        if (!appData->smsOutbox->enqueue(number, SMS_TAG_HISTORY + msg, text, requestedMs)) {
+            FixedPrintf(SerialMon, "History request from %s coalesced\n", number);
+            break;
+        }
+        FixedPrintf(SerialMon, "Queued history SMS to %s (%u points): %s\n", number, (unsigned)packed, text);
+        left -= packed;
+    }
+}
+
+/*
+ * @brief Handle a FENCE request (see SMS_REQ_FENCE) and reply with the resulting fence list.
+ * @paramin appData Application data.
+ * @paramin number Recipient.
+ * @paramin args Text after the command keyword.
+ * @paramin requestedMs millis() when the request was read.
+ */
+static void smsFenceCommand(sysAppData_t* appData, const char* number, const char* args, uint32_t requestedMs) {
+    char reply[SMS_TEXT_MAX_LEN + 1];
+    char name[GEOFENCE_NAME_LEN];
+    const char* rest;
+    bool ok = true;
+    if ((rest = smsMatchCommand(args, "ADD")) != NULL || (rest = smsMatchCommand(args, "DEL")) != NULL) {
+        size_t n = strcspn(rest, " \t");
+        snprintf(name, sizeof(name), "%.*s", (int)n, rest);
+        rest += n;
+        if (toupper((unsigned char)args[0]) == 'D') {
+            ok = appData->geofence->remove(name);
+        } else {
+            int32_t latE6[GEOFENCE_MAX_POLY_VERTICES];
+            int32_t lonE6[GEOFENCE_MAX_POLY_VERTICES];
+            uint8_t points = 0;
+            const char* next;
+            while (points < GEOFENCE_MAX_POLY_VERTICES &&
+                   (next = GeofenceParsePoint(rest, &latE6[points], &lonE6[points])) != NULL) {
+                rest = next;
+                points++;
+            }
+            if (points == 1) {
+                ok = name[0] != '\0' && appData->geofence->addCircle(name, latE6[0], lonE6[0], (uint32_t)atoi(rest));
+            } else {
+                ok = name[0] != '\0' && appData->geofence->addPolygon(name, latE6, lonE6, points);
+            }
+        }
+    }
+    appData->geofence->list(reply, sizeof(reply));
+    if (!ok) {
+        /* Keep the list, say what failed first */
+        char failed[SMS_TEXT_MAX_LEN + 1];
+        snprintf(failed, sizeof(failed), "FENCE %s not done\n%s", args, reply);
+        strcpy(reply, failed);
+    }
+    appData->smsOutbox->enqueue(number, SMS_TAG_NONE, reply, requestedMs);
+}
+
+/*
+ * @brief Answer a STATS request with the headline performance counters in one SMS:
+ *        uptime, AT latency, radio wait per client, median TTFF per start mode,
+ *        heap and the task closest to its stack limit. Ends truncated if it does not fit.
+ * @paramin appData Application data.
+ * @paramin number Recipient.
+ * @paramin requestedMs millis() when the request was read.
+ */
+static void smsSendStats(sysAppData_t* appData, const char* number, uint32_t requestedMs) {
+    static const char* const clientNames[RF_CLIENT_COUNT] = {"gnss", "cell"};
+    static const char* const modeNames[] = {"cold", "warm", "hot"};
+    FixedString<SMS_TEXT_MAX_LEN + 1> text;
+    uint32_t upS = millis() / 1000;
+    text.appendf("Up %ud%02uh", (unsigned)(upS / 86400), (unsigned)(upS % 86400 / 3600));
+
+    AtCommandStats_t at;
+    ModemAt.getTotals(&at);
+    text.appendf(" AT n%u p50 %u p99 %u max %ums %uto", (unsigned)at.latency.count,
+                 (unsigned)HistogramPercentile(at.latency, 50), (unsigned)HistogramPercentile(at.latency, 99),
+                 (unsigned)at.latency.maxMs, (unsigned)at.timeouts);
+
+    text.append(" RF wait p90");
+    for (int i = 0; i < RF_CLIENT_COUNT; ++i) {
+        RfClientStats_t rf;
+        appData->rfArbiter->getStats((RfClient)i, &rf);
+        text.appendf(" %s %u", clientNames[i], (unsigned)HistogramPercentile(rf.wait, 90));
+    }
+    text.append("ms");
+
+    text.append(" TTFF p50");
+    for (int mode = GNSS_START_COLD; mode <= GNSS_START_HOT; ++mode) {
+        GnssTtffStats_t ttff;
+        appData->gpsData->schedule.getStats((GnssStartMode)mode, &ttff);
+        if (ttff.fixes != 0) {
+            text.appendf(" %s %u", modeNames[mode], (unsigned)(HistogramPercentile(ttff.ttff, 50) / 1000));
+        }
+    }
+    text.append("s");
+
+    HeapSample_t heap;
+    HeapMonitor::read(&heap, millis());
+    text.appendf(" Heap %uk lo %uk frag %u%%", (unsigned)(heap.freeBytes / 1024), (unsigned)(heap.minFreeBytes / 1024),
+                 (unsigned)HeapMonitor::fragmentation(heap));
+
+    int tightest = -1;
+    for (int i = 0; i < HeapMonitor::watchedTasks(); ++i) {
+        if (tightest < 0 || HeapMonitor::stackFree(i) < HeapMonitor::stackFree(tightest)) {
+            tightest = i;
+        }
+    }
+    if (tightest >= 0) {
+        text.appendf(" Stack %s %u", HeapMonitor::taskName(tightest), (unsigned)HeapMonitor::stackFree(tightest));
+    }
+
+    if (!appData->smsOutbox->enqueue(number, SMS_TAG_STATS, text.c_str(), requestedMs)) {
+        FixedPrintf(SerialMon, "Stats request from %s coalesced\n", number);
+    }
+}
+
+/*
+ * @brief Answer a TRIP request from the summaries the trip meter keeps up to date: the trip
+ *        in progress, otherwise the last one, then the last one too and the totals if they fit.
+ * @paramin appData Application data.
+ * @paramin number Recipient.
+ * @paramin requestedMs millis() when the request was read.
+ */
+static void smsSendTrip(sysAppData_t* appData, const char* number, uint32_t requestedMs) {
+    char part[SMS_TEXT_MAX_LEN + 1];
+    FixedString<SMS_TEXT_MAX_LEN + 1> text("Trip ");
+    TripSummary_t trip;
+    bool riding = appData->tripMeter->current(&trip);
+    bool haveLast = false;
+    if (riding) {
+        TripFormat(part, sizeof(part), trip, millis());
+        text.append(part);
+        haveLast = appData->tripMeter->last(&trip);
+        if (haveLast) {
+            TripFormat(part, sizeof(part), trip, millis());
+            /* Only whole parts go in */
+            if (text.length() + 8 + strlen(part) <= SMS_TEXT_MAX_LEN) {
+                text.appendf(". Last %s", part);
+            }
+        }
+    } else if (appData->tripMeter->last(&trip)) {
+        TripFormat(part, sizeof(part), trip, millis());
+        text.appendf("last %s", part);
+    } else {
+        text = "No trip since boot";
+    }
+    TripTotals_t totals;
+    appData->tripMeter->getTotals(&totals);
+    snprintf(part, sizeof(part), ". %u trips %u.%u km", (unsigned)totals.trips, (unsigned)(totals.distanceM / 1000),
+             (unsigned)(totals.distanceM % 1000 / 100));
+    if (totals.trips != 0 && text.length() + strlen(part) <= SMS_TEXT_MAX_LEN) {
+        text.append(part);
+    }
+    if (!appData->smsOutbox->enqueue(number, SMS_TAG_TRIP, text.c_str(), requestedMs)) {
+        FixedPrintf(SerialMon, "Trip request from %s coalesced\n", number);
+    }
+}
+
+/*
+ * @brief Print every performance counter: AT latency per command, radio wait and hold
+ *        per client, TTFF per start mode, track filter, power states, heap and stack high-water per task.
+ */
+static void printPerformanceStats(sysAppData_t* appData, Print& out) {
+    FixedPrintf(out, "Uptime %u s\n", (unsigned)(millis() / 1000));
+    ModemAt.printStats(out);
+    appData->rfArbiter->printStats(out);
+    appData->gpsData->schedule.printStats(out);
+    appData->gpsData->filter.printStats(out);
+    appData->power->printStats(out);
+    appData->heapMonitor->printStats(out);
+}
+
+/*
+ * @brief Send up to SMS_SEND_BATCH queued replies while cellularTask holds the radio.
+ *        The rest wait for the next grant, so a burst of requests cannot hold the modem.
+ * @paramin appData Application data.
+ */
+static void smsSendQueued(sysAppData_t* appData) {
+    SmsOutbox* outbox = appData->smsOutbox;
+    SmsOutMessage_t* msg;
+    for (uint8_t n = 0; n < SMS_SEND_BATCH && (msg = outbox->next(millis())) != NULL; ++n) {
+        int messageRef;
+        int cmsError;
+        FixedPrintf(SerialMon, "Sending SMS to %s: %s\n", msg->number, msg->text);
+        AtResult result = appData->modemMgr->simSendMessage(msg->number, msg->text, &messageRef, &cmsError);
+        if (result == AT_OK) {
+            outbox->sent(msg, messageRef, millis());
+        } else {
+            outbox->failed(msg, (result == AT_TIMEOUT) ? SMS_ERROR_TIMEOUT : cmsError, millis());
+        }
+    }
+}
+
+#if UPLINK_ENABLED
+static_assert(sizeof(UPLINK_BROKER_HOST) > 1 && sizeof(UPLINK_BROKER_USER) > 1 && sizeof(UPLINK_BROKER_PASS) > 1,
+              "UPLINK_ENABLED needs a broker of your own: set UPLINK_BROKER_HOST, _USER and _PASS in system.h");
+#endif
+
+/*
+ * @brief Publish the oldest queued fixes in one message, opening the data bearer and MQTT session first if needed.
+ * @paramin appData Application data.
+ */
+static void uplinkService(sysAppData_t* appData) {
+    static char payload[UPLINK_PAYLOAD_MAX];
+    /* Named after the IMEI, read once */
+    static char clientId[24];
+    static char topic[40];
+    Uplink* uplink = appData->uplink;
+    if (topic[0] == '\0') {
+        char imei[MODEM_IMEI_LEN + 1];
+        if (!appData->modemMgr->simGetImei(imei, sizeof(imei))) {
+            uplink->failed(millis());
+            return;
+        }
+        snprintf(clientId, sizeof(clientId), UPLINK_CLIENT_ID_FMT, imei);
+        snprintf(topic, sizeof(topic), UPLINK_TOPIC_FMT, imei);
+    }
+    if (!uplink->connected()) {
+        MqttConfig_t broker;
+        broker.host = UPLINK_BROKER_HOST;
+        broker.port = UPLINK_BROKER_PORT;
+        broker.clientId = clientId;
+        broker.user = UPLINK_BROKER_USER;
+        broker.password = UPLINK_BROKER_PASS;
+        broker.caFile = UPLINK_TLS ? UPLINK_TLS_CA_FILE : NULL;
+        broker.keepAliveS = UPLINK_KEEPALIVE_S;
+        if (!appData->modemMgr->dataAttach(UPLINK_APN) || !appData->modemMgr->mqttConnect(broker)) {
+            uplink->failed(millis());
+            return;
+        }
+        uplink->setConnected(true);
+    }
+    uint32_t lastSeq;
+    size_t count = uplink->nextBatch(payload, sizeof(payload), &lastSeq);
+    if (count == 0) {
+        return;
+    }
+    size_t len = strlen(payload);
+    if (appData->modemMgr->mqttPublish(topic, (const uint8_t*)payload, len, UPLINK_QOS)) {
+        FixedPrintf(SerialMon, "Uplink: %u fixes published in %u bytes\n", (unsigned)count, (unsigned)len);
+        uplink->published(lastSeq, len);
+    } else {
+        /* Session state unknown: start over with a fresh connection after the backoff */
+        appData->modemMgr->mqttDisconnect();
+        uplink->setConnected(false);
+        uplink->failed(millis());
     }
 }
 
@@ -92,62 +563,148 @@ void gpsTask(void* pvParameters) {
  */
 void cellularTask(void* pvParameters) {
     sysAppData_t* appData = (sysAppData_t*)pvParameters;
+    NetworkState* net = appData->netState;
     RegStatus status = REG_NO_RESULT;
-    String SignalQuality;
+    bool smsIndicationEnabled = false;
+    uint32_t lastRegPollMs = millis();
+    int heapSlot = HeapMonitor::watchTask("cellular");
     for (;;) {
-        if (xSemaphoreTake(modemMutex, portMAX_DELAY) == pdTRUE) {
-            if (appData->modemMgr->isSimReady() && appData->modemMgr->simSetNetworkMode(0) ) {
-                String provider = appData->modemMgr->simGetOperator();
-                SerialMon.println("Network provider: " + provider);
-            } else {
+        HeapLoopCheck heapCheck(heapSlot);
+        /* The ring line woke the MCU: the +CMTI itself may have been lost while it woke up */
+        if (appData->power->takeRing()) {
+            appData->smsInbox->requestFetch();
+        }
+        /* SIM, mode and operator are cached; registration follows +CEREG/+CREG indications.
+         * The radio is only taken when there is AT work to do. */
+        bool registered = net->registered();
+        bool smsPending = appData->smsInbox->hasPending() && registered;
+        bool repliesDue = registered && appData->smsOutbox->due(millis());
+        bool regPollDue = !registered && millis() - lastRegPollMs >= NET_REG_POLL_MS;
+        bool uplinkDue = UPLINK_ENABLED && registered && appData->uplink->due(millis());
+        bool powerDue = appData->power->configDue(millis());
+        if (!net->needsRefresh() && smsIndicationEnabled && !smsPending && !regPollDue && !repliesDue && !uplinkDue &&
+            !powerDue && net->registration() == status) {
+            appData->smsInbox->waitPending(pdMS_TO_TICKS(CELL_IDLE_POLL_MS));
+            continue;
+        }
+        /* A new SMS request pre-empts a GNSS search; retries, replies left over from a full batch
+         * and routine housekeeping wait for their deadline */
+        appData->rfArbiter->acquire(RF_CLIENT_CELLULAR,
+                                    smsPending ? RF_PRIO_SMS_REPLY : RF_PRIO_CELL_BACKGROUND,
+                                    smsPending ? SMS_RF_DEADLINE_MS : CELL_RF_DEADLINE_MS);
+        if (net->needsRefresh()) {
+            /* At start and after errors only */
+            if (!appData->modemMgr->simRefreshNetworkState(*net, 0)) {
                 SerialMon.println("SIM not ready, cannot proceed.");
-                xSemaphoreGive(modemMutex);
+                appData->rfArbiter->release(RF_CLIENT_CELLULAR);
                 vTaskDelay(pdMS_TO_TICKS(1000));
                 continue;
             }
+            char provider[NET_OPERATOR_MAX_LEN];
+            net->getOperator(provider, sizeof(provider));
+            FixedPrintf(SerialMon, "Network provider: %s\n", provider);
+            /* The modem may have restarted behind the error */
+            smsIndicationEnabled = false;
+            lastRegPollMs = millis();
+        } else if (regPollDue) {
+            /* Backstop while unregistered, in case an indication was missed */
+            appData->modemMgr->simGetRegistrationStatus(*net);
+            lastRegPollMs = millis();
+        }
+        if (!smsIndicationEnabled) {
+            smsIndicationEnabled = appData->modemMgr->simEnableNewMessageIndication();
+        }
+        if (appData->power->configDue(millis())) {
+            appData->power->configureModem();
+        }
 
-            if (status == REG_NO_RESULT || status == REG_SEARCHING || status == REG_UNREGISTERED) {
-                 SerialMon.print("Wait for the modem to register with the network.");
-                status = appData->modemMgr->simGetRegistrationStatus();
-                switch (status) {
-                    case REG_UNREGISTERED:
-                    case REG_SEARCHING:
-                        SignalQuality = appData->modemMgr->simGetSignalQuality();
-                        SerialMon.printf("Not registered yet (Status: %d). Signal quality: %s\n", status, SignalQuality.c_str());
-                        vTaskDelay(pdMS_TO_TICKS(1000));
-                        break;
-                    case REG_DENIED:
-                        SerialMon.println("Network registration was rejected, please check if the APN is correct");
-                        vTaskDelay(pdMS_TO_TICKS(100));
-                        break;
-                    case REG_OK_HOME:
-                        SerialMon.println("Online registration successful");
-                        break;
-                    case REG_OK_ROAMING:
-                        SerialMon.println("Network registration successful, currently in roaming mode");
-                        break;
-                    default:
-                        SerialMon.printf("Registration Status:%d\n", status);
-                        vTaskDelay(pdMS_TO_TICKS(100));
-                        break;
-                }
+        if (net->registration() != status) {
+            status = net->registration();
+            appData->bootState->setRegistration(status);
+            switch (status) {
+                case REG_UNREGISTERED:
+                case REG_SEARCHING:
+                    FixedPrintf(SerialMon, "Not registered yet (Status: %d). Signal quality: %d\n", status,
+                                appData->modemMgr->simGetSignalQuality());
+                    break;
+                case REG_DENIED:
+                    SerialMon.println("Network registration was rejected, please check if the APN is correct");
+                    break;
+                case REG_OK_HOME:
+                    SerialMon.println("Online registration successful");
+                    break;
+                case REG_OK_ROAMING:
+                    SerialMon.println("Network registration successful, currently in roaming mode");
+                    break;
+                default:
+                    FixedPrintf(SerialMon, "Registration Status:%d\n", status);
+                    break;
             }
+        }
 
-            /* if registration is successful, start GPS, check for new SMS message and send GPS location if available */
-            if (status == REG_OK_HOME || status == REG_OK_ROAMING) {
-                String smsText = appData->modemMgr->simReadMessage();
-                if( (smsText == SMS_REQ_LOCATION) && (appData->gpsData->gps_fix_acquired) ) {
+        /* if registration is successful, read new SMS in one pass and answer location requests */
+        if (net->registered()) {
+            if (smsIndicationEnabled && appData->bootState->smsReady()) {
+                appData->bootState->printStats(SerialMon);
+            }
+            if (appData->smsInbox->hasPending() && appData->modemMgr->simFetchMessages(*appData->smsInbox) < 0) {
+                net->invalidate();
+            }
+            SmsMessage_t sms;
+            FixSnapshot_t fix;
+            while (appData->smsInbox->pop(&sms)) {
+                FixedPrintf(SerialMon, "SMS from %s: %s\n", sms.sender, sms.text);
+                /* Reply to whoever asked; fall back to the configured number */
+                const char* replyTo = (sms.sender[0] != '\0') ? sms.sender : appData->cellData->target_number.c_str();
+                const char* args;
+                /* Consistent lat/lon pair, read without waiting for gpsTask */
+                if (smsMatchCommand(sms.text, SMS_REQ_LOCATION) && appData->gpsData->lastFix.read(&fix)) {
                     SerialMon.println("Location request SMS received");
-                    appData->cellData->msg_lat_buf = String(appData->gpsData->latitude, 6);
-                    appData->cellData->msg_lon_buf = String(appData->gpsData->longitude, 6);
-                    appData->cellData->msg_txt_sms = "Bike GPS Tracker position: " + String(GPS_MAP_URL) + appData->cellData->msg_lat_buf + "," + appData->cellData->msg_lon_buf;
-                    SerialMon.println("Sending SMS to " + appData->cellData->target_number + ": " + appData->cellData->msg_txt_sms);
-                    appData->modemMgr->simSendMessage(appData->cellData->target_number, appData->cellData->msg_txt_sms);
+                    sysCellData_t* cell = appData->cellData;
+                    /* Riding and the fix is getting old: report where the filter puts the bike now */
+                    TrackEstimate_t est;
+                    bool predicted = fix.ageMs >= LOCATION_PREDICT_AFTER_MS && !appData->gpsData->schedule.parked() &&
+                                     appData->gpsData->filter.estimate(millis(), &est);
+                    cell->msg_lat_buf.clear();
+                    appendDegrees(cell->msg_lat_buf, predicted ? est.latE6 : fix.sample.record.latE6);
+                    cell->msg_lon_buf.clear();
+                    appendDegrees(cell->msg_lon_buf, predicted ? est.lonE6 : fix.sample.record.lonE6);
+                    cell->msg_txt_sms.clear();
+                    cell->msg_txt_sms.appendf("Bike GPS Tracker position: %s%s,%s", GPS_MAP_URL,
+                                              cell->msg_lat_buf.c_str(), cell->msg_lon_buf.c_str());
+                    if (predicted) {
+                        cell->msg_txt_sms.appendf(" (predicted %u s after fix, +/- %u m)",
+                                                  (unsigned)(est.sinceFixMs / 1000), (unsigned)est.sigmaM);
+                    } else {
+                        cell->msg_txt_sms.appendf(" (%u s ago)", (unsigned)(fix.ageMs / 1000));
+                    }
+                    if (!appData->smsOutbox->enqueue(replyTo, SMS_TAG_LOCATION, cell->msg_txt_sms.c_str(),
+                                                     sms.receivedMs)) {
+                        FixedPrintf(SerialMon, "Location request from %s coalesced\n", replyTo);
+                    }
+                } else if ((args = smsMatchCommand(sms.text, SMS_REQ_HISTORY)) != NULL) {
+                    SerialMon.println("History request SMS received");
+                    smsSendHistory(appData, replyTo, atoi(args), sms.receivedMs);
+                } else if ((args = smsMatchCommand(sms.text, SMS_REQ_FENCE)) != NULL) {
+                    SerialMon.println("Fence request SMS received");
+                    smsFenceCommand(appData, replyTo, args, sms.receivedMs);
+                } else if (smsMatchCommand(sms.text, SMS_REQ_TRIP) != NULL) {
+                    SerialMon.println("Trip request SMS received");
+                    smsSendTrip(appData, replyTo, sms.receivedMs);
+                } else if (smsMatchCommand(sms.text, SMS_REQ_STATS) != NULL) {
+                    SerialMon.println("Stats request SMS received");
+                    smsSendStats(appData, replyTo, sms.receivedMs);
                 }
             }
-            xSemaphoreGive(modemMutex);
+            smsSendQueued(appData);
+            /* Queued fixes go out in batches, after any SMS reply */
+            if (uplinkDue) {
+                uplinkService(appData);
+            }
         }
-        vTaskDelay(pdMS_TO_TICKS(300));
+        appData->rfArbiter->release(RF_CLIENT_CELLULAR);
+        /* Wake early on +CMTI instead of sleeping the full poll period */
+        appData->smsInbox->waitPending(pdMS_TO_TICKS(CELL_IDLE_POLL_MS));
     }
 }
 
@@ -155,17 +712,18 @@ void cellularTask(void* pvParameters) {
  * @brief Arduino setup function. Initializes hardware and starts GPS task.
  */
 void setup() {
-    SerialMon.begin(115200);
-    SerialAT.begin(MODEM_UART_BAUD, SERIAL_8N1, MODEM_PIN_RX, MODEM_PIN_TX);
+    SerialMon.begin(SERIAL_MON_BAUD);
+    ModemSerial.begin(MODEM_UART_BAUD);
 
     pinMode(USER_BLUE_LED_PIN, OUTPUT);
     TURN_ON_LED();
 
     static sysGpsData_t sysGpsData = {
-        0.0, 
-        0.0, 
         false, 
-        GPS_MODEM_IDLE
+        GPS_MODEM_IDLE,
+        {},
+        {},
+        {}
     };
 
     static sysCellData_t sysCellData = {
@@ -175,28 +733,254 @@ void setup() {
         ""
     };
 
+    /* Fast boot: what the previous boot left in RTC memory */
+    static BootState bootState(rtcBootState);
+    bootState.begin();
+
     /* Create SIM7070G manager instances */
-    static ModemMgr sim7070g(TinyModem, SerialMon, SerialAT, MODEM_PWR_PIN, MODEM_PIN_DTR);
+    static ModemMgr sim7070g(ModemAt, MODEM_TRANSPORT, SerialMon, MODEM_PWR_PIN, MODEM_PIN_DTR);
 
+    ModemAt.begin();
     sim7070g.init();
-    sim7070g.powerOn();
-    sim7070g.awake(); 
+    /* Power key only if the modem does not answer at its last rate */
+    bool modemKept = sim7070g.start(bootState.modemBaud());
+    if (modemKept) {
+        bootState.modemStarted(sim7070g.getBaud());
+    } else {
+        bootState.modemPoweredOff();
+    }
     SerialMon.println("Modem initialized.");
+    bootState.printStats(SerialMon);
+
+    /* Last fix from before the deep sleep: answers LOCATION at once and sets up a hot or warm start */
+    GnssRecord_t savedFix;
+    uint32_t savedFixAgeS;
+    if (bootState.lastFix(&savedFix, &savedFixAgeS)) {
+        GnssSample_t sample = { true, (uint32_t)(millis() - savedFixAgeS * 1000), savedFix };
+        sysGpsData.lastFix.publish(sample);
+        sysGpsData.schedule.restore(savedFix, savedFixAgeS * 1000, millis(), modemKept);
+    }
+
+    /* Radio time-slice arbiter shared by GNSS and cellular */
+    static RfArbiter rfArbiter;
+    rfArbiter.begin();
+
+    /* Modem sleeps between radio slices, the MCU while the modem sleeps and nothing is queued */
+    static PowerManager power(sim7070g, ModemAt, rfArbiter);
+    power.begin(POWER_MCU_LIGHT_SLEEP);
+    power.setNetworkSaving(POWER_EDRX_CYCLE, POWER_PSM_PERIODIC_TAU, POWER_PSM_ACTIVE_TIME);
+    rfArbiter.setBusyHook(PowerManager::onRadioBusy, &power);
+
+    /* Track history, restored from NVS */
+    static TrackStore trackStore;
+    trackStore.begin();
+
+    /* Geofences, restored from NVS */
+    static Geofence geofence;
+    geofence.begin();
+
+    /* Distance, speed, stops and trips, from the accepted fixes */
+    static TripMeter tripMeter;
+
+    /* Append-only fix log on the SD card, written in whole sectors by its own task */
+    static FileBlockDevice fixLogDevice(FIX_LOG_PATH, FIX_LOG_BLOCK_LEN, FIX_LOG_BLOCKS);
+    static FixLog fixLog(fixLogDevice);
+    if (FIX_LOG_ENABLED) {
+        SPI.begin(SD_PIN_SCLK, SD_PIN_MISO, SD_PIN_MOSI, SD_PIN_CS);
+        if (!SD.begin(SD_PIN_CS) || !fixLog.begin()) {
+            SerialMon.println("SD card not available, fix log disabled");
+        }
+    }
+
+    /* Framed bulk export of the track and fix log on the console */
+    static TrackExport trackExport(SerialMon, SERIAL_MON_BAUD, trackStore, fixLog);
+
+    /* SMS intake driven by +CMTI indications */
+    static SmsInbox smsInbox;
+    smsInbox.begin(ModemAt);
+
+    /* SIM and registration cache, kept current by +CEREG/+CREG indications */
+    static NetworkState netState;
+    netState.begin(ModemAt);
+    if (bootState.registration() != REG_NO_RESULT) {
+        /* Modem stayed on through deep sleep with its settings and registration */
+        netState.restore(bootState.registration());
+    }
+
+    /* Batched position uplink, session state followed through +SMSTATE */
+    static Uplink uplink;
+    uplink.begin(ModemAt);
+
+    /* Heap levels over time; allocations per task in heapcheck builds */
+    static HeapMonitor heapMonitor;
+    /* setup() and loop() share the Arduino loop task: report its stack too */
+    HeapMonitor::watchTask("loop");
+
+    /* Replies, coalesced and retried */
+    static SmsOutbox smsOutbox;
 
     static sysAppData_t sysAppData = {
         &sim7070g,
+        &rfArbiter,
+        &power,
+        &smsInbox,
+        &smsOutbox,
+        &netState,
+        &uplink,
+        &trackStore,
+        &geofence,
+        &tripMeter,
+        &fixLog,
+        &trackExport,
+        &bootState,
+        &heapMonitor,
         &sysGpsData,
         &sysCellData
     };
 
-    modemMutex = xSemaphoreCreateMutex();
+    consoleAppData = &sysAppData;
 
     xTaskCreatePinnedToCore(gpsTask, "GpsTask", GPS_TASK_STACK_SIZE, &sysAppData, GPS_TASK_PRIORITY, NULL, TASK_CORE_0);
     xTaskCreatePinnedToCore(cellularTask, "CellularTask", SMS_TASK_STACK_SIZE, &sysAppData, SMS_TASK_PRIORITY, NULL, TASK_CORE_1);
+
+#if MODEM_SIMULATED
+    SimulatedModem.setLinkLimit(SIM_SCENARIO_LINK_LIMIT_BAUD);
+    SimulatedModem.setRingCallback(PowerManager::ring, &power);
+    SimulatedModem.setFixScript(SIM_SCENARIO_FIX_SCRIPT);
+    SimulatedModem.setTrack(20558853, -103428903, 90, -60, 1850);
+    SimulatedModem.failSms(SIM_SCENARIO_SMS_FAILURES);
+    SimulatedModem.startScenario(SIM_SCENARIO_SMS_PERIOD_MS, SIM_SCENARIO_SMS_BURST, sysCellData.target_number.c_str());
+#endif
 }
 
 /*
- * @brief Arduino main loop. Not used, as logic is handled by FreeRTOS tasks.
+ * @brief EXPORT TRACK|LOG [from_seq [baud]] starts a transfer, EXPORT STOP ends it, EXPORT alone reports the last one.
+ * @paramin args Text after "EXPORT", NUL when none.
+ */
+static void consoleExport(const char* args) {
+    TrackExport* exporter = consoleAppData->trackExport;
+    while (*args == ' ') {
+        args++;
+    }
+    if (*args == '\0') {
+        exporter->printStats(SerialMon);
+    } else if (strcasecmp(args, "STOP") == 0) {
+        exporter->stop();
+    } else if (strncasecmp(args, "TRACK", 5) == 0 || strncasecmp(args, "LOG", 3) == 0) {
+        bool track = (toupper((unsigned char)args[0]) == 'T');
+        char* end;
+        uint32_t fromSeq = strtoul(args + (track ? 5 : 3), &end, 10);
+        uint32_t baud = strtoul(end, NULL, 10);
+        exporter->start(track ? EXPORT_SOURCE_TRACK : EXPORT_SOURCE_LOG, fromSeq, baud);
+    } else {
+        FixedPrintf(SerialMon, "Unknown export: %s\n", args);
+    }
+}
+
+/*
+ * @brief Handle one serial console command.
+ * @paramin cmd Command line without terminator.
+ */
+static void consoleCommand(const char* cmd) {
+    if (strcasecmp(cmd, "RF") == 0) {
+        consoleAppData->rfArbiter->printStats(SerialMon);
+    } else if (strcasecmp(cmd, "NET") == 0) {
+        consoleAppData->netState->printStats(SerialMon);
+    } else if (strcasecmp(cmd, "STATS") == 0) {
+        printPerformanceStats(consoleAppData, SerialMon);
+    } else if (strcasecmp(cmd, "AT") == 0) {
+        ModemAt.printStats(SerialMon);
+    } else if (strcasecmp(cmd, "FENCE") == 0) {
+        consoleAppData->geofence->printStats(SerialMon);
+    } else if (strcasecmp(cmd, "HEAP") == 0) {
+        consoleAppData->heapMonitor->printStats(SerialMon);
+    } else if (strcasecmp(cmd, "SMS") == 0) {
+        consoleAppData->smsOutbox->printStats(SerialMon);
+    } else if (strcasecmp(cmd, "UPLINK") == 0) {
+        consoleAppData->uplink->printStats(SerialMon);
+    } else if (strcasecmp(cmd, "BOOT") == 0) {
+        consoleAppData->bootState->printStats(SerialMon);
+    } else if (strcasecmp(cmd, "GNSS") == 0) {
+        consoleAppData->gpsData->schedule.printStats(SerialMon);
+    } else if (strcasecmp(cmd, "FILTER") == 0) {
+        consoleAppData->gpsData->filter.printStats(SerialMon);
+    } else if (strcasecmp(cmd, "POWER") == 0) {
+        consoleAppData->power->printStats(SerialMon);
+    } else if (strcasecmp(cmd, "TRIP") == 0) {
+        consoleAppData->tripMeter->printStats(SerialMon);
+    } else if (strncasecmp(cmd, "EXPORT", 6) == 0 && (cmd[6] == ' ' || cmd[6] == '\0')) {
+        consoleExport(cmd + 6);
+    } else if (strcasecmp(cmd, "LOG") == 0) {
+        consoleAppData->fixLog->printStats(SerialMon);
+    } else if (strcasecmp(cmd, "LOG FLUSH") == 0) {
+        consoleAppData->fixLog->requestFlush();
+#if AT_TRACE_CAPTURE
+    } else if (strcasecmp(cmd, "TRACE") == 0) {
+        TracedModem.dump(SerialMon);
+    } else if (strcasecmp(cmd, "TRACE CLEAR") == 0) {
+        TracedModem.clear();
+#endif
+#if MODEM_TRACE_REPLAY
+    } else if (strcasecmp(cmd, "REPLAY") == 0) {
+        ReplayModem.printReport(SerialMon);
+#endif
+    } else {
+        FixedPrintf(SerialMon, "Unknown command: %s\n", cmd);
+    }
+}
+
+/*
+ * @brief Whether the MCU may light sleep as far as queued work goes: no reply or uplink batch
+ *        due, no SIM read wanted, the fix log written and no export running.
+ *        PowerManager::lightSleep() adds the radio and modem state.
+ * @paramin appData Application data.
+ */
+static bool mcuIdle(sysAppData_t* appData) {
+    uint32_t now = millis();
+    return !appData->smsOutbox->due(now) && !appData->smsInbox->hasPending() &&
+           !(UPLINK_ENABLED && appData->uplink->due(now)) && appData->fixLog->idle() &&
+           !appData->trackExport->running();
+}
+
+/*
+ * @brief Arduino main loop. Application logic runs in FreeRTOS tasks; the loop only serves the serial console.
  */
 void loop() {
+    static char line[32];
+    static size_t len = 0;
+    while (SerialMon.available() > 0) {
+        char c = (char)SerialMon.read();
+        if (c == '\r' || c == '\n') {
+            if (len > 0 && consoleAppData != NULL) {
+                line[len] = '\0';
+                consoleCommand(line);
+            }
+            len = 0;
+        } else if (len < sizeof(line) - 1) {
+            line[len++] = c;
+        }
+    }
+    if (consoleAppData != NULL) {
+        consoleAppData->heapMonitor->sample(millis());
+        if (consoleAppData->trackExport->poll()) {
+            /* Next frame right away: the UART write already blocked this task for the last one */
+            return;
+        }
+    }
+#if MODEM_TRACE_REPLAY
+    static bool replayReported = false;
+    if (!replayReported && ReplayModem.finished() && consoleAppData != NULL) {
+        ReplayModem.printReport(SerialMon);
+        consoleAppData->rfArbiter->printStats(SerialMon);
+        replayReported = true;
+    }
+#endif
+    /* Light sleep in place of the console poll; once awake, let the tasks whose wait ran out go first.
+     * The UART FIFO holds a typed line. */
+    if (consoleAppData != NULL && mcuIdle(consoleAppData) &&
+        consoleAppData->power->lightSleep(POWER_LIGHT_SLEEP_MAX_MS) > 0) {
+        vTaskDelay(1);
+    } else {
+        vTaskDelay(pdMS_TO_TICKS(200));
+    }
 }
\ No newline at end of file
@@ -1,17 +1,20 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <string.h>
 #include "modemMgr.h"
+#include "networkState.h"
 
 /*
  * @brief ModemMgr constructor
- * @paramin modem Reference to TinyGsm modem object
+ * @paramin at Reference to the AT command engine owning the modem port
+ * @paramin transport Modem UART, for following AT+IPR rate changes. NULL if the rate is fixed.
  * @paramin serialMon Reference to Serial monitor
- * @paramin serialAT Reference to Serial AT port
  * @paramin pwrPin Modem power control pin
  * @paramin dtrPin Modem DTR (sleep/wake) pin
  */
-ModemMgr::ModemMgr(TinyGsm& modem, HardwareSerial& serialMon, HardwareSerial& serialAT, int pwrPin, int dtrPin)
-    : modem(modem), serialMon(serialMon), serialAT(serialAT), pwrPin(pwrPin), dtrPin(dtrPin) {}
+ModemMgr::ModemMgr(AtEngine& at, ModemTransport* transport, HardwareSerial& serialMon, int pwrPin, int dtrPin)
+    : at(at), transport(transport), serialMon(serialMon), pwrPin(pwrPin), dtrPin(dtrPin),
+      gnssUrcLock(portMUX_INITIALIZER_UNLOCKED), gnssUrcSample(), gnssUrcReady(NULL) {}
 
 /*
  * @brief Initialize the modem manager.
@@ -21,6 +24,10 @@ void ModemMgr::init() {
     pinMode(dtrPin, OUTPUT);
     digitalWrite(pwrPin, LOW);
     digitalWrite(dtrPin, LOW);
+    if (gnssUrcReady == NULL) {
+        gnssUrcReady = xSemaphoreCreateBinary();
+        at.subscribe("+UGNSINF:", onGnssUrc, this);
+    }
     vTaskDelay(pdMS_TO_TICKS(100));
 }
 
@@ -35,6 +42,8 @@ void ModemMgr::powerOn() {
     digitalWrite(pwrPin, HIGH);
     vTaskDelay(pdMS_TO_TICKS(1000));
     digitalWrite(pwrPin, LOW);
+    /* Echo is on again after power-up, until test() sends ATE0 */
+    at.expectEcho();
 }
 
 /*
@@ -57,39 +66,267 @@ void ModemMgr::restart() {
     powerOn();
 }
 
+/*
+ * @brief Bring the modem up at boot. It may still be on from before a deep sleep or an
+ *        ESP32 reset, and a power key pulse would then switch it off: probe with AT first.
+ * @paramin baud Rate the modem was last running at; every other candidate rate is tried as well.
+ * @return true if the modem was already on, false if it had to be powered on.
+ */
+bool ModemMgr::start(uint32_t baud) {
+    if (transport != NULL && baud != transport->getBaud()) {
+        transport->setBaud(baud);
+    }
+    /* The saved rate may be stale (AT+IPR after the last save, or no save yet): scan them all
+     * before concluding the modem is off, as the power key would switch a running one off */
+    if (probe(1, MODEM_BOOT_PROBE_MS) || findBaud()) {
+        serialMon.println("Modem already on");
+        return true;
+    }
+    powerOn();
+    awake();
+    return false;
+}
+
 /*
  * @brief Test AT communication with the modem.
  * @return true if modem responds to AT, false otherwise.
  */
 bool ModemMgr::test() {
-    if (!modem.testAT()) {
+    AtRequest_t req;
+    /* The modem keeps its AT+IPR rate across an ESP32 reset: search for it before giving up */
+    if (!probe(3, 1000) && !findBaud()) {
         serialMon.println("Failed to communicate with modem");
         return false;
     }
+    /* Disable command echo so responses carry only modem output */
+    at.command(&req, 1000, "E0");
     serialMon.println("Modem is ready");
     return true;
 }
 
 /*
- * @brief Wake up the modem by toggling the DTR pin.
+ * @brief Send plain "AT" until the modem answers OK.
+ * @return true on the first OK.
+ */
+bool ModemMgr::probe(uint8_t attempts, uint32_t timeoutMs) {
+    AtRequest_t req;
+    for (uint8_t attempt = 0; attempt < attempts; ++attempt) {
+        if (at.command(&req, timeoutMs, "%s", "") == AT_OK) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * @brief Check the link after a rate change: AT must answer, then two more
+ *        exchanges, one with an information line, must pass in a row.
+ */
+bool ModemMgr::verifyBaud() {
+    AtRequest_t req;
+    if (!probe(3, 500)) {
+        return false;
+    }
+    if (at.command(&req, 500, "%s", "") != AT_OK) {
+        return false;
+    }
+    return at.command(&req, 500, "I") == AT_OK && req.respLen > 0;
+}
+
+/*
+ * @brief Try each of MODEM_UART_BAUD_CANDIDATES until the modem answers.
+ * @return true with the UART left at the working rate, false with it back at MODEM_UART_BAUD.
+ */
+bool ModemMgr::findBaud() {
+    static const uint32_t candidates[] = MODEM_UART_BAUD_CANDIDATES;
+    if (transport == NULL) {
+        return false;
+    }
+    uint32_t tried = transport->getBaud();
+    for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); ++i) {
+        if (candidates[i] == tried) {
+            continue;
+        }
+        transport->setBaud(candidates[i]);
+        if (probe(2, 300)) {
+            FixedPrintf(serialMon, "Modem found at %lu baud\n", (unsigned long)candidates[i]);
+            return true;
+        }
+    }
+    transport->setBaud(MODEM_UART_BAUD);
+    return false;
+}
+
+/*
+ * @brief Rate the modem UART runs at.
+ */
+uint32_t ModemMgr::getBaud() const {
+    return (transport != NULL) ? transport->getBaud() : MODEM_UART_BAUD;
+}
+
+/*
+ * @brief Move the modem UART to a faster rate with AT+IPR and verify it,
+ *        falling back to a working rate if the link does not hold.
+ * @paramin baud Requested rate.
+ * @return true if the UART runs at baud.
+ */
+bool ModemMgr::negotiateBaud(uint32_t baud) {
+    if (transport == NULL) {
+        return false;
+    }
+    uint32_t previous = transport->getBaud();
+    if (previous == baud) {
+        return true;
+    }
+    AtRequest_t req;
+    if (at.command(&req, 1000, "+IPR=%lu", (unsigned long)baud) != AT_OK) {
+        FixedPrintf(serialMon, "Modem rejected %lu baud\n", (unsigned long)baud);
+        return false;
+    }
+    /* OK was sent at the old rate; the modem switches right after it */
+    vTaskDelay(pdMS_TO_TICKS(MODEM_UART_SWITCH_DELAY_MS));
+    transport->setBaud(baud);
+    if (verifyBaud()) {
+        FixedPrintf(serialMon, "Modem UART at %lu baud\n", (unsigned long)baud);
+        return true;
+    }
+    FixedPrintf(serialMon, "Modem UART unreliable at %lu baud, falling back\n", (unsigned long)baud);
+    transport->setBaud(previous);
+    if (!verifyBaud()) {
+        /* The modem did switch: move it back over the unreliable link. Either the command or
+         * its OK may be garbled, so after every attempt look for the modem at the old rate */
+        bool back = false;
+        for (int attempt = 0; attempt < MODEM_UART_FALLBACK_ATTEMPTS && !back; ++attempt) {
+            transport->setBaud(baud);
+            at.command(&req, 300, "+IPR=%lu", (unsigned long)previous);
+            vTaskDelay(pdMS_TO_TICKS(MODEM_UART_SWITCH_DELAY_MS));
+            transport->setBaud(previous);
+            back = probe(2, 300);
+        }
+        if (!back && !findBaud()) {
+            serialMon.println("Modem UART lost after fallback");
+        }
+    }
+    FixedPrintf(serialMon, "Modem UART at %lu baud\n", (unsigned long)transport->getBaud());
+    return false;
+}
+
+/*
+ * @brief Time back-to-back +CGNSINF exchanges at the current UART rate.
+ * @paramin rounds Number of exchanges.
+ */
+void ModemMgr::uartBenchmark(uint16_t rounds) {
+    AtRequest_t req;
+    uint32_t bytes = 0;
+    uint32_t maxUs = 0;
+    uint16_t done = 0;
+    uint32_t start = micros();
+    for (uint16_t i = 0; i < rounds; ++i) {
+        if (at.command(&req, 2000, "+CGNSINF") != AT_OK) {
+            continue;
+        }
+        /* Response plus the "\r\n...\r\n\r\nOK\r\n" framing around it */
+        bytes += req.respLen + 10;
+        if (req.latencyUs > maxUs) {
+            maxUs = req.latencyUs;
+        }
+        done++;
+    }
+    uint32_t elapsedUs = micros() - start;
+    uint32_t baud = (transport != NULL) ? transport->getBaud() : 0;
+    FixedPrintf(serialMon, "UART benchmark at %lu baud: %u/%u exchanges in %lu ms, avg %lu us, max %lu us, %lu bytes/s\n",
+                (unsigned long)baud, (unsigned)done, (unsigned)rounds, (unsigned long)(elapsedUs / 1000),
+                (unsigned long)(done ? elapsedUs / done : 0), (unsigned long)maxUs,
+                (unsigned long)(elapsedUs ? (uint64_t)bytes * 1000000ULL / elapsedUs : 0));
+}
+
+/*
+ * @brief Wake the modem: with AT+CSCLK=1 it sleeps while DTR is high and leaves sleep when DTR goes low.
  */
 void ModemMgr::awake() {
-    /* Pull DTR HIGH to wake modem */
-    digitalWrite(dtrPin, HIGH);
-    vTaskDelay(pdMS_TO_TICKS(100));
-    /* Pull DTR LOW to complete wake sequence */
     digitalWrite(dtrPin, LOW);
+    if (transport != NULL) {
+        transport->setDtr(false);
+    }
+    vTaskDelay(pdMS_TO_TICKS(MODEM_WAKE_MS));
+}
+
+/*
+ * @brief Let the modem enter sleep mode once its UART is idle (after sleepConfigure()).
+ *        It stays registered and still reports URCs and new SMS on its ring line.
+ */
+void ModemMgr::sleep() {
+    digitalWrite(dtrPin, HIGH);
+    if (transport != NULL) {
+        transport->setDtr(true);
+    }
+}
+
+/*
+ * @brief Enable DTR-controlled sleep (AT+CSCLK=1) and pulse the ring line on URCs (AT+CFGRI=1).
+ *        Neither setting survives a modem power cycle.
+ * @return true if sleep mode was enabled.
+ */
+bool ModemMgr::sleepConfigure() {
+    AtRequest_t req;
+    if (at.command(&req, 1000, "+CSCLK=1") != AT_OK) {
+        serialMon.println("Failed to enable modem sleep");
+        return false;
+    }
+    if (at.command(&req, 1000, "+CFGRI=1") != AT_OK) {
+        serialMon.println("Failed to enable ring on URC");
+    }
+    return true;
+}
+
+/*
+ * @brief Request power saving mode from the network (AT+CPSMS). While in PSM the modem
+ *        cannot be paged: SMS wait until the next periodic update.
+ * @paramin enable false cancels PSM.
+ * @paramin periodicTau Requested periodic TAU (T3412), 8-bit GPRS timer 3 string, e.g. "00100001".
+ * @paramin activeTime Requested active time (T3324), 8-bit GPRS timer 2 string, e.g. "00000101".
+ * @return true if the modem accepted the request; the network may grant other values.
+ */
+bool ModemMgr::psmConfigure(bool enable, const char* periodicTau, const char* activeTime) {
+    AtRequest_t req;
+    AtResult result = enable ? at.command(&req, 5000, "+CPSMS=1,,,\"%s\",\"%s\"", periodicTau, activeTime)
+                             : at.command(&req, 5000, "+CPSMS=0");
+    if (result != AT_OK) {
+        serialMon.println("Failed to configure PSM");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * @brief Request extended DRX on LTE-M (AT+CEDRXS): the modem listens for paging once per cycle.
+ * @paramin enable false disables eDRX.
+ * @paramin cycle Requested eDRX cycle, 4-bit string, e.g. "0010" for 20.48 s.
+ * @return true if the modem accepted the request; the network may grant another cycle.
+ */
+bool ModemMgr::edrxConfigure(bool enable, const char* cycle) {
+    AtRequest_t req;
+    AtResult result = enable ? at.command(&req, 5000, "+CEDRXS=1,4,\"%s\"", cycle)
+                             : at.command(&req, 5000, "+CEDRXS=0");
+    if (result != AT_OK) {
+        serialMon.println("Failed to configure eDRX");
+        return false;
+    }
+    return true;
 }
 
 /*
  * @brief Enable GPS power and functionality on the modem.
  */
 void ModemMgr::GpsEnable() {
-    modem.sendAT("+CGPIO=0,48,1,1");
-    if (modem.waitResponse(10000L) != 1) {
+    AtRequest_t req;
+    if (at.command(&req, 10000L, "+CGPIO=0,48,1,1") != AT_OK) {
         serialMon.println("Failed to enable GPS power");
     }
-    modem.enableGPS();
+    if (at.command(&req, 10000L, "+CGNSPWR=1") != AT_OK) {
+        serialMon.println("Failed to enable GPS");
+        return;
+    }
     serialMon.println("GPS enabled");
 }
 
@@ -97,69 +334,124 @@ void ModemMgr::GpsEnable() {
  * @brief Disable GPS power and functionality on the modem.
  */
 void ModemMgr::GpsDisable() {
-    modem.sendAT("+CGPIO=0,48,1,0");
-    if (modem.waitResponse(10000L) != 1) {
+    AtRequest_t req;
+    if (at.command(&req, 10000L, "+CGPIO=0,48,1,0") != AT_OK) {
         serialMon.println("Failed to disable GPS power");
     }
-    modem.disableGPS();
+    if (at.command(&req, 10000L, "+CGNSPWR=0") != AT_OK) {
+        serialMon.println("Failed to disable GPS");
+        return;
+    }
     serialMon.println("GPS disabled");
 }
 
 /*
- * @brief Check if GPS fix is valid by parsing GNSS raw string.
- * @return true if fix status and mode are both "1", false otherwise.
+ * @brief Restart the GNSS engine, reusing stored ephemeris/almanac for warm and hot starts.
+ * @paramin mode Requested start mode. GNSS must already be powered.
+ * @return true if the modem accepted the restart.
+ */
+bool ModemMgr::GpsRestart(GnssStartMode mode) {
+    static const char* const startCmd[] = { "+CGNSCOLD", "+CGNSWARM", "+CGNSHOT" };
+    AtRequest_t req;
+    if (at.command(&req, 10000L, "%s", startCmd[mode]) != AT_OK) {
+        FixedPrintf(serialMon, "Failed to restart GNSS (%s)\n", startCmd[mode]);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * @brief Read one +CGNSINF report and decode it in place.
+ * @paramout rec Decoded GNSS record.
+ * @return true if the modem answered with a complete, well formed report.
  */
-bool ModemMgr::GpsGetFix() {
-    String gnssRaw = modem.getGPSraw();
-    serialMon.println("Raw GNSS data: " + gnssRaw);
-    int idx = gnssRaw.indexOf(":");
-    String data = (idx < 0) ? gnssRaw : gnssRaw.substring(idx + 1);
-    data.trim();
-    int firstComma = data.indexOf(",");
-    int secondComma = data.indexOf(",", firstComma + 1);
-    if (firstComma < 0 || secondComma < 0)  {
+bool ModemMgr::GpsGetRecord(GnssRecord_t* rec) {
+    AtRequest_t req;
+    size_t len = 0;
+    const char* line = NULL;
+    if (at.command(&req, 2000, "+CGNSINF") == AT_OK) {
+        line = AtEngine::findLine(&req, "+CGNSINF:", &len);
+    }
+    if (line == NULL) {
+        serialMon.println("Failed to read GNSS data");
         return false;
     }
-    String fixStatus = data.substring(0, firstComma);
-    String fixMode = data.substring(firstComma + 1, secondComma);
-    if (fixStatus != "1" || fixMode != "1") {
+    serialMon.print("Raw GNSS data: ");
+    serialMon.write((const uint8_t*)line, len);
+    serialMon.println();
+    if (!GnssParseCgnsinf(line, len, rec)) {
+        serialMon.println("Malformed GNSS data");
         return false;
     }
     return true;
 }
 
 /*
- * @brief Extract latitude and longitude from GNSS raw string.
- * @paramout lat Pointer to float to store latitude.
- * @paramout lon Pointer to float to store longitude.
- */
-void ModemMgr::GpsGetLatLon(float* lat, float* lon) {
-    String gnssRaw = modem.getGPSraw();
-    serialMon.println("Raw GNSS data: " + gnssRaw);
-    int idx = gnssRaw.indexOf(":");
-    String data = (idx < 0) ? gnssRaw : gnssRaw.substring(idx + 1);
-    int fieldCount = 0;
-    int lastPos = 0;
-    float latitude = 0.0, longitude = 0.0;
-    data.trim();
-    for (int i = 0; i < data.length(); ++i) {
-        if (data[i] == ',') {
-            fieldCount++;
-            if (fieldCount == 3) { // latitude is field 3
-                int nextComma = data.indexOf(',', i + 1);
-                String latStr = data.substring(i + 1, nextComma);
-                latitude = latStr.toFloat();
-                i = nextComma - 1;
-            } else if (fieldCount == 4) { // longitude is field 4
-                int nextComma = data.indexOf(',', i + 1);
-                String lonStr = data.substring(i + 1, nextComma);
-                longitude = lonStr.toFloat();
-                break;
-            }
-        }
+ * @brief Take an atomic GNSS snapshot with a single +CGNSINF exchange.
+ * @paramout sample Timestamped record; valid is set only if the modem reports a fix.
+ * @return true if a fix was obtained, false otherwise.
+ */
+bool ModemMgr::GpsSample(GnssSample_t* sample) {
+    sample->valid = false;
+    if (!GpsGetRecord(&sample->record)) {
+        return false;
     }
-    *lat = latitude;
-    *lon = longitude;
+    sample->timestampMs = millis();
+    sample->valid = sample->record.runStatus && sample->record.fixValid;
+    return sample->valid;
+}
+
+/*
+ * @brief Configure periodic +UGNSINF reports pushed by the modem.
+ * @paramin intervalSec Seconds between reports, 0 disables URC reporting.
+ * @return true if the modem accepted the setting.
+ */
+bool ModemMgr::GpsSetUrcReport(uint8_t intervalSec) {
+    AtRequest_t req;
+    if (at.command(&req, 10000L, "+CGNSURC=%u", intervalSec) != AT_OK) {
+        serialMon.println("Failed to set GNSS URC report");
+        return false;
+    }
+    if (intervalSec > 0) {
+        /* Drop any report left over from a previous session */
+        xSemaphoreTake(gnssUrcReady, 0);
+    }
+    return true;
+}
+
+/*
+ * @brief Wait for the next +UGNSINF report pushed by the modem.
+ * @paramin timeoutMs Maximum time to wait for a report.
+ * @paramout sample Timestamped record; valid is set only if the modem reports a fix.
+ * @return true if a report carrying a fix was received, false otherwise.
+ */
+bool ModemMgr::GpsReadUrc(GnssSample_t* sample, uint32_t timeoutMs) {
+    sample->valid = false;
+    if (xSemaphoreTake(gnssUrcReady, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) {
+        return false;
+    }
+    portENTER_CRITICAL(&gnssUrcLock);
+    *sample = gnssUrcSample;
+    portEXIT_CRITICAL(&gnssUrcLock);
+    return sample->valid;
+}
+
+/*
+ * @brief URC handler for +UGNSINF reports. Runs in the AT engine task.
+ */
+void ModemMgr::onGnssUrc(const char* line, size_t len, void* ctx) {
+    ModemMgr* self = static_cast<ModemMgr*>(ctx);
+    GnssSample_t sample;
+    if (!GnssParseCgnsinf(line, len, &sample.record)) {
+        self->serialMon.println("Malformed GNSS report");
+        return;
+    }
+    sample.timestampMs = millis();
+    sample.valid = sample.record.runStatus && sample.record.fixValid;
+    portENTER_CRITICAL(&self->gnssUrcLock);
+    self->gnssUrcSample = sample;
+    portEXIT_CRITICAL(&self->gnssUrcLock);
+    xSemaphoreGive(self->gnssUrcReady);
 }
 
 /*
@@ -167,8 +459,13 @@ void ModemMgr::GpsGetLatLon(float* lat, float* lon) {
  * @return true if SIM is ready, false otherwise.
  */
 bool ModemMgr::isSimReady() {
-    modem.sendAT("+CPIN?");
-    if (modem.waitResponse(10000L) != 1) {
+    AtRequest_t req;
+    size_t len = 0;
+    const char* status = NULL;
+    if (at.command(&req, 5000, "+CPIN?") == AT_OK) {
+        status = AtEngine::findLine(&req, "+CPIN:", &len);
+    }
+    if (status == NULL || len < 5 || memcmp(status, "READY", 5) != 0) {
         serialMon.println("SIM not ready");
         return false;
     }
@@ -176,23 +473,24 @@ bool ModemMgr::isSimReady() {
     return true;
 }
 
-String ModemMgr::simGetSignalQuality() {
-    modem.sendAT("+CSQ");
-    if (modem.waitResponse(10000L) != 1) {
-        serialMon.println("Failed to get signal quality");
-        return "99"; // 99 means unknown or not detectable
+/*
+ * @brief Query the received signal strength.
+ * @return <rssi> of +CSQ, 99 if unknown or not detectable.
+ */
+int ModemMgr::simGetSignalQuality() {
+    AtRequest_t req;
+    size_t len = 0;
+    const char* csq = NULL;
+    if (at.command(&req, 5000, "+CSQ") == AT_OK) {
+        csq = AtEngine::findLine(&req, "+CSQ:", &len);
     }
-    // Custom parsing logic
-    char buf[7];
-    size_t bytesRead = modem.stream.readBytesUntil(',', buf, 7);
-    int16_t rssi = 99;
-    if (bytesRead && bytesRead < 7) {
-        buf[bytesRead] = '\0';
-        rssi = atoi(buf);
+    if (csq == NULL) {
+        serialMon.println("Failed to get signal quality");
+        return 99;
     }
-    modem.waitResponse();
-    serialMon.println("Signal quality (RSSI): " + String(rssi));
-    return String(rssi);
+    int rssi = atoi(csq);
+    FixedPrintf(serialMon, "Signal quality (RSSI): %d\n", rssi);
+    return rssi;
 }
 
 /*
@@ -200,109 +498,297 @@ String ModemMgr::simGetSignalQuality() {
  * @paramin mode Network mode (0=auto, 1=2G only, 2=3G only, 3=4G only).
  */
 bool ModemMgr::simSetNetworkMode(int mode) {
-    String cmd = "+CNMP=" + String(mode);
-    modem.sendAT(cmd);
-    if (modem.waitResponse(10000L) != 1) {
+    AtRequest_t req;
+    if (at.command(&req, 10000L, "+CNMP=%d", mode) != AT_OK) {
         serialMon.println("Failed to set network mode");
         return false;
     }
-    serialMon.println("Network mode set to " + String(mode));
+    FixedPrintf(serialMon, "Network mode set to %d\n", mode);
     return true;
 }
 
 /*
- * @brief Get the SIM card registration status.
- * @return Registration status code (0-5).
+ * @brief Query LTE-M / NB-IoT (+CEREG) and 2G (+CREG) registration into the cache.
+ * @paramout net Network state cache.
+ * @return Combined registration status code (0-5).
  */
-RegStatus ModemMgr::simGetRegistrationStatus() {
-    modem.sendAT("+CREG?");
-    if (modem.waitResponse(10000L) != 1) {
-        serialMon.println("Failed to get registration status");
-        return REG_NO_RESULT;
+RegStatus ModemMgr::simGetRegistrationStatus(NetworkState& net) {
+    static const char* const query[] = { "+CEREG?", "+CREG?" };
+    static const char* const prefix[] = { "+CEREG:", "+CREG:" };
+    AtRequest_t req;
+    for (uint8_t i = 0; i < 2; ++i) {
+        size_t len = 0;
+        const char* line = NULL;
+        if (at.command(&req, 5000, "%s", query[i]) == AT_OK) {
+            line = AtEngine::findLine(&req, prefix[i], &len);
+        }
+        if (line == NULL) {
+            FixedPrintf(serialMon, "Failed to get registration status (%s)\n", query[i]);
+            continue;
+        }
+        net.parseRegistration(i == 0, line, len, false);
     }
-    String response = "";
-    unsigned long start = millis();
-    while ((millis() - start) < 500 && serialAT.available()) {
-        response += (char)serialAT.read();
+    RegStatus status = net.registration();
+    FixedPrintf(serialMon, "Registration status: %d\n", status);
+    return status;
+}
+
+/*
+ * @brief Fill the network state cache: SIM status, network mode, registration and
+ *        operator, and turn on +CREG/+CEREG indications so registration stays current.
+ * @paramout net Network state cache, marked valid on success.
+ * @paramin mode Network mode for AT+CNMP.
+ * @return true if the cache is valid.
+ */
+bool ModemMgr::simRefreshNetworkState(NetworkState& net, int mode) {
+    AtRequest_t req;
+    bool ready = isSimReady();
+    net.setSimReady(ready);
+    if (!ready || !simSetNetworkMode(mode)) {
+        return false;
     }
-    // Example response: "+CREG: 0,1"
-    int cregIdx = response.indexOf("+CREG:");
-    if (cregIdx < 0) {
-        serialMon.println("Unexpected CREG response: " + response);
-        return REG_NO_RESULT;
+    /* n=2: indications carry <tac>/<lac>, <ci> and <AcT> */
+    if (at.command(&req, 5000, "+CEREG=2") != AT_OK || at.command(&req, 5000, "+CREG=2") != AT_OK) {
+        serialMon.println("Failed to enable registration indications");
+        return false;
     }
-    int commaIdx = response.indexOf(",", cregIdx);
-    if (commaIdx < 0) {
-        serialMon.println("Malformed CREG response: " + response);
-        return REG_NO_RESULT;
+    simGetRegistrationStatus(net);
+    char name[NET_OPERATOR_MAX_LEN];
+    simGetOperator(name, sizeof(name));
+    net.setOperator(name);
+    net.refreshed();
+    return true;
+}
+
+/*
+ * @brief Select SMS text mode and enable +CMTI new-message indications.
+ * @return true if the modem accepted both settings.
+ */
+bool ModemMgr::simEnableNewMessageIndication() {
+    AtRequest_t req;
+    if (at.command(&req, 5000, "+CMGF=1") != AT_OK ||
+        at.command(&req, 5000, "+CNMI=2,1,0,0,0") != AT_OK) {
+        serialMon.println("Failed to enable SMS indications");
+        return false;
     }
-    String statusStr = response.substring(commaIdx + 1);
-    statusStr.trim();
-    int status = statusStr.toInt();
-    serialMon.println("Registration status: " + String(status));
-    return static_cast<RegStatus>(status);
+    return true;
+}
+
+static void onSmsListLine(const char* line, size_t len, void* ctx) {
+    static_cast<SmsInbox*>(ctx)->parseListLine(line, len);
 }
 
 /*
- * @brief Read the latest SMS message from the SIM card.
- * @return The content of the latest SMS message, or empty string if none.
+ * @brief Read every stored SMS with one AT+CMGL pass and delete the ones parsed, by index.
+ *        If the inbox fills up, another fetch is requested for the rest.
+ * @paramout inbox Inbox receiving the messages.
+ * @return Number of messages stored in the inbox, or -1 if the listing failed.
  */
-String ModemMgr::simReadMessage() {
-    modem.sendAT("+CMGR=1");
-    if (modem.waitResponse(10000L) != 1) {
-        serialMon.println("Failed to read SMS");
-        return "";
+int ModemMgr::simFetchMessages(SmsInbox& inbox) {
+    AtRequest_t req;
+    AtEngine::prepare(&req, 10000L, "+CMGL=\"ALL\"");
+    req.onLine = onSmsListLine;
+    /* A text reading "OK" or "ERROR" must not end the listing */
+    req.bodyPrefix = "+CMGL:";
+    req.ctx = &inbox;
+    inbox.clearPending();
+    inbox.beginListing();
+    if (at.exec(&req) != AT_OK) {
+        inbox.endListing();
+        inbox.requestFetch();
+        serialMon.println("Failed to list SMS");
+        return -1;
     }
-    String response = "";
-    unsigned long start = millis();
-    while ((millis() - start) < 1000) {
-        while (serialAT.available()) {
-            response += (char)serialAT.read();
-        }
+    bool complete = inbox.endListing();
+    uint16_t indexes[SMS_INBOX_DEPTH];
+    uint8_t listed = inbox.listedIndexes(indexes, SMS_INBOX_DEPTH);
+    if (listed == 0) {
+        return 0;
     }
-    // Parse SMS text from response
-    int textStart = response.indexOf("\n", response.indexOf("+CMGR:"));
-    if (textStart < 0) {
-        serialMon.println("SMS parse error: " + response);
-        return "";
+    /* Only what was parsed: a message that arrived during the listing, or was read
+     * elsewhere but not listed here, stays on the SIM for the next fetch */
+    for (uint8_t i = 0; i < listed; ++i) {
+        if (at.command(&req, 5000, "+CMGD=%u", indexes[i]) != AT_OK) {
+            FixedPrintf(serialMon, "Failed to delete SMS %u\n", indexes[i]);
+        }
     }
-    String smsText = response.substring(textStart + 1);
-    smsText.trim();
-    int textEnd = smsText.indexOf("\n");
-    if (textEnd > 0) {
-        smsText = smsText.substring(0, textEnd);
+    if (!complete) {
+        inbox.requestFetch();
     }
-    serialMon.println("SMS content: " + smsText);
-    return smsText;
+    FixedPrintf(serialMon, "Fetched %u SMS\n", listed);
+    return listed;
 }
 
 /*
  * @brief Send an SMS message via the SIM card.
+ *        The text is sent once the modem's '>' prompt arrives and terminated with Ctrl+Z.
  * @paramin number Recipient phone number.
  * @paramin message Message content.
+ * @paramout messageRef <mr> of "+CMGS: <mr>", -1 if not reported.
+ * @paramout cmsError <err> of "+CMS ERROR: <err>", 0 if none.
+ * @return AT_OK once the network accepted the message.
  */
-void ModemMgr::simSendMessage(const String& number, const String& message) {
-    String cmd = "+CMGS=\"" + number + "\"";
-    modem.sendAT(cmd);
-    if (modem.waitResponse(10000L) != 1) {
-        serialMon.println("Failed to send SMS");
-        return;
-    }
-    modem.sendAT(message);
-    modem.sendAT("\x1A"); // Send Ctrl+Z to indicate end of message
-    if (modem.waitResponse(10000L) != 1) {
-        serialMon.println("Failed to send SMS");
+AtResult ModemMgr::simSendMessage(const char* number, const char* message, int* messageRef, int* cmsError) {
+    AtRequest_t req;
+    size_t len = 0;
+    AtEngine::prepare(&req, 60000L, "+CMGS=\"%s\"", number);
+    req.payload = (const uint8_t*)message;
+    req.payloadLen = strlen(message);
+    req.payloadCtrlZ = true;
+    AtResult result = at.exec(&req);
+    const char* mr = AtEngine::findLine(&req, "+CMGS:", &len);
+    const char* err = AtEngine::findLine(&req, "+CMS ERROR:", &len);
+    *messageRef = (result == AT_OK && mr != NULL) ? atoi(mr) : -1;
+    *cmsError = (err != NULL) ? atoi(err) : 0;
+    if (result != AT_OK) {
+        FixedPrintf(serialMon, "Failed to send SMS (result %d, +CMS ERROR %d)\n", (int)result, *cmsError);
     } else {
-        serialMon.println("SMS sent successfully");
+        FixedPrintf(serialMon, "SMS sent successfully, mr %d\n", *messageRef);
     }
+    return result;
 }
 
 /**
  * @brief Get the current network operator.
- * @return The name of the network operator.
+ * @paramout name Operator name, "" if unknown.
+ * @paramin max Size of name.
+ * @return true if the modem reported an operator.
  */
-String ModemMgr::simGetOperator() {
-    String op = modem.getOperator();
-    serialMon.println("Network operator: " + op);
-    return op;
-}
\ No newline at end of file
+bool ModemMgr::simGetOperator(char* name, size_t max) {
+    AtRequest_t req;
+    size_t len = 0;
+    const char* cops = NULL;
+    name[0] = '\0';
+    if (at.command(&req, 10000L, "+COPS?") == AT_OK) {
+        cops = AtEngine::findLine(&req, "+COPS:", &len);
+    }
+    // Example response: "+COPS: 0,0,\"Operator\",7"
+    const char* open = cops ? (const char*)memchr(cops, '"', len) : NULL;
+    if (open != NULL) {
+        const char* close = (const char*)memchr(open + 1, '"', (size_t)(cops + len - open - 1));
+        size_t n = close ? (size_t)(close - open - 1) : 0;
+        if (n >= max) {
+            n = max - 1;
+        }
+        memcpy(name, open + 1, n);
+        name[n] = '\0';
+    }
+    serialMon.print("Network operator: ");
+    serialMon.println(name);
+    return open != NULL;
+}
+
+/*
+ * @brief Read the modem's IMEI, the identity of this unit towards the broker.
+ * @paramout imei MODEM_IMEI_LEN digits, NUL terminated.
+ * @paramin max Size of imei, at least MODEM_IMEI_LEN + 1.
+ * @return false if the modem gave no IMEI.
+ */
+bool ModemMgr::simGetImei(char* imei, size_t max) {
+    AtRequest_t req;
+    size_t len = 0;
+    const char* line = NULL;
+    imei[0] = '\0';
+    if (max <= MODEM_IMEI_LEN || at.command(&req, 5000, "+CGSN") != AT_OK) {
+        return false;
+    }
+    /* The only information line: the digits alone */
+    line = AtEngine::findLine(&req, "", &len);
+    if (line == NULL || len != MODEM_IMEI_LEN || strspn(line, "0123456789") < MODEM_IMEI_LEN) {
+        return false;
+    }
+    memcpy(imei, line, MODEM_IMEI_LEN);
+    imei[MODEM_IMEI_LEN] = '\0';
+    return true;
+}
+
+/*
+ * @brief Activate PDP context 0 for the modem's IP applications, unless it is already up.
+ * @paramin apn Access point name, "" to keep the one configured in the modem.
+ * @return true if the context is active.
+ */
+bool ModemMgr::dataAttach(const char* apn) {
+    AtRequest_t req;
+    size_t len = 0;
+    const char* state = NULL;
+    if (at.command(&req, 5000, "+CNACT?") == AT_OK) {
+        state = AtEngine::findLine(&req, "+CNACT:", &len);
+    }
+    /* "+CNACT: 0,1,\"10.1.2.3\"": context 0 active */
+    if (state != NULL && len >= 3 && memcmp(state, "0,1", 3) == 0) {
+        return true;
+    }
+    if (apn[0] != '\0' && at.command(&req, 5000, "+CNCFG=0,1,\"%s\"", apn) != AT_OK) {
+        serialMon.println("Failed to set APN");
+        return false;
+    }
+    if (at.command(&req, 30000L, "+CNACT=0,1") != AT_OK) {
+        serialMon.println("Failed to activate PDP context");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * @brief Configure the modem's MQTT client and open a session.
+ * @paramin config Broker, credentials and CA file; keepAliveS outlasts a GNSS slice, the modem sends the pings.
+ * @return true once the broker accepted the connection.
+ */
+bool ModemMgr::mqttConnect(const MqttConfig_t& config) {
+    AtRequest_t req;
+    if (at.command(&req, 5000, "+SMCONF=\"URL\",\"%s\",%u", config.host, (unsigned)config.port) != AT_OK ||
+        at.command(&req, 5000, "+SMCONF=\"CLIENTID\",\"%s\"", config.clientId) != AT_OK ||
+        at.command(&req, 5000, "+SMCONF=\"KEEPTIME\",%u", (unsigned)config.keepAliveS) != AT_OK ||
+        at.command(&req, 5000, "+SMCONF=\"CLEANSS\",1") != AT_OK) {
+        serialMon.println("Failed to configure MQTT");
+        return false;
+    }
+    if (config.user != NULL && config.user[0] != '\0' &&
+        (at.command(&req, 5000, "+SMCONF=\"USERNAME\",\"%s\"", config.user) != AT_OK ||
+         at.command(&req, 5000, "+SMCONF=\"PASSWORD\",\"%s\"", config.password ? config.password : "") != AT_OK)) {
+        serialMon.println("Failed to set MQTT credentials");
+        return false;
+    }
+    if (config.caFile != NULL) {
+        /* TLS 1.2, server certificate checked against the CA file */
+        if (at.command(&req, 5000, "+CSSLCFG=\"SSLVERSION\",0,3") != AT_OK ||
+            at.command(&req, 5000, "+CSSLCFG=\"CONVERT\",2,\"%s\"", config.caFile) != AT_OK ||
+            at.command(&req, 5000, "+SMSSL=1,\"%s\",\"\"", config.caFile) != AT_OK) {
+            FixedPrintf(serialMon, "Failed to set up TLS with %s\n", config.caFile);
+            return false;
+        }
+    }
+    if (at.command(&req, 30000L, "+SMCONN") != AT_OK) {
+        serialMon.println("MQTT connect failed");
+        return false;
+    }
+    FixedPrintf(serialMon, "MQTT connected to %s:%u%s\n", config.host, (unsigned)config.port,
+                config.caFile ? " over TLS" : "");
+    return true;
+}
+
+/*
+ * @brief Publish one message on the open MQTT session.
+ * @paramin payload Message body, sent after the '>' prompt by length (binary safe).
+ * @return true if the modem accepted the message.
+ */
+bool ModemMgr::mqttPublish(const char* topic, const uint8_t* payload, size_t len, uint8_t qos) {
+    AtRequest_t req;
+    AtEngine::prepare(&req, 10000L, "+SMPUB=\"%s\",%u,%u,0", topic, (unsigned)len, (unsigned)qos);
+    req.payload = payload;
+    req.payloadLen = len;
+    req.payloadCtrlZ = false;
+    if (at.exec(&req) != AT_OK) {
+        serialMon.println("MQTT publish failed");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * @brief Close the MQTT session.
+ */
+void ModemMgr::mqttDisconnect() {
+    AtRequest_t req;
+    at.command(&req, 5000, "+SMDISC");
+}
@@ -0,0 +1,67 @@
+#include "modemUart.h"
+
+/*
+ * @brief ModemUart constructor
+ * @paramin serial UART connected to the modem
+ * @paramin rxPin UART RX pin
+ * @paramin txPin UART TX pin
+ */
+ModemUart::ModemUart(HardwareSerial& serial, int rxPin, int txPin)
+    : serial(serial), rxPin(rxPin), txPin(txPin), baud(0) {}
+
+/*
+ * @brief Open the UART with an enlarged RX ring buffer.
+ * @paramin baud Initial baud rate, the modem's power-on rate.
+ */
+void ModemUart::begin(uint32_t baud) {
+    /* Must be set before the driver is installed */
+    serial.setRxBufferSize(MODEM_UART_RX_BUFFER_LEN);
+    serial.begin(baud, SERIAL_8N1, rxPin, txPin);
+    this->baud = baud;
+}
+
+int ModemUart::available() {
+    return serial.available();
+}
+
+int ModemUart::read() {
+    return serial.read();
+}
+
+int ModemUart::peek() {
+    return serial.peek();
+}
+
+/*
+ * @brief Copy up to len buffered bytes in one driver call.
+ * @return Number of bytes copied, without waiting for more to arrive.
+ */
+size_t ModemUart::readBytes(char* buf, size_t len) {
+    return serial.read((uint8_t*)buf, len);
+}
+
+size_t ModemUart::write(uint8_t c) {
+    return serial.write(c);
+}
+
+size_t ModemUart::write(const uint8_t* buf, size_t len) {
+    return serial.write(buf, len);
+}
+
+void ModemUart::flush() {
+    serial.flush();
+}
+
+/*
+ * @brief Change the host-side baud rate, e.g. after the modem accepted AT+IPR.
+ */
+bool ModemUart::setBaud(uint32_t baud) {
+    serial.flush();
+    serial.updateBaudRate(baud);
+    this->baud = baud;
+    return true;
+}
+
+uint32_t ModemUart::getBaud() const {
+    return baud;
+}
@@ -0,0 +1,243 @@
+#include <string.h>
+#include <stdlib.h>
+#include "networkState.h"
+
+#define NET_REG_MAX_FIELDS  6
+
+static const char cregPrefix[] = "+CREG:";
+static const char ceregPrefix[] = "+CEREG:";
+static const char cpinPrefix[] = "+CPIN:";
+
+static bool startsWith(const char* line, size_t len, const char* prefix, size_t prefixLen) {
+    return len >= prefixLen && memcmp(line, prefix, prefixLen) == 0;
+}
+
+static bool isRegistered(RegStatus status) {
+    return status == REG_OK_HOME || status == REG_OK_ROAMING;
+}
+
+/*
+ * @brief NetworkState constructor
+ */
+NetworkState::NetworkState()
+    : lock(portMUX_INITIALIZER_UNLOCKED), valid(false), sim(false), cregStatus(REG_NO_RESULT),
+      ceregStatus(REG_NO_RESULT), act(NET_ACT_UNKNOWN) {
+    operatorName[0] = '\0';
+    memset(&stats, 0, sizeof(stats));
+}
+
+/*
+ * @brief Subscribe to registration and SIM status indications.
+ * @paramin at AT engine delivering URCs.
+ * @return true on success.
+ */
+bool NetworkState::begin(AtEngine& at) {
+    return at.subscribe(ceregPrefix, onUrc, this) && at.subscribe(cregPrefix, onUrc, this) &&
+           at.subscribe(cpinPrefix, onUrc, this);
+}
+
+void NetworkState::onUrc(const char* line, size_t len, void* ctx) {
+    static_cast<NetworkState*>(ctx)->parseUrc(line, len);
+}
+
+/*
+ * @brief Whether SIM, mode, registration and operator must be queried before use.
+ */
+bool NetworkState::needsRefresh() const {
+    return !valid;
+}
+
+/*
+ * @brief Drop the cache after an error; the next cellular iteration queries the modem again.
+ */
+void NetworkState::invalidate() {
+    portENTER_CRITICAL(&lock);
+    if (valid) {
+        stats.invalidations++;
+    }
+    valid = false;
+    portEXIT_CRITICAL(&lock);
+}
+
+/*
+ * @brief Take over the registration kept through deep sleep by a modem that stayed on.
+ *        Its settings, including the registration URCs, are still in place.
+ */
+void NetworkState::restore(RegStatus status) {
+    portENTER_CRITICAL(&lock);
+    sim = true;
+    ceregStatus = status;
+    valid = true;
+    portEXIT_CRITICAL(&lock);
+}
+
+/*
+ * @brief Apply a +CREG, +CEREG or +CPIN indication. Runs in the AT engine task.
+ * @paramin line Line without terminator.
+ * @paramin len Line length.
+ */
+void NetworkState::parseUrc(const char* line, size_t len) {
+    const char* prefix;
+    size_t prefixLen;
+    if (startsWith(line, len, cpinPrefix, sizeof(cpinPrefix) - 1)) {
+        prefix = cpinPrefix;
+        prefixLen = sizeof(cpinPrefix) - 1;
+    } else if (startsWith(line, len, ceregPrefix, sizeof(ceregPrefix) - 1)) {
+        prefix = ceregPrefix;
+        prefixLen = sizeof(ceregPrefix) - 1;
+    } else if (startsWith(line, len, cregPrefix, sizeof(cregPrefix) - 1)) {
+        prefix = cregPrefix;
+        prefixLen = sizeof(cregPrefix) - 1;
+    } else {
+        return;
+    }
+    const char* text = line + prefixLen;
+    size_t n = len - prefixLen;
+    while (n > 0 && *text == ' ') {
+        text++;
+        n--;
+    }
+    if (prefix == cpinPrefix) {
+        /* "+CPIN: NOT READY" when the SIM is pulled, "+CPIN: READY" when it is back */
+        setSimReady(n >= 5 && memcmp(text, "READY", 5) == 0);
+    } else {
+        parseRegistration(prefix == ceregPrefix, text, n, true);
+    }
+}
+
+/*
+ * @brief Apply registration fields.
+ * @paramin eps true for +CEREG (LTE-M / NB-IoT), false for +CREG (2G).
+ * @paramin text Fields after the "+CEREG: " or "+CREG: " prefix.
+ * @paramin len Text length.
+ * @paramin urc true for an indication ("<stat>[,<tac>,<ci>,<AcT>]"),
+ *              false for a query response, which starts with <n>.
+ */
+void NetworkState::parseRegistration(bool eps, const char* text, size_t len, bool urc) {
+    /* Split into comma separated fields; the quoted <tac>/<lac> and <ci> hold no commas */
+    char fields[64];
+    size_t n = len;
+    if (n >= sizeof(fields)) {
+        n = sizeof(fields) - 1;
+    }
+    memcpy(fields, text, n);
+    fields[n] = '\0';
+    const char* field[NET_REG_MAX_FIELDS];
+    uint8_t count = 0;
+    char* p = fields;
+    while (count < NET_REG_MAX_FIELDS) {
+        field[count++] = p;
+        p = strchr(p, ',');
+        if (p == NULL) {
+            break;
+        }
+        *p++ = '\0';
+    }
+    uint8_t first = urc ? 0 : 1;
+    if (count <= first) {
+        return;
+    }
+    RegStatus status = (RegStatus)atoi(field[first]);
+    NetAccessTech tech = (count > first + 3) ? (NetAccessTech)atoi(field[first + 3]) : NET_ACT_UNKNOWN;
+
+    portENTER_CRITICAL(&lock);
+    if (eps) {
+        ceregStatus = status;
+    } else {
+        cregStatus = status;
+    }
+    if (isRegistered(status) && tech != NET_ACT_UNKNOWN) {
+        act = tech;
+    }
+    if (urc) {
+        stats.urcs++;
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+void NetworkState::setSimReady(bool ready) {
+    portENTER_CRITICAL(&lock);
+    sim = ready;
+    if (!ready) {
+        /* SIM removed or locked: registration is gone too */
+        cregStatus = REG_NO_RESULT;
+        ceregStatus = REG_NO_RESULT;
+        valid = false;
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+void NetworkState::setOperator(const char* name) {
+    portENTER_CRITICAL(&lock);
+    strncpy(operatorName, name, sizeof(operatorName) - 1);
+    operatorName[sizeof(operatorName) - 1] = '\0';
+    portEXIT_CRITICAL(&lock);
+}
+
+/*
+ * @brief Mark the cache as filled by a complete refresh.
+ */
+void NetworkState::refreshed() {
+    portENTER_CRITICAL(&lock);
+    valid = true;
+    stats.refreshes++;
+    portEXIT_CRITICAL(&lock);
+}
+
+bool NetworkState::simReady() const {
+    return sim;
+}
+
+/*
+ * @brief Combined registration: a registered domain wins, LTE-M / NB-IoT first.
+ */
+RegStatus NetworkState::registration() const {
+    RegStatus eps = ceregStatus;
+    RegStatus cs = cregStatus;
+    if (isRegistered(eps)) {
+        return eps;
+    }
+    if (isRegistered(cs)) {
+        return cs;
+    }
+    /* Neither registered: EPS tells more on a CAT-M/NB-IoT modem, unless it has not reported */
+    return (eps == REG_NO_RESULT) ? cs : eps;
+}
+
+bool NetworkState::registered() const {
+    return sim && isRegistered(registration());
+}
+
+NetAccessTech NetworkState::accessTech() const {
+    return act;
+}
+
+void NetworkState::getOperator(char* out, size_t max) {
+    portENTER_CRITICAL(&lock);
+    strncpy(out, operatorName, max - 1);
+    out[max - 1] = '\0';
+    portEXIT_CRITICAL(&lock);
+}
+
+void NetworkState::getStats(NetworkStats_t* out) {
+    portENTER_CRITICAL(&lock);
+    *out = stats;
+    portEXIT_CRITICAL(&lock);
+}
+
+/*
+ * @brief Print the cached state and how often it had to be refreshed.
+ */
+void NetworkState::printStats(Print& out) {
+    static const char* const actNames[] = {"GSM", "", "", "EGPRS", "", "", "", "LTE-M", "", "NB-IoT"};
+    char name[NET_OPERATOR_MAX_LEN];
+    NetworkStats_t s;
+    getOperator(name, sizeof(name));
+    getStats(&s);
+    NetAccessTech tech = act;
+    bool techKnown = tech >= NET_ACT_GSM && tech <= NET_ACT_NBIOT && actNames[tech][0] != '\0';
+    FixedPrintf(out, "Network: SIM %s, CREG %d, CEREG %d, %s, operator \"%s\"\n", sim ? "ready" : "not ready",
+                (int)cregStatus, (int)ceregStatus, techKnown ? actNames[tech] : "unknown", name);
+    FixedPrintf(out, "Network: %u refreshes, %u URCs, %u invalidations\n", (unsigned)s.refreshes, (unsigned)s.urcs,
+                (unsigned)s.invalidations);
+}
@@ -0,0 +1,274 @@
+#include <string.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <driver/uart.h>
+#include "powerManager.h"
+
+static const char* const modemStateNames[MODEM_POWER_STATES] = { "active", "sleep", "eDRX", "PSM" };
+static const uint32_t modemStateUa[MODEM_POWER_STATES] = {
+    POWER_MODEM_ACTIVE_UA, POWER_MODEM_SLEEP_UA, POWER_MODEM_EDRX_UA, POWER_MODEM_PSM_UA
+};
+
+/* uA * ms to mAh */
+#define POWER_UAMS_PER_MAH  3600000000ULL
+
+/*
+ * @brief PowerManager constructor
+ * @paramin modem Modem manager, for DTR and the sleep settings.
+ * @paramin at AT engine, polled slower while the modem sleeps.
+ * @paramin arbiter Radio arbiter; the modem is kept awake while it is busy.
+ */
+PowerManager::PowerManager(ModemMgr& modem, AtEngine& at, RfArbiter& arbiter)
+    : modem(modem), at(at), arbiter(arbiter), edrxCycle(NULL), psmPeriodicTau(NULL), psmActiveTime(NULL),
+      lock(NULL), lightSleepOn(false), sleepReady(false), edrxOn(false), psmOn(false),
+      gnssOn(false), lastConfigMs(0), configTried(false), modemState(MODEM_POWER_ACTIVE), lastAccountMs(0),
+      ringPending(false), rang(false), ringCount(0) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+/*
+ * @brief Create the state lock and arm the wake-up sources. Call before the tasks start.
+ * @paramin lightSleep Let lightSleep() put the ESP32 in light sleep.
+ * @return false if the lock could not be created.
+ */
+bool PowerManager::begin(bool lightSleep) {
+    lock = xSemaphoreCreateMutex();
+    if (lock == NULL) {
+        return false;
+    }
+    lastAccountMs = millis();
+    lightSleepOn = lightSleep;
+    if (lightSleep) {
+        /* The modem's RX line is armed around each sleep, over its ring interrupt */
+        esp_sleep_enable_gpio_wakeup();
+        uart_set_wakeup_threshold(UART_NUM_0, POWER_CONSOLE_WAKE_EDGES);
+        esp_sleep_enable_uart_wakeup(UART_NUM_0);
+    }
+    return true;
+}
+
+/*
+ * @brief Network power saving requested by configureModem().
+ * @paramin edrxCycle eDRX cycle for AT+CEDRXS, NULL to leave eDRX off.
+ * @paramin psmPeriodicTau Periodic TAU for AT+CPSMS, NULL to leave PSM off.
+ * @paramin psmActiveTime Active time for AT+CPSMS.
+ */
+void PowerManager::setNetworkSaving(const char* edrxCycle, const char* psmPeriodicTau, const char* psmActiveTime) {
+    this->edrxCycle = edrxCycle;
+    this->psmPeriodicTau = psmPeriodicTau;
+    this->psmActiveTime = psmActiveTime;
+}
+
+/*
+ * @brief Whether configureModem() should run: after boot, after a modem power cycle,
+ *        and every POWER_CONFIG_RETRY_MS while the modem refuses to sleep.
+ */
+bool PowerManager::configDue(uint32_t nowMs) {
+    return !sleepReady && (!configTried || nowMs - lastConfigMs >= POWER_CONFIG_RETRY_MS);
+}
+
+/*
+ * @brief Enable modem sleep and request eDRX/PSM. The caller holds the radio.
+ * @return true if the modem can now sleep.
+ */
+bool PowerManager::configureModem() {
+    bool ready = modem.sleepConfigure();
+    bool edrx = modem.edrxConfigure(edrxCycle != NULL, (edrxCycle != NULL) ? edrxCycle : "");
+    bool psm = modem.psmConfigure(psmPeriodicTau != NULL, (psmPeriodicTau != NULL) ? psmPeriodicTau : "",
+                                  (psmActiveTime != NULL) ? psmActiveTime : "");
+    xSemaphoreTake(lock, portMAX_DELAY);
+    configTried = true;
+    lastConfigMs = millis();
+    sleepReady = ready;
+    edrxOn = edrx && edrxCycle != NULL;
+    psmOn = psm && psmPeriodicTau != NULL;
+    xSemaphoreGive(lock);
+    FixedPrintf(SerialMon, "Modem sleep %s, eDRX %s, PSM %s\n", ready ? "on" : "refused", edrxOn ? "on" : "off",
+                psmOn ? "on" : "off");
+    return ready;
+}
+
+/*
+ * @brief The modem was power cycled and lost its sleep settings: it stays awake until configured again.
+ */
+void PowerManager::modemRestarted() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    sleepReady = false;
+    configTried = false;
+    xSemaphoreGive(lock);
+}
+
+/*
+ * @brief Record the GNSS receiver power for the energy estimate.
+ */
+void PowerManager::setGnss(bool on) {
+    if (on == gnssOn) {
+        return;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    accountLocked(millis());
+    gnssOn = on;
+    xSemaphoreGive(lock);
+}
+
+/*
+ * @brief Whether the ring line fired since the last call.
+ */
+bool PowerManager::takeRing() {
+    if (!ringPending) {
+        return false;
+    }
+    ringPending = false;
+    return true;
+}
+
+/*
+ * @brief Light sleep the ESP32 while the modem sleeps, until the timer, the modem's RX line
+ *        or console input wakes it. The caller checks that no task has queued work.
+ * @paramin maxMs Longest sleep, capped at POWER_LIGHT_SLEEP_MAX_MS.
+ * @return Measured time asleep in ms, 0 if the modem is awake, the radio is wanted or
+ *         a ring is still to be handled.
+ */
+uint32_t PowerManager::lightSleep(uint32_t maxMs) {
+    if (!lightSleepOn || maxMs < POWER_LIGHT_SLEEP_MIN_MS) {
+        return 0;
+    }
+    if (maxMs > POWER_LIGHT_SLEEP_MAX_MS) {
+        maxMs = POWER_LIGHT_SLEEP_MAX_MS;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    /* An awake modem may send at any time, and the UART drops bytes in light sleep */
+    if (modemState == MODEM_POWER_ACTIVE || arbiter.busy() || ringPending) {
+        xSemaphoreGive(lock);
+        return 0;
+    }
+    accountLocked(millis());
+    detachInterrupt(MODEM_PIN_RI);
+    gpio_wakeup_enable((gpio_num_t)MODEM_PIN_RI, GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_timer_wakeup((uint64_t)maxMs * 1000);
+    uint32_t startUs = micros();
+    esp_light_sleep_start();
+    uint32_t sleptMs = (micros() - startUs) / 1000;
+    /* The tick interrupt stopped with the CPU clock: let timed waits see the time that passed */
+    xTaskCatchUpTicks(pdMS_TO_TICKS(sleptMs));
+    accountLocked(millis());
+    gpio_wakeup_disable((gpio_num_t)MODEM_PIN_RI);
+    attachInterruptArg(MODEM_PIN_RI, ring, this, FALLING);
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO) {
+        ring(this);
+    }
+    stats.mcuSleepMs += sleptMs;
+    stats.mcuSleeps++;
+    xSemaphoreGive(lock);
+    return sleptMs;
+}
+
+/*
+ * @brief RfArbiter busy hook: wake the modem before a radio slice, let it sleep after the last one.
+ */
+void PowerManager::onRadioBusy(void* ctx) {
+    static_cast<PowerManager*>(ctx)->update();
+}
+
+/*
+ * @brief Ring line interrupt, or the simulated modem's ring. ISR-safe. Every start bit on
+ *        the RX line is a falling edge, so only the first one of a modem sleep period counts.
+ */
+void IRAM_ATTR PowerManager::ring(void* ctx) {
+    PowerManager* self = static_cast<PowerManager*>(ctx);
+    self->ringPending = true;
+    if (!self->rang) {
+        self->rang = true;
+        self->ringCount++;
+    }
+}
+
+/*
+ * @brief Follow the radio: awake while busy, asleep (once configured) while idle.
+ *        Called by whichever task acquired or released the radio.
+ */
+void PowerManager::update() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool busy = arbiter.busy();
+    if (busy && modemState != MODEM_POWER_ACTIVE) {
+        accountLocked(millis());
+        detachInterrupt(MODEM_PIN_RI);
+        modem.awake();
+        at.setIdlePoll(AT_IDLE_POLL_MS);
+        modemState = MODEM_POWER_ACTIVE;
+        stats.modemWakes++;
+    } else if (!busy && modemState == MODEM_POWER_ACTIVE && sleepReady) {
+        accountLocked(millis());
+        modemState = psmOn ? MODEM_POWER_PSM : edrxOn ? MODEM_POWER_EDRX : MODEM_POWER_SLEEP;
+        at.setIdlePoll(AT_SLEEP_POLL_MS);
+        modem.sleep();
+        rang = false;
+        attachInterruptArg(MODEM_PIN_RI, ring, this, FALLING);
+    }
+    xSemaphoreGive(lock);
+}
+
+/*
+ * @brief Add the time since the last call to the current states. Call with the lock held.
+ */
+void PowerManager::accountLocked(uint32_t nowMs) {
+    uint32_t elapsed = nowMs - lastAccountMs;
+    lastAccountMs = nowMs;
+    stats.modemMs[modemState] += elapsed;
+    if (gnssOn) {
+        stats.gnssMs += elapsed;
+    }
+    stats.totalMs += elapsed;
+}
+
+/*
+ * @brief Copy the time per state, brought up to now.
+ */
+void PowerManager::getStats(PowerStats_t* out) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    accountLocked(millis());
+    *out = stats;
+    xSemaphoreGive(lock);
+    out->rings = ringCount;
+}
+
+/*
+ * @brief Average battery current over the time in stats, from the current model.
+ */
+uint32_t PowerManager::averageUa(const PowerStats_t& s) {
+    if (s.totalMs == 0) {
+        return 0;
+    }
+    uint64_t charge = s.gnssMs * POWER_GNSS_UA + s.mcuSleepMs * POWER_MCU_SLEEP_UA +
+                      (s.totalMs - s.mcuSleepMs) * POWER_MCU_ACTIVE_UA + s.totalMs * POWER_BOARD_UA;
+    for (int i = 0; i < MODEM_POWER_STATES; ++i) {
+        charge += s.modemMs[i] * modemStateUa[i];
+    }
+    return (uint32_t)(charge / s.totalMs);
+}
+
+/*
+ * @brief Print time and modelled charge per state, the average current and the battery life it gives.
+ */
+void PowerManager::printStats(Print& out) {
+    PowerStats_t s;
+    getStats(&s);
+    uint64_t total = (s.totalMs != 0) ? s.totalMs : 1;
+    for (int i = 0; i < MODEM_POWER_STATES; ++i) {
+        FixedPrintf(out, "Power: modem %-6s %7lu s (%3u%%), %lu.%02lu mAh\n", modemStateNames[i],
+                    (unsigned long)(s.modemMs[i] / 1000), (unsigned)(s.modemMs[i] * 100 / total),
+                    (unsigned long)(s.modemMs[i] * modemStateUa[i] / POWER_UAMS_PER_MAH),
+                    (unsigned long)(s.modemMs[i] * modemStateUa[i] * 100 / POWER_UAMS_PER_MAH % 100));
+    }
+    FixedPrintf(out, "Power: GNSS on %lu s (%u%%), MCU light sleep %lu s (%u%%) in %u sleeps%s\n",
+                (unsigned long)(s.gnssMs / 1000), (unsigned)(s.gnssMs * 100 / total),
+                (unsigned long)(s.mcuSleepMs / 1000), (unsigned)(s.mcuSleepMs * 100 / total), (unsigned)s.mcuSleeps,
+                lightSleepOn ? "" : " (off)");
+    FixedPrintf(out, "Power: %u modem wakes, %u rings\n", (unsigned)s.modemWakes, (unsigned)s.rings);
+    uint32_t avgUa = averageUa(s);
+    uint64_t usedUah = (uint64_t)avgUa * s.totalMs / 3600000ULL;
+    uint32_t lifeH = (avgUa != 0) ? (uint32_t)((uint64_t)POWER_BATTERY_MAH * 1000 / avgUa) : 0;
+    FixedPrintf(out, "Power: average %lu.%02lu mA, %lu mAh used in %lu s, %u mAh battery lasts about %lu h\n",
+                (unsigned long)(avgUa / 1000), (unsigned long)(avgUa % 1000 / 10), (unsigned long)(usedUah / 1000),
+                (unsigned long)(s.totalMs / 1000), (unsigned)POWER_BATTERY_MAH, (unsigned long)lifeH);
+}
@@ -0,0 +1,252 @@
+#include <string.h>
+#include "rfArbiter.h"
+#include "fixedString.h"
+
+static const char* const rfClientNames[RF_CLIENT_COUNT] = { "GNSS", "Cellular" };
+
+static inline bool isOverdue(uint32_t deadlineMs, uint32_t now) {
+    return (int32_t)(now - deadlineMs) >= 0;
+}
+
+/*
+ * @brief RfArbiter constructor
+ */
+RfArbiter::RfArbiter() : lock(portMUX_INITIALIZER_UNLOCKED), owner(RF_CLIENT_NONE), grantedAtMs(0),
+      busyHook(NULL), busyHookCtx(NULL) {
+    memset(grantSem, 0, sizeof(grantSem));
+    memset(preemptSem, 0, sizeof(preemptSem));
+    memset(requests, 0, sizeof(requests));
+    memset(stats, 0, sizeof(stats));
+}
+
+/*
+ * @brief Create the per-client grant and pre-emption semaphores.
+ * @return true on success.
+ */
+bool RfArbiter::begin() {
+    for (int i = 0; i < RF_CLIENT_COUNT; ++i) {
+        grantSem[i] = xSemaphoreCreateBinary();
+        preemptSem[i] = xSemaphoreCreateBinary();
+        if (grantSem[i] == NULL || preemptSem[i] == NULL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * @brief Block until the client owns the radio. Re-acquiring an owned slice returns at once.
+ * @paramin client Requesting client.
+ * @paramin priority Slice priority (RF_PRIO_*).
+ * @paramin deadlineMs Time from now after which the request pre-empts any owner.
+ * @return true once the radio is granted.
+ */
+bool RfArbiter::acquire(RfClient client, uint8_t priority, uint32_t deadlineMs) {
+    uint32_t now = millis();
+    bool granted = false;
+    RfClient notify = RF_CLIENT_NONE;
+
+    portENTER_CRITICAL(&lock);
+    if (owner == client) {
+        portEXIT_CRITICAL(&lock);
+        return true;
+    }
+    RfRequest_t* req = &requests[client];
+    req->waiting = true;
+    req->priority = priority;
+    req->deadlineMs = now + deadlineMs;
+    req->waitStartMs = now;
+    if (owner == RF_CLIENT_NONE) {
+        grantLocked(client, now);
+        granted = true;
+    } else if (outranksOwnerLocked(req, now)) {
+        notify = owner;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if (notify != RF_CLIENT_NONE) {
+        xSemaphoreGive(preemptSem[notify]);
+    }
+    if (!granted) {
+        xSemaphoreTake(grantSem[client], portMAX_DELAY);
+    }
+    /* Forget pre-emption requests aimed at an earlier slice */
+    xSemaphoreTake(preemptSem[client], 0);
+    if (busyHook != NULL) {
+        busyHook(busyHookCtx);
+    }
+    return true;
+}
+
+/*
+ * @brief Give the radio up and hand it to the next waiter, if any.
+ * @paramin client Current owner.
+ */
+void RfArbiter::release(RfClient client) {
+    uint32_t now = millis();
+    RfClient next = RF_CLIENT_NONE;
+
+    portENTER_CRITICAL(&lock);
+    if (owner != client) {
+        portEXIT_CRITICAL(&lock);
+        return;
+    }
+    uint32_t hold = now - grantedAtMs;
+    HistogramAdd(&stats[client].hold, hold);
+    owner = RF_CLIENT_NONE;
+    next = pickNextLocked(now);
+    if (next != RF_CLIENT_NONE) {
+        grantLocked(next, now);
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if (next != RF_CLIENT_NONE) {
+        xSemaphoreGive(grantSem[next]);
+    } else if (busyHook != NULL) {
+        busyHook(busyHookCtx);
+    }
+}
+
+/*
+ * @brief Check whether a waiter should take the radio from this client.
+ * @paramin client Client to check, normally the current owner.
+ * @return true if the owner should stop at its next clean boundary.
+ */
+bool RfArbiter::yieldRequested(RfClient client) {
+    uint32_t now = millis();
+    bool yield = false;
+    portENTER_CRITICAL(&lock);
+    if (owner == client) {
+        for (int i = 0; i < RF_CLIENT_COUNT && !yield; ++i) {
+            if (i != client && requests[i].waiting && outranksOwnerLocked(&requests[i], now)) {
+                yield = true;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    return yield;
+}
+
+/*
+ * @brief Sleep inside an owned slice, waking early if another client needs the radio.
+ * @paramin client Current owner.
+ * @paramin ticks Maximum time to wait.
+ * @return true if the slice should be given up, false if the full time elapsed.
+ */
+bool RfArbiter::waitPreempt(RfClient client, TickType_t ticks) {
+    TickType_t start = xTaskGetTickCount();
+    for (;;) {
+        if (yieldRequested(client)) {
+            portENTER_CRITICAL(&lock);
+            stats[client].preemptions++;
+            portEXIT_CRITICAL(&lock);
+            return true;
+        }
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= ticks) {
+            return false;
+        }
+        TickType_t step = ticks - elapsed;
+        if (step > pdMS_TO_TICKS(RF_PREEMPT_POLL_MS)) {
+            step = pdMS_TO_TICKS(RF_PREEMPT_POLL_MS);
+        }
+        xSemaphoreTake(preemptSem[client], step);
+    }
+}
+
+/*
+ * @brief Whether a client owns the radio or waits for it.
+ */
+bool RfArbiter::busy() {
+    portENTER_CRITICAL(&lock);
+    bool result = owner != RF_CLIENT_NONE;
+    for (int i = 0; i < RF_CLIENT_COUNT; ++i) {
+        result = result || requests[i].waiting;
+    }
+    portEXIT_CRITICAL(&lock);
+    return result;
+}
+
+/*
+ * @brief Have hook called whenever the radio may have gone from idle to busy or back,
+ *        e.g. to wake or sleep the modem. Set once before the tasks start.
+ *        The hook runs in the acquiring task before acquire() returns, and reads busy() itself.
+ */
+void RfArbiter::setBusyHook(RfBusyHook hook, void* ctx) {
+    busyHookCtx = ctx;
+    busyHook = hook;
+}
+
+/*
+ * @brief Copy the wait/hold counters of one client.
+ */
+void RfArbiter::getStats(RfClient client, RfClientStats_t* out) {
+    portENTER_CRITICAL(&lock);
+    *out = stats[client];
+    portEXIT_CRITICAL(&lock);
+}
+
+/*
+ * @brief Print how long each client (gpsTask, cellularTask) waited for and held the radio.
+ */
+void RfArbiter::printStats(Print& out) {
+    for (int i = 0; i < RF_CLIENT_COUNT; ++i) {
+        RfClientStats_t s;
+        getStats((RfClient)i, &s);
+        FixedPrintf(out, "RF %s: grants %u, hold total %u ms, preempted %u\n", rfClientNames[i], (unsigned)s.grants,
+                    (unsigned)s.hold.totalMs, (unsigned)s.preemptions);
+        FixedString<24> label;
+        label.appendf("RF %s wait", rfClientNames[i]);
+        HistogramPrint(out, label.c_str(), s.wait);
+        label.clear();
+        label.appendf("RF %s hold", rfClientNames[i]);
+        HistogramPrint(out, label.c_str(), s.hold);
+    }
+}
+
+bool RfArbiter::outranksOwnerLocked(const RfRequest_t* req, uint32_t now) const {
+    if (owner == RF_CLIENT_NONE) {
+        return true;
+    }
+    return req->priority > requests[owner].priority || isOverdue(req->deadlineMs, now);
+}
+
+RfClient RfArbiter::pickNextLocked(uint32_t now) const {
+    RfClient best = RF_CLIENT_NONE;
+    for (int i = 0; i < RF_CLIENT_COUNT; ++i) {
+        const RfRequest_t* req = &requests[i];
+        if (!req->waiting) {
+            continue;
+        }
+        if (best == RF_CLIENT_NONE) {
+            best = (RfClient)i;
+            continue;
+        }
+        const RfRequest_t* cur = &requests[best];
+        bool reqOverdue = isOverdue(req->deadlineMs, now);
+        bool curOverdue = isOverdue(cur->deadlineMs, now);
+        bool earlier = (int32_t)(req->deadlineMs - cur->deadlineMs) < 0;
+        if (reqOverdue != curOverdue) {
+            if (reqOverdue) {
+                best = (RfClient)i;
+            }
+        } else if (!reqOverdue && req->priority != cur->priority) {
+            if (req->priority > cur->priority) {
+                best = (RfClient)i;
+            }
+        } else if (earlier) {
+            best = (RfClient)i;
+        }
+    }
+    return best;
+}
+
+void RfArbiter::grantLocked(RfClient client, uint32_t now) {
+    RfRequest_t* req = &requests[client];
+    uint32_t wait = now - req->waitStartMs;
+    req->waiting = false;
+    owner = client;
+    grantedAtMs = now;
+    stats[client].grants++;
+    HistogramAdd(&stats[client].wait, wait);
+}
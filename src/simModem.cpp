@@ -0,0 +1,783 @@
+#include <stdarg.h>
+#include <string.h>
+#include <stdlib.h>
+#include <freertos/task.h>
+#include "simModem.h"
+#include "fixedString.h"
+
+/* Simulated clock starts at 2024-01-01 00:00:00 UTC */
+#define SIM_EPOCH_DAYS  19723L
+
+/* Rates accepted by AT+IPR */
+static const uint32_t simBaudRates[] = { 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600, 3686400 };
+
+static bool startsWith(const char* s, const char* prefix) {
+    return strncmp(s, prefix, strlen(prefix)) == 0;
+}
+
+/*
+ * @brief Convert days since 1970-01-01 to a civil date.
+ */
+static void civilFromDays(long z, int* y, unsigned* m, unsigned* d) {
+    z += 719468;
+    long era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    *d = doy - (153 * mp + 2) / 5 + 1;
+    *m = mp < 10 ? mp + 3 : mp - 9;
+    *y = (int)(yoe + era * 400 + (*m <= 2));
+}
+
+/*
+ * @brief SimModem constructor
+ * @paramin log Output for scenario reports
+ */
+SimModem::SimModem(Print& log)
+    : log(log), lock(portMUX_INITIALIZER_UNLOCKED), outHead(0), outTail(0), outUsed(0), segHead(0), segCount(0),
+      wireFreeUs(0), hostBaud(SIM_MODEM_POWER_ON_BAUD), modemBaud(SIM_MODEM_POWER_ON_BAUD), linkLimitBaud(0),
+      lineNoise(SIM_MODEM_BIT_ERROR_SEED),
+      cmdLen(0), cmdWireUs(0), payloadMode(false), payloadLen(0), payloadExpect(0), latencyRuleCount(0), fixScriptPos(0), gnssOn(false),
+      latE6(20558853), lonE6(-103428903), stepLatE6(0), stepLonE6(0), speedKmhX100(0), regStatus(1),
+      cregMode(0), ceregMode(0), dataLink(true), pdpActive(false), mqttSession(false), dtrHigh(false), sleepEnabled(false), ringCb(NULL),
+      ringCtx(NULL), messageRef(0), smsFailures(0), scenarioPeriodMs(0), scenarioBurst(1),
+      scenarioSender(NULL) {
+    memset(sms, 0, sizeof(sms));
+    memset(&stats, 0, sizeof(stats));
+    payloadNumber[0] = '\0';
+    payloadTopic[0] = '\0';
+    strcpy(fixScript, "0001");
+    setLatency("+CGNSINF", 50);
+    setLatency("+COPS", 200);
+    setLatency("+CMGS", 1500);
+    setLatency("+CNACT=", 500);
+    setLatency("+SMCONN", 800);
+    setLatency("+SMPUB", 150);
+}
+
+/*
+ * @brief Wire time of one 8N1 character.
+ */
+uint32_t SimModem::byteTimeUs(uint32_t baud) {
+    return (10000000UL + baud - 1) / baud;
+}
+
+/*
+ * @brief Whether the next byte over a link above its limit is corrupted: one in
+ *        SIM_MODEM_BIT_ERROR_PERIOD on average, at random but the same every run.
+ */
+bool SimModem::noiseHit() {
+    lineNoise ^= lineNoise << 13;
+    lineNoise ^= lineNoise >> 17;
+    lineNoise ^= lineNoise << 5;
+    return lineNoise % SIM_MODEM_BIT_ERROR_PERIOD == 0;
+}
+
+/*
+ * @brief Bytes of the head segment that have fully arrived at the host. Call with lock held.
+ */
+size_t SimModem::deliverable() {
+    if (segCount == 0) {
+        return 0;
+    }
+    const Segment_t* seg = &segments[segHead];
+    int32_t elapsed = (int32_t)(micros() - seg->releaseUs);
+    if (elapsed < 0) {
+        return 0;
+    }
+    uint32_t arrived = (uint32_t)elapsed / seg->byteUs;
+    if (arrived > seg->total) {
+        arrived = seg->total;
+    }
+    uint32_t delivered = seg->total - seg->len;
+    return (arrived > delivered) ? arrived - delivered : 0;
+}
+
+/*
+ * @brief Remove one deliverable byte, garbled if the host UART does not match its rate. Call with lock held.
+ */
+uint8_t SimModem::take() {
+    Segment_t* seg = &segments[segHead];
+    uint8_t c = outBuf[outTail];
+    bool overLimit = linkLimitBaud != 0 && seg->baud > linkLimitBaud;
+    if (seg->baud != hostBaud || (overLimit && noiseHit())) {
+        /* Framing error: never a valid line terminator */
+        c = (uint8_t)((c ^ 0x5A) | 0x80);
+        stats.garbledBytes++;
+    }
+    outTail = (outTail + 1) % SIM_MODEM_OUT_BUF_LEN;
+    outUsed--;
+    stats.bytesOut++;
+    if (--seg->len == 0) {
+        segHead = (uint8_t)((segHead + 1) % SIM_MODEM_SEGMENTS);
+        segCount--;
+    }
+    return c;
+}
+
+int SimModem::available() {
+    portENTER_CRITICAL(&lock);
+    int n = (int)deliverable();
+    portEXIT_CRITICAL(&lock);
+    return n;
+}
+
+int SimModem::read() {
+    int c = -1;
+    portENTER_CRITICAL(&lock);
+    if (deliverable() > 0) {
+        c = take();
+    }
+    portEXIT_CRITICAL(&lock);
+    return c;
+}
+
+int SimModem::peek() {
+    int c = -1;
+    portENTER_CRITICAL(&lock);
+    if (deliverable() > 0) {
+        c = outBuf[outTail];
+    }
+    portEXIT_CRITICAL(&lock);
+    return c;
+}
+
+/*
+ * @brief Copy the bytes that have arrived so far, like a UART driver ring buffer read.
+ */
+size_t SimModem::readBytes(char* buf, size_t len) {
+    size_t n = 0;
+    portENTER_CRITICAL(&lock);
+    while (n < len) {
+        size_t ready = deliverable();
+        if (ready == 0) {
+            break;
+        }
+        for (; ready > 0 && n < len; --ready) {
+            buf[n++] = (char)take();
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    return n;
+}
+
+/*
+ * @brief Accept host bytes: AT command lines, or SMS text after a '>' prompt.
+ */
+size_t SimModem::write(uint8_t c) {
+    stats.bytesIn++;
+    uint32_t byteUs = byteTimeUs(hostBaud);
+    stats.wireInUs += byteUs;
+    if (hostBaud != modemBaud) {
+        /* The modem only sees framing errors */
+        stats.garbledBytes++;
+        cmdLen = 0;
+        cmdWireUs = 0;
+        return 1;
+    }
+    if (linkLimitBaud != 0 && modemBaud > linkLimitBaud && noiseHit()) {
+        c = (uint8_t)((c ^ 0x5A) | 0x80);
+        stats.garbledBytes++;
+    }
+    cmdWireUs += byteUs;
+    if (payloadMode && payloadLen == 0 && c == '\n') {
+        /* Rest of the command line's "\r\n", not payload */
+        return 1;
+    }
+    if (payloadMode && payloadExpect != 0) {
+        /* MQTT publish: counted bytes, no terminator */
+        if (payloadLen < sizeof(payloadBuf) - 1) {
+            payloadBuf[payloadLen] = (char)c;
+        }
+        if (++payloadLen == payloadExpect) {
+            uint32_t wire = cmdWireUs;
+            cmdWireUs = 0;
+            handlePublish(wire);
+        }
+        return 1;
+    }
+    if (payloadMode) {
+        if (c == 0x1A) {
+            uint32_t wire = cmdWireUs;
+            cmdWireUs = 0;
+            handlePayload(wire);
+        } else if (c == 0x1B) {
+            payloadMode = false;
+        } else if (payloadLen < sizeof(payloadBuf) - 1) {
+            payloadBuf[payloadLen++] = (char)c;
+        }
+        return 1;
+    }
+    if (c == '\r' || c == '\n') {
+        uint32_t wire = cmdWireUs;
+        cmdWireUs = 0;
+        if (cmdLen > 0) {
+            cmdBuf[cmdLen] = '\0';
+            cmdLen = 0;
+            if (dtrHigh && sleepEnabled) {
+                /* UART off: the host should have pulled DTR low first */
+                stats.sleepDrops++;
+            } else if (strncasecmp(cmdBuf, "AT", 2) == 0) {
+                handleCommand(cmdBuf + 2, wire);
+            }
+        }
+        return 1;
+    }
+    if (cmdLen < sizeof(cmdBuf) - 1) {
+        cmdBuf[cmdLen++] = (char)c;
+    }
+    return 1;
+}
+
+size_t SimModem::write(const uint8_t* buf, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        write(buf[i]);
+    }
+    return len;
+}
+
+/*
+ * @brief Set the host UART rate. Bytes only pass intact when it matches the modem's AT+IPR rate.
+ */
+bool SimModem::setBaud(uint32_t baud) {
+    portENTER_CRITICAL(&lock);
+    hostBaud = baud;
+    portEXIT_CRITICAL(&lock);
+    return true;
+}
+
+uint32_t SimModem::getBaud() const {
+    return hostBaud;
+}
+
+/*
+ * @brief Follow the host's DTR line: high lets the modem sleep once AT+CSCLK=1 is set.
+ */
+void SimModem::setDtr(bool high) {
+    dtrHigh = high;
+}
+
+/*
+ * @brief Highest rate the simulated wiring carries cleanly, 0 for no limit.
+ *        Rates above it are accepted by AT+IPR but corrupt about one byte in SIM_MODEM_BIT_ERROR_PERIOD.
+ */
+void SimModem::setLinkLimit(uint32_t maxBaud) {
+    linkLimitBaud = maxBaud;
+}
+
+/*
+ * @brief Set the response latency of every command starting with cmdPrefix.
+ * @return false if the rule table is full.
+ */
+bool SimModem::setLatency(const char* cmdPrefix, uint32_t ms) {
+    for (uint8_t i = 0; i < latencyRuleCount; ++i) {
+        if (strcmp(latencyRules[i].prefix, cmdPrefix) == 0) {
+            latencyRules[i].ms = ms;
+            return true;
+        }
+    }
+    if (latencyRuleCount >= SIM_MODEM_LATENCY_RULES) {
+        return false;
+    }
+    LatencyRule_t* rule = &latencyRules[latencyRuleCount++];
+    strncpy(rule->prefix, cmdPrefix, sizeof(rule->prefix) - 1);
+    rule->prefix[sizeof(rule->prefix) - 1] = '\0';
+    rule->ms = ms;
+    return true;
+}
+
+/*
+ * @brief Script +CGNSINF fix results: one character per query, '1' fix, '0' no fix.
+ *        The last character repeats once the script is exhausted.
+ */
+void SimModem::setFixScript(const char* script) {
+    portENTER_CRITICAL(&lock);
+    strncpy(fixScript, script, SIM_MODEM_FIX_SCRIPT_LEN);
+    fixScript[SIM_MODEM_FIX_SCRIPT_LEN] = '\0';
+    fixScriptPos = 0;
+    portEXIT_CRITICAL(&lock);
+}
+
+/*
+ * @brief Set the simulated position and how far it moves per reported fix.
+ */
+void SimModem::setTrack(int32_t lat, int32_t lon, int32_t stepLat, int32_t stepLon, uint16_t speed) {
+    portENTER_CRITICAL(&lock);
+    latE6 = lat;
+    lonE6 = lon;
+    stepLatE6 = stepLat;
+    stepLonE6 = stepLon;
+    speedKmhX100 = speed;
+    portEXIT_CRITICAL(&lock);
+}
+
+/*
+ * @brief Format the fields after <stat> of +CREG/+CEREG: location and AcT (LTE-M) with <n>=2 while registered.
+ */
+static void regDetail(char* out, size_t max, uint8_t mode, int status) {
+    if (mode >= 2 && (status == 1 || status == 5)) {
+        snprintf(out, max, ",\"1A2B\",\"01A2B3C4\",7");
+    } else {
+        out[0] = '\0';
+    }
+}
+
+/*
+ * @brief Set the <stat> reported by +CREG and +CEREG (1 home, 2 searching, 5 roaming, ...),
+ *        with an indication for each that has them enabled.
+ */
+void SimModem::setRegistration(int status) {
+    char detail[32];
+    if (status == regStatus) {
+        return;
+    }
+    regStatus = status;
+    if (ceregMode > 0) {
+        regDetail(detail, sizeof(detail), ceregMode, status);
+        respond(0, "\r\n+CEREG: %d%s\r\n", status, detail);
+    }
+    if (cregMode > 0) {
+        regDetail(detail, sizeof(detail), cregMode, status);
+        respond(0, "\r\n+CREG: %d%s\r\n", status, detail);
+    }
+}
+
+/*
+ * @brief Make the data bearer available or take it away. Dropping it ends the
+ *        MQTT session with "+SMSTATE: 0" and refuses PDP activation until restored.
+ */
+void SimModem::setDataLink(bool up) {
+    dataLink = up;
+    if (!up) {
+        pdpActive = false;
+        if (mqttSession) {
+            mqttSession = false;
+            respond(0, "\r\n+SMSTATE: 0\r\n");
+        }
+    }
+}
+
+/*
+ * @brief Store an incoming SMS on the simulated SIM and raise +CMTI.
+ * @return false if the SIM storage is full.
+ */
+bool SimModem::injectSms(const char* sender, const char* text) {
+    int slot = -1;
+    portENTER_CRITICAL(&lock);
+    for (int i = 0; i < SIM_MODEM_SMS_SLOTS; ++i) {
+        if (!sms[i].used) {
+            slot = i;
+            sms[i].used = true;
+            sms[i].read = false;
+            strncpy(sms[i].sender, sender, sizeof(sms[i].sender) - 1);
+            sms[i].sender[sizeof(sms[i].sender) - 1] = '\0';
+            strncpy(sms[i].text, text, sizeof(sms[i].text) - 1);
+            sms[i].text[sizeof(sms[i].text) - 1] = '\0';
+            sms[i].injectedMs = millis();
+            stats.smsRequests++;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    if (slot < 0) {
+        return false;
+    }
+    respond(0, "\r\n+CMTI: \"SM\",%d\r\n", slot + 1);
+    if (dtrHigh && sleepEnabled && ringCb != NULL) {
+        stats.rings++;
+        ringCb(ringCtx);
+    }
+    return true;
+}
+
+/*
+ * @brief Called for every ring pulse while the modem sleeps, as the RI line interrupt would be.
+ */
+void SimModem::setRingCallback(void (*cb)(void* ctx), void* ctx) {
+    ringCtx = ctx;
+    ringCb = cb;
+}
+
+/*
+ * @brief Refuse the next AT+CMGS attempts with "+CMS ERROR: 500", as a congested network would.
+ */
+void SimModem::failSms(uint8_t count) {
+    smsFailures = count;
+}
+
+/*
+ * @brief Start a task that sends a burst of "LOCATION" requests every period, as a worried owner would,
+ *        and reports timings.
+ * @paramin smsPeriodMs Time between bursts.
+ * @paramin burst Requests per burst.
+ * @paramin sender Requesting number.
+ */
+void SimModem::startScenario(uint32_t smsPeriodMs, uint8_t burst, const char* sender) {
+    scenarioPeriodMs = smsPeriodMs;
+    scenarioBurst = burst;
+    scenarioSender = sender;
+    xTaskCreate(scenarioTask, "SimScenario", SIM_SCENARIO_TASK_STACK_SIZE, this, SIM_SCENARIO_TASK_PRIORITY, NULL);
+}
+
+void SimModem::scenarioTask(void* pvParameters) {
+    SimModem* self = static_cast<SimModem*>(pvParameters);
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(self->scenarioPeriodMs));
+        self->printStats(self->log);
+        for (uint8_t i = 0; i < self->scenarioBurst; ++i) {
+            self->injectSms(self->scenarioSender, "LOCATION");
+        }
+    }
+}
+
+void SimModem::getStats(SimModemStats_t* out) {
+    portENTER_CRITICAL(&lock);
+    *out = stats;
+    portEXIT_CRITICAL(&lock);
+}
+
+/*
+ * @brief Print AT traffic and SMS request-to-reply latency, including the delta since the last report.
+ */
+void SimModem::printStats(Print& out) {
+    static uint32_t lastExchanges = 0;
+    SimModemStats_t s;
+    getStats(&s);
+    uint32_t avg = s.smsReplies ? s.replyLatencyTotalMs / s.smsReplies : 0;
+    FixedPrintf(out, "SIM modem: %u AT exchanges (%u this cycle), %u bytes in, %u bytes out\n",
+                (unsigned)s.exchanges, (unsigned)(s.exchanges - lastExchanges),
+                (unsigned)s.bytesIn, (unsigned)s.bytesOut);
+    FixedPrintf(out, "SIM modem: UART %u baud, wire time %u ms in, %u ms out, %u garbled bytes\n",
+                (unsigned)modemBaud, (unsigned)(s.wireInUs / 1000), (unsigned)(s.wireOutUs / 1000),
+                (unsigned)s.garbledBytes);
+    FixedPrintf(out, "SIM modem: SMS %u requests, %u replies, reply latency min %u avg %u max %u ms\n",
+                (unsigned)s.smsRequests, (unsigned)s.smsReplies,
+                (unsigned)s.replyLatencyMinMs, (unsigned)avg, (unsigned)s.replyLatencyMaxMs);
+    if (s.mqttSessions != 0) {
+        FixedPrintf(out, "SIM modem: MQTT %u sessions, %u publishes, %u payload bytes\n", (unsigned)s.mqttSessions,
+                    (unsigned)s.mqttPublishes, (unsigned)s.mqttBytes);
+    }
+    if (sleepEnabled) {
+        FixedPrintf(out, "SIM modem: sleep %s, %u rings, %u commands lost while asleep\n", dtrHigh ? "on" : "off",
+                    (unsigned)s.rings, (unsigned)s.sleepDrops);
+    }
+    lastExchanges = s.exchanges;
+}
+
+uint32_t SimModem::latencyFor(const char* cmd) const {
+    for (uint8_t i = 0; i < latencyRuleCount; ++i) {
+        if (startsWith(cmd, latencyRules[i].prefix)) {
+            return latencyRules[i].ms;
+        }
+    }
+    return SIM_MODEM_DEFAULT_LATENCY_MS;
+}
+
+/*
+ * @brief Queue formatted modem output, put on the wire after delayUs.
+ */
+void SimModem::respond(uint32_t delayUs, const char* fmt, ...) {
+    char buf[320];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (n < 0) {
+        return;
+    }
+    emit(delayUs, buf, ((size_t)n < sizeof(buf)) ? (size_t)n : sizeof(buf) - 1);
+}
+
+void SimModem::emit(uint32_t delayUs, const char* data, size_t len) {
+    bool dropped = false;
+    portENTER_CRITICAL(&lock);
+    if (outUsed + len > SIM_MODEM_OUT_BUF_LEN || segCount >= SIM_MODEM_SEGMENTS) {
+        dropped = true;
+    } else {
+        uint8_t idx = (uint8_t)((segHead + segCount) % SIM_MODEM_SEGMENTS);
+        Segment_t* seg = &segments[idx];
+        uint32_t release = micros() + delayUs;
+        /* One byte at a time on the wire: start after the previous segment */
+        if (segCount > 0 && (int32_t)(wireFreeUs - release) > 0) {
+            release = wireFreeUs;
+        }
+        seg->len = (uint16_t)len;
+        seg->total = (uint16_t)len;
+        seg->releaseUs = release;
+        seg->baud = modemBaud;
+        seg->byteUs = byteTimeUs(modemBaud);
+        wireFreeUs = release + len * seg->byteUs;
+        stats.wireOutUs += len * seg->byteUs;
+        segCount++;
+        for (size_t i = 0; i < len; ++i) {
+            outBuf[outHead] = (uint8_t)data[i];
+            outHead = (outHead + 1) % SIM_MODEM_OUT_BUF_LEN;
+        }
+        outUsed += len;
+    }
+    portEXIT_CRITICAL(&lock);
+    if (dropped) {
+        log.println("SIM modem: output buffer full, response dropped");
+    }
+}
+
+/*
+ * @brief Format the body of a +CGNSINF report (21 fields).
+ */
+size_t SimModem::formatGnss(char* out, size_t max, bool fix) {
+    if (!gnssOn) {
+        return snprintf(out, max, "0,,,,,,,,,,,,,,,,,,,,");
+    }
+    if (!fix) {
+        return snprintf(out, max, "1,0,,,,,,,0,,,,,,,,,,,,");
+    }
+    uint32_t secs = millis() / 1000;
+    int y;
+    unsigned mo, d;
+    civilFromDays(SIM_EPOCH_DAYS + (long)(secs / 86400), &y, &mo, &d);
+    uint32_t sod = secs % 86400;
+    int32_t lat = latE6;
+    int32_t lon = lonE6;
+    return snprintf(out, max,
+                    "1,1,%04d%02u%02u%02u%02u%02u.000,%s%ld.%06ld,%s%ld.%06ld,1560.200,%u.%02u,0.0,1,,0.9,1.2,0.8,,12,8,0,,35,,",
+                    y, mo, d, (unsigned)(sod / 3600), (unsigned)(sod / 60 % 60), (unsigned)(sod % 60),
+                    lat < 0 ? "-" : "", (long)(labs(lat) / 1000000), (long)(labs(lat) % 1000000),
+                    lon < 0 ? "-" : "", (long)(labs(lon) / 1000000), (long)(labs(lon) % 1000000),
+                    (unsigned)(speedKmhX100 / 100), (unsigned)(speedKmhX100 % 100));
+}
+
+/*
+ * @brief Answer one AT command line (without the leading "AT").
+ */
+void SimModem::handleCommand(const char* cmd, uint32_t inputUs) {
+    /* Processing starts once the whole line has crossed the wire */
+    uint32_t delay = latencyFor(cmd) * 1000UL + inputUs;
+    stats.exchanges++;
+
+    if (cmd[0] == '\0' || strcmp(cmd, "E0") == 0 || startsWith(cmd, "+CNMP=") ||
+        startsWith(cmd, "+CGPIO=") || startsWith(cmd, "+CMGF=") || startsWith(cmd, "+CNMI=") ||
+        startsWith(cmd, "+CGNSURC=") || startsWith(cmd, "+CFGRI=") || startsWith(cmd, "+CPSMS=") ||
+        startsWith(cmd, "+CEDRXS=")) {
+        respond(delay, "\r\nOK\r\n");
+    } else if (startsWith(cmd, "+CSCLK=")) {
+        sleepEnabled = cmd[7] == '1';
+        respond(delay, "\r\nOK\r\n");
+    } else if (strcmp(cmd, "I") == 0) {
+        respond(delay, "\r\nSIM7070 R1.4 (simulated)\r\n\r\nOK\r\n");
+    } else if (strcmp(cmd, "+CGSN") == 0) {
+        respond(delay, "\r\n%s\r\n\r\nOK\r\n", SIM_MODEM_IMEI);
+    } else if (strcmp(cmd, "+IPR?") == 0) {
+        respond(delay, "\r\n+IPR: %u\r\n\r\nOK\r\n", (unsigned)modemBaud);
+    } else if (startsWith(cmd, "+IPR=")) {
+        uint32_t baud = strtoul(cmd + 5, NULL, 10);
+        bool supported = false;
+        for (size_t i = 0; i < sizeof(simBaudRates) / sizeof(simBaudRates[0]); ++i) {
+            supported = supported || simBaudRates[i] == baud;
+        }
+        /* OK still goes out at the old rate, the switch follows it */
+        respond(delay, supported ? "\r\nOK\r\n" : "\r\nERROR\r\n");
+        if (supported) {
+            portENTER_CRITICAL(&lock);
+            modemBaud = baud;
+            portEXIT_CRITICAL(&lock);
+        }
+    } else if (strcmp(cmd, "+CPIN?") == 0) {
+        respond(delay, "\r\n+CPIN: READY\r\n\r\nOK\r\n");
+    } else if (strcmp(cmd, "+CSQ") == 0) {
+        respond(delay, "\r\n+CSQ: 20,99\r\n\r\nOK\r\n");
+    } else if (strcmp(cmd, "+CREG?") == 0 || strcmp(cmd, "+CEREG?") == 0) {
+        bool eps = (cmd[2] == 'E');
+        char detail[32];
+        regDetail(detail, sizeof(detail), eps ? ceregMode : cregMode, regStatus);
+        respond(delay, "\r\n+%s: %u,%d%s\r\n\r\nOK\r\n", eps ? "CEREG" : "CREG",
+                (unsigned)(eps ? ceregMode : cregMode), regStatus, detail);
+    } else if (startsWith(cmd, "+CREG=") || startsWith(cmd, "+CEREG=")) {
+        bool eps = (cmd[2] == 'E');
+        int mode = atoi(cmd + (eps ? 7 : 6));
+        if (mode < 0 || mode > 2) {
+            respond(delay, "\r\nERROR\r\n");
+        } else {
+            (eps ? ceregMode : cregMode) = (uint8_t)mode;
+            respond(delay, "\r\nOK\r\n");
+        }
+    } else if (strcmp(cmd, "+COPS?") == 0) {
+        respond(delay, "\r\n+COPS: 0,0,\"SIMULATED\",7\r\n\r\nOK\r\n");
+    } else if (startsWith(cmd, "+CGNSPWR=")) {
+        gnssOn = (atoi(cmd + 9) == 1);
+        respond(delay, "\r\nOK\r\n");
+    } else if (strcmp(cmd, "+CGNSCOLD") == 0 || strcmp(cmd, "+CGNSWARM") == 0 || strcmp(cmd, "+CGNSHOT") == 0) {
+        respond(delay, gnssOn ? "\r\nOK\r\n" : "\r\nERROR\r\n");
+    } else if (strcmp(cmd, "+CGNSINF") == 0) {
+        char body[160];
+        bool fix = false;
+        portENTER_CRITICAL(&lock);
+        if (gnssOn) {
+            fix = (fixScript[fixScriptPos] == '1');
+            if (fixScript[fixScriptPos] != '\0' && fixScript[fixScriptPos + 1] != '\0') {
+                fixScriptPos++;
+            }
+        }
+        portEXIT_CRITICAL(&lock);
+        formatGnss(body, sizeof(body), fix);
+        if (fix) {
+            latE6 += stepLatE6;
+            lonE6 += stepLonE6;
+        }
+        respond(delay, "\r\n+CGNSINF: %s\r\n\r\nOK\r\n", body);
+    } else if (startsWith(cmd, "+CMGL=")) {
+        for (int i = 0; i < SIM_MODEM_SMS_SLOTS; ++i) {
+            if (sms[i].used) {
+                respond(delay, "\r\n+CMGL: %d,\"%s\",\"%s\",\"\",\"24/01/01,00:00:00+00\"\r\n%s",
+                        i + 1, sms[i].read ? "REC READ" : "REC UNREAD", sms[i].sender, sms[i].text);
+                sms[i].read = true;
+            }
+        }
+        respond(delay, "\r\n\r\nOK\r\n");
+    } else if (startsWith(cmd, "+CMGR=")) {
+        int i = atoi(cmd + 6) - 1;
+        if (i >= 0 && i < SIM_MODEM_SMS_SLOTS && sms[i].used) {
+            respond(delay, "\r\n+CMGR: \"%s\",\"%s\",\"\",\"24/01/01,00:00:00+00\"\r\n%s\r\n\r\nOK\r\n",
+                    sms[i].read ? "REC READ" : "REC UNREAD", sms[i].sender, sms[i].text);
+            sms[i].read = true;
+        } else {
+            respond(delay, "\r\nOK\r\n");
+        }
+    } else if (startsWith(cmd, "+CMGD=")) {
+        int i = atoi(cmd + 6) - 1;
+        const char* comma = strchr(cmd, ',');
+        int flag = comma ? atoi(comma + 1) : 0;
+        portENTER_CRITICAL(&lock);
+        for (int j = 0; j < SIM_MODEM_SMS_SLOTS; ++j) {
+            if ((flag == 0 && j == i) || (flag == 1 && sms[j].read) || flag == 4) {
+                sms[j].used = false;
+            }
+        }
+        portEXIT_CRITICAL(&lock);
+        respond(delay, "\r\nOK\r\n");
+    } else if (startsWith(cmd, "+CMGS=\"")) {
+        const char* num = cmd + 7;
+        const char* end = strchr(num, '"');
+        size_t n = end ? (size_t)(end - num) : strlen(num);
+        if (n >= sizeof(payloadNumber)) {
+            n = sizeof(payloadNumber) - 1;
+        }
+        memcpy(payloadNumber, num, n);
+        payloadNumber[n] = '\0';
+        payloadLen = 0;
+        payloadExpect = 0;
+        payloadMode = true;
+        respond(SIM_MODEM_DEFAULT_LATENCY_MS * 1000UL + inputUs, "\r\n> ");
+    } else if (strcmp(cmd, "+CNACT?") == 0) {
+        respond(delay, "\r\n+CNACT: 0,%d,\"%s\"\r\n\r\nOK\r\n", pdpActive ? 1 : 0,
+                pdpActive ? "10.64.0.2" : "0.0.0.0");
+    } else if (startsWith(cmd, "+CNACT=0,")) {
+        bool up = (atoi(cmd + 9) == 1);
+        if (up && !dataLink) {
+            respond(delay, "\r\nERROR\r\n");
+        } else {
+            pdpActive = up;
+            mqttSession = mqttSession && up;
+            respond(delay, up ? "\r\nOK\r\n\r\n+APP PDP: 0,ACTIVE\r\n" : "\r\nOK\r\n\r\n+APP PDP: 0,DEACTIVE\r\n");
+        }
+    } else if (startsWith(cmd, "+CNCFG=") || startsWith(cmd, "+SMCONF=") || startsWith(cmd, "+CSSLCFG=") ||
+               startsWith(cmd, "+SMSSL=")) {
+        respond(delay, "\r\nOK\r\n");
+    } else if (strcmp(cmd, "+SMCONN") == 0) {
+        /* The broker is always reachable while the bearer is up */
+        if (!pdpActive || !dataLink || mqttSession) {
+            respond(delay, "\r\nERROR\r\n");
+        } else {
+            mqttSession = true;
+            stats.mqttSessions++;
+            respond(delay, "\r\nOK\r\n");
+        }
+    } else if (strcmp(cmd, "+SMDISC") == 0) {
+        respond(delay, mqttSession ? "\r\nOK\r\n" : "\r\nERROR\r\n");
+        mqttSession = false;
+    } else if (strcmp(cmd, "+SMSTATE?") == 0) {
+        respond(delay, "\r\n+SMSTATE: %d\r\n\r\nOK\r\n", mqttSession ? 1 : 0);
+    } else if (startsWith(cmd, "+SMPUB=\"")) {
+        /* +SMPUB="<topic>",<length>,<qos>,<retain> */
+        const char* topic = cmd + 8;
+        const char* end = strchr(topic, '"');
+        size_t len = (end != NULL && end[1] == ',') ? strtoul(end + 2, NULL, 10) : 0;
+        if (!mqttSession || len == 0 || len > SIM_MODEM_PAYLOAD_LEN) {
+            respond(delay, "\r\nERROR\r\n");
+        } else {
+            size_t n = (size_t)(end - topic);
+            if (n >= sizeof(payloadTopic)) {
+                n = sizeof(payloadTopic) - 1;
+            }
+            memcpy(payloadTopic, topic, n);
+            payloadTopic[n] = '\0';
+            payloadLen = 0;
+            payloadExpect = len;
+            payloadMode = true;
+            respond(SIM_MODEM_DEFAULT_LATENCY_MS * 1000UL + inputUs, "\r\n> ");
+        }
+    } else {
+        respond(delay, "\r\nERROR\r\n");
+    }
+}
+
+/*
+ * @brief Complete an AT+SMPUB exchange once the announced length has arrived; the broker logs the message.
+ */
+void SimModem::handlePublish(uint32_t inputUs) {
+    payloadMode = false;
+    payloadExpect = 0;
+    payloadBuf[payloadLen < sizeof(payloadBuf) ? payloadLen : sizeof(payloadBuf) - 1] = '\0';
+    if (!mqttSession) {
+        respond(latencyFor("+SMPUB") * 1000UL + inputUs, "\r\nERROR\r\n");
+        return;
+    }
+    portENTER_CRITICAL(&lock);
+    stats.mqttPublishes++;
+    stats.mqttBytes += payloadLen;
+    portEXIT_CRITICAL(&lock);
+    FixedPrintf(log, "SIM broker: %s (%u bytes): %s\n", payloadTopic, (unsigned)payloadLen, payloadBuf);
+    respond(latencyFor("+SMPUB") * 1000UL + inputUs, "\r\nOK\r\n");
+}
+
+/*
+ * @brief Complete an AT+CMGS exchange once Ctrl+Z arrives and time the reply.
+ */
+void SimModem::handlePayload(uint32_t inputUs) {
+    payloadMode = false;
+    payloadBuf[payloadLen] = '\0';
+    if (smsFailures > 0) {
+        smsFailures--;
+        FixedPrintf(log, "SIM modem: SMS to %s refused\n", payloadNumber);
+        respond(latencyFor("+CMGS") * 1000UL + inputUs, "\r\n+CMS ERROR: 500\r\n");
+        return;
+    }
+    uint32_t now = millis();
+    uint32_t oldest = 0;
+    bool answered = false;
+    /* The reply answers every request from that number still waiting, measured from the oldest */
+    portENTER_CRITICAL(&lock);
+    for (int i = 0; i < SIM_MODEM_SMS_SLOTS; ++i) {
+        if (sms[i].injectedMs != 0 && strcmp(sms[i].sender, payloadNumber) == 0) {
+            uint32_t waited = now - sms[i].injectedMs;
+            if (!answered || waited > oldest) {
+                oldest = waited;
+            }
+            answered = true;
+            sms[i].injectedMs = 0;
+        }
+    }
+    if (answered) {
+        stats.smsReplies++;
+        stats.replyLatencyTotalMs += oldest;
+        if (stats.smsReplies == 1 || oldest < stats.replyLatencyMinMs) {
+            stats.replyLatencyMinMs = oldest;
+        }
+        if (oldest > stats.replyLatencyMaxMs) {
+            stats.replyLatencyMaxMs = oldest;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    FixedPrintf(log, "SIM modem: SMS to %s: %s\n", payloadNumber, payloadBuf);
+    respond(latencyFor("+CMGS") * 1000UL + inputUs, "\r\n+CMGS: %u\r\n\r\nOK\r\n", ++messageRef);
+}
@@ -0,0 +1,179 @@
+#include <string.h>
+#include <stdlib.h>
+#include "smsInbox.h"
+
+/*
+ * @brief SmsInbox constructor
+ */
+SmsInbox::SmsInbox()
+    : head(0), tail(0), used(0), listing(NULL), listOverflow(false), listStart(0), listCount(0),
+      pending(true), pendingSem(NULL) {}
+
+/*
+ * @brief Subscribe to +CMTI new-message indications.
+ *        The inbox starts pending so messages stored while powered off are read once.
+ * @paramin at AT engine delivering URCs.
+ * @return true on success.
+ */
+bool SmsInbox::begin(AtEngine& at) {
+    pendingSem = xSemaphoreCreateBinary();
+    if (pendingSem == NULL) {
+        return false;
+    }
+    return at.subscribe("+CMTI:", onCmti, this);
+}
+
+/*
+ * @brief Check whether the SIM holds messages that have not been fetched yet.
+ */
+bool SmsInbox::hasPending() const {
+    return pending;
+}
+
+/*
+ * @brief Block until a new-message indication arrives or the time elapses.
+ * @paramin ticks Maximum time to wait.
+ * @return true if messages are pending.
+ */
+bool SmsInbox::waitPending(TickType_t ticks) {
+    if (!pending && pendingSem != NULL) {
+        xSemaphoreTake(pendingSem, ticks);
+    }
+    return pending;
+}
+
+/*
+ * @brief Mark the SIM storage as fetched. Called right before the AT+CMGL pass.
+ */
+void SmsInbox::clearPending() {
+    pending = false;
+}
+
+/*
+ * @brief Force a fetch on the next cellular iteration, e.g. when the ring was full.
+ */
+void SmsInbox::requestFetch() {
+    pending = true;
+    if (pendingSem != NULL) {
+        xSemaphoreGive(pendingSem);
+    }
+}
+
+/*
+ * @brief Start an AT+CMGL pass.
+ */
+void SmsInbox::beginListing() {
+    listing = NULL;
+    listOverflow = false;
+    listStart = head;
+    listCount = 0;
+}
+
+/*
+ * @brief Consume one AT+CMGL response line: a "+CMGL:" header or a text line.
+ *        Runs in the AT engine task while the fetching task waits.
+ * @paramin line Line without terminator.
+ * @paramin len Line length.
+ */
+void SmsInbox::parseListLine(const char* line, size_t len) {
+    static const char header[] = "+CMGL:";
+    if (len >= sizeof(header) - 1 && memcmp(line, header, sizeof(header) - 1) == 0) {
+        if (used >= SMS_INBOX_DEPTH) {
+            listOverflow = true;
+            listing = NULL;
+            return;
+        }
+        SmsMessage_t* msg = &ring[head];
+        memset(msg, 0, sizeof(*msg));
+        /* +CMGL: <index>,"<stat>","<oa>",["<alpha>"],["<scts>"] */
+        msg->index = (uint16_t)atoi(line + sizeof(header) - 1);
+        const char* p = line;
+        const char* end = line + len;
+        for (int quoted = 0; quoted < 2 && p < end; ++quoted) {
+            const char* open = (const char*)memchr(p, '"', (size_t)(end - p));
+            const char* close = open ? (const char*)memchr(open + 1, '"', (size_t)(end - open - 1)) : NULL;
+            if (close == NULL) {
+                break;
+            }
+            if (quoted == 1) {
+                size_t n = (size_t)(close - open - 1);
+                if (n >= sizeof(msg->sender)) {
+                    n = sizeof(msg->sender) - 1;
+                }
+                memcpy(msg->sender, open + 1, n);
+            }
+            p = close + 1;
+        }
+        msg->receivedMs = millis();
+        listing = msg;
+        head = (uint8_t)((head + 1) % SMS_INBOX_DEPTH);
+        used++;
+        listCount++;
+        return;
+    }
+    if (listing == NULL) {
+        return;
+    }
+    /* Text body, possibly spread over several lines */
+    size_t have = strlen(listing->text);
+    if (have > 0 && have < SMS_TEXT_MAX_LEN) {
+        listing->text[have++] = '\n';
+    }
+    size_t n = SMS_TEXT_MAX_LEN - have;
+    if (len < n) {
+        n = len;
+    }
+    memcpy(listing->text + have, line, n);
+    listing->text[have + n] = '\0';
+}
+
+/*
+ * @brief Finish an AT+CMGL pass.
+ * @return true if every listed message fit in the ring.
+ */
+bool SmsInbox::endListing() {
+    listing = NULL;
+    return !listOverflow;
+}
+
+/*
+ * @brief SIM storage indexes of the messages stored by the last pass.
+ * @paramout indexes Destination array.
+ * @paramin max Capacity of the destination array.
+ * @return Number of indexes written.
+ */
+uint8_t SmsInbox::listedIndexes(uint16_t* indexes, uint8_t max) const {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < listCount && n < max; ++i) {
+        indexes[n++] = ring[(listStart + i) % SMS_INBOX_DEPTH].index;
+    }
+    return n;
+}
+
+/*
+ * @brief Take the oldest message out of the ring.
+ * @paramout msg Destination.
+ * @return false if the ring is empty.
+ */
+bool SmsInbox::pop(SmsMessage_t* msg) {
+    if (used == 0) {
+        return false;
+    }
+    *msg = ring[tail];
+    tail = (uint8_t)((tail + 1) % SMS_INBOX_DEPTH);
+    used--;
+    return true;
+}
+
+uint8_t SmsInbox::count() const {
+    return used;
+}
+
+/*
+ * @brief URC handler for +CMTI: "<mem>",<index>. Runs in the AT engine task.
+ */
+void SmsInbox::onCmti(const char* line, size_t len, void* ctx) {
+    (void)line;
+    (void)len;
+    static_cast<SmsInbox*>(ctx)->requestFetch();
+}
@@ -0,0 +1,209 @@
+#include <string.h>
+#include "smsOutbox.h"
+#include "fixedString.h"
+
+static const char* const outStateNames[] = {"free", "queued", "sent", "failed"};
+
+static void copyText(char* dst, const char* src, size_t max) {
+    strncpy(dst, src, max - 1);
+    dst[max - 1] = '\0';
+}
+
+/*
+ * @brief SmsOutbox constructor
+ */
+SmsOutbox::SmsOutbox() : lock(portMUX_INITIALIZER_UNLOCKED), nextSeq(1) {
+    memset(slots, 0, sizeof(slots));
+    memset(&stats, 0, sizeof(stats));
+}
+
+/*
+ * @brief Queued reply, or one delivered within the coalescing window, to the same number and tag.
+ *        Call with lock held.
+ */
+SmsOutMessage_t* SmsOutbox::find(const char* number, uint8_t tag, uint32_t nowMs) {
+    for (int i = 0; i < SMS_OUTBOX_SLOTS; ++i) {
+        SmsOutMessage_t* msg = &slots[i];
+        bool live = msg->state == SMS_OUT_QUEUED ||
+                    (msg->state == SMS_OUT_SENT && nowMs - msg->doneMs < SMS_COALESCE_WINDOW_MS);
+        if (live && msg->tag == tag && strcmp(msg->number, number) == 0) {
+            return msg;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * @brief A free slot, else the one finished longest ago. Call with lock held.
+ * @return NULL if every slot is queued.
+ */
+SmsOutMessage_t* SmsOutbox::allocate() {
+    SmsOutMessage_t* oldest = NULL;
+    for (int i = 0; i < SMS_OUTBOX_SLOTS; ++i) {
+        SmsOutMessage_t* msg = &slots[i];
+        if (msg->state == SMS_OUT_FREE) {
+            return msg;
+        }
+        if (msg->state != SMS_OUT_QUEUED && (oldest == NULL || (int32_t)(msg->doneMs - oldest->doneMs) < 0)) {
+            oldest = msg;
+        }
+    }
+    return oldest;
+}
+
+/*
+ * @brief Queue a reply. A request the queue already answers is coalesced instead.
+ * @paramin number Recipient.
+ * @paramin tag Coalescing tag, SMS_TAG_NONE for a reply that never merges.
+ * @paramin text Message text, truncated to one SMS.
+ * @paramin nowMs millis() when the request was read.
+ * @return true if a new reply was queued; false if it was coalesced or the queue is full.
+ */
+bool SmsOutbox::enqueue(const char* number, uint8_t tag, const char* text, uint32_t nowMs) {
+    bool queued = false;
+    portENTER_CRITICAL(&lock);
+    stats.requested++;
+    SmsOutMessage_t* msg = (tag != SMS_TAG_NONE) ? find(number, tag, nowMs) : NULL;
+    if (msg != NULL) {
+        if (msg->state == SMS_OUT_QUEUED) {
+            /* Fresher text, same place in the queue */
+            copyText(msg->text, text, sizeof(msg->text));
+        }
+        msg->coalesced++;
+        stats.coalesced++;
+    } else if ((msg = allocate()) == NULL) {
+        stats.dropped++;
+    } else {
+        memset(msg, 0, sizeof(*msg));
+        msg->state = SMS_OUT_QUEUED;
+        msg->tag = tag;
+        msg->messageRef = -1;
+        msg->seq = nextSeq++;
+        msg->requestedMs = nowMs;
+        msg->nextTryMs = nowMs;
+        copyText(msg->number, number, sizeof(msg->number));
+        copyText(msg->text, text, sizeof(msg->text));
+        queued = true;
+    }
+    portEXIT_CRITICAL(&lock);
+    return queued;
+}
+
+/*
+ * @brief Whether a queued reply is ready to be sent, its backoff over.
+ */
+bool SmsOutbox::due(uint32_t nowMs) {
+    bool ready = false;
+    portENTER_CRITICAL(&lock);
+    for (int i = 0; i < SMS_OUTBOX_SLOTS && !ready; ++i) {
+        ready = slots[i].state == SMS_OUT_QUEUED && (int32_t)(nowMs - slots[i].nextTryMs) >= 0;
+    }
+    portEXIT_CRITICAL(&lock);
+    return ready;
+}
+
+/*
+ * @brief Oldest reply that is due. The slot belongs to the caller until sent() or failed();
+ *        call from cellularTask only. cellularTask is the only task queueing tagged replies, which
+ *        may rewrite a queued slot; other tasks queue untagged alerts, which never touch one.
+ * @return NULL if nothing is due.
+ */
+SmsOutMessage_t* SmsOutbox::next(uint32_t nowMs) {
+    SmsOutMessage_t* first = NULL;
+    portENTER_CRITICAL(&lock);
+    for (int i = 0; i < SMS_OUTBOX_SLOTS; ++i) {
+        SmsOutMessage_t* msg = &slots[i];
+        if (msg->state == SMS_OUT_QUEUED && (int32_t)(nowMs - msg->nextTryMs) >= 0 &&
+            (first == NULL || msg->seq < first->seq)) {
+            first = msg;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    return first;
+}
+
+/*
+ * @brief The modem accepted the message.
+ * @paramin messageRef <mr> from +CMGS, -1 if not reported.
+ */
+void SmsOutbox::sent(SmsOutMessage_t* msg, int messageRef, uint32_t nowMs) {
+    uint32_t latency = nowMs - msg->requestedMs;
+    portENTER_CRITICAL(&lock);
+    msg->state = SMS_OUT_SENT;
+    msg->attempts++;
+    msg->messageRef = (int16_t)messageRef;
+    msg->doneMs = nowMs;
+    stats.sent++;
+    stats.latencyTotalMs += latency;
+    if (stats.sent == 1 || latency < stats.latencyMinMs) {
+        stats.latencyMinMs = latency;
+    }
+    if (latency > stats.latencyMaxMs) {
+        stats.latencyMaxMs = latency;
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+/*
+ * @brief +CMS ERROR codes retrying cannot fix: unassigned number, invalid text mode parameter or PDU.
+ */
+bool SmsOutbox::permanentError(int error) {
+    return error == 1 || error == 304 || error == 305;
+}
+
+/*
+ * @brief An attempt failed: retry after a backoff, or give up.
+ * @paramin error +CMS ERROR code, SMS_ERROR_TIMEOUT, or 0 for a plain ERROR.
+ */
+void SmsOutbox::failed(SmsOutMessage_t* msg, int error, uint32_t nowMs) {
+    portENTER_CRITICAL(&lock);
+    msg->attempts++;
+    msg->error = (int16_t)error;
+    if (permanentError(error) || msg->attempts >= SMS_MAX_ATTEMPTS) {
+        msg->state = SMS_OUT_FAILED;
+        msg->doneMs = nowMs;
+        stats.failed++;
+    } else {
+        uint32_t backoff = SMS_RETRY_MIN_MS << (msg->attempts - 1);
+        msg->nextTryMs = nowMs + (backoff > SMS_RETRY_MAX_MS ? SMS_RETRY_MAX_MS : backoff);
+        stats.retries++;
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+void SmsOutbox::getStats(SmsOutboxStats_t* out) {
+    portENTER_CRITICAL(&lock);
+    *out = stats;
+    portEXIT_CRITICAL(&lock);
+}
+
+/*
+ * @brief Print queue counters, request-to-send latency and the outcome of each reply still held.
+ */
+void SmsOutbox::printStats(Print& out) {
+    SmsOutboxStats_t s;
+    getStats(&s);
+    FixedPrintf(out, "SMS out: %u requests, %u coalesced, %u dropped, %u sent, %u retries, %u failed\n",
+                (unsigned)s.requested, (unsigned)s.coalesced, (unsigned)s.dropped, (unsigned)s.sent,
+                (unsigned)s.retries, (unsigned)s.failed);
+    FixedPrintf(out, "SMS out: request to send min %u avg %u max %u ms\n", (unsigned)s.latencyMinMs,
+                (unsigned)(s.sent ? s.latencyTotalMs / s.sent : 0), (unsigned)s.latencyMaxMs);
+    uint32_t now = millis();
+    for (int i = 0; i < SMS_OUTBOX_SLOTS; ++i) {
+        SmsOutMessage_t msg;
+        portENTER_CRITICAL(&lock);
+        msg = slots[i];
+        portEXIT_CRITICAL(&lock);
+        if (msg.state == SMS_OUT_FREE) {
+            continue;
+        }
+        FixedPrintf(out, "  #%u to %s tag %u: %s, %u attempts, mr %d, error %d, %u coalesced, ",
+                    (unsigned)msg.seq, msg.number, (unsigned)msg.tag, outStateNames[msg.state],
+                    (unsigned)msg.attempts, (int)msg.messageRef, (int)msg.error, (unsigned)msg.coalesced);
+        if (msg.state == SMS_OUT_QUEUED) {
+            FixedPrintf(out, "waiting %u ms\n", (unsigned)(now - msg.requestedMs));
+        } else {
+            FixedPrintf(out, "%u ms after request\n", (unsigned)(msg.doneMs - msg.requestedMs));
+        }
+    }
+}
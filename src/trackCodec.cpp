@@ -0,0 +1,141 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "trackCodec.h"
+
+/* Terminal digits first, then continuation digits; see tools/track_decode.py */
+static const char codecAlphabet[] =
+    "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcde"
+    "fghijklmnopqrstuvwxyz!#%&'()*+,-./:;<=>?_";
+
+/* Longest varint of a 32-bit value: ceil(32 / log2(41)) */
+#define CODEC_MAX_DIGITS  6
+
+static uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+/*
+ * @brief Write one value as base-41 digits, least significant first.
+ * @return Number of characters, 0 if they do not fit before end.
+ */
+static size_t putVarint(uint32_t v, char* out, const char* end) {
+    char digits[CODEC_MAX_DIGITS];
+    size_t n = 0;
+    while (v >= TRACK_CODEC_RADIX) {
+        digits[n++] = codecAlphabet[TRACK_CODEC_RADIX + v % TRACK_CODEC_RADIX];
+        v /= TRACK_CODEC_RADIX;
+    }
+    digits[n++] = codecAlphabet[v];
+    if ((size_t)(end - out) < n) {
+        return 0;
+    }
+    memcpy(out, digits, n);
+    return n;
+}
+
+/*
+ * @brief Write one point: three values, all or nothing.
+ * @return Number of characters, 0 if the point does not fit before end.
+ */
+static size_t putPoint(uint32_t t, uint32_t lat, uint32_t lon, char* out, const char* end) {
+    size_t a = putVarint(t, out, end);
+    size_t b = a ? putVarint(lat, out + a, end) : 0;
+    size_t c = b ? putVarint(lon, out + a + b, end) : 0;
+    return c ? a + b + c : 0;
+}
+
+/*
+ * @brief Pack as many of the most recent points as fit into compact text (see trackCodec.h).
+ * @paramin points Points, oldest first.
+ * @paramin count Number of points available.
+ * @paramout out Text buffer, NUL terminated.
+ * @paramin max Size of out.
+ * @return Number of points packed, the newest count; 0 if not even one fits.
+ */
+size_t TrackEncodeCompact(const TrackPoint_t* points, size_t count, char* out, size_t max) {
+    static const size_t markLen = sizeof(TRACK_CODEC_MARK) - 1;
+    if (count == 0 || max <= markLen) {
+        if (max > 0) {
+            out[0] = '\0';
+        }
+        return 0;
+    }
+    /* Keep room for the terminator */
+    const char* end = out + max - 1;
+    memcpy(out, TRACK_CODEC_MARK, markLen);
+    char* p = out + markLen;
+
+    const TrackPoint_t* cur = &points[count - 1];
+    int32_t latQ = cur->latE6 / TRACK_COORD_QUANT;
+    int32_t lonQ = cur->lonE6 / TRACK_COORD_QUANT;
+    size_t n = putPoint(cur->utc, zigzag(latQ), zigzag(lonQ), p, end);
+    if (n == 0) {
+        out[0] = '\0';
+        return 0;
+    }
+    p += n;
+    size_t packed = 1;
+    for (; packed < count; ++packed) {
+        const TrackPoint_t* older = &points[count - 1 - packed];
+        int32_t olderLatQ = older->latE6 / TRACK_COORD_QUANT;
+        int32_t olderLonQ = older->lonE6 / TRACK_COORD_QUANT;
+        /* Track time only moves forward; a clock step back is flattened to 0 */
+        uint32_t dt = (cur->utc >= older->utc) ? cur->utc - older->utc : 0;
+        n = putPoint(dt, zigzag(olderLatQ - latQ), zigzag(olderLonQ - lonQ), p, end);
+        if (n == 0) {
+            break;
+        }
+        p += n;
+        cur = older;
+        latQ = olderLatQ;
+        lonQ = olderLonQ;
+    }
+    *p = '\0';
+    return packed;
+}
+
+/*
+ * @brief Pack points into decimal text: the first point absolute as
+ *        "YYMMDDhhmmss lat,lon", the rest as ";dt,dlat,dlon" with dt in
+ *        seconds and dlat/dlon in 1e-5 degrees.
+ * @paramin points Points, oldest first.
+ * @paramin count Number of points available.
+ * @paramout out Text buffer.
+ * @paramin max Size of out, including the terminator.
+ * @return Number of points packed.
+ */
+size_t TrackFormatDecimal(const TrackPoint_t* points, size_t count, char* out, size_t max) {
+    if (count == 0 || max == 0) {
+        return 0;
+    }
+    time_t t = (time_t)(points[0].utc + TRACK_EPOCH_UNIX);
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    int32_t latQ = points[0].latE6 / TRACK_COORD_QUANT;
+    int32_t lonQ = points[0].lonE6 / TRACK_COORD_QUANT;
+    int len = snprintf(out, max, "%02d%02d%02d%02d%02d%02d %s%ld.%05ld,%s%ld.%05ld",
+                       tm.tm_year % 100, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                       latQ < 0 ? "-" : "", (long)(labs(latQ) / 100000), (long)(labs(latQ) % 100000),
+                       lonQ < 0 ? "-" : "", (long)(labs(lonQ) / 100000), (long)(labs(lonQ) % 100000));
+    if (len < 0 || (size_t)len >= max) {
+        out[0] = '\0';
+        return 0;
+    }
+    size_t packed = 1;
+    for (; packed < count; ++packed) {
+        const TrackPoint_t* prev = &points[packed - 1];
+        const TrackPoint_t* cur = &points[packed];
+        char entry[40];
+        int n = snprintf(entry, sizeof(entry), ";%lu,%ld,%ld", (unsigned long)(cur->utc - prev->utc),
+                         (long)(cur->latE6 / TRACK_COORD_QUANT - prev->latE6 / TRACK_COORD_QUANT),
+                         (long)(cur->lonE6 / TRACK_COORD_QUANT - prev->lonE6 / TRACK_COORD_QUANT));
+        if (n < 0 || (size_t)(len + n) >= max) {
+            break;
+        }
+        memcpy(out + len, entry, (size_t)n + 1);
+        len += n;
+    }
+    return packed;
+}
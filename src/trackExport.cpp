@@ -0,0 +1,226 @@
+#include <string.h>
+#include "trackExport.h"
+#include "fixedString.h"
+
+static const char* const sourceNames[] = { "track", "log" };
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+/*
+ * @brief Fill in a frame header.
+ * @paramout header EXPORT_HEADER_LEN bytes.
+ * @paramin len Payload length.
+ */
+void ExportFrameHeader(uint8_t* header, uint8_t type, uint32_t seq, uint16_t aux, uint16_t len) {
+    header[0] = EXPORT_SYNC0;
+    header[1] = EXPORT_SYNC1;
+    header[2] = type;
+    put32(header + 3, seq);
+    put16(header + 7, len);
+    put16(header + 9, aux);
+    put16(header + 11, Crc16(header + 2, 9));
+}
+
+/*
+ * @brief TrackExport constructor
+ * @paramin port Serial console the frames go to.
+ * @paramin consoleBaud Console rate, restored after each transfer.
+ * @paramin track Track to export from RAM.
+ * @paramin log Fix log to export from its device.
+ */
+TrackExport::TrackExport(HardwareSerial& port, uint32_t consoleBaud, TrackStore& track, FixLog& log)
+    : port(port), consoleBaud(consoleBaud), track(track), log(log), stopRequested(false) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool TrackExport::running() const {
+    return stats.running;
+}
+
+/*
+ * @brief Acknowledge in text, switch the console rate and send the start frame.
+ * @paramin source Track or fix log.
+ * @paramin fromSeq First sequence number wanted; older blocks are skipped, 0 for everything.
+ * @paramin baud Rate for the transfer, 0 to keep the console rate.
+ * @return false if a transfer is running, the source is empty or the rate is out of range.
+ */
+bool TrackExport::start(ExportSource source, uint32_t fromSeq, uint32_t baud) {
+    uint32_t oldest;
+    uint32_t newest;
+    if (stats.running) {
+        return false;
+    }
+    bool ok = (source == EXPORT_SOURCE_TRACK) ? track.seqRange(&oldest, &newest) : log.seqRange(&oldest, &newest);
+    if (!ok) {
+        FixedPrintf(port, "Export: %s empty or unavailable\n", sourceNames[source]);
+        return false;
+    }
+    if (baud == 0) {
+        baud = consoleBaud;
+    }
+    if (baud > EXPORT_MAX_BAUD) {
+        FixedPrintf(port, "Export: %u baud is above %u\n", (unsigned)baud, (unsigned)EXPORT_MAX_BAUD);
+        return false;
+    }
+    if (source == EXPORT_SOURCE_LOG) {
+        /* Buffered fixes reach the open segment before it is read, as it goes last */
+        log.requestFlush();
+    }
+    memset(&stats, 0, sizeof(stats));
+    stats.source = source;
+    stats.running = true;
+    stats.baud = baud;
+    stats.fromSeq = (fromSeq > oldest) ? fromSeq : oldest;
+    stats.toSeq = newest;
+    stats.nextSeq = stats.fromSeq;
+    stopRequested = false;
+
+    FixedPrintf(port, "EXPORT %s %u-%u at %u baud\n", sourceNames[source], (unsigned)stats.fromSeq,
+                (unsigned)stats.toSeq, (unsigned)baud);
+    port.flush();
+    if (baud != consoleBaud) {
+        port.updateBaudRate(baud);
+        delay(EXPORT_BAUD_SETTLE_MS);
+    }
+    uint8_t last[4];
+    put32(last, newest);
+    stats.startMs = millis();
+    writeFrame(EXPORT_TYPE_START, stats.fromSeq, 0, last, sizeof(last), Crc16(last, sizeof(last)));
+    return true;
+}
+
+/*
+ * @brief End the transfer after the frame on the wire; the end frame gives the resume point.
+ */
+void TrackExport::stop() {
+    stopRequested = stats.running;
+}
+
+/*
+ * @brief Send the next frame. Blocks the calling task while the UART drains.
+ * @return true while the transfer is running.
+ */
+bool TrackExport::poll() {
+    if (!stats.running) {
+        return false;
+    }
+    if (stopRequested || stats.nextSeq > stats.toSeq) {
+        finish();
+        return false;
+    }
+    bool sent = (stats.source == EXPORT_SOURCE_TRACK) ? sendTrack(stats.nextSeq) : sendLog(stats.nextSeq);
+    if (!sent) {
+        writeFrame(EXPORT_TYPE_MISSING, stats.nextSeq, 0, NULL, 0, Crc16(NULL, 0));
+        stats.missing++;
+    }
+    stats.nextSeq++;
+    return true;
+}
+
+/*
+ * @brief One track block, straight from TrackStore's RAM.
+ * @return false if the block is no longer stored.
+ */
+bool TrackExport::sendTrack(uint32_t seq) {
+    uint32_t startUs = micros();
+    const TrackBlock_t* blk = track.lockBlock(seq);
+    if (blk == NULL) {
+        return false;
+    }
+    /* Bytes below used stay put until the block is recycled, which the CRC then reveals */
+    uint16_t used = blk->used;
+    uint16_t points = blk->points;
+    uint16_t crc = Crc16(blk->data, used);
+    track.unlockBlock();
+    noteHold(startUs);
+    writeFrame(EXPORT_TYPE_TRACK, seq, points, blk->data, used, crc);
+    return true;
+}
+
+/*
+ * @brief One fix log segment, cut after its last valid record.
+ * @return false if the segment was overwritten, never written or cannot be read.
+ */
+bool TrackExport::sendLog(uint32_t seq) {
+    uint32_t startUs = micros();
+    uint16_t records;
+    bool ok = log.readSegment(seq, segment, &records);
+    noteHold(startUs);
+    if (!ok) {
+        return false;
+    }
+    uint16_t len = (uint16_t)(FIX_LOG_HEADER_LEN + records * FIX_LOG_FRAME_LEN);
+    writeFrame(EXPORT_TYPE_LOG, seq, records, segment, len, Crc16(segment, len));
+    return true;
+}
+
+/*
+ * @brief Header from the stack, payload from where it is stored, then its CRC.
+ */
+void TrackExport::writeFrame(uint8_t type, uint32_t seq, uint16_t aux, const uint8_t* payload, uint16_t len,
+                             uint16_t crc) {
+    uint8_t header[EXPORT_HEADER_LEN];
+    ExportFrameHeader(header, type, seq, aux, len);
+    uint8_t trailer[EXPORT_TRAILER_LEN];
+    put16(trailer, crc);
+    port.write(header, sizeof(header));
+    if (len != 0) {
+        port.write(payload, len);
+    }
+    port.write(trailer, sizeof(trailer));
+    stats.frames++;
+    stats.bytes += sizeof(header) + len + sizeof(trailer);
+}
+
+/*
+ * @brief Send the end frame, go back to the console rate and report.
+ */
+void TrackExport::finish() {
+    stats.stopped = stopRequested;
+    writeFrame(EXPORT_TYPE_END, stats.nextSeq, stats.stopped ? 1 : 0, NULL, 0, Crc16(NULL, 0));
+    port.flush();
+    stats.elapsedMs = millis() - stats.startMs;
+    stats.running = false;
+    stopRequested = false;
+    if (stats.baud != consoleBaud) {
+        delay(EXPORT_BAUD_SETTLE_MS);
+        port.updateBaudRate(consoleBaud);
+    }
+    printStats(port);
+}
+
+void TrackExport::noteHold(uint32_t startUs) {
+    uint32_t elapsed = micros() - startUs;
+    if (elapsed > stats.holdMaxUs) {
+        stats.holdMaxUs = elapsed;
+    }
+}
+
+/*
+ * @brief Print the last transfer: range, frames, throughput and how much of the link it used.
+ */
+void TrackExport::printStats(Print& out) {
+    const ExportStats_t& s = stats;
+    if (s.frames == 0) {
+        out.println("Export: no transfer since boot");
+        return;
+    }
+    uint32_t ms = s.running ? millis() - s.startMs : s.elapsedMs;
+    uint32_t bytesPerS = ms ? (uint32_t)((uint64_t)s.bytes * 1000 / ms) : 0;
+    /* 10 bits per byte on the wire */
+    uint32_t linkPct = s.baud ? (uint32_t)((uint64_t)bytesPerS * 1000 / s.baud) : 0;
+    FixedPrintf(out, "Export: %s %u-%u %s, resume at %u\n", sourceNames[s.source], (unsigned)s.fromSeq,
+                (unsigned)s.toSeq, s.running ? "running" : s.stopped ? "stopped" : "done", (unsigned)s.nextSeq);
+    FixedPrintf(out, "Export: %u frames (%u missing), %u bytes in %u ms, %u B/s at %u baud (%u%% of the link), "
+                "longest hold %u us\n",
+                (unsigned)s.frames, (unsigned)s.missing, (unsigned)s.bytes, (unsigned)ms, (unsigned)bytesPerS,
+                (unsigned)s.baud, (unsigned)linkPct, (unsigned)s.holdMaxUs);
+}
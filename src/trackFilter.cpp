@@ -0,0 +1,278 @@
+#include <string.h>
+#include "trackFilter.h"
+#include "fixedPoint.h"
+#include "fixedString.h"
+
+/*
+ * @brief TrackFilter constructor
+ */
+TrackFilter::TrackFilter() : lock(portMUX_INITIALIZER_UNLOCKED) {
+    memset(&state, 0, sizeof(state));
+    memset(&stats, 0, sizeof(stats));
+}
+
+/*
+ * @brief Constant-velocity prediction over dtMs with white acceleration noise.
+ */
+void TrackFilter::predict(Axis_t* a, uint32_t dtMs) {
+    int64_t dt = dtMs;
+    a->pos += (int32_t)((int64_t)a->vel * dt / 1000);
+    /* Acceleration noise as position and velocity deviations over dt */
+    int64_t qPos = (int64_t)TRACK_FILTER_ACCEL_CMS2 * dt * dt / 2000000;
+    int64_t qVel = (int64_t)TRACK_FILTER_ACCEL_CMS2 * dt / 1000;
+    a->p00 += 2 * a->p01 * dt / 1000 + a->p11 * dt / 1000 * dt / 1000 + qPos * qPos;
+    a->p01 += a->p11 * dt / 1000 + qPos * qVel;
+    a->p11 += qVel * qVel;
+}
+
+/*
+ * @brief Measurement update with a position z (cm), variance r (cm^2).
+ */
+void TrackFilter::updatePosition(Axis_t* a, int32_t z, int64_t r) {
+    int64_t s = a->p00 + r;
+    int64_t k0 = (a->p00 << 16) / s;
+    int64_t k1 = (a->p01 << 16) / s;
+    int64_t y = (int64_t)z - a->pos;
+    a->pos += (int32_t)((k0 * y) >> 16);
+    a->vel += (int32_t)((k1 * y) >> 16);
+    int64_t p01 = a->p01;
+    a->p00 -= (k0 * a->p00) >> 16;
+    a->p01 -= (k0 * p01) >> 16;
+    a->p11 -= (k1 * p01) >> 16;
+}
+
+/*
+ * @brief Measurement update with a velocity z (cm/s), variance r (cm^2/s^2).
+ */
+void TrackFilter::updateVelocity(Axis_t* a, int32_t z, int64_t r) {
+    int64_t s = a->p11 + r;
+    int64_t k0 = (a->p01 << 16) / s;
+    int64_t k1 = (a->p11 << 16) / s;
+    int64_t y = (int64_t)z - a->vel;
+    a->pos += (int32_t)((k0 * y) >> 16);
+    a->vel += (int32_t)((k1 * y) >> 16);
+    int64_t p11 = a->p11;
+    a->p00 -= (k0 * a->p01) >> 16;
+    a->p01 -= (k0 * p11) >> 16;
+    a->p11 -= (k1 * p11) >> 16;
+}
+
+void TrackFilter::toLocal(const State_t& s, int32_t latE6, int32_t lonE6, int64_t* east, int64_t* north) {
+    *north = (int64_t)(latE6 - s.originLatE6) * FIXED_M_PER_DEG_LAT / 10000;
+    *east = (int64_t)(lonE6 - s.originLonE6) * FIXED_M_PER_DEG_LAT / 10000 * s.lonScaleQ15 >> 15;
+}
+
+void TrackFilter::toGlobal(const State_t& s, int32_t east, int32_t north, int32_t* latE6, int32_t* lonE6) {
+    *latE6 = s.originLatE6 + (int32_t)((int64_t)north * 10000 / FIXED_M_PER_DEG_LAT);
+    *lonE6 = s.originLonE6 + (int32_t)(((int64_t)east << 15) / s.lonScaleQ15 * 10000 / FIXED_M_PER_DEG_LAT);
+}
+
+/*
+ * @brief Velocity over ground in cm/s, east and north, from speed and course.
+ */
+void TrackFilter::measuredVelocity(const GnssRecord_t& rec, int32_t* east, int32_t* north) {
+    if (rec.speedKmhX100 < TRACK_FILTER_VEL_MIN_KMH_X100) {
+        *east = 0;
+        *north = 0;
+        return;
+    }
+    /* km/h * 100 to cm/s */
+    int32_t speed = (int32_t)rec.speedKmhX100 * 5 / 18;
+    *east = speed * FixedSinX100(rec.courseX100) >> 15;
+    *north = speed * FixedSinX100(rec.courseX100 + 9000) >> 15;
+}
+
+/*
+ * @brief Start over at a fix: origin on the fix, velocity as measured.
+ */
+void TrackFilter::restart(State_t* s, const GnssRecord_t& rec, uint32_t nowMs) {
+    int64_t sigma = (int64_t)rec.hdopX100 * TRACK_FILTER_UERE_CM / 100;
+    if (sigma < TRACK_FILTER_POS_SIGMA_MIN_CM) {
+        sigma = TRACK_FILTER_POS_SIGMA_MIN_CM;
+    }
+    int32_t ve, vn;
+    measuredVelocity(rec, &ve, &vn);
+    memset(s, 0, sizeof(*s));
+    s->valid = true;
+    s->timeMs = nowMs;
+    s->originLatE6 = rec.latE6;
+    s->originLonE6 = rec.lonE6;
+    s->lonScaleQ15 = FixedLonScaleQ15(rec.latE6);
+    Axis_t* axes[2] = {&s->east, &s->north};
+    int32_t vel[2] = {ve, vn};
+    for (int i = 0; i < 2; ++i) {
+        axes[i]->vel = vel[i];
+        axes[i]->p00 = sigma * sigma;
+        axes[i]->p11 = (int64_t)TRACK_FILTER_VEL_SIGMA_CMS * TRACK_FILTER_VEL_SIGMA_CMS;
+    }
+}
+
+/*
+ * @brief Filter one accepted GNSS sample. Runs in gpsTask.
+ * @paramout latE6 Filtered position, unchanged if the sample was rejected.
+ * @paramout lonE6
+ * @return TRACK_FILTER_REJECTED if the sample is treated as multipath.
+ */
+TrackFilterResult TrackFilter::update(const GnssRecord_t& rec, uint32_t nowMs, int32_t* latE6, int32_t* lonE6) {
+    uint32_t startUs = micros();
+    State_t s;
+    portENTER_CRITICAL(&lock);
+    s = state;
+    portEXIT_CRITICAL(&lock);
+
+    TrackFilterResult result = TRACK_FILTER_ACCEPTED;
+    uint32_t dtMs = nowMs - s.timeMs;
+    int64_t sigma = (int64_t)rec.hdopX100 * TRACK_FILTER_UERE_CM / 100;
+    if (sigma < TRACK_FILTER_POS_SIGMA_MIN_CM) {
+        sigma = TRACK_FILTER_POS_SIGMA_MIN_CM;
+    }
+    int64_t r = sigma * sigma;
+    uint32_t correctionCm = 0;
+    if (!s.valid || dtMs > TRACK_FILTER_MAX_GAP_MS) {
+        result = TRACK_FILTER_RESTARTED;
+    } else {
+        Axis_t east = s.east;
+        Axis_t north = s.north;
+        int32_t lastEast = east.pos;
+        int32_t lastNorth = north.pos;
+        predict(&east, dtMs);
+        predict(&north, dtMs);
+        int64_t zEast, zNorth;
+        toLocal(s, rec.latE6, rec.lonE6, &zEast, &zNorth);
+        int64_t yEast = zEast - east.pos;
+        int64_t yNorth = zNorth - north.pos;
+        /* Beyond 1000 km it is a jump whatever the variance */
+        bool far = yEast > 100000000 || yEast < -100000000 || yNorth > 100000000 || yNorth < -100000000;
+        int64_t gate = TRACK_FILTER_GATE_SIGMA * (int64_t)FixedIsqrt64((uint64_t)(east.p00 + north.p00 + 2 * r)) +
+                       (int64_t)TRACK_FILTER_MANEUVER_CMS2 * dtMs / 1000 * dtMs / 2000;
+        /* Distance from the last estimate against what a bike covers in dt, with the fix's own error */
+        int64_t dEast = zEast - lastEast;
+        int64_t dNorth = zNorth - lastNorth;
+        int64_t reach = (int64_t)TRACK_FILTER_MAX_SPEED_CMS * dtMs / 1000 + TRACK_FILTER_GATE_SIGMA * sigma;
+        bool impossible = far || dEast * dEast + dNorth * dNorth > reach * reach;
+        if (impossible || yEast * yEast + yNorth * yNorth > gate * gate) {
+            result = (++s.rejectedInRow >= TRACK_FILTER_RESET_AFTER) ? TRACK_FILTER_RESTARTED : TRACK_FILTER_REJECTED;
+        } else {
+            int32_t vEast, vNorth;
+            measuredVelocity(rec, &vEast, &vNorth);
+            int64_t rv = (int64_t)TRACK_FILTER_VEL_SIGMA_CMS * TRACK_FILTER_VEL_SIGMA_CMS;
+            updatePosition(&east, (int32_t)zEast, r);
+            updateVelocity(&east, vEast, rv);
+            updatePosition(&north, (int32_t)zNorth, r);
+            updateVelocity(&north, vNorth, rv);
+            s.east = east;
+            s.north = north;
+            s.timeMs = nowMs;
+            s.rejectedInRow = 0;
+            correctionCm = FixedIsqrt64((uint64_t)((zEast - east.pos) * (zEast - east.pos) +
+                                              (zNorth - north.pos) * (zNorth - north.pos)));
+            toGlobal(s, east.pos, north.pos, latE6, lonE6);
+            /* Keep the local frame small: move the origin under the estimate */
+            if (east.pos > TRACK_FILTER_REANCHOR_CM || east.pos < -TRACK_FILTER_REANCHOR_CM ||
+                north.pos > TRACK_FILTER_REANCHOR_CM || north.pos < -TRACK_FILTER_REANCHOR_CM) {
+                s.originLatE6 = *latE6;
+                s.originLonE6 = *lonE6;
+                s.east.pos = 0;
+                s.north.pos = 0;
+            }
+        }
+    }
+    if (result == TRACK_FILTER_RESTARTED) {
+        restart(&s, rec, nowMs);
+        *latE6 = rec.latE6;
+        *lonE6 = rec.lonE6;
+    }
+
+    uint32_t elapsed = micros() - startUs;
+    portENTER_CRITICAL(&lock);
+    state = s;
+    stats.updates++;
+    if (result == TRACK_FILTER_REJECTED) {
+        stats.rejected++;
+    } else if (result == TRACK_FILTER_RESTARTED) {
+        stats.restarts++;
+    } else {
+        stats.correctionTotalCm += correctionCm;
+    }
+    stats.updateTotalUs += elapsed;
+    if (elapsed > stats.updateMaxUs) {
+        stats.updateMaxUs = elapsed;
+    }
+    portEXIT_CRITICAL(&lock);
+    return result;
+}
+
+/*
+ * @brief Position extrapolated from the last update to nowMs. Any task.
+ * @return false before the first fix or more than TRACK_FILTER_PREDICT_MAX_MS after the last one.
+ */
+bool TrackFilter::estimate(uint32_t nowMs, TrackEstimate_t* est) {
+    State_t s;
+    portENTER_CRITICAL(&lock);
+    s = state;
+    portEXIT_CRITICAL(&lock);
+    uint32_t dtMs = nowMs - s.timeMs;
+    if (!s.valid || dtMs > TRACK_FILTER_PREDICT_MAX_MS) {
+        return false;
+    }
+    predict(&s.east, dtMs);
+    predict(&s.north, dtMs);
+    toGlobal(s, s.east.pos, s.north.pos, &est->latE6, &est->lonE6);
+    est->sigmaM = FixedIsqrt64((uint64_t)(s.east.p00 + s.north.p00)) / 100;
+    est->sinceFixMs = dtMs;
+    return true;
+}
+
+/*
+ * @brief How long after the last update an estimate stays within maxErrorM (one sigma),
+ *        in 1 s steps up to TRACK_FILTER_PREDICT_MAX_MS.
+ */
+uint32_t TrackFilter::horizonMs(uint32_t maxErrorM) {
+    State_t s;
+    portENTER_CRITICAL(&lock);
+    s = state;
+    portEXIT_CRITICAL(&lock);
+    if (!s.valid) {
+        return 0;
+    }
+    int64_t limit = (int64_t)maxErrorM * maxErrorM * 10000;
+    uint32_t lo = 0, hi = TRACK_FILTER_PREDICT_MAX_MS / 1000;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi + 1) / 2;
+        Axis_t east = s.east;
+        Axis_t north = s.north;
+        predict(&east, mid * 1000);
+        predict(&north, mid * 1000);
+        if (east.p00 + north.p00 <= limit) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo * 1000;
+}
+
+void TrackFilter::getStats(TrackFilterStats_t* out) {
+    portENTER_CRITICAL(&lock);
+    *out = stats;
+    portEXIT_CRITICAL(&lock);
+}
+
+/*
+ * @brief Print update cost, rejections and the mean correction applied to fixes.
+ */
+void TrackFilter::printStats(Print& out) {
+    TrackFilterStats_t s;
+    getStats(&s);
+    uint32_t accepted = s.updates - s.rejected - s.restarts;
+    FixedPrintf(out, "Track filter: %u fixes, %u rejected as jumps, %u restarts\n", (unsigned)s.updates,
+                (unsigned)s.rejected, (unsigned)s.restarts);
+    FixedPrintf(out, "Track filter: update avg %u us max %u us, mean correction %u cm\n",
+                (unsigned)(s.updates ? s.updateTotalUs / s.updates : 0), (unsigned)s.updateMaxUs,
+                (unsigned)(accepted ? s.correctionTotalCm / accepted : 0));
+    TrackEstimate_t est;
+    if (estimate(millis(), &est)) {
+        FixedPrintf(out, "Track filter: estimate %u s after the last fix, +/- %u m\n",
+                    (unsigned)(est.sinceFixMs / 1000), (unsigned)est.sigmaM);
+    }
+}
@@ -0,0 +1,329 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <Preferences.h>
+#include "trackStore.h"
+
+/* Longest encoded point: three 5-byte varints */
+#define TRACK_POINT_MAX_LEN  15
+
+static size_t putVarint(uint8_t* p, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static size_t getVarint(const uint8_t* p, size_t len, uint32_t* v) {
+    uint32_t result = 0;
+    for (size_t i = 0; i < len && i < 5; ++i) {
+        result |= (uint32_t)(p[i] & 0x7F) << (7 * i);
+        if ((p[i] & 0x80) == 0) {
+            *v = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static int32_t quantize(int32_t e6) {
+    return (e6 + ((e6 >= 0) ? TRACK_COORD_QUANT / 2 : -TRACK_COORD_QUANT / 2)) / TRACK_COORD_QUANT;
+}
+
+/*
+ * @brief TrackStore constructor
+ */
+TrackStore::TrackStore()
+    : head(0), nextSeq(1), unsaved(0), haveLast(false), lastUtc(0), lastLatQ(0), lastLonQ(0), lock(NULL) {
+    memset(blocks, 0, sizeof(blocks));
+}
+
+/*
+ * @brief Load the track saved in NVS and resume appending after its last point.
+ * @return false if the lock could not be created.
+ */
+bool TrackStore::begin() {
+    lock = xSemaphoreCreateMutex();
+    if (lock == NULL) {
+        return false;
+    }
+    Preferences prefs;
+    if (prefs.begin(TRACK_NVS_NAMESPACE, true)) {
+        char key[8];
+        for (uint8_t i = 0; i < TRACK_BLOCKS; ++i) {
+            snprintf(key, sizeof(key), "b%02u", i);
+            if (prefs.getBytes(key, &blocks[i], sizeof(blocks[i])) != sizeof(blocks[i]) ||
+                blocks[i].used > sizeof(blocks[i].data)) {
+                memset(&blocks[i], 0, sizeof(blocks[i]));
+            }
+        }
+        prefs.end();
+    }
+    /* Newest block is the one with the highest sequence number */
+    uint32_t newest = 0;
+    for (uint8_t i = 0; i < TRACK_BLOCKS; ++i) {
+        if (blocks[i].seq > newest) {
+            newest = blocks[i].seq;
+            head = i;
+        }
+    }
+    if (newest == 0) {
+        startBlock();
+        return true;
+    }
+    nextSeq = newest + 1;
+    /* Recover the delta base from the last point of the head block */
+    TrackPoint_t last;
+    const TrackBlock_t* blk = &blocks[head];
+    if (blk->points > 0 && decodeBlock(blk, &last, blk->points - 1, 1) == 1) {
+        haveLast = true;
+        lastUtc = last.utc;
+        lastLatQ = last.latE6 / TRACK_COORD_QUANT;
+        lastLonQ = last.lonE6 / TRACK_COORD_QUANT;
+    }
+    return true;
+}
+
+/*
+ * @brief Convert the UTC time of a GNSS record to track seconds.
+ * @return false if the record carries no valid date.
+ */
+bool TrackStore::recordTime(const GnssRecord_t& rec, uint32_t* utc) {
+    uint32_t unixTime;
+    if (!GnssRecordUnixTime(&rec, &unixTime) || unixTime < TRACK_EPOCH_UNIX) {
+        return false;
+    }
+    *utc = unixTime - TRACK_EPOCH_UNIX;
+    return true;
+}
+
+/*
+ * @brief Add a fix to the track, skipping it if the bike has not moved.
+ * @paramin rec Valid GNSS record.
+ * @return true if the point was stored.
+ */
+bool TrackStore::append(const GnssRecord_t& rec) {
+    uint32_t utc;
+    if (!rec.fixValid || !recordTime(rec, &utc)) {
+        return false;
+    }
+    int32_t latQ = quantize(rec.latE6);
+    int32_t lonQ = quantize(rec.lonE6);
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool stored = false;
+    if (!haveLast || abs(latQ - lastLatQ) >= TRACK_MIN_MOVE_Q || abs(lonQ - lastLonQ) >= TRACK_MIN_MOVE_Q ||
+        utc - lastUtc >= TRACK_MAX_GAP_S || utc < lastUtc) {
+        stored = appendPoint(utc, latQ, lonQ);
+    }
+    xSemaphoreGive(lock);
+    return stored;
+}
+
+/*
+ * @brief Encode one point into the head block, opening a new block when it is full.
+ *        Called with the lock held.
+ */
+bool TrackStore::appendPoint(uint32_t utc, int32_t latQ, int32_t lonQ) {
+    TrackBlock_t* blk = &blocks[head];
+    if ((size_t)blk->used + TRACK_POINT_MAX_LEN > sizeof(blk->data)) {
+        persist(head);
+        head = (uint8_t)((head + 1) % TRACK_BLOCKS);
+        startBlock();
+        blk = &blocks[head];
+    }
+    uint8_t* p = blk->data + blk->used;
+    size_t n;
+    if (blk->points == 0 || utc < lastUtc) {
+        /* Key point: absolute values, so the block decodes on its own */
+        if (blk->points != 0) {
+            /* Clock went backwards: start a fresh block rather than encode a negative delta */
+            persist(head);
+            head = (uint8_t)((head + 1) % TRACK_BLOCKS);
+            startBlock();
+            blk = &blocks[head];
+            p = blk->data;
+        }
+        n = putVarint(p, utc);
+        n += putVarint(p + n, zigzag(latQ));
+        n += putVarint(p + n, zigzag(lonQ));
+    } else {
+        n = putVarint(p, utc - lastUtc);
+        n += putVarint(p + n, zigzag(latQ - lastLatQ));
+        n += putVarint(p + n, zigzag(lonQ - lastLonQ));
+    }
+    blk->used = (uint16_t)(blk->used + n);
+    blk->points++;
+    haveLast = true;
+    lastUtc = utc;
+    lastLatQ = latQ;
+    lastLonQ = lonQ;
+    if (++unsaved >= TRACK_PERSIST_EVERY) {
+        persist(head);
+    }
+    return true;
+}
+
+/*
+ * @brief Reset the head block and give it the next sequence number. Called with the lock held.
+ */
+void TrackStore::startBlock() {
+    memset(&blocks[head], 0, sizeof(blocks[head]));
+    blocks[head].seq = nextSeq++;
+}
+
+/*
+ * @brief Write one block to NVS. Called with the lock held.
+ */
+void TrackStore::persist(uint8_t idx) {
+    Preferences prefs;
+    if (!prefs.begin(TRACK_NVS_NAMESPACE, false)) {
+        return;
+    }
+    char key[8];
+    snprintf(key, sizeof(key), "b%02u", idx);
+    prefs.putBytes(key, &blocks[idx], sizeof(blocks[idx]));
+    prefs.end();
+    if (idx == head) {
+        unsaved = 0;
+    }
+}
+
+/*
+ * @brief Decode points of one block.
+ * @paramin skip Number of leading points to skip.
+ * @paramout out Decoded points.
+ * @paramin max Maximum number of points to decode.
+ * @return Number of points written to out.
+ */
+size_t TrackStore::decodeBlock(const TrackBlock_t* blk, TrackPoint_t* out, size_t skip, size_t max) {
+    size_t pos = 0;
+    size_t written = 0;
+    uint32_t utc = 0;
+    int32_t latQ = 0;
+    int32_t lonQ = 0;
+    for (uint16_t i = 0; i < blk->points && written < max; ++i) {
+        uint32_t t, la, lo;
+        size_t n;
+        if ((n = getVarint(blk->data + pos, blk->used - pos, &t)) == 0) {
+            break;
+        }
+        pos += n;
+        if ((n = getVarint(blk->data + pos, blk->used - pos, &la)) == 0) {
+            break;
+        }
+        pos += n;
+        if ((n = getVarint(blk->data + pos, blk->used - pos, &lo)) == 0) {
+            break;
+        }
+        pos += n;
+        if (i == 0) {
+            utc = t;
+            latQ = unzigzag(la);
+            lonQ = unzigzag(lo);
+        } else {
+            utc += t;
+            latQ += unzigzag(la);
+            lonQ += unzigzag(lo);
+        }
+        if (i >= skip) {
+            out[written].utc = utc;
+            out[written].latE6 = latQ * TRACK_COORD_QUANT;
+            out[written].lonE6 = lonQ * TRACK_COORD_QUANT;
+            written++;
+        }
+    }
+    return written;
+}
+
+/*
+ * @brief Copy the most recent points, oldest first.
+ * @paramout out Point buffer.
+ * @paramin max Number of points wanted.
+ * @return Number of points copied.
+ */
+size_t TrackStore::latest(TrackPoint_t* out, size_t max) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    /* Walk back from the head block until enough points are covered */
+    size_t covered = 0;
+    uint8_t first = head;
+    uint8_t blocksBack = 0;
+    for (;;) {
+        const TrackBlock_t* blk = &blocks[first];
+        if (blk->seq == 0) {
+            break;
+        }
+        covered += blk->points;
+        if (covered >= max || blocksBack == TRACK_BLOCKS - 1) {
+            break;
+        }
+        uint8_t prev = (uint8_t)((first + TRACK_BLOCKS - 1) % TRACK_BLOCKS);
+        if (blocks[prev].seq == 0 || blocks[prev].seq > blk->seq) {
+            break;
+        }
+        first = prev;
+        blocksBack++;
+    }
+    size_t skip = (covered > max) ? covered - max : 0;
+    size_t written = 0;
+    for (uint8_t i = 0; i <= blocksBack && written < max; ++i) {
+        const TrackBlock_t* blk = &blocks[(first + i) % TRACK_BLOCKS];
+        size_t n = decodeBlock(blk, out + written, skip, max - written);
+        skip = (skip > blk->points) ? skip - blk->points : 0;
+        written += n;
+    }
+    xSemaphoreGive(lock);
+    return written;
+}
+
+/*
+ * @brief Sequence numbers of the oldest and newest blocks in the track. Any task.
+ * @return false if the track is empty.
+ */
+bool TrackStore::seqRange(uint32_t* oldest, uint32_t* newest) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint32_t lo = 0;
+    uint32_t hi = 0;
+    for (uint8_t i = 0; i < TRACK_BLOCKS; ++i) {
+        uint32_t seq = blocks[i].seq;
+        if (seq != 0 && blocks[i].points != 0) {
+            lo = (lo == 0 || seq < lo) ? seq : lo;
+            hi = (seq > hi) ? seq : hi;
+        }
+    }
+    xSemaphoreGive(lock);
+    *oldest = lo;
+    *newest = hi;
+    return hi != 0;
+}
+
+/*
+ * @brief Lock the track and find a block to read in place. Keep the lock short:
+ *        gpsTask waits on it to append. Release it with unlockBlock().
+ * @paramin seq Block sequence number.
+ * @return The block, or NULL (and the track unlocked) if it was overwritten or is empty.
+ */
+const TrackBlock_t* TrackStore::lockBlock(uint32_t seq) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < TRACK_BLOCKS; ++i) {
+        if (blocks[i].seq == seq && blocks[i].points != 0) {
+            return &blocks[i];
+        }
+    }
+    xSemaphoreGive(lock);
+    return NULL;
+}
+
+void TrackStore::unlockBlock() {
+    xSemaphoreGive(lock);
+}
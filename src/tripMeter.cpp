@@ -0,0 +1,208 @@
+#include <string.h>
+#include <stdio.h>
+#include "tripMeter.h"
+#include "fixedPoint.h"
+#include "fixedString.h"
+
+#define TRIP_MIN_PER_DAY  1440
+
+/*
+ * @brief TripMeter constructor
+ */
+TripMeter::TripMeter()
+    : haveFix(false), lastLatE6(0), lastLonE6(0), lastMs(0), still(false), anchorLatE6(0), anchorLonE6(0),
+      anchorMs(0), anchorUtcMin(0), tripCm(0), lock(portMUX_INITIALIZER_UNLOCKED), haveLast(false) {
+    memset(&trip, 0, sizeof(trip));
+    memset(&currentTrip, 0, sizeof(currentTrip));
+    memset(&lastTrip, 0, sizeof(lastTrip));
+    memset(&totals, 0, sizeof(totals));
+}
+
+/*
+ * @brief Feed one accepted fix. Called by gpsTask only; a few table lookups and one square root.
+ * @paramin rec Accepted (filtered) fix.
+ * @paramin nowMs millis() of the fix.
+ */
+void TripMeter::update(const GnssRecord_t& rec, uint32_t nowMs) {
+    uint32_t startUs = micros();
+    uint16_t utcMin = (uint16_t)(rec.hour * 60 + rec.minute);
+    bool slow = rec.speedKmhX100 < TRIP_STOP_SPEED_KMH_X100;
+    bool finished = false;
+    if (!haveFix) {
+        haveFix = true;
+        still = slow;
+        anchorLatE6 = rec.latE6;
+        anchorLonE6 = rec.lonE6;
+        anchorMs = nowMs;
+        anchorUtcMin = utcMin;
+    } else if (!slow ||
+               FixedDistanceCm(anchorLatE6, anchorLonE6, rec.latE6, rec.lonE6) > (uint32_t)TRIP_STOP_RADIUS_M * 100) {
+        /* Moving, or arrived somewhere new since the last fix */
+        uint32_t dt = nowMs - lastMs;
+        uint32_t credit = (dt > TRIP_MAX_GAP_MS) ? TRIP_MAX_GAP_MS : dt;
+        if (!trip.active) {
+            memset(&trip, 0, sizeof(trip));
+            trip.active = true;
+            trip.startMs = nowMs - credit;
+            trip.startUtcMin = (uint16_t)((utcMin + TRIP_MIN_PER_DAY - credit / 60000) % TRIP_MIN_PER_DAY);
+            tripCm = 0;
+        } else if (still && lastMs - anchorMs >= TRIP_STOP_MIN_MS) {
+            /* Leaving a stop: it lasted at least until the last fix there */
+            trip.stops++;
+            trip.stoppedMs += lastMs - anchorMs;
+        }
+        tripCm += FixedDistanceCm(lastLatE6, lastLonE6, rec.latE6, rec.lonE6);
+        trip.distanceM = tripCm / 100;
+        trip.movingMs += credit;
+        if (rec.speedKmhX100 > trip.maxSpeedKmhX100) {
+            trip.maxSpeedKmhX100 = rec.speedKmhX100;
+        }
+        still = false;
+        anchorLatE6 = rec.latE6;
+        anchorLonE6 = rec.lonE6;
+        anchorMs = nowMs;
+        anchorUtcMin = utcMin;
+    } else {
+        still = true;
+        if (trip.active && nowMs - anchorMs >= TRIP_END_DWELL_MS) {
+            finished = true;
+        }
+    }
+    lastLatE6 = rec.latE6;
+    lastLonE6 = rec.lonE6;
+    lastMs = nowMs;
+    if (trip.active && !finished) {
+        trip.endMs = nowMs;
+        trip.endUtcMin = utcMin;
+    }
+    trip.stopped = trip.active && still;
+    trip.stillSinceMs = anchorMs;
+
+    uint32_t elapsed = micros() - startUs;
+    portENTER_CRITICAL(&lock);
+    if (finished) {
+        finishTrip();
+    }
+    currentTrip = trip;
+    totals.updates++;
+    totals.updateTotalUs += elapsed;
+    if (elapsed > totals.updateMaxUs) {
+        totals.updateMaxUs = elapsed;
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+/*
+ * @brief Close the trip at the arrival on its final stop; drift-sized trips are dropped. Call with the lock held.
+ */
+void TripMeter::finishTrip() {
+    trip.active = false;
+    trip.stopped = false;
+    trip.endMs = anchorMs;
+    trip.endUtcMin = anchorUtcMin;
+    if (trip.distanceM >= TRIP_MIN_DISTANCE_M) {
+        lastTrip = trip;
+        haveLast = true;
+        totals.trips++;
+        totals.distanceM += trip.distanceM;
+        totals.movingMs += trip.movingMs;
+        if (trip.maxSpeedKmhX100 > totals.maxSpeedKmhX100) {
+            totals.maxSpeedKmhX100 = trip.maxSpeedKmhX100;
+        }
+    }
+    memset(&trip, 0, sizeof(trip));
+    tripCm = 0;
+}
+
+/*
+ * @brief Copy the trip in progress. Any task.
+ * @return false if the bike is not on a trip.
+ */
+bool TripMeter::current(TripSummary_t* out) {
+    portENTER_CRITICAL(&lock);
+    *out = currentTrip;
+    portEXIT_CRITICAL(&lock);
+    return out->active;
+}
+
+/*
+ * @brief Copy the last finished trip. Any task.
+ * @return false if no trip finished since boot.
+ */
+bool TripMeter::last(TripSummary_t* out) {
+    portENTER_CRITICAL(&lock);
+    *out = lastTrip;
+    bool result = haveLast;
+    portEXIT_CRITICAL(&lock);
+    return result;
+}
+
+void TripMeter::getTotals(TripTotals_t* out) {
+    portENTER_CRITICAL(&lock);
+    *out = totals;
+    portEXIT_CRITICAL(&lock);
+}
+
+/*
+ * @brief Print the trip in progress, the last trip, totals since boot and the cost per fix.
+ */
+void TripMeter::printStats(Print& out) {
+    char line[128];
+    TripSummary_t t;
+    uint32_t now = millis();
+    if (current(&t)) {
+        TripFormat(line, sizeof(line), t, now);
+        FixedPrintf(out, "Trip: %s\n", line);
+    } else {
+        out.println("Trip: none in progress");
+    }
+    if (last(&t)) {
+        TripFormat(line, sizeof(line), t, now);
+        FixedPrintf(out, "Trip: last %s\n", line);
+    }
+    TripTotals_t s;
+    getTotals(&s);
+    FixedPrintf(out, "Trip: %u trips, %u.%u km, max %u.%u km/h since boot; %u fixes, update avg %u us max %u us\n",
+                (unsigned)s.trips, (unsigned)(s.distanceM / 1000), (unsigned)(s.distanceM % 1000 / 100),
+                (unsigned)(s.maxSpeedKmhX100 / 100), (unsigned)(s.maxSpeedKmhX100 % 100 / 10), (unsigned)s.updates,
+                (unsigned)(s.updates ? s.updateTotalUs / s.updates : 0), (unsigned)s.updateMaxUs);
+}
+
+/*
+ * @brief One-line trip summary, e.g. "08:10-08:52 UTC: 8.1 km in 42 min (38 moving), avg 12.8 max 29.0 km/h, 1 stop".
+ *        A trip in progress reads "riding since 08:10 UTC: ..." or "stopped 6 min, riding since ...".
+ * @paramout out Text buffer.
+ * @paramin max Size of out.
+ * @paramin trip Summary from current() or last().
+ * @paramin nowMs millis() now, for a trip in progress.
+ * @return Length of the text, truncated to fit.
+ */
+size_t TripFormat(char* out, size_t max, const TripSummary_t& trip, uint32_t nowMs) {
+    size_t len = 0;
+    int n;
+    if (trip.active) {
+        n = trip.stopped ? snprintf(out, max, "stopped %u min, riding since %02u:%02u UTC",
+                                    (unsigned)((nowMs - trip.stillSinceMs) / 60000),
+                                    (unsigned)(trip.startUtcMin / 60), (unsigned)(trip.startUtcMin % 60))
+                         : snprintf(out, max, "riding since %02u:%02u UTC", (unsigned)(trip.startUtcMin / 60),
+                                    (unsigned)(trip.startUtcMin % 60));
+    } else {
+        n = snprintf(out, max, "%02u:%02u-%02u:%02u UTC", (unsigned)(trip.startUtcMin / 60),
+                     (unsigned)(trip.startUtcMin % 60), (unsigned)(trip.endUtcMin / 60),
+                     (unsigned)(trip.endUtcMin % 60));
+    }
+    if (n > 0) {
+        len = ((size_t)n < max) ? (size_t)n : max - 1;
+    }
+    uint32_t durationMs = (trip.active ? nowMs : trip.endMs) - trip.startMs;
+    uint32_t avgKmhX10 = trip.movingMs ? (uint32_t)((uint64_t)trip.distanceM * 36000 / trip.movingMs) : 0;
+    n = snprintf(out + len, max - len, ": %u.%u km in %u min (%u moving), avg %u.%u max %u.%u km/h, %u stop%s",
+                 (unsigned)(trip.distanceM / 1000), (unsigned)(trip.distanceM % 1000 / 100),
+                 (unsigned)(durationMs / 60000), (unsigned)(trip.movingMs / 60000), (unsigned)(avgKmhX10 / 10),
+                 (unsigned)(avgKmhX10 % 10), (unsigned)(trip.maxSpeedKmhX100 / 100),
+                 (unsigned)(trip.maxSpeedKmhX100 % 100 / 10), (unsigned)trip.stops, (trip.stops == 1) ? "" : "s");
+    if (n > 0) {
+        len += ((size_t)n < max - len) ? (size_t)n : max - len - 1;
+    }
+    return len;
+}
@@ -0,0 +1,162 @@
+#include <string.h>
+#include "uplink.h"
+#include "trackCodec.h"
+#include "fixedString.h"
+
+/*
+ * @brief Uplink constructor
+ */
+Uplink::Uplink()
+    : lock(portMUX_INITIALIZER_UNLOCKED), head(0), used(0), headSeq(0), session(false), retryAtMs(0),
+      backoffMs(0) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+/*
+ * @brief Follow the MQTT session state reported by the modem.
+ * @paramin at AT engine delivering URCs.
+ * @return true on success.
+ */
+bool Uplink::begin(AtEngine& at) {
+    return at.subscribe("+SMSTATE:", onSessionUrc, this);
+}
+
+/*
+ * @brief "+SMSTATE: 0": the broker or the bearer dropped the session.
+ */
+void Uplink::onSessionUrc(const char* line, size_t len, void* ctx) {
+    static const char prefix[] = "+SMSTATE:";
+    const char* p = line + sizeof(prefix) - 1;
+    const char* end = line + len;
+    while (p < end && *p == ' ') {
+        p++;
+    }
+    static_cast<Uplink*>(ctx)->setConnected(p < end && *p != '0');
+}
+
+/*
+ * @brief Queue a fix for upload. Never blocks; a full queue drops its oldest fix.
+ * @return false if the fix has no valid time.
+ */
+bool Uplink::enqueue(const GnssRecord_t& rec) {
+    UplinkPoint_t p;
+    if (!TrackStore::recordTime(rec, &p.point.utc)) {
+        return false;
+    }
+    p.point.latE6 = rec.latE6;
+    p.point.lonE6 = rec.lonE6;
+    p.queuedMs = millis();
+    portENTER_CRITICAL(&lock);
+    if (used == UPLINK_QUEUE_DEPTH) {
+        head = (uint8_t)((head + 1) % UPLINK_QUEUE_DEPTH);
+        headSeq++;
+        used--;
+        stats.dropped++;
+    }
+    ring[(head + used) % UPLINK_QUEUE_DEPTH] = p;
+    used++;
+    stats.queued++;
+    portEXIT_CRITICAL(&lock);
+    return true;
+}
+
+/*
+ * @brief Whether a batch should go out now: enough fixes or an old enough one, and no backoff pending.
+ */
+bool Uplink::due(uint32_t nowMs) {
+    portENTER_CRITICAL(&lock);
+    bool ready = used >= UPLINK_BATCH_POINTS ||
+                 (used > 0 && nowMs - ring[head].queuedMs >= UPLINK_MAX_DELAY_MS);
+    portEXIT_CRITICAL(&lock);
+    return ready && (backoffMs == 0 || (int32_t)(nowMs - retryAtMs) >= 0);
+}
+
+/*
+ * @brief Pack the oldest queued fixes into one payload. They stay queued until published().
+ * @paramout out Payload text.
+ * @paramin max Size of out.
+ * @paramout lastSeq Sequence number of the last packed fix, for published().
+ * @return Number of fixes packed, 0 if the queue is empty.
+ */
+size_t Uplink::nextBatch(char* out, size_t max, uint32_t* lastSeq) {
+    TrackPoint_t points[UPLINK_BATCH_MAX_POINTS];
+    size_t count = 0;
+    uint32_t firstSeq;
+    portENTER_CRITICAL(&lock);
+    firstSeq = headSeq;
+    for (; count < used && count < UPLINK_BATCH_MAX_POINTS; ++count) {
+        points[count] = ring[(head + count) % UPLINK_QUEUE_DEPTH].point;
+    }
+    portEXIT_CRITICAL(&lock);
+    size_t packed = TrackFormatDecimal(points, count, out, max);
+    *lastSeq = firstSeq + (uint32_t)packed - 1;
+    return packed;
+}
+
+/*
+ * @brief The broker accepted a batch: drop its fixes and clear the backoff.
+ * @paramin lastSeq Sequence number from nextBatch().
+ * @paramin bytes Payload length.
+ */
+void Uplink::published(uint32_t lastSeq, size_t bytes) {
+    portENTER_CRITICAL(&lock);
+    /* Fixes dropped from a full queue meanwhile are already gone */
+    while (used > 0 && (int32_t)(lastSeq - headSeq) >= 0) {
+        head = (uint8_t)((head + 1) % UPLINK_QUEUE_DEPTH);
+        headSeq++;
+        used--;
+        stats.published++;
+    }
+    stats.batches++;
+    stats.payloadBytes += bytes;
+    portEXIT_CRITICAL(&lock);
+    backoffMs = 0;
+}
+
+/*
+ * @brief A connect or publish failed: wait before the next attempt, twice as long each time.
+ */
+void Uplink::failed(uint32_t nowMs) {
+    backoffMs = (backoffMs == 0) ? UPLINK_RETRY_MIN_MS : backoffMs * 2;
+    if (backoffMs > UPLINK_RETRY_MAX_MS) {
+        backoffMs = UPLINK_RETRY_MAX_MS;
+    }
+    retryAtMs = nowMs + backoffMs;
+    portENTER_CRITICAL(&lock);
+    stats.failures++;
+    portEXIT_CRITICAL(&lock);
+}
+
+bool Uplink::connected() const {
+    return session;
+}
+
+void Uplink::setConnected(bool up) {
+    if (up && !session) {
+        portENTER_CRITICAL(&lock);
+        stats.connects++;
+        portEXIT_CRITICAL(&lock);
+    }
+    session = up;
+}
+
+void Uplink::getStats(UplinkStats_t* out) {
+    portENTER_CRITICAL(&lock);
+    *out = stats;
+    portEXIT_CRITICAL(&lock);
+}
+
+/*
+ * @brief Print queue and delivery counters, and fixes per publish.
+ */
+void Uplink::printStats(Print& out) {
+    UplinkStats_t s;
+    getStats(&s);
+    uint32_t perBatch = s.batches ? s.published * 10 / s.batches : 0;
+    FixedPrintf(out, "Uplink: %s, %u queued, %u published, %u dropped\n", session ? "connected" : "disconnected",
+                (unsigned)s.queued, (unsigned)s.published, (unsigned)s.dropped);
+    FixedPrintf(out, "Uplink: %u publishes, %u.%u fixes and %u bytes each, %u sessions, %u failures\n",
+                (unsigned)s.batches, (unsigned)(perBatch / 10), (unsigned)(perBatch % 10),
+                (unsigned)(s.batches ? s.payloadBytes / s.batches : 0), (unsigned)s.connects,
+                (unsigned)s.failures);
+}
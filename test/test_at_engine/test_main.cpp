@@ -0,0 +1,192 @@
+#include <unity.h>
+#include <string.h>
+#include "atEngine.h"
+#include "simModem.h"
+
+#define EXCHANGE_TIMEOUT_MS  3000
+
+/* Runs the engine in the test's thread: start() and pump() are what the engine task loops over */
+class TestEngine : public AtEngine {
+public:
+    explicit TestEngine(Stream& stream) : AtEngine(stream, Serial) {}
+
+    AtResult run(AtRequest_t* req) {
+        start(req);
+        uint32_t startMs = millis();
+        while (req->result == AT_PENDING && millis() - startMs < EXCHANGE_TIMEOUT_MS) {
+            pump();
+            delay(1);
+        }
+        if (req->result == AT_PENDING) {
+            finish(AT_TIMEOUT);
+        }
+        return req->result;
+    }
+
+    void idle(uint32_t ms) {
+        uint32_t startMs = millis();
+        while (millis() - startMs < ms) {
+            pump();
+            delay(1);
+        }
+    }
+};
+
+struct UrcLog_t {
+    uint8_t count;
+    char last[64];
+};
+
+static void onUrc(const char* line, size_t len, void* ctx) {
+    UrcLog_t* log = static_cast<UrcLog_t*>(ctx);
+    size_t n = (len < sizeof(log->last) - 1) ? len : sizeof(log->last) - 1;
+    memcpy(log->last, line, n);
+    log->last[n] = '\0';
+    log->count++;
+}
+
+static SimModem* sim;
+static TestEngine* at;
+static AtRequest_t req;
+static UrcLog_t cmti;
+
+void setUp() {
+    sim = new SimModem(Serial);
+    at = new TestEngine(*sim);
+    memset(&cmti, 0, sizeof(cmti));
+    at->subscribe("+CMTI:", onUrc, &cmti);
+}
+
+void tearDown() {
+    delete at;
+    delete sim;
+}
+
+static void test_information_line_and_ok() {
+    AtEngine::prepare(&req, 1000, "+CSQ");
+    TEST_ASSERT_EQUAL(AT_OK, at->run(&req));
+    size_t len;
+    const char* csq = AtEngine::findLine(&req, "+CSQ:", &len);
+    TEST_ASSERT_NOT_NULL(csq);
+    TEST_ASSERT_EQUAL_STRING_LEN("20,99", csq, len);
+    TEST_ASSERT_GREATER_THAN(0, req.latencyUs);
+}
+
+static void test_error_kept_in_response() {
+    AtEngine::prepare(&req, 1000, "+CGNSCOLD");
+    TEST_ASSERT_EQUAL(AT_ERROR, at->run(&req));
+    TEST_ASSERT_EQUAL_STRING("ERROR", req.resp);
+}
+
+static void test_urc_while_idle() {
+    TEST_ASSERT_TRUE(sim->injectSms("+15550001", "LOC"));
+    at->idle(200);
+    TEST_ASSERT_EQUAL_UINT8(1, cmti.count);
+    TEST_ASSERT_EQUAL_STRING("+CMTI: \"SM\",1", cmti.last);
+}
+
+static void test_urc_during_command_not_in_response() {
+    /* The indication is on the wire before the +COPS? answer (200 ms) */
+    TEST_ASSERT_TRUE(sim->injectSms("+15550001", "LOC"));
+    AtEngine::prepare(&req, 1000, "+COPS?");
+    TEST_ASSERT_EQUAL(AT_OK, at->run(&req));
+    TEST_ASSERT_EQUAL_UINT8(1, cmti.count);
+    TEST_ASSERT_NULL(strstr(req.resp, "+CMTI"));
+    size_t len;
+    TEST_ASSERT_NOT_NULL(AtEngine::findLine(&req, "+COPS:", &len));
+}
+
+static void test_urc_matching_set_command() {
+    UrcLog_t cereg;
+    memset(&cereg, 0, sizeof(cereg));
+    at->subscribe("+CEREG:", onUrc, &cereg);
+    AtEngine::prepare(&req, 1000, "+CEREG=2");
+    TEST_ASSERT_EQUAL(AT_OK, at->run(&req));
+    /* The indication is on the wire before the next +CEREG=2 answer */
+    sim->setRegistration(5);
+    AtEngine::prepare(&req, 1000, "+CEREG=2");
+    TEST_ASSERT_EQUAL(AT_OK, at->run(&req));
+    TEST_ASSERT_EQUAL_UINT8(1, cereg.count);
+    TEST_ASSERT_EQUAL_STRING("+CEREG: 5,\"1A2B\",\"01A2B3C4\",7", cereg.last);
+    TEST_ASSERT_NULL(strstr(req.resp, "+CEREG"));
+    /* The read command's answer still belongs to the request */
+    AtEngine::prepare(&req, 1000, "+CEREG?");
+    TEST_ASSERT_EQUAL(AT_OK, at->run(&req));
+    TEST_ASSERT_EQUAL_UINT8(1, cereg.count);
+    size_t len;
+    TEST_ASSERT_NOT_NULL(AtEngine::findLine(&req, "+CEREG:", &len));
+}
+
+static void test_prompt_and_payload() {
+    static const char text[] = "Position 20.558853,-103.428903";
+    AtEngine::prepare(&req, 5000, "+CMGS=\"+15550001\"");
+    req.payload = (const uint8_t*)text;
+    req.payloadLen = strlen(text);
+    req.payloadCtrlZ = true;
+    sim->setLatency("+CMGS", 10);
+    TEST_ASSERT_EQUAL(AT_OK, at->run(&req));
+    size_t len;
+    TEST_ASSERT_NOT_NULL(AtEngine::findLine(&req, "+CMGS:", &len));
+}
+
+static void test_line_callback_streams_lines() {
+    TEST_ASSERT_TRUE(sim->injectSms("+15550001", "LOC"));
+    TEST_ASSERT_TRUE(sim->injectSms("+15550002", "TRACK"));
+    at->idle(200);
+    UrcLog_t lines;
+    memset(&lines, 0, sizeof(lines));
+    AtEngine::prepare(&req, 1000, "+CMGL=\"ALL\"");
+    req.onLine = onUrc;
+    req.ctx = &lines;
+    TEST_ASSERT_EQUAL(AT_OK, at->run(&req));
+    /* Header and body of each message */
+    TEST_ASSERT_EQUAL_UINT8(4, lines.count);
+    TEST_ASSERT_EQUAL_STRING("TRACK", lines.last);
+    TEST_ASSERT_EQUAL_size_t(0, req.respLen);
+}
+
+static void test_message_text_is_not_a_result_code() {
+    TEST_ASSERT_TRUE(sim->injectSms("+15550001", "OK"));
+    TEST_ASSERT_TRUE(sim->injectSms("+15550002", "AT+CFUN=0"));
+    TEST_ASSERT_TRUE(sim->injectSms("+15550003", "ERROR"));
+    at->idle(200);
+    UrcLog_t lines;
+    memset(&lines, 0, sizeof(lines));
+    AtEngine::prepare(&req, 1000, "+CMGL=\"ALL\"");
+    req.onLine = onUrc;
+    req.bodyPrefix = "+CMGL:";
+    req.ctx = &lines;
+    TEST_ASSERT_EQUAL(AT_OK, at->run(&req));
+    TEST_ASSERT_EQUAL_UINT8(6, lines.count);
+    TEST_ASSERT_EQUAL_STRING("ERROR", lines.last);
+
+    /* The engine is back to normal routing afterwards */
+    AtEngine::prepare(&req, 1000, "+CSQ");
+    TEST_ASSERT_EQUAL(AT_OK, at->run(&req));
+}
+
+static void test_stats_per_command() {
+    AtEngine::prepare(&req, 1000, "+CSQ");
+    at->run(&req);
+    AtEngine::prepare(&req, 1000, "+CGNSCOLD");
+    at->run(&req);
+    AtCommandStats_t totals;
+    at->getTotals(&totals);
+    TEST_ASSERT_EQUAL_UINT32(2, totals.latency.count);
+    TEST_ASSERT_EQUAL_UINT32(1, totals.errors);
+    TEST_ASSERT_EQUAL_UINT32(0, totals.timeouts);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_information_line_and_ok);
+    RUN_TEST(test_error_kept_in_response);
+    RUN_TEST(test_urc_while_idle);
+    RUN_TEST(test_urc_during_command_not_in_response);
+    RUN_TEST(test_urc_matching_set_command);
+    RUN_TEST(test_prompt_and_payload);
+    RUN_TEST(test_line_callback_streams_lines);
+    RUN_TEST(test_message_text_is_not_a_result_code);
+    RUN_TEST(test_stats_per_command);
+    return UNITY_END();
+}
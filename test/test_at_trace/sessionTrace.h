@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+
+/* Session of test_replay_session() captured on SimModem, dumped and converted with tools/at_trace.py */
+static const uint8_t atTraceData[] = {
+    0x41, 0x54, 0x52, 0x31, 0x83, 0x00, 0x41, 0x54, 0x0d, 0x0a, 0x04, 0xf5, 0xc2, 0x01, 0x0d, 0x0a,
+    0x4f, 0x4b, 0x0d, 0x00, 0xb2, 0x2a, 0x0a, 0x85, 0x20, 0x41, 0x54, 0x45, 0x30, 0x0d, 0x0a, 0x05,
+    0xd0, 0xd4, 0x01, 0x0d, 0x0a, 0x4f, 0x4b, 0x0d, 0x0a, 0x89, 0x89, 0x22, 0x41, 0x54, 0x2b, 0x43,
+    0x50, 0x49, 0x4e, 0x3f, 0x0d, 0x0a, 0x04, 0xdb, 0xed, 0x01, 0x0d, 0x0a, 0x2b, 0x43, 0x50, 0x04,
+    0xb9, 0x29, 0x49, 0x4e, 0x3a, 0x20, 0x52, 0x04, 0xe6, 0x29, 0x45, 0x41, 0x44, 0x59, 0x0d, 0x04,
+    0xdd, 0x29, 0x0a, 0x0d, 0x0a, 0x4f, 0x4b, 0x01, 0xdd, 0x29, 0x0d, 0x0a, 0x87, 0xcd, 0x08, 0x41,
+    0x54, 0x2b, 0x43, 0x53, 0x51, 0x0d, 0x0a, 0x04, 0x9a, 0xe1, 0x01, 0x0d, 0x0a, 0x2b, 0x43, 0x53,
+    0x05, 0xd1, 0x2c, 0x51, 0x3a, 0x20, 0x32, 0x30, 0x2c, 0x04, 0xed, 0x29, 0x39, 0x39, 0x0d, 0x0a,
+    0x0d, 0x04, 0xeb, 0x29, 0x0a, 0x4f, 0x4b, 0x0d, 0x0a, 0x89, 0x94, 0x22, 0x41, 0x54, 0x2b, 0x43,
+    0x4f, 0x50, 0x53, 0x3f, 0x0d, 0x0a, 0x04, 0xa4, 0xec, 0x0c, 0x0d, 0x0a, 0x2b, 0x43, 0x4f, 0x04,
+    0xa9, 0x2a, 0x50, 0x53, 0x3a, 0x20, 0x30, 0x04, 0xaa, 0x2a, 0x2c, 0x30, 0x2c, 0x22, 0x53, 0x04,
+    0x98, 0x2a, 0x49, 0x4d, 0x55, 0x4c, 0x41, 0x04, 0xb8, 0x2a, 0x54, 0x45, 0x44, 0x22, 0x2c, 0x04,
+    0xfa, 0x29, 0x37, 0x0d, 0x0a, 0x0d, 0x0a, 0x03, 0xd2, 0x27, 0x4f, 0x4b, 0x0d, 0x0a, 0x88, 0xef,
+    0x19, 0x41, 0x54, 0x2b, 0x43, 0x47, 0x53, 0x4e, 0x0d, 0x0a, 0x04, 0x89, 0xe8, 0x01, 0x0d, 0x0a,
+    0x38, 0x36, 0x39, 0x04, 0xe6, 0x29, 0x39, 0x35, 0x31, 0x30, 0x33, 0x04, 0xfe, 0x29, 0x30, 0x30,
+    0x37, 0x30, 0x37, 0x04, 0xb3, 0x2a, 0x30, 0x30, 0x0d, 0x0a, 0x0d, 0x04, 0x9c, 0x2a, 0x0a, 0x4f,
+    0x4b, 0x0d, 0x0a, 0x8a, 0xf4, 0x19, 0x41, 0x54, 0x2b, 0x43, 0x4d, 0x47, 0x46, 0x3d, 0x31, 0x0d,
+    0x0a, 0x04, 0xf1, 0xfb, 0x01, 0x0d, 0x0a, 0x4f, 0x4b, 0x0d, 0x00, 0xda, 0x29, 0x0a, 0x92, 0x0b,
+    0x41, 0x54, 0x2b, 0x43, 0x4e, 0x4d, 0x49, 0x3d, 0x32, 0x2c, 0x31, 0x2c, 0x30, 0x2c, 0x30, 0x2c,
+    0x30, 0x0d, 0x0a, 0x04, 0xcf, 0xbd, 0x02, 0x0d, 0x0a, 0x4f, 0x4b, 0x0d, 0x00, 0x89, 0x2a, 0x0a,
+    0x92, 0x28, 0x41, 0x54, 0x2b, 0x43, 0x47, 0x50, 0x49, 0x4f, 0x3d, 0x30, 0x2c, 0x34, 0x38, 0x2c,
+    0x31, 0x2c, 0x31, 0x0d, 0x0a, 0x04, 0xd8, 0xbd, 0x02, 0x0d, 0x0a, 0x4f, 0x4b, 0x0d, 0x00, 0xc8,
+    0x29, 0x0a, 0x8d, 0x0b, 0x41, 0x54, 0x2b, 0x43, 0x47, 0x4e, 0x53, 0x50, 0x57, 0x52, 0x3d, 0x31,
+    0x0d, 0x0a, 0x04, 0xa2, 0x94, 0x02, 0x0d, 0x0a, 0x4f, 0x4b, 0x0d, 0x00, 0x89, 0x2a, 0x0a, 0x8b,
+    0x0c, 0x41, 0x54, 0x2b, 0x43, 0x47, 0x4e, 0x53, 0x49, 0x4e, 0x46, 0x0d, 0x0a, 0x04, 0x83, 0xe9,
+    0x03, 0x0d, 0x0a, 0x2b, 0x43, 0x47, 0x04, 0x8a, 0x2a, 0x4e, 0x53, 0x49, 0x4e, 0x46, 0x04, 0x87,
+    0x2a, 0x3a, 0x20, 0x31, 0x2c, 0x30, 0x04, 0xed, 0x29, 0x2c, 0x2c, 0x2c, 0x2c, 0x2c, 0x04, 0xe3,
+    0x29, 0x2c, 0x2c, 0x30, 0x2c, 0x2c, 0x04, 0xfe, 0x29, 0x2c, 0x2c, 0x2c, 0x2c, 0x2c, 0x05, 0xf0,
+    0x29, 0x2c, 0x2c, 0x2c, 0x2c, 0x2c, 0x0d, 0x04, 0xea, 0x29, 0x0a, 0x0d, 0x0a, 0x4f, 0x4b, 0x01,
+    0x92, 0x2a, 0x0d, 0x0a, 0x8b, 0xee, 0x08, 0x41, 0x54, 0x2b, 0x43, 0x47, 0x4e, 0x53, 0x49, 0x4e,
+    0x46, 0x0d, 0x0a, 0x04, 0x81, 0xee, 0x03, 0x0d, 0x0a, 0x2b, 0x43, 0x47, 0x05, 0x88, 0x2a, 0x4e,
+    0x53, 0x49, 0x4e, 0x46, 0x3a, 0x04, 0xab, 0x2a, 0x20, 0x31, 0x2c, 0x30, 0x2c, 0x04, 0x9a, 0x2a,
+    0x2c, 0x2c, 0x2c, 0x2c, 0x2c, 0x04, 0xe6, 0x29, 0x2c, 0x30, 0x2c, 0x2c, 0x2c, 0x04, 0xfb, 0x29,
+    0x2c, 0x2c, 0x2c, 0x2c, 0x2c, 0x05, 0xf4, 0x2a, 0x2c, 0x2c, 0x2c, 0x2c, 0x0d, 0x0a, 0x04, 0xc1,
+    0x2d, 0x0d, 0x0a, 0x4f, 0x4b, 0x0d, 0x00, 0xd5, 0x29, 0x0a, 0x8b, 0x2b, 0x41, 0x54, 0x2b, 0x43,
+    0x47, 0x4e, 0x53, 0x49, 0x4e, 0x46, 0x0d, 0x0a, 0x04, 0xde, 0xe8, 0x03, 0x0d, 0x0a, 0x2b, 0x43,
+    0x47, 0x04, 0x97, 0x2a, 0x4e, 0x53, 0x49, 0x4e, 0x46, 0x04, 0xea, 0x29, 0x3a, 0x20, 0x31, 0x2c,
+    0x30, 0x04, 0xd8, 0x29, 0x2c, 0x2c, 0x2c, 0x2c, 0x2c, 0x04, 0x98, 0x2a, 0x2c, 0x2c, 0x30, 0x2c,
+    0x2c, 0x05, 0x90, 0x2a, 0x2c, 0x2c, 0x2c, 0x2c, 0x2c, 0x2c, 0x04, 0x90, 0x2b, 0x2c, 0x2c, 0x2c,
+    0x2c, 0x0d, 0x04, 0xb6, 0x2b, 0x0a, 0x0d, 0x0a, 0x4f, 0x4b, 0x01, 0xda, 0x29, 0x0d, 0x0a, 0x83,
+    0xe3, 0x08, 0x41, 0x54, 0x0d, 0x0a,
+};
@@ -0,0 +1,213 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "atEngine.h"
+#include "atTrace.h"
+#include "fixLog.h"
+#include "modemMgr.h"
+#include "simModem.h"
+#include "trackExport.h"
+#include "sessionTrace.h"
+
+#define TEST_FINAL_TIMEOUT_MS  200
+#define TEST_COPS_MS           200
+
+/* Keeps what dump() writes, with a log line from another task in between */
+class DumpCapture : public Print {
+public:
+    DumpCapture() : len(0) {}
+
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+
+    size_t write(const uint8_t* data, size_t n) override {
+        if (len + n > sizeof(buf)) {
+            return 0;
+        }
+        memcpy(buf + len, data, n);
+        len += n;
+        return n;
+    }
+    using Print::write;
+
+    uint8_t buf[4096];
+    size_t len;
+};
+
+/* Blocking AT exchanges run the engine in the test's thread while they wait */
+static void pumpEngine(void* ctx) {
+    static_cast<AtEngine*>(ctx)->service(0);
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return (uint32_t)get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+/* The session the fixture was captured from */
+static void runSession(ModemMgr* modem) {
+    char text[32];
+    GnssRecord_t rec;
+    TEST_ASSERT_TRUE(modem->test());
+    TEST_ASSERT_TRUE(modem->isSimReady());
+    TEST_ASSERT_GREATER_THAN(0, modem->simGetSignalQuality());
+    TEST_ASSERT_TRUE(modem->simGetOperator(text, sizeof(text)));
+    TEST_ASSERT_TRUE(modem->simGetImei(text, sizeof(text)));
+    TEST_ASSERT_TRUE(modem->simEnableNewMessageIndication());
+    modem->GpsEnable();
+    for (int i = 0; i < 3; ++i) {
+        TEST_ASSERT_TRUE(modem->GpsGetRecord(&rec));
+    }
+}
+
+static const AtReplayCommandStats_t* findCommand(const AtReplayStats_t* s, const char* name) {
+    for (uint8_t i = 0; i < s->commandCount; ++i) {
+        if (strcmp(s->commands[i].name, name) == 0) {
+            return &s->commands[i];
+        }
+    }
+    return NULL;
+}
+
+/* Replay the fixture through AtEngine and ModemMgr as a MODEM_TRACE_REPLAY build does */
+static void replaySession(bool realtime, AtReplayStats_t* s) {
+    AtTraceReplay* replay = new AtTraceReplay(atTraceData, sizeof(atTraceData), realtime);
+    AtEngine* at = new AtEngine(*replay, Serial);
+    ModemMgr* modem = new ModemMgr(*at, NULL, Serial, 4, MODEM_PIN_DTR);
+    TEST_ASSERT_TRUE(at->begin());
+    hostSetBlockHook(pumpEngine, at);
+    runSession(modem);
+
+    /* The capture ends at the last closed record: the host's final AT, its answer still coming in */
+    TEST_ASSERT_FALSE(replay->finished());
+    AtRequest_t req;
+    TEST_ASSERT_EQUAL(AT_TIMEOUT, at->command(&req, TEST_FINAL_TIMEOUT_MS, "%s", ""));
+    hostSetBlockHook(NULL, NULL);
+    replay->getStats(s);
+    replay->printReport(Serial);
+    delete modem;
+    delete at;
+    delete replay;
+}
+
+void setUp() {}
+
+void tearDown() {
+    hostSetBlockHook(NULL, NULL);
+}
+
+static void test_dump_frames() {
+    SimModem* sim = new SimModem(Serial);
+    AtTraceStream* traced = new AtTraceStream(*sim);
+    AtEngine* at = new AtEngine(*traced, Serial);
+    ModemMgr* modem = new ModemMgr(*at, sim, Serial, 4, MODEM_PIN_DTR);
+    TEST_ASSERT_TRUE(at->begin());
+    hostSetBlockHook(pumpEngine, at);
+    runSession(modem);
+    hostSetBlockHook(NULL, NULL);
+
+    DumpCapture* cap = new DumpCapture();
+    cap->print("GPS: no fix\n");
+    traced->dump(*cap);
+    TEST_ASSERT_TRUE(cap->len < sizeof(cap->buf));
+    cap->buf[cap->len] = '\0';
+
+    /* Chunks numbered with their offset, in order, then the end frame with the total */
+    const char* marker = strstr((const char*)cap->buf, "AT-TRACE ");
+    TEST_ASSERT_NOT_NULL(marker);
+    TEST_ASSERT_EQUAL_UINT32(traced->size(), strtoul(marker + 9, NULL, 10));
+    const uint8_t* p = (const uint8_t*)strchr(marker, '\n') + 1;
+    const uint8_t* end = cap->buf + cap->len;
+    uint32_t offset = 0;
+    uint32_t frames = 0;
+    while (true) {
+        const uint8_t* header = p;
+        TEST_ASSERT_TRUE(header + EXPORT_HEADER_LEN + EXPORT_TRAILER_LEN <= end);
+        TEST_ASSERT_EQUAL_HEX8(EXPORT_SYNC0, header[0]);
+        TEST_ASSERT_EQUAL_HEX8(EXPORT_SYNC1, header[1]);
+        TEST_ASSERT_EQUAL_HEX16(Crc16(header + 2, 9), get16(header + 11));
+        uint16_t len = get16(header + 7);
+        const uint8_t* payload = header + EXPORT_HEADER_LEN;
+        TEST_ASSERT_TRUE(payload + len + EXPORT_TRAILER_LEN <= end);
+        TEST_ASSERT_EQUAL_HEX16(Crc16(payload, len), get16(payload + len));
+        TEST_ASSERT_EQUAL_UINT32(offset, get32(header + 3));
+        p = payload + len + EXPORT_TRAILER_LEN;
+        if (header[2] == EXPORT_TYPE_END) {
+            TEST_ASSERT_EQUAL_UINT16(0, len);
+            TEST_ASSERT_EQUAL_UINT16(traced->overflowed() ? 1 : 0, get16(header + 9));
+            break;
+        }
+        TEST_ASSERT_EQUAL_HEX8(AT_TRACE_FRAME_DATA, header[2]);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(AT_TRACE_DUMP_CHUNK, len);
+        if (offset == 0) {
+            TEST_ASSERT_EQUAL_MEMORY(AT_TRACE_MAGIC, payload, AT_TRACE_MAGIC_LEN);
+        }
+        offset += len;
+        frames++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(traced->size(), offset);
+    TEST_ASSERT_EQUAL_UINT32((traced->size() + AT_TRACE_DUMP_CHUNK - 1) / AT_TRACE_DUMP_CHUNK, frames);
+    TEST_ASSERT_NOT_NULL(strstr((const char*)p, "AT-TRACE END\n"));
+
+    delete cap;
+    delete modem;
+    delete at;
+    delete traced;
+    delete sim;
+}
+
+static void test_replay_session() {
+    AtReplayStats_t s;
+    replaySession(true, &s);
+
+    /* Every host byte as captured, every modem byte handed out */
+    TEST_ASSERT_TRUE(s.finished);
+    TEST_ASSERT_EQUAL_UINT32(0, s.divergences);
+    TEST_ASSERT_EQUAL_UINT32(150, s.bytesToModem);
+    TEST_ASSERT_EQUAL_UINT32(267, s.bytesFromModem);
+
+    /* One entry per command, the unanswered final AT not counted */
+    TEST_ASSERT_EQUAL_UINT8(11, s.commandCount);
+    const AtReplayCommandStats_t* cmd = findCommand(&s, "");
+    TEST_ASSERT_NOT_NULL(cmd);
+    TEST_ASSERT_EQUAL_UINT32(1, cmd->count);
+    cmd = findCommand(&s, "+CGNSINF");
+    TEST_ASSERT_NOT_NULL(cmd);
+    TEST_ASSERT_EQUAL_UINT32(3, cmd->count);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(cmd->maxUs, cmd->totalUs / cmd->count);
+
+    /* Real time: the operator query waits out the modem's latency as captured */
+    cmd = findCommand(&s, "+COPS");
+    TEST_ASSERT_NOT_NULL(cmd);
+    TEST_ASSERT_EQUAL_UINT32(1, cmd->count);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(TEST_COPS_MS * 1000UL, cmd->maxUs);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(s.traceUs, s.elapsedUs);
+}
+
+static void test_replay_as_fast_as_possible() {
+    AtReplayStats_t s;
+    replaySession(false, &s);
+    TEST_ASSERT_TRUE(s.finished);
+    TEST_ASSERT_EQUAL_UINT32(0, s.divergences);
+
+    /* Only the host side left in each exchange: the session runs in less than the capture took */
+    const AtReplayCommandStats_t* cmd = findCommand(&s, "+COPS");
+    TEST_ASSERT_NOT_NULL(cmd);
+    printf("AT replay: +COPS %lu us, session %lu ms (trace %lu ms)\n", (unsigned long)cmd->maxUs,
+           (unsigned long)(s.elapsedUs / 1000), (unsigned long)(s.traceUs / 1000));
+    TEST_ASSERT_LESS_THAN_UINT32(TEST_COPS_MS * 1000UL, cmd->maxUs);
+    TEST_ASSERT_LESS_THAN_UINT32(s.traceUs, s.elapsedUs);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_dump_frames);
+    RUN_TEST(test_replay_session);
+    RUN_TEST(test_replay_as_fast_as_possible);
+    return UNITY_END();
+}
@@ -0,0 +1,278 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "fixLog.h"
+
+#define TEST_LOG_PATH    "test_fix_log.bin"
+#define TEST_LOG_BLOCKS  4
+
+/* Runs the writer in the test's thread: the log task loops over the same steps */
+class TestFixLog : public FixLog {
+public:
+    explicit TestFixLog(BlockDevice& dev) : FixLog(dev) {}
+
+    /* Take every queued fix, as run() does between waits */
+    void drain() {
+        FixLogRecord_t rec;
+        while (xQueueReceive(queue, &rec, 0) == pdTRUE) {
+            if (rec.utc == 0) {
+                flushSegment();
+            } else {
+                addRecord(rec);
+            }
+        }
+    }
+};
+
+static FileBlockDevice* dev;
+static TestFixLog* fixLog;
+
+static GnssRecord_t fixAt(uint32_t i) {
+    GnssRecord_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.runStatus = true;
+    rec.fixValid = true;
+    rec.year = 2024;
+    rec.month = 3;
+    rec.day = 15;
+    rec.hour = 10 + i / 3600;
+    rec.minute = i / 60 % 60;
+    rec.second = i % 60;
+    rec.latE6 = 20558853 + (int32_t)i;
+    rec.lonE6 = -103428903;
+    rec.hdopX100 = 90;
+    rec.satsUsed = 7;
+    return rec;
+}
+
+/* Log fixes first..first+count-1 */
+static void logFixes(uint32_t first, uint32_t count) {
+    for (uint32_t i = first; i < first + count; ++i) {
+        GnssRecord_t rec = fixAt(i);
+        TEST_ASSERT_TRUE(fixLog->append(rec));
+        fixLog->drain();
+    }
+}
+
+/* Power cycle: a fresh log recovers from what the device holds */
+static void restart() {
+    delete fixLog;
+    delete dev;
+    dev = new FileBlockDevice(TEST_LOG_PATH, FIX_LOG_BLOCK_LEN, TEST_LOG_BLOCKS);
+    fixLog = new TestFixLog(*dev);
+    TEST_ASSERT_TRUE(fixLog->begin());
+}
+
+/* Overwrite bytes of the file, as a write torn by power loss leaves them */
+static void corrupt(long offset, uint8_t value) {
+    FILE* f = fopen(TEST_LOG_PATH, "r+b");
+    TEST_ASSERT_NOT_NULL(f);
+    fseek(f, offset, SEEK_SET);
+    fputc(value, f);
+    fclose(f);
+}
+
+static long recordOffset(uint32_t block, uint32_t record) {
+    return (long)(block * FIX_LOG_BLOCK_LEN + FIX_LOG_HEADER_LEN + record * FIX_LOG_FRAME_LEN);
+}
+
+static uint32_t recordUtc(const uint8_t* block, uint16_t record) {
+    FixLogRecord_t r;
+    memcpy(&r, block + FIX_LOG_HEADER_LEN + record * FIX_LOG_FRAME_LEN + 2, sizeof(r));
+    return r.utc;
+}
+
+void setUp() {
+    remove(TEST_LOG_PATH);
+    dev = NULL;
+    fixLog = NULL;
+    restart();
+}
+
+void tearDown() {
+    delete fixLog;
+    delete dev;
+    remove(TEST_LOG_PATH);
+}
+
+static void test_recovered_after_restart() {
+    logFixes(0, FIX_LOG_RECORDS_PER_BLOCK + 3);
+    fixLog->requestFlush();
+    fixLog->drain();
+    restart();
+
+    FixLogStats_t s;
+    fixLog->getStats(&s);
+    TEST_ASSERT_EQUAL_UINT32(3, s.recovered);
+    uint32_t oldest, newest;
+    TEST_ASSERT_TRUE(fixLog->seqRange(&oldest, &newest));
+    TEST_ASSERT_EQUAL_UINT32(1, oldest);
+    TEST_ASSERT_EQUAL_UINT32(2, newest);
+
+    /* The open segment is filled on, not rewritten */
+    logFixes(100, 1);
+    fixLog->requestFlush();
+    fixLog->drain();
+    uint8_t block[FIX_LOG_BLOCK_LEN];
+    uint16_t records;
+    TEST_ASSERT_TRUE(fixLog->readSegment(2, block, &records));
+    TEST_ASSERT_EQUAL_UINT16(4, records);
+    GnssRecord_t first = fixAt(FIX_LOG_RECORDS_PER_BLOCK);
+    GnssRecord_t added = fixAt(100);
+    uint32_t utc;
+    TEST_ASSERT_TRUE(GnssRecordUnixTime(&first, &utc));
+    TEST_ASSERT_EQUAL_UINT32(utc, recordUtc(block, 0));
+    TEST_ASSERT_TRUE(GnssRecordUnixTime(&added, &utc));
+    TEST_ASSERT_EQUAL_UINT32(utc, recordUtc(block, 3));
+}
+
+static void test_torn_record_cut_at_first_bad_frame() {
+    logFixes(0, 5);
+    fixLog->requestFlush();
+    fixLog->drain();
+    /* A flipped bit in the third record's payload */
+    corrupt(recordOffset(0, 2) + 6, 0x5A);
+    restart();
+
+    FixLogStats_t s;
+    fixLog->getStats(&s);
+    TEST_ASSERT_EQUAL_UINT32(2, s.recovered);
+
+    /* The next record lands where the torn one was; nothing after it survives */
+    logFixes(200, 1);
+    fixLog->requestFlush();
+    fixLog->drain();
+    uint8_t block[FIX_LOG_BLOCK_LEN];
+    uint16_t records;
+    TEST_ASSERT_TRUE(fixLog->readSegment(1, block, &records));
+    TEST_ASSERT_EQUAL_UINT16(3, records);
+    GnssRecord_t added = fixAt(200);
+    uint32_t utc;
+    TEST_ASSERT_TRUE(GnssRecordUnixTime(&added, &utc));
+    TEST_ASSERT_EQUAL_UINT32(utc, recordUtc(block, 2));
+}
+
+static void test_truncated_file_recovered() {
+    logFixes(0, FIX_LOG_RECORDS_PER_BLOCK + 4);
+    fixLog->requestFlush();
+    fixLog->drain();
+    /* The last write stopped halfway through the second record of segment 2 */
+    TEST_ASSERT_EQUAL_INT(0, truncate(TEST_LOG_PATH, recordOffset(1, 1) + FIX_LOG_FRAME_LEN / 2));
+    restart();
+
+    FixLogStats_t s;
+    fixLog->getStats(&s);
+    TEST_ASSERT_EQUAL_UINT32(1, s.recovered);
+    uint8_t block[FIX_LOG_BLOCK_LEN];
+    uint16_t records;
+    TEST_ASSERT_TRUE(fixLog->readSegment(1, block, &records));
+    TEST_ASSERT_EQUAL_UINT16(FIX_LOG_RECORDS_PER_BLOCK, records);
+}
+
+static void test_torn_header_falls_back_to_previous_segment() {
+    logFixes(0, FIX_LOG_RECORDS_PER_BLOCK + 2);
+    fixLog->requestFlush();
+    fixLog->drain();
+    /* Sequence number of segment 2 */
+    corrupt((long)FIX_LOG_BLOCK_LEN + 4, 0xFF);
+    restart();
+
+    /* Segment 1 was full: segment 2 is started again in its block */
+    uint32_t oldest, newest;
+    TEST_ASSERT_TRUE(fixLog->seqRange(&oldest, &newest));
+    TEST_ASSERT_EQUAL_UINT32(2, newest);
+    uint8_t block[FIX_LOG_BLOCK_LEN];
+    uint16_t records;
+    TEST_ASSERT_FALSE(fixLog->readSegment(2, block, &records));
+    logFixes(300, 1);
+    fixLog->requestFlush();
+    fixLog->drain();
+    TEST_ASSERT_TRUE(fixLog->readSegment(2, block, &records));
+    TEST_ASSERT_EQUAL_UINT16(1, records);
+    TEST_ASSERT_TRUE(fixLog->readSegment(1, block, &records));
+    TEST_ASSERT_EQUAL_UINT16(FIX_LOG_RECORDS_PER_BLOCK, records);
+}
+
+static void test_wrap_around() {
+    /* Six full segments on a four-block device */
+    logFixes(0, 6 * FIX_LOG_RECORDS_PER_BLOCK);
+    uint32_t oldest, newest;
+    TEST_ASSERT_TRUE(fixLog->seqRange(&oldest, &newest));
+    TEST_ASSERT_EQUAL_UINT32(7, newest);
+    TEST_ASSERT_EQUAL_UINT32(7 - TEST_LOG_BLOCKS + 1, oldest);
+
+    uint8_t block[FIX_LOG_BLOCK_LEN];
+    uint16_t records;
+    TEST_ASSERT_FALSE(fixLog->readSegment(oldest - 1, block, &records));
+    for (uint32_t seq = oldest; seq < newest; ++seq) {
+        TEST_ASSERT_TRUE(fixLog->readSegment(seq, block, &records));
+        TEST_ASSERT_EQUAL_UINT16(FIX_LOG_RECORDS_PER_BLOCK, records);
+        GnssRecord_t first = fixAt((seq - 1) * FIX_LOG_RECORDS_PER_BLOCK);
+        uint32_t utc;
+        TEST_ASSERT_TRUE(GnssRecordUnixTime(&first, &utc));
+        TEST_ASSERT_EQUAL_UINT32(utc, recordUtc(block, 0));
+    }
+    /* The open segment is empty and its block still holds segment 3 */
+    TEST_ASSERT_FALSE(fixLog->readSegment(newest, block, &records));
+    TEST_ASSERT_FALSE(fixLog->readSegment(newest + 1, block, &records));
+
+    /* Recovery across the wrap picks the highest sequence, not the highest block */
+    restart();
+    TEST_ASSERT_TRUE(fixLog->seqRange(&oldest, &newest));
+    TEST_ASSERT_EQUAL_UINT32(7, newest);
+    logFixes(1000, 1);
+    fixLog->requestFlush();
+    fixLog->drain();
+    TEST_ASSERT_TRUE(fixLog->readSegment(7, block, &records));
+    TEST_ASSERT_EQUAL_UINT16(1, records);
+    TEST_ASSERT_FALSE(fixLog->readSegment(3, block, &records));
+    TEST_ASSERT_TRUE(fixLog->readSegment(4, block, &records));
+}
+
+static void test_write_amplification_and_flushes() {
+    /* Batched: one block write per full segment */
+    logFixes(0, 2 * FIX_LOG_RECORDS_PER_BLOCK);
+    FixLogStats_t s;
+    fixLog->getStats(&s);
+    TEST_ASSERT_EQUAL_UINT32(2 * FIX_LOG_RECORDS_PER_BLOCK, s.logged);
+    TEST_ASSERT_EQUAL_UINT32(2, s.flushes);
+    TEST_ASSERT_EQUAL_UINT32(2 * FIX_LOG_RECORDS_PER_BLOCK * sizeof(FixLogRecord_t), s.payloadBytes);
+    TEST_ASSERT_EQUAL_UINT32(2 * FIX_LOG_BLOCK_LEN, s.deviceBytes);
+    uint32_t batchedAmp = s.deviceBytes * 100 / s.payloadBytes;
+
+    /* Flushed after every fix: the open segment is rewritten each time */
+    restart();
+    logFixes(500, 1);
+    for (uint32_t i = 1; i < FIX_LOG_RECORDS_PER_BLOCK; ++i) {
+        fixLog->requestFlush();
+        logFixes(500 + i, 1);
+    }
+    fixLog->getStats(&s);
+    TEST_ASSERT_EQUAL_UINT32(FIX_LOG_RECORDS_PER_BLOCK, s.flushes);
+    TEST_ASSERT_EQUAL_UINT32(FIX_LOG_RECORDS_PER_BLOCK * FIX_LOG_BLOCK_LEN, s.deviceBytes);
+    uint32_t eagerAmp = s.deviceBytes * 100 / s.payloadBytes;
+    printf("Fix log write amplification: %u.%02u batched, %u.%02u flushed per fix, flush avg %u us max %u us\n",
+           (unsigned)(batchedAmp / 100), (unsigned)(batchedAmp % 100), (unsigned)(eagerAmp / 100),
+           (unsigned)(eagerAmp % 100), (unsigned)(s.flushTotalUs / s.flushes), (unsigned)s.flushMaxUs);
+    TEST_ASSERT_EQUAL_UINT32(0, s.errors);
+    TEST_ASSERT_LESS_THAN_UINT32(eagerAmp, batchedAmp);
+
+    /* An empty flush request writes nothing */
+    fixLog->requestFlush();
+    fixLog->drain();
+    FixLogStats_t after;
+    fixLog->getStats(&after);
+    TEST_ASSERT_EQUAL_UINT32(s.flushes, after.flushes);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_recovered_after_restart);
+    RUN_TEST(test_torn_record_cut_at_first_bad_frame);
+    RUN_TEST(test_truncated_file_recovered);
+    RUN_TEST(test_torn_header_falls_back_to_previous_segment);
+    RUN_TEST(test_wrap_around);
+    RUN_TEST(test_write_amplification_and_flushes);
+    return UNITY_END();
+}
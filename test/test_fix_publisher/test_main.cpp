@@ -0,0 +1,95 @@
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include "fixPublisher.h"
+
+#define PUBLISHES  200000
+
+/* Every field derives from n, so a torn copy shows as a mismatch */
+static void makeSample(uint32_t n, GnssSample_t* sample) {
+    memset(sample, 0, sizeof(*sample));
+    sample->valid = true;
+    sample->timestampMs = n;
+    sample->record.fixValid = true;
+    sample->record.latE6 = (int32_t)n;
+    sample->record.lonE6 = -(int32_t)n;
+    sample->record.altitudeCm = (int32_t)(n * 3);
+    sample->record.speedKmhX100 = (uint16_t)n;
+    sample->record.satsUsed = (uint8_t)n;
+}
+
+static bool consistent(const GnssSample_t& s) {
+    uint32_t n = s.timestampMs;
+    return s.valid && s.record.fixValid && s.record.latE6 == (int32_t)n && s.record.lonE6 == -(int32_t)n &&
+           s.record.altitudeCm == (int32_t)(n * 3) && s.record.speedKmhX100 == (uint16_t)n &&
+           s.record.satsUsed == (uint8_t)n;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+static void test_empty_until_first_publish() {
+    FixPublisher pub;
+    FixSnapshot_t snap;
+    TEST_ASSERT_FALSE(pub.read(&snap));
+    TEST_ASSERT_EQUAL_UINT32(0, pub.sequence());
+
+    GnssSample_t sample;
+    makeSample(7, &sample);
+    pub.publish(sample);
+    TEST_ASSERT_TRUE(pub.read(&snap));
+    TEST_ASSERT_EQUAL_UINT32(1, snap.sequence);
+    TEST_ASSERT_EQUAL_UINT32(1, pub.sequence());
+    TEST_ASSERT_TRUE(consistent(snap.sample));
+    TEST_ASSERT_EQUAL_INT32(7, snap.sample.record.latE6);
+}
+
+static void test_concurrent_reads_never_torn() {
+    static FixPublisher pub;
+    std::atomic<bool> done(false);
+    std::atomic<bool> seen(false);
+    std::thread writer([&]() {
+        GnssSample_t sample;
+        for (uint32_t n = 1; n <= PUBLISHES; ++n) {
+            makeSample(n, &sample);
+            pub.publish(sample);
+            /* Keep publishing only once the reader is running, or it may see nothing */
+            while (n == 1 && !seen.load()) {
+                std::this_thread::yield();
+            }
+        }
+        done.store(true);
+    });
+
+    uint32_t reads = 0;
+    uint32_t torn = 0;
+    uint32_t lastSeq = 0;
+    bool ordered = true;
+    while (!done.load()) {
+        FixSnapshot_t snap;
+        if (!pub.read(&snap)) {
+            continue;
+        }
+        reads++;
+        seen.store(true);
+        if (!consistent(snap.sample) || snap.sample.timestampMs != snap.sequence) {
+            torn++;
+        }
+        ordered = ordered && snap.sequence >= lastSeq;
+        lastSeq = snap.sequence;
+    }
+    writer.join();
+
+    TEST_ASSERT_GREATER_THAN(0, reads);
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_EQUAL_UINT32(PUBLISHES, pub.sequence());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_until_first_publish);
+    RUN_TEST(test_concurrent_reads_never_torn);
+    return UNITY_END();
+}
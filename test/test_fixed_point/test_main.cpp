@@ -0,0 +1,50 @@
+#include <unity.h>
+#include <math.h>
+#include "fixedPoint.h"
+
+void setUp() {}
+
+void tearDown() {}
+
+static void test_sine() {
+    for (int32_t deg = -36000; deg <= 36000; deg += 125) {
+        double want = sin(deg / 100.0 * M_PI / 180.0) * 32768.0;
+        TEST_ASSERT_INT_WITHIN(8, (int32_t)lround(want), FixedSinX100(deg));
+    }
+}
+
+static void test_isqrt() {
+    TEST_ASSERT_EQUAL_UINT32(0, FixedIsqrt64(0));
+    TEST_ASSERT_EQUAL_UINT32(3, FixedIsqrt64(15));
+    TEST_ASSERT_EQUAL_UINT32(4, FixedIsqrt64(16));
+    TEST_ASSERT_EQUAL_UINT32(4294967295UL, FixedIsqrt64(0xFFFFFFFFFFFFFFFFULL));
+    TEST_ASSERT_EQUAL_UINT32(1000000007UL, FixedIsqrt64(1000000007ULL * 1000000007ULL));
+}
+
+static void test_lon_scale() {
+    TEST_ASSERT_UINT32_WITHIN(1, 32767, FixedLonScaleQ15(0));
+    TEST_ASSERT_UINT32_WITHIN(2, (uint32_t)lround(cos(20.558853 * M_PI / 180.0) * 32768.0),
+                              FixedLonScaleQ15(20558853));
+    TEST_ASSERT_EQUAL_UINT32(FixedLonScaleQ15(45000000), FixedLonScaleQ15(-45000000));
+    /* Held off zero at the poles */
+    TEST_ASSERT_EQUAL_UINT32(FIXED_LON_SCALE_MIN_Q15, FixedLonScaleQ15(90000000));
+    TEST_ASSERT_EQUAL_UINT32(FIXED_LON_SCALE_MIN_Q15, FixedLonScaleQ15(-89990000));
+}
+
+static void test_distance() {
+    /* 0.001 degree of latitude is 111.195 m anywhere */
+    TEST_ASSERT_UINT32_WITHIN(1, 11119, FixedDistanceCm(20558853, -103428903, 20559853, -103428903));
+    /* 0.001 degree of longitude shrinks with cos(latitude) */
+    TEST_ASSERT_UINT32_WITHIN(20, (uint32_t)lround(11119.5 * cos(20.558853 * M_PI / 180.0)),
+                              FixedDistanceCm(20558853, -103428903, 20558853, -103427903));
+    TEST_ASSERT_EQUAL_UINT32(FixedDistanceCm(0, 0, 300, 400), FixedDistanceCm(300, 400, 0, 0));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_sine);
+    RUN_TEST(test_isqrt);
+    RUN_TEST(test_lon_scale);
+    RUN_TEST(test_distance);
+    return UNITY_END();
+}
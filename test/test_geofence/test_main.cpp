@@ -0,0 +1,196 @@
+#include <unity.h>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <Preferences.h>
+#include "geofence.h"
+#include "fixedPoint.h"
+
+#define BASE_LAT  20558853
+#define BASE_LON  -103428903
+
+#define BENCH_POINTS  5000
+
+static Geofence* fence;
+static GeofenceEvent_t events[4];
+
+/* Offsets in metres to degrees * 1e6 at a latitude, as a float reference */
+static int32_t northE6(double m) {
+    return (int32_t)lround(m * 1e6 / FIXED_M_PER_DEG_LAT);
+}
+
+static int32_t eastE6(int32_t latE6, double m) {
+    return (int32_t)lround(m * 1e6 / FIXED_M_PER_DEG_LAT / cos(latE6 * 1e-6 * M_PI / 180.0));
+}
+
+/* Fixes needed to settle a point: the first sets the state, the rest confirm a change */
+static size_t settle(int32_t latE6, int32_t lonE6) {
+    size_t n = 0;
+    for (int i = 0; i < GEOFENCE_CONFIRM_FIXES; ++i) {
+        n += fence->evaluate(latE6, lonE6, events + n, 4 - n);
+    }
+    return n;
+}
+
+void setUp() {
+    Preferences::wipe();
+    fence = new Geofence();
+    fence->begin();
+}
+
+void tearDown() {
+    delete fence;
+}
+
+static void test_circle_edge_at_equator_and_north() {
+    static const int32_t lats[] = { BASE_LAT, 60000000 };
+    for (size_t k = 0; k < sizeof(lats) / sizeof(lats[0]); ++k) {
+        delete fence;
+        Preferences::wipe();
+        fence = new Geofence();
+        fence->begin();
+        int32_t lat = lats[k];
+        TEST_ASSERT_TRUE(fence->addCircle("home", lat, BASE_LON, 500));
+        /* First fix far away: outside, no event */
+        TEST_ASSERT_EQUAL_size_t(0, fence->evaluate(lat + northE6(5000), BASE_LON, events, 4));
+        /* 510 m east is outside, 490 m east inside, whatever the latitude */
+        TEST_ASSERT_EQUAL_size_t(0, settle(lat, BASE_LON + eastE6(lat, 510)));
+        TEST_ASSERT_EQUAL_size_t(1, settle(lat, BASE_LON + eastE6(lat, 490)));
+        TEST_ASSERT_TRUE(events[0].entered);
+        TEST_ASSERT_EQUAL_STRING("home", events[0].name);
+    }
+}
+
+static void test_hysteresis_and_confirmation() {
+    TEST_ASSERT_TRUE(fence->addCircle("yard", BASE_LAT, BASE_LON, 100));
+    TEST_ASSERT_EQUAL_size_t(0, fence->evaluate(BASE_LAT, BASE_LON, events, 4));
+    /* Within the margin outside the edge: still inside */
+    TEST_ASSERT_EQUAL_size_t(0, settle(BASE_LAT + northE6(110), BASE_LON));
+    /* One stray fix outside is not enough */
+    TEST_ASSERT_EQUAL_size_t(0, fence->evaluate(BASE_LAT + northE6(200), BASE_LON, events, 4));
+    TEST_ASSERT_EQUAL_size_t(0, fence->evaluate(BASE_LAT, BASE_LON, events, 4));
+    TEST_ASSERT_EQUAL_size_t(1, settle(BASE_LAT + northE6(200), BASE_LON));
+    TEST_ASSERT_FALSE(events[0].entered);
+}
+
+static void test_concave_polygon() {
+    /* L shape: 1 km square with its north-east quarter cut out */
+    const double m[6][2] = { { 0, 0 }, { 1000, 0 }, { 1000, 500 }, { 500, 500 }, { 500, 1000 }, { 0, 1000 } };
+    int32_t latE6[6], lonE6[6];
+    for (int i = 0; i < 6; ++i) {
+        latE6[i] = BASE_LAT + northE6(m[i][1]);
+        lonE6[i] = BASE_LON + eastE6(BASE_LAT, m[i][0]);
+    }
+    TEST_ASSERT_TRUE(fence->addPolygon("farm", latE6, lonE6, 6));
+    TEST_ASSERT_EQUAL_size_t(0, fence->evaluate(BASE_LAT - northE6(2000), BASE_LON, events, 4));
+    /* In the cut-out corner: outside */
+    TEST_ASSERT_EQUAL_size_t(0, settle(BASE_LAT + northE6(750), BASE_LON + eastE6(BASE_LAT, 750)));
+    /* In the south-east arm */
+    TEST_ASSERT_EQUAL_size_t(1, settle(BASE_LAT + northE6(250), BASE_LON + eastE6(BASE_LAT, 750)));
+    TEST_ASSERT_TRUE(events[0].entered);
+}
+
+static void test_rejects_bad_shapes() {
+    int32_t lat[3] = { BASE_LAT, BASE_LAT + 10000, BASE_LAT };
+    int32_t lon[3] = { BASE_LON, BASE_LON, BASE_LON + 10000 };
+    TEST_ASSERT_FALSE(fence->addCircle("big", BASE_LAT, BASE_LON, GEOFENCE_MAX_RADIUS_M + 1));
+    TEST_ASSERT_FALSE(fence->addPolygon("two", lat, lon, 2));
+    /* Wider than the 16-bit vertex offsets */
+    lon[2] = BASE_LON + 400000;
+    TEST_ASSERT_FALSE(fence->addPolygon("wide", lat, lon, 3));
+    TEST_ASSERT_EQUAL_UINT8(0, fence->count());
+}
+
+static void test_fences_kept_in_nvs() {
+    TEST_ASSERT_TRUE(fence->addCircle("home", BASE_LAT, BASE_LON, 300));
+    TEST_ASSERT_TRUE(fence->addCircle("work", BASE_LAT + 50000, BASE_LON, 300));
+    TEST_ASSERT_TRUE(fence->remove("home"));
+    Geofence reloaded;
+    TEST_ASSERT_TRUE(reloaded.begin());
+    TEST_ASSERT_EQUAL_UINT8(1, reloaded.count());
+    TEST_ASSERT_EQUAL_size_t(0, reloaded.evaluate(BASE_LAT + 50000, BASE_LON, events, 4));
+}
+
+static void test_grid_limits_exact_tests() {
+    /* Fences spread over 50 km; a fix near one tests only its neighbours */
+    char name[GEOFENCE_NAME_LEN];
+    for (int i = 0; i < GEOFENCE_MAX_FENCES; ++i) {
+        snprintf(name, sizeof(name), "F%d", i);
+        TEST_ASSERT_TRUE(fence->addCircle(name, BASE_LAT + (i % 8) * 60000, BASE_LON + (i / 8) * 60000, 200));
+    }
+    fence->evaluate(BASE_LAT, BASE_LON, events, 4);
+    GeofenceStats_t before;
+    fence->getStats(&before);
+    for (int i = 0; i < 100; ++i) {
+        fence->evaluate(BASE_LAT + i * 10, BASE_LON, events, 4);
+    }
+    GeofenceStats_t after;
+    fence->getStats(&after);
+    TEST_ASSERT_LESS_OR_EQUAL(100 * 2, after.candidates - before.candidates);
+}
+
+/*
+ * GEOFENCE_MAX_FENCES random circles and star-shaped octagons within 0.1 degrees,
+ * checked along a 5000-fix random walk of up to 30 m steps over a slightly larger square.
+ */
+static void test_benchmark_random_walk() {
+    char name[GEOFENCE_NAME_LEN];
+    srand(1);
+    for (int i = 0; i < GEOFENCE_MAX_FENCES; ++i) {
+        snprintf(name, sizeof(name), "B%d", i);
+        int32_t lat = BASE_LAT + random(-100000, 100000);
+        int32_t lon = BASE_LON + random(-100000, 100000);
+        if (i % 2 == 0) {
+            TEST_ASSERT_TRUE(fence->addCircle(name, lat, lon, random(50, 1000)));
+        } else {
+            /* Radius 200 m to 1 km per vertex */
+            int32_t latE6[8], lonE6[8];
+            for (int k = 0; k < 8; ++k) {
+                double a = k * M_PI / 4;
+                long r = random(2000, 9000);
+                latE6[k] = lat + (int32_t)lround(r * sin(a));
+                lonE6[k] = lon + (int32_t)lround(r * cos(a));
+            }
+            TEST_ASSERT_TRUE(fence->addPolygon(name, latE6, lonE6, 8));
+        }
+    }
+    static int32_t walk[BENCH_POINTS][2];
+    int32_t lat = BASE_LAT, lon = BASE_LON;
+    for (int i = 0; i < BENCH_POINTS; ++i) {
+        lat = constrain(lat + random(-270, 271), BASE_LAT - 120000, BASE_LAT + 120000);
+        lon = constrain(lon + random(-270, 271), BASE_LON - 120000, BASE_LON + 120000);
+        walk[i][0] = lat;
+        walk[i][1] = lon;
+    }
+    /* micros() is too coarse for one check on the host: time the whole walk */
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_POINTS; ++i) {
+        fence->evaluate(walk[i][0], walk[i][1], events, 4);
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    uint32_t nsPerFix = (uint32_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() /
+                                   BENCH_POINTS);
+    GeofenceStats_t s;
+    fence->getStats(&s);
+    printf("Geofence benchmark: %u fixes, %lu ns per fix, %u.%02u exact tests per fix\n", (unsigned)s.evaluations,
+           (unsigned long)nsPerFix, (unsigned)(s.candidates / s.evaluations),
+           (unsigned)(s.candidates * 100 / s.evaluations % 100));
+
+    TEST_ASSERT_EQUAL_UINT32(BENCH_POINTS, s.evaluations);
+    /* The grid leaves well under one of the 32 fences to test exactly per fix */
+    TEST_ASSERT_LESS_THAN_UINT32(BENCH_POINTS, s.candidates);
+    TEST_ASSERT_LESS_THAN_UINT32(20000, nsPerFix);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_circle_edge_at_equator_and_north);
+    RUN_TEST(test_hysteresis_and_confirmation);
+    RUN_TEST(test_concave_polygon);
+    RUN_TEST(test_rejects_bad_shapes);
+    RUN_TEST(test_fences_kept_in_nvs);
+    RUN_TEST(test_grid_limits_exact_tests);
+    RUN_TEST(test_benchmark_random_walk);
+    return UNITY_END();
+}
@@ -0,0 +1,92 @@
+#include <unity.h>
+#include <string.h>
+#include "gnssParser.h"
+
+static const char* const fixLine =
+    "+CGNSINF: 1,1,20240315101530.250,20.558853,-103.428903,1560.200,12.34,271.5,1,,0.9,1.2,0.8,,12,7,1,,35,,";
+
+static bool parse(const char* line, GnssRecord_t* rec) {
+    return GnssParseCgnsinf(line, strlen(line), rec);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+static void test_fix_fields() {
+    GnssRecord_t rec;
+    TEST_ASSERT_TRUE(parse(fixLine, &rec));
+    TEST_ASSERT_TRUE(rec.runStatus);
+    TEST_ASSERT_TRUE(rec.fixValid);
+    TEST_ASSERT_EQUAL_UINT16(2024, rec.year);
+    TEST_ASSERT_EQUAL_UINT8(3, rec.month);
+    TEST_ASSERT_EQUAL_UINT8(15, rec.day);
+    TEST_ASSERT_EQUAL_UINT8(10, rec.hour);
+    TEST_ASSERT_EQUAL_UINT8(15, rec.minute);
+    TEST_ASSERT_EQUAL_UINT8(30, rec.second);
+    TEST_ASSERT_EQUAL_UINT16(250, rec.millisecond);
+    TEST_ASSERT_EQUAL_INT32(20558853, rec.latE6);
+    TEST_ASSERT_EQUAL_INT32(-103428903, rec.lonE6);
+    TEST_ASSERT_EQUAL_INT32(156020, rec.altitudeCm);
+    TEST_ASSERT_EQUAL_UINT16(1234, rec.speedKmhX100);
+    TEST_ASSERT_EQUAL_UINT16(27150, rec.courseX100);
+    TEST_ASSERT_EQUAL_UINT16(90, rec.hdopX100);
+    TEST_ASSERT_EQUAL_UINT16(120, rec.pdopX100);
+    TEST_ASSERT_EQUAL_UINT8(12, rec.satsInView);
+    TEST_ASSERT_EQUAL_UINT8(8, rec.satsUsed);
+}
+
+static void test_prefix_and_terminator_optional() {
+    GnssRecord_t a;
+    GnssRecord_t b;
+    TEST_ASSERT_TRUE(parse(fixLine, &a));
+    char bare[GNSS_CGNSINF_MAX_LEN];
+    snprintf(bare, sizeof(bare), "%s\r\n", fixLine + strlen("+CGNSINF: "));
+    TEST_ASSERT_TRUE(parse(bare, &b));
+    TEST_ASSERT_EQUAL_MEMORY(&a, &b, sizeof(a));
+}
+
+static void test_no_fix() {
+    GnssRecord_t rec;
+    TEST_ASSERT_TRUE(parse("+CGNSINF: 1,0,,,,,,,0,,,,,,,,,,,,", &rec));
+    TEST_ASSERT_TRUE(rec.runStatus);
+    TEST_ASSERT_FALSE(rec.fixValid);
+    uint32_t unixTime;
+    TEST_ASSERT_FALSE(GnssRecordUnixTime(&rec, &unixTime));
+
+    TEST_ASSERT_TRUE(parse("+CGNSINF: 0,,,,,,,,,,,,,,,,,,,,", &rec));
+    TEST_ASSERT_FALSE(rec.runStatus);
+}
+
+static void test_malformed_rejected() {
+    GnssRecord_t rec;
+    /* Truncated: a field short */
+    TEST_ASSERT_FALSE(parse("+CGNSINF: 1,1,20240315101530.250,20.558853,-103.428903,1560.200,12.34", &rec));
+    TEST_ASSERT_FALSE(rec.fixValid);
+    /* Letter in the latitude */
+    TEST_ASSERT_FALSE(parse(
+        "+CGNSINF: 1,1,20240315101530.250,20.5x8853,-103.428903,1560.200,12.34,271.5,1,,0.9,1.2,0.8,,12,7,1,,35,,", &rec));
+    /* Latitude out of range */
+    TEST_ASSERT_FALSE(parse(
+        "+CGNSINF: 1,1,20240315101530.250,91.000000,-103.428903,1560.200,12.34,271.5,1,,0.9,1.2,0.8,,12,7,1,,35,,", &rec));
+    TEST_ASSERT_FALSE(parse("", &rec));
+}
+
+static void test_unix_time() {
+    GnssRecord_t rec;
+    TEST_ASSERT_TRUE(parse(fixLine, &rec));
+    uint32_t unixTime;
+    TEST_ASSERT_TRUE(GnssRecordUnixTime(&rec, &unixTime));
+    /* 2024-03-15 10:15:30 UTC */
+    TEST_ASSERT_EQUAL_UINT32(1710497730UL, unixTime);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_fix_fields);
+    RUN_TEST(test_prefix_and_terminator_optional);
+    RUN_TEST(test_no_fix);
+    RUN_TEST(test_malformed_rejected);
+    RUN_TEST(test_unix_time);
+    return UNITY_END();
+}
@@ -0,0 +1,95 @@
+#include <unity.h>
+#include <stdio.h>
+#include "atEngine.h"
+#include "modemMgr.h"
+#include "simModem.h"
+
+#define TEST_LINK_LIMIT  115200
+#define TEST_ROUNDS      20
+
+/* Blocking AT exchanges run the engine in the test's thread while they wait */
+static void pumpEngine(void* ctx) {
+    static_cast<AtEngine*>(ctx)->service(0);
+}
+
+static SimModem* sim;
+static AtEngine* at;
+static ModemMgr* modem;
+
+void setUp() {
+    sim = new SimModem(Serial);
+    at = new AtEngine(*sim, Serial);
+    modem = new ModemMgr(*at, sim, Serial, 4, MODEM_PIN_DTR);
+    TEST_ASSERT_TRUE(at->begin());
+    hostSetBlockHook(pumpEngine, at);
+    /* Only the UART: the modem answers +CGNSINF at once */
+    sim->setLatency("+CGNSINF", 0);
+}
+
+void tearDown() {
+    hostSetBlockHook(NULL, NULL);
+    delete modem;
+    delete at;
+    delete sim;
+}
+
+/* Average +CGNSINF exchange time at the current rate, 0 if any exchange failed */
+static uint32_t exchangeUs() {
+    AtRequest_t req;
+    size_t len;
+    uint32_t total = 0;
+    for (int i = 0; i < TEST_ROUNDS; ++i) {
+        if (at->command(&req, 2000, "+CGNSINF") != AT_OK || AtEngine::findLine(&req, "+CGNSINF:", &len) == NULL) {
+            return 0;
+        }
+        total += req.latencyUs;
+    }
+    return total / TEST_ROUNDS;
+}
+
+static void test_switch_to_target_rate() {
+    uint32_t slowUs = exchangeUs();
+    TEST_ASSERT_TRUE(modem->negotiateBaud(MODEM_UART_TARGET_BAUD));
+    TEST_ASSERT_EQUAL_UINT32(MODEM_UART_TARGET_BAUD, modem->getBaud());
+    SimModemStats_t before;
+    sim->getStats(&before);
+    uint32_t fastUs = exchangeUs();
+    printf("+CGNSINF exchange: %lu us at %lu baud, %lu us at %lu baud\n", (unsigned long)slowUs,
+           (unsigned long)MODEM_UART_BAUD, (unsigned long)fastUs, (unsigned long)MODEM_UART_TARGET_BAUD);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, slowUs);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, fastUs);
+    /* Wire time per byte is 96 times shorter; the rest is the engine and the response framing */
+    TEST_ASSERT_LESS_THAN_UINT32(slowUs / 10, fastUs);
+
+    /* A byte or two may be lost at the switch itself, none after it */
+    SimModemStats_t after;
+    sim->getStats(&after);
+    TEST_ASSERT_EQUAL_UINT32(before.garbledBytes, after.garbledBytes);
+}
+
+static void test_link_limit_falls_back_to_previous_rate() {
+    sim->setLinkLimit(TEST_LINK_LIMIT);
+    TEST_ASSERT_FALSE(modem->negotiateBaud(MODEM_UART_TARGET_BAUD));
+    TEST_ASSERT_EQUAL_UINT32(MODEM_UART_BAUD, modem->getBaud());
+
+    /* Both ends back at the old rate: clean exchanges again */
+    SimModemStats_t before;
+    sim->getStats(&before);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, before.garbledBytes);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, exchangeUs());
+    SimModemStats_t after;
+    sim->getStats(&after);
+    TEST_ASSERT_EQUAL_UINT32(before.garbledBytes, after.garbledBytes);
+
+    /* A rate the wiring carries is kept */
+    TEST_ASSERT_TRUE(modem->negotiateBaud(TEST_LINK_LIMIT));
+    TEST_ASSERT_EQUAL_UINT32(TEST_LINK_LIMIT, modem->getBaud());
+    TEST_ASSERT_GREATER_THAN_UINT32(0, exchangeUs());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_switch_to_target_rate);
+    RUN_TEST(test_link_limit_falls_back_to_previous_rate);
+    return UNITY_END();
+}
@@ -0,0 +1,220 @@
+#include <unity.h>
+#include <new>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gnssParser.h"
+
+#define PERF_ROUNDS  20000
+
+static const char* const fixLine =
+    "+CGNSINF: 1,1,20240315101530.250,20.558853,-103.428903,1560.200,12.34,271.5,1,,0.9,1.2,0.8,,12,7,1,,35,,";
+
+/* Every heap allocation made through operator new (and new[], which calls it) while counting */
+static bool counting;
+static uint32_t allocations;
+
+void* operator new(size_t size) {
+    if (counting) {
+        allocations++;
+    }
+    void* p = malloc(size != 0 ? size : 1);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+/*
+ * Just enough of the Arduino core's String for the code that parsed +CGNSINF before
+ * GnssParseCgnsinf(): one heap buffer per non-empty string, as in WString.cpp.
+ */
+class LegacyString {
+public:
+    LegacyString() : buf(NULL), len(0) {}
+    LegacyString(const char* s) : buf(NULL), len(0) { assign(s, strlen(s)); }
+    LegacyString(const LegacyString& s) : buf(NULL), len(0) { assign(s.buf, s.len); }
+    ~LegacyString() { delete[] buf; }
+
+    LegacyString& operator=(const LegacyString& s) {
+        if (this != &s) {
+            assign(s.buf, s.len);
+        }
+        return *this;
+    }
+
+    int length() const { return (int)len; }
+    char operator[](int i) const { return buf[i]; }
+    bool operator!=(const char* s) const { return strcmp(c_str(), s) != 0; }
+    const char* c_str() const { return (buf != NULL) ? buf : ""; }
+
+    int indexOf(char c, int from = 0) const {
+        for (size_t i = (size_t)from; i < len; ++i) {
+            if (buf[i] == c) {
+                return (int)i;
+            }
+        }
+        return -1;
+    }
+
+    LegacyString substring(int from, int to = -1) const {
+        LegacyString out;
+        if (to < 0 || (size_t)to > len) {
+            to = (int)len;
+        }
+        if (from < to) {
+            out.assign(buf + from, (size_t)(to - from));
+        }
+        return out;
+    }
+
+    void trim() {
+        size_t start = 0;
+        size_t end = len;
+        while (start < end && (buf[start] == ' ' || buf[start] == '\r' || buf[start] == '\n')) {
+            start++;
+        }
+        while (end > start && (buf[end - 1] == ' ' || buf[end - 1] == '\r' || buf[end - 1] == '\n')) {
+            end--;
+        }
+        memmove(buf, buf + start, end - start);
+        len = end - start;
+        if (buf != NULL) {
+            buf[len] = '\0';
+        }
+    }
+
+    float toFloat() const { return (float)atof(c_str()); }
+
+private:
+    void assign(const char* s, size_t n) {
+        delete[] buf;
+        buf = NULL;
+        len = n;
+        if (n > 0) {
+            buf = new char[n + 1];
+            memcpy(buf, s, n);
+            buf[n] = '\0';
+        }
+    }
+
+    char* buf;
+    size_t len;
+};
+
+/* ModemMgr::GpsGetFix() before the parser, minus the modem read and the console echo */
+static bool legacyGetFix(const LegacyString& gnssRaw) {
+    int idx = gnssRaw.indexOf(':');
+    LegacyString data = (idx < 0) ? gnssRaw : gnssRaw.substring(idx + 1);
+    data.trim();
+    int firstComma = data.indexOf(',');
+    int secondComma = data.indexOf(',', firstComma + 1);
+    if (firstComma < 0 || secondComma < 0) {
+        return false;
+    }
+    LegacyString fixStatus = data.substring(0, firstComma);
+    LegacyString fixMode = data.substring(firstComma + 1, secondComma);
+    return !(fixStatus != "1" || fixMode != "1");
+}
+
+/* ModemMgr::GpsGetLatLon() before the parser */
+static void legacyGetLatLon(const LegacyString& gnssRaw, float* lat, float* lon) {
+    int idx = gnssRaw.indexOf(':');
+    LegacyString data = (idx < 0) ? gnssRaw : gnssRaw.substring(idx + 1);
+    int fieldCount = 0;
+    float latitude = 0.0, longitude = 0.0;
+    data.trim();
+    for (int i = 0; i < data.length(); ++i) {
+        if (data[i] == ',') {
+            fieldCount++;
+            if (fieldCount == 3) {
+                int nextComma = data.indexOf(',', i + 1);
+                LegacyString latStr = data.substring(i + 1, nextComma);
+                latitude = latStr.toFloat();
+                i = nextComma - 1;
+            } else if (fieldCount == 4) {
+                int nextComma = data.indexOf(',', i + 1);
+                LegacyString lonStr = data.substring(i + 1, nextComma);
+                longitude = lonStr.toFloat();
+                break;
+            }
+        }
+    }
+    *lat = latitude;
+    *lon = longitude;
+}
+
+struct PerfResult_t {
+    uint32_t nsPerParse;
+    uint32_t allocsPerParse;
+};
+
+/* One poll as the old gpsTask did it: getGPSraw() into a String, then GpsGetFix() and GpsGetLatLon() */
+static PerfResult_t runLegacy(float* lat, float* lon) {
+    volatile bool fix = false;
+    allocations = 0;
+    counting = true;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < PERF_ROUNDS; ++i) {
+        LegacyString raw(fixLine);
+        fix = legacyGetFix(raw);
+        if (fix) {
+            legacyGetLatLon(raw, lat, lon);
+        }
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    counting = false;
+    PerfResult_t r;
+    r.nsPerParse = (uint32_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / PERF_ROUNDS);
+    r.allocsPerParse = allocations / PERF_ROUNDS;
+    return r;
+}
+
+static PerfResult_t runParser(GnssRecord_t* rec) {
+    size_t len = strlen(fixLine);
+    allocations = 0;
+    counting = true;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < PERF_ROUNDS; ++i) {
+        GnssParseCgnsinf(fixLine, len, rec);
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    counting = false;
+    PerfResult_t r;
+    r.nsPerParse = (uint32_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / PERF_ROUNDS);
+    r.allocsPerParse = allocations / PERF_ROUNDS;
+    return r;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+static void test_parser_against_string_code() {
+    float lat = 0.0f;
+    float lon = 0.0f;
+    GnssRecord_t rec;
+    PerfResult_t legacy = runLegacy(&lat, &lon);
+    PerfResult_t parser = runParser(&rec);
+    printf("CGNSINF parse: String code %lu ns, %lu allocations; GnssParseCgnsinf %lu ns, %lu allocations\n",
+           (unsigned long)legacy.nsPerParse, (unsigned long)legacy.allocsPerParse,
+           (unsigned long)parser.nsPerParse, (unsigned long)parser.allocsPerParse);
+
+    /* Same position, to the precision the float version had */
+    TEST_ASSERT_TRUE(rec.fixValid);
+    TEST_ASSERT_INT32_WITHIN(2, (int32_t)(lat * 1e6f), rec.latE6);
+    TEST_ASSERT_INT32_WITHIN(8, (int32_t)(lon * 1e6f), rec.lonE6);
+    TEST_ASSERT_EQUAL_UINT32(0, parser.allocsPerParse);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, legacy.allocsPerParse);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_parser_against_string_code);
+    return UNITY_END();
+}
@@ -0,0 +1,153 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "atEngine.h"
+#include "modemMgr.h"
+#include "powerManager.h"
+#include "rfArbiter.h"
+#include "simModem.h"
+
+#define TEST_PWR_PIN      4
+#define TEST_SLEEP_MS     100
+#define TEST_EDRX_CYCLE   "0010"
+
+/* Blocking AT exchanges run the engine in the test's thread while they wait */
+static void pumpEngine(void* ctx) {
+    static_cast<AtEngine*>(ctx)->service(0);
+}
+
+static SimModem* sim;
+static AtEngine* at;
+static ModemMgr* modem;
+static RfArbiter* arbiter;
+static PowerManager* power;
+
+void setUp() {
+    sim = new SimModem(Serial);
+    at = new AtEngine(*sim, Serial);
+    modem = new ModemMgr(*at, sim, Serial, TEST_PWR_PIN, MODEM_PIN_DTR);
+    arbiter = new RfArbiter();
+    power = new PowerManager(*modem, *at, *arbiter);
+    TEST_ASSERT_TRUE(at->begin());
+    TEST_ASSERT_TRUE(arbiter->begin());
+    TEST_ASSERT_TRUE(power->begin(true));
+    power->setNetworkSaving(TEST_EDRX_CYCLE, NULL, NULL);
+    arbiter->setBusyHook(PowerManager::onRadioBusy, power);
+    sim->setRingCallback(PowerManager::ring, power);
+    hostSetBlockHook(pumpEngine, at);
+}
+
+void tearDown() {
+    hostSetBlockHook(NULL, NULL);
+    delete power;
+    delete arbiter;
+    delete modem;
+    delete at;
+    delete sim;
+}
+
+/* Configure modem sleep in a cellular slice; the release lets the modem sleep */
+static void configureAndRelease() {
+    arbiter->acquire(RF_CLIENT_CELLULAR, RF_PRIO_CELL_BACKGROUND, 1000);
+    TEST_ASSERT_TRUE(power->configureModem());
+    arbiter->release(RF_CLIENT_CELLULAR);
+}
+
+static void test_no_light_sleep_while_modem_awake() {
+    /* Not configured yet: the modem never sleeps, so neither does the MCU */
+    TEST_ASSERT_EQUAL_UINT32(0, power->lightSleep(TEST_SLEEP_MS));
+    configureAndRelease();
+    TEST_ASSERT_EQUAL_UINT32(0, power->lightSleep(POWER_LIGHT_SLEEP_MIN_MS - 1));
+
+    /* Holding the radio wakes the modem */
+    arbiter->acquire(RF_CLIENT_GNSS, RF_PRIO_GNSS, 1000);
+    TEST_ASSERT_EQUAL_UINT32(0, power->lightSleep(TEST_SLEEP_MS));
+    arbiter->release(RF_CLIENT_GNSS);
+
+    PowerStats_t s;
+    power->getStats(&s);
+    TEST_ASSERT_EQUAL_UINT32(0, s.mcuSleeps);
+    TEST_ASSERT_EQUAL_UINT32(1, s.modemWakes);
+}
+
+static void test_light_sleep_credits_measured_time() {
+    configureAndRelease();
+    uint32_t startMs = millis();
+    uint32_t slept = power->lightSleep(TEST_SLEEP_MS);
+    uint32_t wallMs = millis() - startMs;
+    TEST_ASSERT_UINT32_WITHIN(TEST_SLEEP_MS / 2, TEST_SLEEP_MS, slept);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(wallMs, slept);
+
+    PowerStats_t s;
+    power->getStats(&s);
+    TEST_ASSERT_EQUAL_UINT32(1, s.mcuSleeps);
+    TEST_ASSERT_EQUAL_UINT32(slept, (uint32_t)s.mcuSleepMs);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32((uint32_t)s.totalMs, (uint32_t)s.mcuSleepMs);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32((uint32_t)s.mcuSleepMs, (uint32_t)s.modemMs[MODEM_POWER_EDRX]);
+}
+
+static void test_one_ring_per_modem_sleep() {
+    configureAndRelease();
+    TEST_ASSERT_TRUE(sim->injectSms("+5213312345678", "LOCATION"));
+    TEST_ASSERT_TRUE(sim->injectSms("+5213312345678", "LOCATION"));
+
+    /* A ring still to be handled keeps the MCU awake */
+    TEST_ASSERT_EQUAL_UINT32(0, power->lightSleep(TEST_SLEEP_MS));
+    TEST_ASSERT_TRUE(power->takeRing());
+    TEST_ASSERT_FALSE(power->takeRing());
+
+    /* Next modem sleep period */
+    arbiter->acquire(RF_CLIENT_CELLULAR, RF_PRIO_SMS_REPLY, 1000);
+    arbiter->release(RF_CLIENT_CELLULAR);
+    TEST_ASSERT_TRUE(sim->injectSms("+5213312345678", "LOCATION"));
+
+    SimModemStats_t simStats;
+    sim->getStats(&simStats);
+    PowerStats_t s;
+    power->getStats(&s);
+    TEST_ASSERT_EQUAL_UINT32(3, simStats.rings);
+    TEST_ASSERT_EQUAL_UINT32(2, s.rings);
+    TEST_ASSERT_TRUE(power->takeRing());
+}
+
+static void test_average_current_from_table() {
+    PowerStats_t s;
+    memset(&s, 0, sizeof(s));
+    s.totalMs = 10000;
+    s.modemMs[MODEM_POWER_ACTIVE] = 1000;
+    s.modemMs[MODEM_POWER_EDRX] = 9000;
+    s.gnssMs = 500;
+    s.mcuSleepMs = 8000;
+    uint32_t expected = (uint32_t)((1000ULL * POWER_MODEM_ACTIVE_UA + 9000ULL * POWER_MODEM_EDRX_UA +
+                                    500ULL * POWER_GNSS_UA + 8000ULL * POWER_MCU_SLEEP_UA +
+                                    2000ULL * POWER_MCU_ACTIVE_UA + 10000ULL * POWER_BOARD_UA) / 10000);
+    TEST_ASSERT_EQUAL_UINT32(expected, PowerManager::averageUa(s));
+
+    /* Time the MCU did not measure asleep is charged at the active current */
+    PowerStats_t awake = s;
+    awake.mcuSleepMs = 0;
+    TEST_ASSERT_EQUAL_UINT32(expected + 8000ULL * (POWER_MCU_ACTIVE_UA - POWER_MCU_SLEEP_UA) / 10000,
+                             PowerManager::averageUa(awake));
+
+    /* A short idle stretch as the console loop runs it */
+    configureAndRelease();
+    for (int i = 0; i < 3; ++i) {
+        power->lightSleep(TEST_SLEEP_MS);
+    }
+    power->getStats(&s);
+    awake = s;
+    awake.mcuSleepMs = 0;
+    printf("Idle with light sleep: %lu uA, MCU asleep %lu of %lu ms; without: %lu uA\n",
+           (unsigned long)PowerManager::averageUa(s), (unsigned long)s.mcuSleepMs, (unsigned long)s.totalMs,
+           (unsigned long)PowerManager::averageUa(awake));
+    TEST_ASSERT_LESS_THAN_UINT32(PowerManager::averageUa(awake), PowerManager::averageUa(s));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_no_light_sleep_while_modem_awake);
+    RUN_TEST(test_light_sleep_credits_measured_time);
+    RUN_TEST(test_one_ring_per_modem_sleep);
+    RUN_TEST(test_average_current_from_table);
+    return UNITY_END();
+}
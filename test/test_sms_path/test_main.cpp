@@ -0,0 +1,181 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "system.h"
+#include "smsInbox.h"
+#include "smsOutbox.h"
+
+#define TEST_CMGS_MS          200
+#define TEST_WAIT_MS          1000
+#define TEST_REPLY_BUDGET_MS  500
+#define TEST_REQUESTER        "+5213312345678"
+#define TEST_OTHER            "+5213387654321"
+#define TEST_REPLY            "Bike GPS Tracker position: " GPS_MAP_URL "20.558853,-103.428903 (4 s ago)"
+
+/* Keeps what the simulated modem logs, to see the replies it sent */
+class LogCapture : public Print {
+public:
+    LogCapture() : len(0) { buf[0] = '\0'; }
+
+    size_t write(uint8_t c) override {
+        if (len < sizeof(buf) - 1) {
+            buf[len++] = (char)c;
+            buf[len] = '\0';
+        }
+        return 1;
+    }
+    using Print::write;
+
+    uint32_t count(const char* text) const {
+        uint32_t n = 0;
+        for (const char* p = strstr(buf, text); p != NULL; p = strstr(p + 1, text)) {
+            n++;
+        }
+        return n;
+    }
+
+    char buf[4096];
+    size_t len;
+};
+
+/* Blocking AT exchanges run the engine in the test's thread while they wait */
+static void pumpEngine(void* ctx) {
+    static_cast<AtEngine*>(ctx)->service(0);
+}
+
+static LogCapture* simLog;
+static SimModem* sim;
+static AtEngine* at;
+static ModemMgr* modem;
+static SmsInbox* inbox;
+static SmsOutbox* outbox;
+
+void setUp() {
+    simLog = new LogCapture();
+    sim = new SimModem(*simLog);
+    at = new AtEngine(*sim, Serial);
+    modem = new ModemMgr(*at, sim, Serial, 4, MODEM_PIN_DTR);
+    inbox = new SmsInbox();
+    outbox = new SmsOutbox();
+    TEST_ASSERT_TRUE(at->begin());
+    TEST_ASSERT_TRUE(inbox->begin(*at));
+    hostSetBlockHook(pumpEngine, at);
+    sim->setLatency("+CMGS", TEST_CMGS_MS);
+    TEST_ASSERT_TRUE(modem->simEnableNewMessageIndication());
+    /* The boot pass over messages stored while powered off: from here on only +CMTI raises pending */
+    TEST_ASSERT_EQUAL_INT(0, modem->simFetchMessages(*inbox));
+}
+
+void tearDown() {
+    hostSetBlockHook(NULL, NULL);
+    delete outbox;
+    delete inbox;
+    delete modem;
+    delete at;
+    delete sim;
+    delete simLog;
+}
+
+static uint32_t exchanges() {
+    SimModemStats_t s;
+    sim->getStats(&s);
+    return s.exchanges;
+}
+
+/*
+ * One cellularTask grant once +CMTI raised the pending flag: fetch, answer, send a batch.
+ * skipMs moves the outbox clock forward, in place of waiting out a retry backoff.
+ */
+static void cellularGrant(uint32_t skipMs) {
+    if (inbox->hasPending()) {
+        TEST_ASSERT_GREATER_OR_EQUAL(0, modem->simFetchMessages(*inbox));
+    }
+    SmsMessage_t sms;
+    while (inbox->pop(&sms)) {
+        if (strcmp(sms.text, SMS_REQ_LOCATION) == 0) {
+            outbox->enqueue(sms.sender, SMS_TAG_LOCATION, TEST_REPLY, sms.receivedMs);
+        }
+    }
+    SmsOutMessage_t* msg;
+    for (uint8_t n = 0; n < SMS_SEND_BATCH && (msg = outbox->next(millis() + skipMs)) != NULL; ++n) {
+        int messageRef;
+        int cmsError;
+        AtResult result = modem->simSendMessage(msg->number, msg->text, &messageRef, &cmsError);
+        if (result == AT_OK) {
+            outbox->sent(msg, messageRef, millis() + skipMs);
+        } else {
+            outbox->failed(msg, (result == AT_TIMEOUT) ? SMS_ERROR_TIMEOUT : cmsError, millis() + skipMs);
+        }
+    }
+}
+
+static void test_location_request_answered() {
+    uint32_t before = exchanges();
+    TEST_ASSERT_TRUE(sim->injectSms(TEST_REQUESTER, SMS_REQ_LOCATION));
+    TEST_ASSERT_TRUE(inbox->waitPending(pdMS_TO_TICKS(TEST_WAIT_MS)));
+    cellularGrant(0);
+
+    /* AT+CMGL, AT+CMGD=1, AT+CMGS */
+    TEST_ASSERT_EQUAL_UINT32(3, exchanges() - before);
+    TEST_ASSERT_EQUAL_UINT32(1, simLog->count("SIM modem: SMS to " TEST_REQUESTER ": " TEST_REPLY "\n"));
+
+    SimModemStats_t s;
+    sim->getStats(&s);
+    SmsOutboxStats_t out;
+    outbox->getStats(&out);
+    printf("SMS request to reply: %lu ms at the modem, %lu ms to +CMGS, %lu AT commands\n",
+           (unsigned long)s.replyLatencyMaxMs, (unsigned long)out.latencyMaxMs, (unsigned long)(exchanges() - before));
+    TEST_ASSERT_EQUAL_UINT32(1, s.smsReplies);
+    TEST_ASSERT_EQUAL_UINT32(1, out.sent);
+    /* The modem takes the text at Ctrl+Z, after three exchanges at 9600 baud; +CMGS confirms it TEST_CMGS_MS later */
+    TEST_ASSERT_LESS_THAN_UINT32(TEST_REPLY_BUDGET_MS, s.replyLatencyMaxMs);
+    TEST_ASSERT_GREATER_OR_EQUAL(TEST_CMGS_MS, out.latencyMaxMs);
+    TEST_ASSERT_LESS_THAN_UINT32(TEST_REPLY_BUDGET_MS + TEST_CMGS_MS, out.latencyMaxMs);
+}
+
+static void test_burst_coalesced_into_one_pass() {
+    uint32_t before = exchanges();
+    for (int i = 0; i < 3; ++i) {
+        TEST_ASSERT_TRUE(sim->injectSms(TEST_REQUESTER, SMS_REQ_LOCATION));
+    }
+    TEST_ASSERT_TRUE(sim->injectSms(TEST_OTHER, SMS_REQ_LOCATION));
+    TEST_ASSERT_TRUE(inbox->waitPending(pdMS_TO_TICKS(TEST_WAIT_MS)));
+    cellularGrant(0);
+
+    /* One listing, one delete per message, one reply per number */
+    TEST_ASSERT_EQUAL_UINT32(1 + 4 + 2, exchanges() - before);
+    TEST_ASSERT_EQUAL_UINT32(1, simLog->count("SIM modem: SMS to " TEST_REQUESTER ": " TEST_REPLY "\n"));
+    TEST_ASSERT_EQUAL_UINT32(1, simLog->count("SIM modem: SMS to " TEST_OTHER ": " TEST_REPLY "\n"));
+    SmsOutboxStats_t out;
+    outbox->getStats(&out);
+    TEST_ASSERT_EQUAL_UINT32(2, out.coalesced);
+    TEST_ASSERT_EQUAL_UINT32(2, out.sent);
+}
+
+static void test_refused_reply_retried_after_backoff() {
+    sim->failSms(1);
+    TEST_ASSERT_TRUE(sim->injectSms(TEST_REQUESTER, SMS_REQ_LOCATION));
+    TEST_ASSERT_TRUE(inbox->waitPending(pdMS_TO_TICKS(TEST_WAIT_MS)));
+    cellularGrant(0);
+    uint32_t failedMs = millis();
+    TEST_ASSERT_EQUAL_UINT32(0, simLog->count("SIM modem: SMS to " TEST_REQUESTER ": "));
+
+    /* Not before the backoff, then one more AT+CMGS only */
+    TEST_ASSERT_FALSE(outbox->due(failedMs));
+    uint32_t before = exchanges();
+    cellularGrant(SMS_RETRY_MIN_MS);
+    TEST_ASSERT_EQUAL_UINT32(1, exchanges() - before);
+    TEST_ASSERT_EQUAL_UINT32(1, simLog->count("SIM modem: SMS to " TEST_REQUESTER ": " TEST_REPLY "\n"));
+    SmsOutboxStats_t out;
+    outbox->getStats(&out);
+    TEST_ASSERT_EQUAL_UINT32(1, out.retries);
+    TEST_ASSERT_EQUAL_UINT32(1, out.sent);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_location_request_answered);
+    RUN_TEST(test_burst_coalesced_into_one_pass);
+    RUN_TEST(test_refused_reply_retried_after_backoff);
+    return UNITY_END();
+}
@@ -0,0 +1,138 @@
+#include <unity.h>
+#include <string.h>
+#include "trackCodec.h"
+
+#define MAX_POINTS  64
+
+/* Decoder as in tools/track_decode.py: points come back newest first */
+static int digitValue(char c, bool* last) {
+    static const char alphabet[] =
+        "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcde"
+        "fghijklmnopqrstuvwxyz!#%&'()*+,-./:;<=>?_";
+    const char* p = strchr(alphabet, c);
+    if (c == '\0' || p == NULL) {
+        return -1;
+    }
+    int v = (int)(p - alphabet);
+    *last = v < TRACK_CODEC_RADIX;
+    return v % TRACK_CODEC_RADIX;
+}
+
+static bool getVarint(const char** text, uint32_t* out) {
+    uint32_t v = 0;
+    uint32_t scale = 1;
+    bool last = false;
+    while (!last) {
+        int d = digitValue(**text, &last);
+        if (d < 0) {
+            return false;
+        }
+        (*text)++;
+        v += (uint32_t)d * scale;
+        scale *= TRACK_CODEC_RADIX;
+    }
+    *out = v;
+    return true;
+}
+
+static int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static size_t decode(const char* text, TrackPoint_t* points, size_t max) {
+    if (strncmp(text, TRACK_CODEC_MARK, strlen(TRACK_CODEC_MARK)) != 0) {
+        return 0;
+    }
+    text += strlen(TRACK_CODEC_MARK);
+    size_t n = 0;
+    uint32_t t, lat, lon;
+    while (n < max && *text != '\0' && getVarint(&text, &t) && getVarint(&text, &lat) && getVarint(&text, &lon)) {
+        if (n == 0) {
+            points[0].utc = t;
+            points[0].latE6 = unzigzag(lat) * TRACK_COORD_QUANT;
+            points[0].lonE6 = unzigzag(lon) * TRACK_COORD_QUANT;
+        } else {
+            points[n].utc = points[n - 1].utc - t;
+            points[n].latE6 = points[n - 1].latE6 + unzigzag(lat) * TRACK_COORD_QUANT;
+            points[n].lonE6 = points[n - 1].lonE6 + unzigzag(lon) * TRACK_COORD_QUANT;
+        }
+        n++;
+    }
+    return n;
+}
+
+static TrackPoint_t track[MAX_POINTS];
+
+void setUp() {
+    /* A ride heading north-west, a ten minute stop every eighth point and a 70 km jump */
+    uint32_t utc = 120000000UL;
+    for (size_t i = 0; i < MAX_POINTS; ++i) {
+        utc += (i % 8 == 7) ? 600 : 30;
+        track[i].utc = utc;
+        track[i].latE6 = 20558850 + (int32_t)i * 1230 - ((i > 40) ? 700000 : 0);
+        track[i].lonE6 = -103428900 - (int32_t)i * 870;
+    }
+}
+
+void tearDown() {}
+
+static void test_round_trip_newest_first() {
+    char text[1024];
+    size_t packed = TrackEncodeCompact(track, MAX_POINTS, text, sizeof(text));
+    TEST_ASSERT_EQUAL_size_t(MAX_POINTS, packed);
+    TrackPoint_t out[MAX_POINTS];
+    TEST_ASSERT_EQUAL_size_t(MAX_POINTS, decode(text, out, MAX_POINTS));
+    for (size_t i = 0; i < MAX_POINTS; ++i) {
+        const TrackPoint_t& want = track[MAX_POINTS - 1 - i];
+        TEST_ASSERT_EQUAL_UINT32(want.utc, out[i].utc);
+        TEST_ASSERT_EQUAL_INT32(want.latE6, out[i].latE6);
+        TEST_ASSERT_EQUAL_INT32(want.lonE6, out[i].lonE6);
+    }
+}
+
+static void test_sms_budget_keeps_newest() {
+    char text[161];
+    size_t packed = TrackEncodeCompact(track, MAX_POINTS, text, sizeof(text));
+    TEST_ASSERT_GREATER_THAN(10, packed);
+    TEST_ASSERT_LESS_THAN(MAX_POINTS, packed);
+    TEST_ASSERT_LESS_OR_EQUAL(160, strlen(text));
+    TrackPoint_t out[MAX_POINTS];
+    TEST_ASSERT_EQUAL_size_t(packed, decode(text, out, MAX_POINTS));
+    TEST_ASSERT_EQUAL_UINT32(track[MAX_POINTS - 1].utc, out[0].utc);
+    TEST_ASSERT_EQUAL_UINT32(track[MAX_POINTS - packed].utc, out[packed - 1].utc);
+}
+
+static void test_gsm_alphabet_only() {
+    char text[1024];
+    TrackEncodeCompact(track, MAX_POINTS, text, sizeof(text));
+    for (const char* p = text; *p != '\0'; ++p) {
+        /* Symbols that need an escape or are missing in GSM 03.38 */
+        TEST_ASSERT_NULL(strchr("[]^{}~`\\|$@", *p));
+    }
+}
+
+static void test_too_small() {
+    char text[4];
+    TEST_ASSERT_EQUAL_size_t(0, TrackEncodeCompact(track, MAX_POINTS, text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("", text);
+    TEST_ASSERT_EQUAL_size_t(0, TrackEncodeCompact(track, 0, text, sizeof(text)));
+}
+
+static void test_decimal_text() {
+    char text[64];
+    TEST_ASSERT_EQUAL_size_t(3, TrackFormatDecimal(track, 3, text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("231020212030 20.55885,-103.42890;30,123,-87;30,123,-87", text);
+    /* Only whole steps are packed */
+    TEST_ASSERT_EQUAL_size_t(2, TrackFormatDecimal(track, 3, text, 45));
+    TEST_ASSERT_EQUAL_STRING("231020212030 20.55885,-103.42890;30,123,-87", text);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_newest_first);
+    RUN_TEST(test_sms_budget_keeps_newest);
+    RUN_TEST(test_gsm_alphabet_only);
+    RUN_TEST(test_too_small);
+    RUN_TEST(test_decimal_text);
+    return UNITY_END();
+}
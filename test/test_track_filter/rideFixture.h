@@ -0,0 +1,378 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * A 15-minute ride from BASE_LAT/BASE_LON as +CGNSINF lines, one fix every 5 s at
+ * 4-8 m/s with a few right-angle turns, HDOP 0.8-2.5 and a 100-300 m
+ * multipath jump in about one fix of 30. Synthetic: each line carries the
+ * true position it was generated from, so the filter can be scored.
+ */
+struct RideFix_t {
+    const char* line;
+    int32_t trueLatE6;
+    int32_t trueLonE6;
+    bool jump;
+};
+
+static const RideFix_t rideFixes[] = {
+    { "+CGNSINF: 1,1,20240315101535.000,20.558897,-103.428640,1558.857,18.77,81.0,1,,1.3,1.7,0.9,,14,8,1,,38,,",
+      20558900, -103428664, false },
+    { "+CGNSINF: 1,1,20240315101540.000,20.559044,-103.428312,1559.795,19.85,76.5,1,,1.3,1.7,0.9,,14,7,1,,38,,",
+      20558959, -103428415, false },
+    { "+CGNSINF: 1,1,20240315101545.000,20.559029,-103.428155,1560.034,19.73,73.7,1,,1.3,1.7,0.9,,14,10,1,,38,,",
+      20559019, -103428174, false },
+    { "+CGNSINF: 1,1,20240315101550.000,20.559026,-103.427918,1562.640,17.07,73.7,1,,2.5,2.9,0.9,,14,9,1,,38,,",
+      20559076, -103427951, false },
+    { "+CGNSINF: 1,1,20240315101555.000,20.559112,-103.427766,1561.818,17.96,73.2,1,,1.1,1.5,0.9,,14,7,1,,38,,",
+      20559133, -103427715, false },
+    { "+CGNSINF: 1,1,20240315101600.000,20.559171,-103.427375,1562.346,17.49,75.5,1,,2.1,2.5,0.9,,14,9,1,,38,,",
+      20559187, -103427490, false },
+    { "+CGNSINF: 1,1,20240315101605.000,20.559318,-103.427211,1557.753,15.61,72.9,1,,1.7,2.1,0.9,,14,7,1,,38,,",
+      20559238, -103427277, false },
+    { "+CGNSINF: 1,1,20240315101610.000,20.559297,-103.427136,1560.572,16.02,77.0,1,,2.1,2.5,0.9,,14,10,1,,38,,",
+      20559283, -103427084, false },
+    { "+CGNSINF: 1,1,20240315101615.000,20.559369,-103.426940,1561.396,13.72,75.4,1,,1.1,1.5,0.9,,14,9,1,,38,,",
+      20559325, -103426897, false },
+    { "+CGNSINF: 1,1,20240315101620.000,20.559203,-103.426638,1561.048,14.80,76.0,1,,2.3,2.7,0.9,,14,7,1,,38,,",
+      20559361, -103426709, false },
+    { "+CGNSINF: 1,1,20240315101625.000,20.559429,-103.426520,1558.351,15.59,79.2,1,,1.3,1.7,0.9,,14,6,1,,38,,",
+      20559404, -103426499, false },
+    { "+CGNSINF: 1,1,20240315101630.000,20.559527,-103.426309,1557.730,17.12,72.5,1,,1.2,1.6,0.9,,14,8,1,,38,,",
+      20559460, -103426273, false },
+    { "+CGNSINF: 1,1,20240315101635.000,20.559532,-103.426101,1559.588,15.72,76.6,1,,1.0,1.4,0.9,,14,10,1,,38,,",
+      20559509, -103426061, false },
+    { "+CGNSINF: 1,1,20240315101640.000,20.559530,-103.425818,1561.591,17.02,77.5,1,,1.2,1.6,0.9,,14,8,1,,38,,",
+      20559553, -103425852, false },
+    { "+CGNSINF: 1,1,20240315101645.000,20.559676,-103.425709,1561.112,16.19,79.2,1,,1.8,2.2,0.9,,14,7,1,,38,,",
+      20559602, -103425637, false },
+    { "+CGNSINF: 1,1,20240315101650.000,20.559637,-103.425491,1558.687,15.01,77.0,1,,1.8,2.2,0.9,,14,7,1,,38,,",
+      20559643, -103425442, false },
+    { "+CGNSINF: 1,1,20240315101655.000,20.559697,-103.425174,1558.943,15.06,76.9,1,,1.3,1.7,0.9,,14,6,1,,38,,",
+      20559687, -103425235, false },
+    { "+CGNSINF: 1,1,20240315101700.000,20.559718,-103.424925,1561.498,16.09,74.5,1,,1.5,1.9,0.9,,14,10,1,,38,,",
+      20559738, -103425016, false },
+    { "+CGNSINF: 1,1,20240315101705.000,20.559872,-103.424820,1561.941,18.16,72.6,1,,1.4,1.8,0.9,,14,7,1,,38,,",
+      20559801, -103424787, false },
+    { "+CGNSINF: 1,1,20240315101710.000,20.559592,-103.424738,1558.394,18.13,164.7,1,,2.2,2.6,0.9,,14,6,1,,38,,",
+      20559592, -103424721, false },
+    { "+CGNSINF: 1,1,20240315101715.000,20.559425,-103.424735,1562.474,16.16,161.5,1,,1.9,2.3,0.9,,14,7,1,,38,,",
+      20559399, -103424663, false },
+    { "+CGNSINF: 1,1,20240315101720.000,20.559223,-103.424662,1557.691,16.29,163.0,1,,1.7,2.1,0.9,,14,6,1,,38,,",
+      20559205, -103424609, false },
+    { "+CGNSINF: 1,1,20240315101725.000,20.558996,-103.424567,1560.475,17.21,166.6,1,,1.0,1.4,0.9,,14,7,1,,38,,",
+      20559000, -103424556, false },
+    { "+CGNSINF: 1,1,20240315101730.000,20.558796,-103.424548,1561.504,16.50,168.7,1,,1.4,1.8,0.9,,14,7,1,,38,,",
+      20558794, -103424509, false },
+    { "+CGNSINF: 1,1,20240315101735.000,20.556374,-103.423814,1562.124,18.81,168.2,1,,2.1,2.5,0.9,,14,9,1,,38,,",
+      20558573, -103424470, true },
+    { "+CGNSINF: 1,1,20240315101740.000,20.558408,-103.424472,1562.547,18.55,169.0,1,,2.1,2.5,0.9,,14,9,1,,38,,",
+      20558347, -103424417, false },
+    { "+CGNSINF: 1,1,20240315101745.000,20.558133,-103.424275,1561.743,19.64,169.9,1,,1.5,1.9,0.9,,14,8,1,,38,,",
+      20558106, -103424364, false },
+    { "+CGNSINF: 1,1,20240315101750.000,20.557939,-103.424247,1558.619,20.19,169.7,1,,2.1,2.5,0.9,,14,6,1,,38,,",
+      20557851, -103424305, false },
+    { "+CGNSINF: 1,1,20240315101755.000,20.557638,-103.424218,1558.517,20.02,163.6,1,,2.1,2.5,0.9,,14,6,1,,38,,",
+      20557610, -103424241, false },
+    { "+CGNSINF: 1,1,20240315101800.000,20.557383,-103.424219,1557.872,19.47,165.6,1,,1.9,2.3,0.9,,14,8,1,,38,,",
+      20557368, -103424176, false },
+    { "+CGNSINF: 1,1,20240315101805.000,20.557164,-103.424188,1560.730,18.60,165.9,1,,1.0,1.4,0.9,,14,6,1,,38,,",
+      20557141, -103424118, false },
+    { "+CGNSINF: 1,1,20240315101810.000,20.555989,-103.426662,1562.471,17.97,165.5,1,,1.8,2.2,0.9,,14,7,1,,38,,",
+      20556913, -103424057, true },
+    { "+CGNSINF: 1,1,20240315101815.000,20.556582,-103.424030,1557.736,19.65,164.7,1,,1.2,1.6,0.9,,14,7,1,,38,,",
+      20556672, -103423992, false },
+    { "+CGNSINF: 1,1,20240315101820.000,20.556421,-103.423902,1558.426,20.67,166.5,1,,1.1,1.5,0.9,,14,7,1,,38,,",
+      20556417, -103423923, false },
+    { "+CGNSINF: 1,1,20240315101825.000,20.556187,-103.423970,1560.460,22.08,167.3,1,,1.9,2.2,0.9,,14,9,1,,38,,",
+      20556142, -103423852, false },
+    { "+CGNSINF: 1,1,20240315101830.000,20.555977,-103.423793,1557.874,23.24,169.3,1,,2.0,2.4,0.9,,14,10,1,,38,,",
+      20555857, -103423779, false },
+    { "+CGNSINF: 1,1,20240315101835.000,20.555559,-103.423701,1557.503,23.72,163.4,1,,1.7,2.1,0.9,,14,9,1,,38,,",
+      20555574, -103423700, false },
+    { "+CGNSINF: 1,1,20240315101840.000,20.555207,-103.423609,1557.231,24.37,169.3,1,,1.6,2.0,0.9,,14,8,1,,38,,",
+      20555277, -103423631, false },
+    { "+CGNSINF: 1,1,20240315101845.000,20.554922,-103.423495,1561.989,26.66,167.2,1,,1.1,1.5,0.9,,14,10,1,,38,,",
+      20554964, -103423565, false },
+    { "+CGNSINF: 1,1,20240315101850.000,20.554715,-103.423504,1558.905,24.90,168.5,1,,1.3,1.7,0.9,,14,10,1,,38,,",
+      20554664, -103423502, false },
+    { "+CGNSINF: 1,1,20240315101855.000,20.554461,-103.423360,1561.521,22.99,173.9,1,,1.5,1.9,0.9,,14,7,1,,38,,",
+      20554377, -103423457, false },
+    { "+CGNSINF: 1,1,20240315101900.000,20.554104,-103.423368,1557.358,21.06,175.6,1,,1.4,1.8,0.9,,14,7,1,,38,,",
+      20554109, -103423420, false },
+    { "+CGNSINF: 1,1,20240315101905.000,20.553900,-103.423431,1561.786,22.15,168.9,1,,1.4,1.8,0.9,,14,9,1,,38,,",
+      20553835, -103423377, false },
+    { "+CGNSINF: 1,1,20240315101910.000,20.553562,-103.423337,1562.457,22.34,171.4,1,,1.0,1.4,0.9,,14,8,1,,38,,",
+      20553566, -103423332, false },
+    { "+CGNSINF: 1,1,20240315101915.000,20.553332,-103.423451,1558.346,20.91,176.4,1,,2.4,2.8,0.9,,14,8,1,,38,,",
+      20553316, -103423302, false },
+    { "+CGNSINF: 1,1,20240315101920.000,20.553232,-103.423373,1559.839,17.69,171.0,1,,1.8,2.1,0.9,,14,10,1,,38,,",
+      20553088, -103423270, false },
+    { "+CGNSINF: 1,1,20240315101925.000,20.552914,-103.423265,1562.968,18.28,177.3,1,,1.0,1.4,0.9,,14,10,1,,38,,",
+      20552849, -103423247, false },
+    { "+CGNSINF: 1,1,20240315101930.000,20.552530,-103.423312,1560.024,20.23,174.2,1,,1.8,2.2,0.9,,14,10,1,,38,,",
+      20552600, -103423216, false },
+    { "+CGNSINF: 1,1,20240315101935.000,20.552536,-103.423560,1562.553,19.36,262.1,1,,2.0,2.4,0.9,,14,9,1,,38,,",
+      20552571, -103423480, false },
+    { "+CGNSINF: 1,1,20240315101940.000,20.552593,-103.423718,1557.756,19.50,260.2,1,,0.9,1.3,0.9,,14,10,1,,38,,",
+      20552531, -103423741, false },
+    { "+CGNSINF: 1,1,20240315101945.000,20.552478,-103.423958,1558.448,17.89,264.2,1,,1.9,2.3,0.9,,14,8,1,,38,,",
+      20552494, -103423991, false },
+    { "+CGNSINF: 1,1,20240315101950.000,20.552413,-103.424356,1557.218,19.36,259.9,1,,1.4,1.9,0.9,,14,9,1,,38,,",
+      20552459, -103424255, false },
+    { "+CGNSINF: 1,1,20240315101955.000,20.552430,-103.424561,1562.847,21.31,259.2,1,,2.2,2.6,0.9,,14,8,1,,38,,",
+      20552409, -103424540, false },
+    { "+CGNSINF: 1,1,20240315102000.000,20.552282,-103.424952,1560.949,19.24,260.2,1,,2.0,2.4,0.9,,14,8,1,,38,,",
+      20552360, -103424805, false },
+    { "+CGNSINF: 1,1,20240315102005.000,20.552282,-103.425207,1559.862,20.31,262.1,1,,1.1,1.5,0.9,,14,6,1,,38,,",
+      20552318, -103425078, false },
+    { "+CGNSINF: 1,1,20240315102010.000,20.552309,-103.425355,1558.101,19.71,260.0,1,,1.6,2.0,0.9,,14,7,1,,38,,",
+      20552286, -103425351, false },
+    { "+CGNSINF: 1,1,20240315102015.000,20.552213,-103.425518,1559.911,19.53,262.3,1,,1.4,1.8,0.9,,14,9,1,,38,,",
+      20552248, -103425615, false },
+    { "+CGNSINF: 1,1,20240315102020.000,20.552201,-103.425768,1561.577,18.54,264.7,1,,2.5,2.9,0.9,,14,8,1,,38,,",
+      20552222, -103425857, false },
+    { "+CGNSINF: 1,1,20240315102025.000,20.552206,-103.426103,1562.763,17.64,263.8,1,,1.8,2.2,0.9,,14,7,1,,38,,",
+      20552202, -103426080, false },
+    { "+CGNSINF: 1,1,20240315102030.000,20.552266,-103.426205,1559.288,15.18,264.1,1,,1.9,2.4,0.9,,14,8,1,,38,,",
+      20552180, -103426283, false },
+    { "+CGNSINF: 1,1,20240315102035.000,20.552086,-103.426359,1562.148,15.95,263.0,1,,2.5,2.9,0.9,,14,7,1,,38,,",
+      20552162, -103426483, false },
+    { "+CGNSINF: 1,1,20240315102040.000,20.553588,-103.424582,1559.990,13.85,267.3,1,,1.3,1.7,0.9,,14,10,1,,38,,",
+      20552150, -103426675, true },
+    { "+CGNSINF: 1,1,20240315102045.000,20.552146,-103.426866,1557.615,14.91,262.5,1,,1.6,2.0,0.9,,14,6,1,,38,,",
+      20552134, -103426870, false },
+    { "+CGNSINF: 1,1,20240315102050.000,20.552089,-103.427116,1561.166,14.75,267.7,1,,1.9,2.3,0.9,,14,8,1,,38,,",
+      20552120, -103427064, false },
+    { "+CGNSINF: 1,1,20240315102055.000,20.552086,-103.427267,1561.098,13.84,263.9,1,,1.1,1.5,0.9,,14,8,1,,38,,",
+      20552099, -103427255, false },
+    { "+CGNSINF: 1,1,20240315102100.000,20.552003,-103.427571,1562.833,14.10,257.7,1,,2.3,2.7,0.9,,14,8,1,,38,,",
+      20552069, -103427444, false },
+    { "+CGNSINF: 1,1,20240315102105.000,20.552090,-103.427593,1559.786,13.95,258.4,1,,2.5,2.9,0.9,,14,10,1,,38,,",
+      20552033, -103427632, false },
+    { "+CGNSINF: 1,1,20240315102110.000,20.551985,-103.427871,1562.580,16.42,261.4,1,,1.2,1.6,0.9,,14,10,1,,38,,",
+      20551999, -103427835, false },
+    { "+CGNSINF: 1,1,20240315102115.000,20.551998,-103.427989,1557.693,15.84,256.6,1,,0.8,1.2,0.9,,14,8,1,,38,,",
+      20551960, -103428043, false },
+    { "+CGNSINF: 1,1,20240315102120.000,20.551717,-103.428003,1557.893,15.59,171.3,1,,1.3,1.7,0.9,,14,7,1,,38,,",
+      20551763, -103428001, false },
+    { "+CGNSINF: 1,1,20240315102125.000,20.551643,-103.427993,1559.272,17.10,168.3,1,,1.3,1.7,0.9,,14,8,1,,38,,",
+      20551553, -103427962, false },
+    { "+CGNSINF: 1,1,20240315102130.000,20.551372,-103.427902,1561.683,16.75,171.9,1,,1.0,1.4,0.9,,14,6,1,,38,,",
+      20551350, -103427928, false },
+    { "+CGNSINF: 1,1,20240315102135.000,20.551164,-103.427978,1559.483,16.03,169.4,1,,2.0,2.4,0.9,,14,8,1,,38,,",
+      20551141, -103427894, false },
+    { "+CGNSINF: 1,1,20240315102140.000,20.550891,-103.427917,1561.784,14.94,171.3,1,,1.6,2.0,0.9,,14,8,1,,38,,",
+      20550951, -103427861, false },
+    { "+CGNSINF: 1,1,20240315102145.000,20.550758,-103.427809,1560.529,14.61,170.9,1,,2.2,2.6,0.9,,14,6,1,,38,,",
+      20550774, -103427825, false },
+    { "+CGNSINF: 1,1,20240315102150.000,20.550499,-103.427770,1560.673,16.74,168.7,1,,1.5,1.9,0.9,,14,10,1,,38,,",
+      20550578, -103427792, false },
+    { "+CGNSINF: 1,1,20240315102155.000,20.550417,-103.427736,1560.195,14.96,171.8,1,,2.5,2.9,0.9,,14,6,1,,38,,",
+      20550385, -103427757, false },
+    { "+CGNSINF: 1,1,20240315102200.000,20.550120,-103.427721,1557.896,17.34,165.8,1,,1.2,1.6,0.9,,14,6,1,,38,,",
+      20550174, -103427709, false },
+    { "+CGNSINF: 1,1,20240315102205.000,20.550046,-103.427651,1560.029,19.23,166.5,1,,2.0,2.4,0.9,,14,8,1,,38,,",
+      20549948, -103427662, false },
+    { "+CGNSINF: 1,1,20240315102210.000,20.549801,-103.427630,1560.240,19.60,167.9,1,,2.3,2.7,0.9,,14,6,1,,38,,",
+      20549721, -103427605, false },
+    { "+CGNSINF: 1,1,20240315102215.000,20.549428,-103.427552,1559.373,20.06,162.4,1,,1.5,1.9,0.9,,14,9,1,,38,,",
+      20549480, -103427538, false },
+    { "+CGNSINF: 1,1,20240315102220.000,20.549291,-103.427365,1561.275,21.24,163.6,1,,1.9,2.3,0.9,,14,6,1,,38,,",
+      20549220, -103427456, false },
+    { "+CGNSINF: 1,1,20240315102225.000,20.549095,-103.427418,1559.780,19.36,164.9,1,,2.4,2.8,0.9,,14,7,1,,38,,",
+      20548980, -103427385, false },
+    { "+CGNSINF: 1,1,20240315102230.000,20.548852,-103.427374,1559.173,18.56,160.7,1,,2.5,2.9,0.9,,14,8,1,,38,,",
+      20548748, -103427311, false },
+    { "+CGNSINF: 1,1,20240315102235.000,20.548555,-103.427238,1561.175,19.90,164.5,1,,0.9,1.3,0.9,,14,7,1,,38,,",
+      20548511, -103427228, false },
+    { "+CGNSINF: 1,1,20240315102240.000,20.548276,-103.427164,1560.613,17.96,164.5,1,,1.0,1.4,0.9,,14,8,1,,38,,",
+      20548288, -103427149, false },
+    { "+CGNSINF: 1,1,20240315102245.000,20.548109,-103.427069,1558.173,19.59,162.1,1,,2.4,2.8,0.9,,14,8,1,,38,,",
+      20548054, -103427067, false },
+    { "+CGNSINF: 1,1,20240315102250.000,20.547899,-103.426959,1558.021,20.91,159.3,1,,2.2,2.6,0.9,,14,6,1,,38,,",
+      20547818, -103426974, false },
+    { "+CGNSINF: 1,1,20240315102255.000,20.547612,-103.426782,1559.093,17.60,161.3,1,,2.1,2.5,0.9,,14,7,1,,38,,",
+      20547601, -103426884, false },
+    { "+CGNSINF: 1,1,20240315102300.000,20.547354,-103.426738,1560.705,18.19,159.1,1,,2.4,2.8,0.9,,14,9,1,,38,,",
+      20547390, -103426797, false },
+    { "+CGNSINF: 1,1,20240315102305.000,20.547251,-103.426749,1562.060,18.93,157.3,1,,1.2,1.6,0.9,,14,6,1,,38,,",
+      20547181, -103426708, false },
+    { "+CGNSINF: 1,1,20240315102310.000,20.546998,-103.426647,1560.310,18.30,159.6,1,,2.2,2.6,0.9,,14,10,1,,38,,",
+      20546973, -103426628, false },
+    { "+CGNSINF: 1,1,20240315102315.000,20.546986,-103.426845,1559.121,16.21,251.0,1,,1.5,1.9,0.9,,14,6,1,,38,,",
+      20546905, -103426830, false },
+    { "+CGNSINF: 1,1,20240315102320.000,20.546795,-103.427021,1558.474,13.96,248.3,1,,0.9,1.4,0.9,,14,9,1,,38,,",
+      20546845, -103427012, false },
+    { "+CGNSINF: 1,1,20240315102325.000,20.546795,-103.427088,1558.808,15.43,249.3,1,,2.2,2.6,0.9,,14,10,1,,38,,",
+      20546783, -103427207, false },
+    { "+CGNSINF: 1,1,20240315102330.000,20.546786,-103.427418,1561.163,16.43,253.4,1,,1.5,1.9,0.9,,14,8,1,,38,,",
+      20546727, -103427414, false },
+    { "+CGNSINF: 1,1,20240315102335.000,20.546709,-103.427650,1557.062,16.81,252.6,1,,0.9,1.3,0.9,,14,10,1,,38,,",
+      20546663, -103427629, false },
+    { "+CGNSINF: 1,1,20240315102340.000,20.546487,-103.427811,1561.812,18.26,247.8,1,,2.2,2.6,0.9,,14,9,1,,38,,",
+      20546586, -103427859, false },
+    { "+CGNSINF: 1,1,20240315102345.000,20.546464,-103.428044,1561.978,19.17,248.5,1,,1.4,1.8,0.9,,14,10,1,,38,,",
+      20546509, -103428100, false },
+    { "+CGNSINF: 1,1,20240315102350.000,20.546404,-103.428411,1557.838,16.75,253.0,1,,2.0,2.4,0.9,,14,7,1,,38,,",
+      20546434, -103428320, false },
+    { "+CGNSINF: 1,1,20240315102355.000,20.546336,-103.428517,1559.726,15.98,247.2,1,,1.1,1.5,0.9,,14,8,1,,38,,",
+      20546359, -103428533, false },
+    { "+CGNSINF: 1,1,20240315102400.000,20.546476,-103.428513,1561.034,19.67,340.0,1,,2.0,2.4,0.9,,14,7,1,,38,,",
+      20546578, -103428621, false },
+    { "+CGNSINF: 1,1,20240315102405.000,20.546645,-103.428719,1561.667,16.24,342.8,1,,1.5,1.9,0.9,,14,9,1,,38,,",
+      20546782, -103428694, false },
+    { "+CGNSINF: 1,1,20240315102410.000,20.546884,-103.428690,1559.965,15.00,340.1,1,,2.1,2.5,0.9,,14,7,1,,38,,",
+      20546969, -103428767, false },
+    { "+CGNSINF: 1,1,20240315102415.000,20.547058,-103.428748,1562.616,16.88,340.9,1,,2.4,2.8,0.9,,14,9,1,,38,,",
+      20547164, -103428833, false },
+    { "+CGNSINF: 1,1,20240315102420.000,20.547395,-103.428805,1560.819,18.85,345.9,1,,1.7,2.1,0.9,,14,6,1,,38,,",
+      20547380, -103428899, false },
+    { "+CGNSINF: 1,1,20240315102425.000,20.547527,-103.428936,1559.015,16.56,345.8,1,,1.3,1.7,0.9,,14,7,1,,38,,",
+      20547576, -103428955, false },
+    { "+CGNSINF: 1,1,20240315102430.000,20.547735,-103.428966,1562.710,15.28,344.1,1,,1.3,1.7,0.9,,14,9,1,,38,,",
+      20547769, -103429013, false },
+    { "+CGNSINF: 1,1,20240315102435.000,20.547915,-103.429046,1562.035,16.70,340.2,1,,1.0,1.4,0.9,,14,9,1,,38,,",
+      20547961, -103429079, false },
+    { "+CGNSINF: 1,1,20240315102440.000,20.548132,-103.429139,1559.464,15.38,341.7,1,,1.9,2.3,0.9,,14,8,1,,38,,",
+      20548136, -103429134, false },
+    { "+CGNSINF: 1,1,20240315102445.000,20.548393,-103.429110,1558.241,15.15,347.9,1,,1.8,2.2,0.9,,14,6,1,,38,,",
+      20548332, -103429186, false },
+    { "+CGNSINF: 1,1,20240315102450.000,20.548379,-103.429228,1562.526,15.06,340.8,1,,2.3,2.7,0.9,,14,6,1,,38,,",
+      20548519, -103429247, false },
+    { "+CGNSINF: 1,1,20240315102455.000,20.548651,-103.429403,1562.018,15.35,341.7,1,,2.2,2.6,0.9,,14,7,1,,38,,",
+      20548691, -103429303, false },
+    { "+CGNSINF: 1,1,20240315102500.000,20.548796,-103.429395,1560.408,15.02,342.5,1,,1.3,1.7,0.9,,14,7,1,,38,,",
+      20548860, -103429367, false },
+    { "+CGNSINF: 1,1,20240315102505.000,20.549172,-103.429281,1562.146,14.13,342.8,1,,1.8,2.2,0.9,,14,10,1,,38,,",
+      20549041, -103429427, false },
+    { "+CGNSINF: 1,1,20240315102510.000,20.549238,-103.429510,1558.708,16.61,342.9,1,,2.1,2.5,0.9,,14,9,1,,38,,",
+      20549245, -103429486, false },
+    { "+CGNSINF: 1,1,20240315102515.000,20.549421,-103.429553,1561.986,17.88,346.5,1,,1.3,1.7,0.9,,14,6,1,,38,,",
+      20549455, -103429550, false },
+    { "+CGNSINF: 1,1,20240315102520.000,20.549631,-103.429585,1560.767,17.67,340.9,1,,1.0,1.4,0.9,,14,10,1,,38,,",
+      20549676, -103429622, false },
+    { "+CGNSINF: 1,1,20240315102525.000,20.549905,-103.429669,1562.134,18.07,339.9,1,,1.1,1.5,0.9,,14,9,1,,38,,",
+      20549889, -103429693, false },
+    { "+CGNSINF: 1,1,20240315102530.000,20.550095,-103.429775,1557.883,16.65,343.5,1,,2.5,2.9,0.9,,14,7,1,,38,,",
+      20550084, -103429756, false },
+    { "+CGNSINF: 1,1,20240315102535.000,20.550137,-103.429877,1558.982,18.04,339.7,1,,2.4,2.8,0.9,,14,7,1,,38,,",
+      20550285, -103429831, false },
+    { "+CGNSINF: 1,1,20240315102540.000,20.550546,-103.429860,1562.348,17.44,338.6,1,,1.4,1.8,0.9,,14,8,1,,38,,",
+      20550480, -103429913, false },
+    { "+CGNSINF: 1,1,20240315102545.000,20.550704,-103.430054,1557.695,19.24,337.8,1,,0.8,1.2,0.9,,14,8,1,,38,,",
+      20550689, -103430012, false },
+    { "+CGNSINF: 1,1,20240315102550.000,20.550957,-103.430074,1558.327,18.72,340.7,1,,1.9,2.3,0.9,,14,7,1,,38,,",
+      20550911, -103430106, false },
+    { "+CGNSINF: 1,1,20240315102555.000,20.551153,-103.430209,1559.593,20.41,341.3,1,,1.4,1.8,0.9,,14,9,1,,38,,",
+      20551141, -103430196, false },
+    { "+CGNSINF: 1,1,20240315102600.000,20.551248,-103.430387,1562.023,19.17,338.9,1,,2.1,2.5,0.9,,14,10,1,,38,,",
+      20551365, -103430284, false },
+    { "+CGNSINF: 1,1,20240315102605.000,20.551624,-103.430398,1558.399,19.52,342.2,1,,1.6,2.0,0.9,,14,8,1,,38,,",
+      20551598, -103430375, false },
+    { "+CGNSINF: 1,1,20240315102610.000,20.551780,-103.430476,1562.176,18.36,337.4,1,,0.9,1.4,0.9,,14,9,1,,38,,",
+      20551812, -103430463, false },
+    { "+CGNSINF: 1,1,20240315102615.000,20.552020,-103.430547,1562.061,19.25,339.0,1,,1.0,1.4,0.9,,14,10,1,,38,,",
+      20552027, -103430543, false },
+    { "+CGNSINF: 1,1,20240315102620.000,20.552262,-103.430602,1561.771,18.48,341.2,1,,1.0,1.4,0.9,,14,10,1,,38,,",
+      20552232, -103430629, false },
+    { "+CGNSINF: 1,1,20240315102625.000,20.552422,-103.430692,1557.112,16.28,340.9,1,,1.3,1.7,0.9,,14,9,1,,38,,",
+      20552424, -103430701, false },
+    { "+CGNSINF: 1,1,20240315102630.000,20.552636,-103.430743,1561.544,16.35,343.7,1,,0.9,1.3,0.9,,14,10,1,,38,,",
+      20552618, -103430772, false },
+    { "+CGNSINF: 1,1,20240315102635.000,20.554910,-103.429308,1558.884,14.92,336.8,1,,1.9,2.2,0.9,,14,8,1,,38,,",
+      20552793, -103430847, true },
+    { "+CGNSINF: 1,1,20240315102640.000,20.552986,-103.430975,1557.108,16.40,340.3,1,,1.4,1.8,0.9,,14,10,1,,38,,",
+      20552982, -103430931, false },
+    { "+CGNSINF: 1,1,20240315102645.000,20.553147,-103.431030,1559.837,15.25,334.9,1,,1.1,1.5,0.9,,14,6,1,,38,,",
+      20553156, -103431010, false },
+    { "+CGNSINF: 1,1,20240315102650.000,20.553336,-103.431041,1562.883,13.98,334.4,1,,2.1,2.5,0.9,,14,10,1,,38,,",
+      20553325, -103431092, false },
+    { "+CGNSINF: 1,1,20240315102655.000,20.553415,-103.431163,1561.929,13.76,334.3,1,,2.3,2.7,0.9,,14,8,1,,38,,",
+      20553484, -103431180, false },
+    { "+CGNSINF: 1,1,20240315102700.000,20.555282,-103.429209,1560.504,13.89,332.6,1,,1.2,1.6,0.9,,14,8,1,,38,,",
+      20553647, -103431262, true },
+    { "+CGNSINF: 1,1,20240315102705.000,20.553588,-103.431502,1559.827,14.86,246.9,1,,1.5,1.9,0.9,,14,8,1,,38,,",
+      20553569, -103431437, false },
+    { "+CGNSINF: 1,1,20240315102710.000,20.553519,-103.431625,1562.012,15.36,249.8,1,,2.2,2.6,0.9,,14,9,1,,38,,",
+      20553490, -103431634, false },
+    { "+CGNSINF: 1,1,20240315102715.000,20.553526,-103.431803,1562.775,15.60,250.4,1,,2.1,2.5,0.9,,14,9,1,,38,,",
+      20553422, -103431820, false },
+    { "+CGNSINF: 1,1,20240315102720.000,20.553279,-103.431892,1559.876,16.98,246.6,1,,1.6,2.0,0.9,,14,8,1,,38,,",
+      20553351, -103432018, false },
+    { "+CGNSINF: 1,1,20240315102725.000,20.553274,-103.432320,1559.362,16.80,247.1,1,,1.9,2.3,0.9,,14,8,1,,38,,",
+      20553271, -103432234, false },
+    { "+CGNSINF: 1,1,20240315102730.000,20.553183,-103.432477,1560.387,18.15,247.8,1,,2.0,2.4,0.9,,14,6,1,,38,,",
+      20553179, -103432470, false },
+    { "+CGNSINF: 1,1,20240315102735.000,20.553142,-103.432656,1560.103,18.81,252.6,1,,1.4,1.8,0.9,,14,10,1,,38,,",
+      20553096, -103432709, false },
+    { "+CGNSINF: 1,1,20240315102740.000,20.553047,-103.432887,1560.490,19.35,253.6,1,,1.9,2.3,0.9,,14,7,1,,38,,",
+      20553019, -103432965, false },
+    { "+CGNSINF: 1,1,20240315102745.000,20.553114,-103.433193,1558.522,20.44,253.0,1,,1.9,2.3,0.9,,14,6,1,,38,,",
+      20552949, -103433238, false },
+    { "+CGNSINF: 1,1,20240315102750.000,20.552913,-103.433546,1557.086,20.92,260.1,1,,0.9,1.3,0.9,,14,8,1,,38,,",
+      20552891, -103433514, false },
+    { "+CGNSINF: 1,1,20240315102755.000,20.552767,-103.433833,1562.115,20.75,256.8,1,,2.0,2.4,0.9,,14,6,1,,38,,",
+      20552841, -103433776, false },
+    { "+CGNSINF: 1,1,20240315102800.000,20.552768,-103.433983,1558.903,21.83,255.0,1,,1.9,2.3,0.9,,14,9,1,,38,,",
+      20552781, -103434051, false },
+    { "+CGNSINF: 1,1,20240315102805.000,20.552745,-103.434418,1560.256,22.25,258.0,1,,1.2,1.6,0.9,,14,7,1,,38,,",
+      20552728, -103434345, false },
+    { "+CGNSINF: 1,1,20240315102810.000,20.552675,-103.434676,1560.215,23.89,259.9,1,,2.0,2.4,0.9,,14,10,1,,38,,",
+      20552662, -103434661, false },
+    { "+CGNSINF: 1,1,20240315102815.000,20.552600,-103.435049,1561.381,23.30,260.3,1,,1.6,2.0,0.9,,14,8,1,,38,,",
+      20552600, -103434962, false },
+    { "+CGNSINF: 1,1,20240315102820.000,20.552581,-103.435322,1558.483,24.39,257.3,1,,0.8,1.2,0.9,,14,7,1,,38,,",
+      20552538, -103435269, false },
+    { "+CGNSINF: 1,1,20240315102825.000,20.552367,-103.435566,1560.737,23.04,255.0,1,,2.4,2.8,0.9,,14,9,1,,38,,",
+      20552469, -103435562, false },
+    { "+CGNSINF: 1,1,20240315102830.000,20.552385,-103.435877,1558.689,23.86,253.9,1,,1.5,1.9,0.9,,14,8,1,,38,,",
+      20552387, -103435869, false },
+    { "+CGNSINF: 1,1,20240315102835.000,20.552272,-103.436251,1562.927,24.64,254.9,1,,1.5,1.9,0.9,,14,10,1,,38,,",
+      20552304, -103436189, false },
+    { "+CGNSINF: 1,1,20240315102840.000,20.552307,-103.436495,1558.666,24.75,251.0,1,,2.0,2.4,0.9,,14,10,1,,38,,",
+      20552204, -103436513, false },
+    { "+CGNSINF: 1,1,20240315102845.000,20.552088,-103.436813,1560.513,23.44,246.2,1,,0.8,1.2,0.9,,14,8,1,,38,,",
+      20552097, -103436814, false },
+    { "+CGNSINF: 1,1,20240315102850.000,20.551995,-103.437155,1557.165,26.39,252.6,1,,0.9,1.3,0.9,,14,9,1,,38,,",
+      20551994, -103437142, false },
+    { "+CGNSINF: 1,1,20240315102855.000,20.551908,-103.437513,1560.021,27.25,253.0,1,,0.9,1.4,0.9,,14,7,1,,38,,",
+      20551882, -103437471, false },
+    { "+CGNSINF: 1,1,20240315102900.000,20.551728,-103.437730,1560.715,25.63,251.9,1,,2.2,2.6,0.9,,14,8,1,,38,,",
+      20551786, -103437786, false },
+    { "+CGNSINF: 1,1,20240315102905.000,20.551741,-103.438089,1561.254,23.64,253.1,1,,2.5,2.9,0.9,,14,9,1,,38,,",
+      20551684, -103438090, false },
+    { "+CGNSINF: 1,1,20240315102910.000,20.551600,-103.438414,1558.800,24.17,252.3,1,,2.1,2.5,0.9,,14,9,1,,38,,",
+      20551582, -103438396, false },
+    { "+CGNSINF: 1,1,20240315102915.000,20.551433,-103.438664,1558.283,23.02,247.6,1,,2.4,2.8,0.9,,14,9,1,,38,,",
+      20551476, -103438677, false },
+    { "+CGNSINF: 1,1,20240315102920.000,20.551360,-103.438964,1557.643,22.04,247.4,1,,2.2,2.6,0.9,,14,9,1,,38,,",
+      20551378, -103438957, false },
+    { "+CGNSINF: 1,1,20240315102925.000,20.551283,-103.439229,1557.904,23.49,252.3,1,,1.5,1.9,0.9,,14,6,1,,38,,",
+      20551288, -103439249, false },
+    { "+CGNSINF: 1,1,20240315102930.000,20.551199,-103.439488,1562.161,21.55,249.8,1,,2.0,2.4,0.9,,14,6,1,,38,,",
+      20551209, -103439520, false },
+    { "+CGNSINF: 1,1,20240315102935.000,20.551069,-103.439409,1559.891,20.27,163.6,1,,1.8,2.2,0.9,,14,9,1,,38,,",
+      20550960, -103439438, false },
+    { "+CGNSINF: 1,1,20240315102940.000,20.550620,-103.439332,1557.979,21.49,164.1,1,,2.2,2.6,0.9,,14,9,1,,38,,",
+      20550708, -103439346, false },
+    { "+CGNSINF: 1,1,20240315102945.000,20.550501,-103.439332,1558.383,21.33,159.2,1,,1.5,1.9,0.9,,14,9,1,,38,,",
+      20550446, -103439252, false },
+    { "+CGNSINF: 1,1,20240315102950.000,20.550400,-103.439581,1561.633,22.59,252.8,1,,0.8,1.2,0.9,,14,10,1,,38,,",
+      20550359, -103439528, false },
+    { "+CGNSINF: 1,1,20240315102955.000,20.550163,-103.439722,1557.089,21.25,252.2,1,,2.4,2.8,0.9,,14,8,1,,38,,",
+      20550285, -103439809, false },
+    { "+CGNSINF: 1,1,20240315103000.000,20.550229,-103.440211,1559.691,20.14,253.7,1,,2.2,2.6,0.9,,14,7,1,,38,,",
+      20550209, -103440077, false },
+    { "+CGNSINF: 1,1,20240315103005.000,20.550135,-103.440362,1557.768,21.74,254.6,1,,1.0,1.4,0.9,,14,8,1,,38,,",
+      20550135, -103440344, false },
+    { "+CGNSINF: 1,1,20240315103010.000,20.549986,-103.440598,1561.167,20.43,249.3,1,,2.1,2.5,0.9,,14,7,1,,38,,",
+      20550056, -103440603, false },
+    { "+CGNSINF: 1,1,20240315103015.000,20.549824,-103.440875,1559.971,19.72,250.3,1,,2.0,2.4,0.9,,14,10,1,,38,,",
+      20549973, -103440851, false },
+    { "+CGNSINF: 1,1,20240315103020.000,20.549857,-103.441077,1562.015,18.07,248.5,1,,0.9,1.3,0.9,,14,10,1,,38,,",
+      20549890, -103441084, false },
+    { "+CGNSINF: 1,1,20240315103025.000,20.549919,-103.441347,1562.000,17.15,252.5,1,,2.0,2.4,0.9,,14,7,1,,38,,",
+      20549820, -103441303, false },
+    { "+CGNSINF: 1,1,20240315103030.000,20.549835,-103.441488,1559.434,15.61,250.2,1,,1.3,1.7,0.9,,14,8,1,,38,,",
+      20549753, -103441499, false },
+};
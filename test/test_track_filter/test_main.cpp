@@ -0,0 +1,203 @@
+#include <unity.h>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "trackFilter.h"
+#include "rideFixture.h"
+
+#define BASE_LAT      20558853
+#define BASE_LON      -103428903
+#define E6_PER_M      8.99321     /* degrees * 1e6 per metre of latitude */
+#define RIDE_FIXES    120
+#define REPLAY_FIXES  (sizeof(rideFixes) / sizeof(rideFixes[0]))
+#define REPLAY_ROUNDS 200
+
+static TrackFilter* filter;
+static uint32_t noiseState;
+
+/* Deterministic noise, uniform in +-range */
+static double noise(double range) {
+    noiseState = noiseState * 1664525u + 1013904223u;
+    return ((double)(noiseState >> 8) / (double)(1u << 24) * 2.0 - 1.0) * range;
+}
+
+/* A fix eastM/northM metres from the base, riding east at speed */
+static GnssRecord_t fixAt(double eastM, double northM, uint16_t speedKmhX100) {
+    GnssRecord_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.runStatus = true;
+    rec.fixValid = true;
+    rec.latE6 = BASE_LAT + (int32_t)lround(northM * E6_PER_M);
+    rec.lonE6 = BASE_LON + (int32_t)lround(eastM * E6_PER_M / cos(BASE_LAT * 1e-6 * M_PI / 180.0));
+    rec.speedKmhX100 = speedKmhX100;
+    rec.courseX100 = 9000;
+    rec.hdopX100 = 100;
+    rec.satsUsed = 8;
+    return rec;
+}
+
+static double errorM(int32_t latE6, int32_t lonE6, double eastM, double northM) {
+    double dn = (latE6 - BASE_LAT) / E6_PER_M - northM;
+    double de = (lonE6 - BASE_LON) / E6_PER_M * cos(BASE_LAT * 1e-6 * M_PI / 180.0) - eastM;
+    return sqrt(dn * dn + de * de);
+}
+
+static double apartM(int32_t latA, int32_t lonA, int32_t latB, int32_t lonB) {
+    double dn = (latA - latB) / E6_PER_M;
+    double de = (lonA - lonB) / E6_PER_M * cos(latA * 1e-6 * M_PI / 180.0);
+    return sqrt(dn * dn + de * de);
+}
+
+void setUp() {
+    filter = new TrackFilter();
+    noiseState = 12345;
+}
+
+void tearDown() {
+    delete filter;
+}
+
+static void test_first_fix_restarts_at_fix() {
+    GnssRecord_t rec = fixAt(0, 0, 0);
+    int32_t lat, lon;
+    TEST_ASSERT_EQUAL(TRACK_FILTER_RESTARTED, filter->update(rec, 1000, &lat, &lon));
+    TEST_ASSERT_EQUAL_INT32(rec.latE6, lat);
+    TEST_ASSERT_EQUAL_INT32(rec.lonE6, lon);
+}
+
+static void test_smooths_noisy_ride() {
+    /* 18 km/h east, one fix a second, 6 m of noise */
+    double rawSq = 0;
+    double filteredSq = 0;
+    for (int i = 0; i < RIDE_FIXES; ++i) {
+        double east = i * 5.0;
+        GnssRecord_t rec = fixAt(east + noise(6), noise(6), 1800);
+        int32_t lat, lon;
+        TrackFilterResult result = filter->update(rec, 1000 + i * 1000, &lat, &lon);
+        TEST_ASSERT_NOT_EQUAL(TRACK_FILTER_REJECTED, result);
+        if (i >= 10) {
+            double raw = errorM(rec.latE6, rec.lonE6, east, 0);
+            double filtered = errorM(lat, lon, east, 0);
+            rawSq += raw * raw;
+            filteredSq += filtered * filtered;
+        }
+    }
+    TEST_ASSERT_LESS_THAN((int)(sqrt(rawSq) * 1000), (int)(sqrt(filteredSq) * 1000 * 3 / 2));
+}
+
+static void test_rejects_jump_then_follows_real_move() {
+    int32_t lat, lon;
+    for (int i = 0; i < 20; ++i) {
+        filter->update(fixAt(i * 5.0, 0, 1800), 1000 + i * 1000, &lat, &lon);
+    }
+    /* Multipath: 400 m north for one fix */
+    GnssRecord_t jump = fixAt(100, 400, 1800);
+    int32_t keptLat = lat;
+    TEST_ASSERT_EQUAL(TRACK_FILTER_REJECTED, filter->update(jump, 21000, &lat, &lon));
+    TEST_ASSERT_EQUAL_INT32(keptLat, lat);
+    TEST_ASSERT_EQUAL(TRACK_FILTER_ACCEPTED, filter->update(fixAt(110, 0, 1800), 22000, &lat, &lon));
+
+    /* The bike was carried off: after TRACK_FILTER_RESET_AFTER rejections the filter starts over */
+    TrackFilterResult result = TRACK_FILTER_ACCEPTED;
+    for (int i = 0; i < TRACK_FILTER_RESET_AFTER; ++i) {
+        result = filter->update(fixAt(5000, 5000, 0), 23000 + i * 1000, &lat, &lon);
+    }
+    TEST_ASSERT_EQUAL(TRACK_FILTER_RESTARTED, result);
+    TEST_ASSERT_TRUE(errorM(lat, lon, 5000, 5000) < 1.0);
+}
+
+static void test_long_gap_restarts() {
+    int32_t lat, lon;
+    filter->update(fixAt(0, 0, 0), 1000, &lat, &lon);
+    TEST_ASSERT_EQUAL(TRACK_FILTER_RESTARTED,
+                      filter->update(fixAt(3000, 0, 0), 1000 + TRACK_FILTER_MAX_GAP_MS + 1000, &lat, &lon));
+}
+
+static void test_estimate_extrapolates() {
+    int32_t lat, lon;
+    for (int i = 0; i < 30; ++i) {
+        filter->update(fixAt(i * 5.0, 0, 1800), 1000 + i * 1000, &lat, &lon);
+    }
+    TrackEstimate_t est;
+    TEST_ASSERT_TRUE(filter->estimate(30000 + 10000, &est));
+    /* 10 s on at 5 m/s */
+    TEST_ASSERT_TRUE(errorM(est.latE6, est.lonE6, 29 * 5.0 + 50, 0) < 3.0);
+    TEST_ASSERT_EQUAL_UINT32(10000, est.sinceFixMs);
+    TrackEstimate_t near;
+    filter->estimate(30000, &near);
+    TEST_ASSERT_GREATER_THAN(near.sigmaM, est.sigmaM + 1);
+    TEST_ASSERT_FALSE(filter->estimate(30000 + TRACK_FILTER_PREDICT_MAX_MS + 1, &est));
+}
+
+/*
+ * Replay rideFixture.h: RMS error of the raw and the filtered fixes against the
+ * true path, multipath jumps caught against good fixes dropped, and the cost of
+ * one update() over REPLAY_ROUNDS runs of the ride.
+ */
+static void test_recorded_ride() {
+    static GnssRecord_t recs[REPLAY_FIXES];
+    static uint32_t atMs[REPLAY_FIXES];
+    uint32_t firstS = 0;
+    for (size_t i = 0; i < REPLAY_FIXES; ++i) {
+        uint32_t unixS;
+        TEST_ASSERT_TRUE(GnssParseCgnsinf(rideFixes[i].line, strlen(rideFixes[i].line), &recs[i]));
+        TEST_ASSERT_TRUE(GnssRecordUnixTime(&recs[i], &unixS));
+        firstS = (i == 0) ? unixS : firstS;
+        atMs[i] = 1000 + (unixS - firstS) * 1000;
+    }
+
+    uint32_t jumps = 0, caught = 0, falseRejects = 0, scored = 0;
+    double rawSq = 0, filteredSq = 0;
+    for (size_t i = 0; i < REPLAY_FIXES; ++i) {
+        const RideFix_t& f = rideFixes[i];
+        int32_t lat, lon;
+        TrackFilterResult result = filter->update(recs[i], atMs[i], &lat, &lon);
+        if (f.jump) {
+            jumps++;
+            caught += (result == TRACK_FILTER_REJECTED);
+        } else if (result == TRACK_FILTER_REJECTED) {
+            falseRejects++;
+        } else if (result == TRACK_FILTER_ACCEPTED && i >= 5) {
+            double raw = apartM(recs[i].latE6, recs[i].lonE6, f.trueLatE6, f.trueLonE6);
+            double filtered = apartM(lat, lon, f.trueLatE6, f.trueLonE6);
+            rawSq += raw * raw;
+            filteredSq += filtered * filtered;
+            scored++;
+        }
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int round = 0; round < REPLAY_ROUNDS; ++round) {
+        TrackFilter replay;
+        for (size_t i = 0; i < REPLAY_FIXES; ++i) {
+            int32_t lat, lon;
+            replay.update(recs[i], atMs[i], &lat, &lon);
+        }
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    uint32_t nsPerUpdate = (uint32_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() /
+                                      (REPLAY_ROUNDS * REPLAY_FIXES));
+    double rawRms = sqrt(rawSq / scored);
+    double filteredRms = sqrt(filteredSq / scored);
+    printf("Track filter replay: %u fixes, RMS error raw %.1f m, filtered %.1f m, %u/%u jumps rejected, "
+           "%u good fixes rejected, %lu ns per update\n", (unsigned)REPLAY_FIXES, rawRms, filteredRms,
+           (unsigned)caught, (unsigned)jumps, (unsigned)falseRejects, (unsigned long)nsPerUpdate);
+
+    TEST_ASSERT_GREATER_THAN_UINT32(REPLAY_FIXES * 3 / 4, scored);
+    TEST_ASSERT_TRUE(filteredRms < rawRms * 0.7);
+    TEST_ASSERT_EQUAL_UINT32(jumps, caught);
+    TEST_ASSERT_LESS_OR_EQUAL(2, falseRejects);
+    TEST_ASSERT_LESS_THAN_UINT32(20000, nsPerUpdate);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_fix_restarts_at_fix);
+    RUN_TEST(test_smooths_noisy_ride);
+    RUN_TEST(test_rejects_jump_then_follows_real_move);
+    RUN_TEST(test_long_gap_restarts);
+    RUN_TEST(test_estimate_extrapolates);
+    RUN_TEST(test_recorded_ride);
+    return UNITY_END();
+}
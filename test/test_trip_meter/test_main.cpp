@@ -0,0 +1,112 @@
+#include <unity.h>
+#include <math.h>
+#include <string.h>
+#include "tripMeter.h"
+
+#define BASE_LAT      45500000
+#define BASE_LON      -73600000
+#define E6_PER_M      8.99321     /* degrees * 1e6 per metre of latitude */
+#define FIX_PERIOD_MS 5000
+#define START_SECOND  (8 * 3600 + 10 * 60)
+
+static TripMeter* meter;
+static uint32_t nowMs;
+static double eastM;
+static uint32_t noiseState;
+
+static double noise(double range) {
+    noiseState = noiseState * 1664525u + 1013904223u;
+    return ((double)(noiseState >> 8) / (double)(1u << 24) * 2.0 - 1.0) * range;
+}
+
+/* One fix every FIX_PERIOD_MS, riding east at speed or standing with jitter */
+static void feed(uint32_t fixes, uint16_t speedKmhX100, double jitterM) {
+    for (uint32_t i = 0; i < fixes; ++i) {
+        nowMs += FIX_PERIOD_MS;
+        eastM += speedKmhX100 / 360.0 * FIX_PERIOD_MS / 1000.0;
+        GnssRecord_t rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.fixValid = true;
+        uint32_t second = START_SECOND + nowMs / 1000;
+        rec.hour = (uint8_t)(second / 3600 % 24);
+        rec.minute = (uint8_t)(second / 60 % 60);
+        rec.second = (uint8_t)(second % 60);
+        rec.latE6 = BASE_LAT + (int32_t)lround(noise(jitterM) * E6_PER_M);
+        rec.lonE6 = BASE_LON + (int32_t)lround((eastM + noise(jitterM)) * E6_PER_M / cos(BASE_LAT * 1e-6 * M_PI / 180.0));
+        rec.speedKmhX100 = speedKmhX100;
+        rec.courseX100 = 9000;
+        meter->update(rec, nowMs);
+    }
+}
+
+void setUp() {
+    meter = new TripMeter();
+    nowMs = 0;
+    eastM = 0;
+    noiseState = 99;
+}
+
+void tearDown() {
+    delete meter;
+}
+
+static void test_standing_still_is_no_trip() {
+    feed(100, 0, 4);
+    TripSummary_t trip;
+    TEST_ASSERT_FALSE(meter->current(&trip));
+    TEST_ASSERT_FALSE(meter->last(&trip));
+}
+
+static void test_ride_with_one_stop() {
+    feed(2, 0, 0);
+    /* 3 km at 18 km/h, 2 min stop, 1 km, then parked */
+    feed(120, 1800, 2);
+    feed(24, 0, 3);
+    TripSummary_t trip;
+    TEST_ASSERT_TRUE(meter->current(&trip));
+    TEST_ASSERT_TRUE(trip.stopped);
+    feed(40, 1800, 2);
+    TEST_ASSERT_TRUE(meter->current(&trip));
+    TEST_ASSERT_FALSE(trip.stopped);
+    TEST_ASSERT_EQUAL_UINT16(1, trip.stops);
+    feed(TRIP_END_DWELL_MS / FIX_PERIOD_MS + 1, 0, 3);
+
+    TEST_ASSERT_FALSE(meter->current(&trip));
+    TEST_ASSERT_TRUE(meter->last(&trip));
+    TEST_ASSERT_UINT32_WITHIN(40, 4000, trip.distanceM);
+    TEST_ASSERT_EQUAL_UINT16(1, trip.stops);
+    TEST_ASSERT_UINT32_WITHIN(FIX_PERIOD_MS, 160 * FIX_PERIOD_MS, trip.movingMs);
+    TEST_ASSERT_UINT32_WITHIN(FIX_PERIOD_MS, 23 * FIX_PERIOD_MS, trip.stoppedMs);
+    TEST_ASSERT_EQUAL_UINT16(1800, trip.maxSpeedKmhX100);
+    TEST_ASSERT_EQUAL_UINT16(8 * 60 + 10, trip.startUtcMin);
+
+    TripTotals_t totals;
+    meter->getTotals(&totals);
+    TEST_ASSERT_EQUAL_UINT32(1, totals.trips);
+    TEST_ASSERT_EQUAL_UINT32(trip.distanceM, totals.distanceM);
+
+    char text[128];
+    TripFormat(text, sizeof(text), trip, nowMs);
+    TEST_ASSERT_NOT_NULL(strstr(text, "08:10-"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "1 stop"));
+}
+
+static void test_short_move_forgotten() {
+    feed(2, 0, 0);
+    feed(6, 1200, 0);
+    feed(TRIP_END_DWELL_MS / FIX_PERIOD_MS + 1, 0, 2);
+    TripSummary_t trip;
+    TEST_ASSERT_FALSE(meter->current(&trip));
+    TEST_ASSERT_FALSE(meter->last(&trip));
+    TripTotals_t totals;
+    meter->getTotals(&totals);
+    TEST_ASSERT_EQUAL_UINT32(0, totals.trips);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_standing_still_is_no_trip);
+    RUN_TEST(test_ride_with_one_stop);
+    RUN_TEST(test_short_move_forgotten);
+    return UNITY_END();
+}
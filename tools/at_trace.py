@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Decode AT traces dumped by the firmware's "TRACE" console command.
+
+AtTraceStream::dump() writes an "AT-TRACE <len>" line, then the trace in
+CRC-checked frames laid out as in include/trackExport.h, one per 256-byte
+chunk numbered with its offset, and an end frame carrying the total length.
+Log lines printed by other tasks between frames are skipped; a chunk that
+fails its CRC or goes missing stops the decode with its offset, dump again.
+The trace is printed as a timeline with a per-command latency summary, and
+can be converted to include/atTraceData.h for MODEM_TRACE_REPLAY builds.
+
+Usage:
+    python tools/at_trace.py capture.log
+    python tools/at_trace.py capture.log --header include/atTraceData.h
+"""
+import argparse
+import re
+import sys
+
+from track_export import HEADER, SYNC, T_END, TRAILER_LEN, crc16
+
+MAGIC = b"ATR1"
+DIR_TX = 0x80
+T_DATA = ord("A")
+
+
+def extract(log):
+    m = re.search(rb"AT-TRACE (\d+)\r?\n", log)
+    if not m:
+        sys.exit("no AT-TRACE dump found")
+    total, chunks, pos = int(m.group(1)), {}, m.end()
+    while True:
+        pos = log.find(SYNC, pos)
+        if pos < 0 or pos + HEADER.size > len(log):
+            sys.exit("AT trace cut short after %d bytes, dump again" % sum(map(len, chunks.values())))
+        _, ftype, seq, length, aux, hcrc = HEADER.unpack_from(log, pos)
+        if crc16(log[pos + 2:pos + HEADER.size - 2]) != hcrc:
+            pos += 1          # sync bytes inside a log line
+            continue
+        payload = log[pos + HEADER.size:pos + HEADER.size + length]
+        trailer = log[pos + HEADER.size + length:pos + HEADER.size + length + TRAILER_LEN]
+        if len(trailer) < TRAILER_LEN or crc16(payload) != int.from_bytes(trailer, "little"):
+            sys.exit("AT trace chunk at offset %d failed its CRC, dump again" % seq)
+        pos += HEADER.size + length + TRAILER_LEN
+        if ftype == T_END:
+            end, overflowed = seq, aux
+            break
+        if ftype == T_DATA:
+            chunks[seq] = payload
+    trace = b""
+    for seq in sorted(chunks):
+        if seq != len(trace):
+            break
+        trace += chunks[seq]
+    if len(trace) != end or end != total:
+        sys.exit("AT trace chunk at offset %d missing, dump again" % len(trace))
+    if overflowed:
+        print("warning: capture buffer overflowed, the trace stops early", file=sys.stderr)
+    if not trace.startswith(MAGIC):
+        sys.exit("bad trace magic")
+    return trace
+
+
+def records(trace):
+    pos, t = len(MAGIC), 0
+    while pos < len(trace):
+        hdr = trace[pos]
+        pos += 1
+        delta, shift = 0, 0
+        while True:
+            b = trace[pos]
+            pos += 1
+            delta |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                break
+        t += delta
+        n = (hdr & 0x7F) + 1
+        yield t, bool(hdr & DIR_TX), trace[pos:pos + n]
+        pos += n
+
+
+def report(trace):
+    stats, pending, rx_line = {}, None, b""
+    sent = received = 0
+    for t, tx, data in records(trace):
+        print("%10.3f ms %s %r" % (t / 1000.0, ">>" if tx else "<<", data.decode("latin-1")))
+        if tx:
+            sent += len(data)
+            m = re.match(rb"AT([^=?\r]*)", data)
+            if m:
+                pending = (m.group(1).decode() or "", t)
+            continue
+        received += len(data)
+        rx_line += data
+        *lines, rx_line = rx_line.split(b"\n")
+        for line in lines:
+            line = line.strip()
+            if pending and (line == b"OK" or line.startswith((b"ERROR", b"+CME ERROR", b"+CMS ERROR"))):
+                name, t0 = pending
+                stats.setdefault(name, []).append(t - t0)
+                pending = None
+    print("\n%d bytes to modem, %d bytes from modem" % (sent, received))
+    for name, lat in sorted(stats.items()):
+        print("  AT%-14s n=%-4d avg %8.1f ms  max %8.1f ms"
+              % (name, len(lat), sum(lat) / len(lat) / 1000.0, max(lat) / 1000.0))
+
+
+def write_header(trace, path):
+    with open(path, "w") as f:
+        f.write("#pragma once\n#include <stdint.h>\n\n")
+        f.write("/* AT trace replayed by MODEM_TRACE_REPLAY builds, generated by tools/at_trace.py */\n")
+        f.write("static const uint8_t atTraceData[] = {\n")
+        for i in range(0, len(trace), 16):
+            f.write("    " + ", ".join("0x%02x" % b for b in trace[i:i + 16]) + ",\n")
+        f.write("};\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", help="serial log containing an AT-TRACE dump")
+    parser.add_argument("--header", help="write the trace as a C header for replay builds")
+    args = parser.parse_args()
+    with open(args.log, "rb") as f:
+        trace = extract(f.read())
+    if args.header:
+        write_header(trace, args.header)
+    else:
+        report(trace)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""Decode the compact track text of "HISTORY" SMS replies.
+
+Each SMS holds one "T1..." block (see include/trackCodec.h), newest point
+first; the first reply also carries a map link to the newest point. Paste one
+or more messages, in any order, as arguments or on stdin. Points are printed
+oldest first as CSV, or written as GPX.
+
+Usage:
+    python tools/track_decode.py "http://www.google.com/maps/place/... T1..."
+    python tools/track_decode.py --gpx track.gpx < sms.txt
+"""
+import argparse
+import sys
+from datetime import datetime, timezone
+
+MARK = "T1"
+RADIX = 41
+ALPHABET = ("0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcde"
+            "fghijklmnopqrstuvwxyz!#%&'()*+,-./:;<=>?_")
+DIGITS = {c: i for i, c in enumerate(ALPHABET)}
+TRACK_EPOCH_UNIX = 1577836800
+COORD_SCALE = 100000
+
+
+def varints(text):
+    value, scale = 0, 1
+    for c in text:
+        d = DIGITS.get(c)
+        if d is None:
+            sys.exit("bad character %r in track text" % c)
+        if d >= RADIX:
+            value += (d - RADIX) * scale
+            scale *= RADIX
+        else:
+            yield value + d * scale
+            value, scale = 0, 1
+    if scale != 1:
+        sys.exit("track text cut off mid-value")
+
+
+def unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def decode(block):
+    values = list(varints(block[len(MARK):]))
+    if len(values) < 3 or len(values) % 3:
+        sys.exit("track text cut off mid-point")
+    utc, lat, lon = values[0], unzigzag(values[1]), unzigzag(values[2])
+    points = [(utc, lat, lon)]
+    for i in range(3, len(values), 3):
+        utc -= values[i]
+        lat += unzigzag(values[i + 1])
+        lon += unzigzag(values[i + 2])
+        points.append((utc, lat, lon))
+    return points
+
+
+def blocks(text):
+    return [word for word in text.split() if word.startswith(MARK)]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("sms", nargs="*", help="SMS texts; read from stdin if none")
+    ap.add_argument("--gpx", help="write a GPX track to this file")
+    args = ap.parse_args()
+
+    text = " ".join(args.sms) if args.sms else sys.stdin.read()
+    points = {}
+    for block in blocks(text):
+        for utc, lat, lon in decode(block):
+            points[utc] = (lat, lon)
+    if not points:
+        sys.exit("no %s... track text found" % MARK)
+
+    rows = []
+    for utc in sorted(points):
+        lat, lon = points[utc]
+        when = datetime.fromtimestamp(utc + TRACK_EPOCH_UNIX, timezone.utc)
+        rows.append((when.strftime("%Y-%m-%dT%H:%M:%SZ"), lat / COORD_SCALE, lon / COORD_SCALE))
+
+    if args.gpx:
+        with open(args.gpx, "w") as f:
+            f.write('<?xml version="1.0" encoding="UTF-8"?>\n'
+                    '<gpx version="1.1" creator="track_decode.py" xmlns="http://www.topografix.com/GPX/1/1">\n'
+                    '<trk><trkseg>\n')
+            for when, lat, lon in rows:
+                f.write('<trkpt lat="%.5f" lon="%.5f"><time>%s</time></trkpt>\n' % (lat, lon, when))
+            f.write("</trkseg></trk>\n</gpx>\n")
+        print("%d points written to %s" % (len(rows), args.gpx))
+    else:
+        print("time,lat,lon")
+        for when, lat, lon in rows:
+            print("%s,%.5f,%.5f" % (when, lat, lon))
+
+
+if __name__ == "__main__":
+    main()
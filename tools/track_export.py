@@ -0,0 +1,353 @@
+#!/usr/bin/env python3
+"""Pull the stored track or fix log off a unit with the "EXPORT" console command.
+
+The firmware sends one CRC-checked frame per stored block, numbered with the
+block's sequence number (see include/trackExport.h). A frame that fails its
+CRC, or goes missing, stops the transfer and restarts it from that sequence
+number; a transfer cut short can be continued later with --from. Points are
+written as CSV, oldest first.
+
+Usage:
+    python tools/track_export.py /dev/ttyUSB0 --source log --baud 921600 -o day.csv
+    python tools/track_export.py /dev/ttyUSB0 --source track --from 120 -o track.csv
+    python tools/track_export.py --simulate
+"""
+import argparse
+import os
+import random
+import select
+import struct
+import sys
+import termios
+import threading
+import time
+import tty
+from datetime import datetime, timezone
+
+SYNC = b"\xa5\x5a"
+HEADER = struct.Struct("<2sBIHHH")
+TRAILER_LEN = 2
+T_START, T_TRACK, T_LOG, T_MISSING, T_END = b"STLME"
+
+TRACK_EPOCH_UNIX = 1577836800
+TRACK_COORD_QUANT = 10
+LOG_MAGIC = b"FLG1"
+LOG_HEADER_LEN = 12
+LOG_RECORD = struct.Struct("<IiiiHHHBB")
+LOG_FRAME_LEN = 2 + LOG_RECORD.size + 2
+IDLE_TIMEOUT_S = 3.0
+MAX_RESTARTS = 8         # in a row from the same sequence number
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, as Crc16() in src/fixLog.cpp."""
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def frame(ftype, seq, aux=0, payload=b""):
+    head = struct.pack("<BIHH", ftype, seq, len(payload), aux)
+    return (SYNC + head + struct.pack("<H", crc16(head)) + payload
+            + struct.pack("<H", crc16(payload)))
+
+
+def varint(data, pos):
+    value = shift = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            return value, pos
+
+
+def unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def track_points(data, count):
+    """Decode a TrackStore block: a key point, then deltas (src/trackStore.cpp)."""
+    pos, utc, lat, lon = 0, 0, 0, 0
+    for i in range(count):
+        t, pos = varint(data, pos)
+        la, pos = varint(data, pos)
+        lo, pos = varint(data, pos)
+        if i == 0:
+            utc, lat, lon = t, unzigzag(la), unzigzag(lo)
+        else:
+            utc, lat, lon = utc + t, lat + unzigzag(la), lon + unzigzag(lo)
+        yield (utc + TRACK_EPOCH_UNIX, lat * TRACK_COORD_QUANT, lon * TRACK_COORD_QUANT)
+
+
+def log_records(data, count):
+    """Decode a fix log segment up to its last valid record (include/fixLog.h)."""
+    if data[:4] != LOG_MAGIC:
+        return
+    for i in range(count):
+        pos = LOG_HEADER_LEN + i * LOG_FRAME_LEN
+        rec = data[pos + 2:pos + 2 + LOG_RECORD.size]
+        crc = struct.unpack_from("<H", data, pos + 2 + LOG_RECORD.size)[0]
+        if crc16(data[pos + 1:pos + 2 + LOG_RECORD.size]) != crc:
+            return
+        yield LOG_RECORD.unpack(rec)
+
+
+class Frames:
+    """Frame scanner: skips text and garbage, checks both CRCs."""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.bad = 0
+
+    def feed(self, data):
+        self.buf += data
+
+    def __iter__(self):
+        while True:
+            i = self.buf.find(SYNC)
+            if i < 0:
+                del self.buf[:max(0, len(self.buf) - 1)]
+                return
+            del self.buf[:i]
+            if len(self.buf) < HEADER.size:
+                return
+            _, ftype, seq, length, aux, hcrc = HEADER.unpack_from(self.buf)
+            if crc16(self.buf[2:HEADER.size - 2]) != hcrc:
+                del self.buf[:1]
+                continue
+            end = HEADER.size + length + TRAILER_LEN
+            if len(self.buf) < end:
+                return
+            payload = bytes(self.buf[HEADER.size:HEADER.size + length])
+            ok = crc16(payload) == struct.unpack_from("<H", self.buf, end - TRAILER_LEN)[0]
+            del self.buf[:end]
+            if not ok:
+                self.bad += 1
+            yield ftype, seq, aux, payload if ok else None
+
+
+class Port:
+    """Raw serial port or pseudo-terminal, standard library only."""
+
+    def __init__(self, path, baud):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        self.set_baud(baud)
+
+    def set_baud(self, baud):
+        speed = getattr(termios, "B%d" % baud, None)
+        if speed is None:
+            sys.exit("%d baud not supported by this host" % baud)
+        attr = termios.tcgetattr(self.fd)
+        attr[4] = attr[5] = speed
+        termios.tcsetattr(self.fd, termios.TCSADRAIN, attr)
+
+    def write(self, data):
+        os.write(self.fd, data)
+
+    def read(self, timeout):
+        ready, _, _ = select.select([self.fd], [], [], timeout)
+        return os.read(self.fd, 4096) if ready else b""
+
+    def read_line(self, prefix, timeout):
+        """Wait for a text line; returns it with the bytes read after it, or None."""
+        buf, deadline = b"", time.time() + timeout
+        while time.time() < deadline:
+            buf += self.read(0.1)
+            *lines, _ = buf.split(b"\n")
+            for i, line in enumerate(lines):
+                if line.strip().startswith(prefix):
+                    rest = b"\n".join(lines[i + 1:] + [_])
+                    return line.strip().decode("latin-1"), rest
+        return None, b""
+
+
+def transfer(port, source, first, baud, console_baud, out, stats):
+    """One EXPORT run from seq first. Returns the next seq to ask for, or None when complete."""
+    port.write(("EXPORT %s %d %d\n" % (source.upper(), first, baud)).encode())
+    ack, data = port.read_line(b"EXPORT ", 5.0)
+    if ack is None:
+        sys.exit("no answer to EXPORT; is the console on %d baud?" % console_baud)
+    if not ack.startswith("EXPORT " + source):
+        sys.exit(ack)
+    if baud != console_baud:
+        port.set_baud(baud)
+    frames, expected, last, started = Frames(), first, None, time.time()
+    restart = None
+    while True:
+        data = data or port.read(IDLE_TIMEOUT_S)
+        if not data:
+            restart = expected
+            break
+        stats["bytes"] += len(data)
+        frames.feed(data)
+        data = b""
+        done = False
+        for ftype, seq, aux, payload in frames:
+            if ftype == T_END:
+                done = True
+                break
+            if ftype == T_START and payload is not None:
+                expected = max(expected, seq)
+                last = struct.unpack("<I", payload)[0]
+                continue
+            if seq < expected or restart is not None:
+                continue
+            if payload is None or seq > expected:
+                # Lost or damaged: let the running frames drain, then ask again from here
+                restart = expected
+                port.write(b"EXPORT STOP\n")
+                continue
+            if ftype == T_TRACK:
+                for utc, lat, lon in track_points(payload, aux):
+                    out.write("%s,%.6f,%.6f\n" % (iso(utc), lat / 1e6, lon / 1e6))
+                    stats["points"] += 1
+            elif ftype == T_LOG:
+                for utc, lat, lon, alt, speed, course, hdop, sats, _ in log_records(payload, aux):
+                    out.write("%s,%.6f,%.6f,%.2f,%.2f,%.2f,%.2f,%d\n"
+                              % (iso(utc), lat / 1e6, lon / 1e6, alt / 100.0, speed / 100.0,
+                                 course / 100.0, hdop / 100.0, sats))
+                    stats["points"] += 1
+            elif ftype == T_MISSING:
+                stats["missing"] += 1
+            stats["frames"] += 1
+            expected = seq + 1
+        if done:
+            break
+    stats["bad"] += frames.bad
+    stats["seconds"] += time.time() - started
+    if baud != console_baud:
+        time.sleep(0.2)
+        port.set_baud(console_baud)
+    stats["next"] = expected
+    if restart is not None:
+        return restart
+    return None if last is None or expected > last else expected
+
+
+def iso(utc):
+    return datetime.fromtimestamp(utc, timezone.utc).strftime("%Y-%m-%dT%H:%M:%SZ")
+
+
+class FakeUnit(threading.Thread):
+    """Answers EXPORT on the other end of a pseudo-terminal with synthetic blocks,
+    damaging one frame per transfer and printing a log line now and then."""
+
+    def __init__(self, fd, blocks):
+        super().__init__(daemon=True)
+        self.fd, self.blocks, self.damaged = fd, blocks, set()
+        self.rng = random.Random(7)
+
+    def run(self):
+        line = b""
+        while True:
+            line += os.read(self.fd, 256)
+            while b"\n" in line:
+                cmd, line = line.split(b"\n", 1)
+                words = cmd.split()
+                if len(words) >= 2 and words[0] == b"EXPORT" and words[1] != b"STOP":
+                    line = self.export(int(words[2]) if len(words) > 2 else 0, line)
+
+    def export(self, first, pending):
+        oldest, newest = 3, 3 + len(self.blocks) - 1
+        first = max(first, oldest)
+        os.write(self.fd, b"EXPORT log %d-%d at 921600 baud\n" % (first, newest))
+        os.write(self.fd, frame(T_START, first, 0, struct.pack("<I", newest)))
+        seq = first
+        while seq <= newest:
+            ready, _, _ = select.select([self.fd], [], [], 0)
+            if ready:
+                pending += os.read(self.fd, 256)
+                if b"EXPORT STOP" in pending:
+                    pending = pending.split(b"EXPORT STOP\n", 1)[1]
+                    break
+            block = self.blocks[seq - oldest]
+            if block is None:
+                data = frame(T_MISSING, seq)
+            else:
+                data = frame(T_LOG, seq, (len(block) - LOG_HEADER_LEN) // LOG_FRAME_LEN, block)
+                if seq not in self.damaged and self.rng.random() < 0.05:
+                    self.damaged.add(seq)
+                    data = data[:20] + bytes([data[20] ^ 0xFF]) + data[21:]
+            if self.rng.random() < 0.05:
+                os.write(self.fd, b"Trip request SMS received\n")
+            os.write(self.fd, data)
+            seq += 1
+        os.write(self.fd, frame(T_END, seq, 1 if seq <= newest else 0))
+        return pending
+
+
+def fake_blocks(count, records):
+    blocks, utc = [], 1760000000
+    for n in range(count):
+        if n == 5:
+            blocks.append(None)
+            continue
+        seg = bytearray(LOG_MAGIC + struct.pack("<I", n + 3))
+        seg += struct.pack("<H", crc16(seg)) + b"\0\0"
+        for i in range(records):
+            rec = LOG_RECORD.pack(utc, 20558853 + utc % 1000 * 40, -103428903, 185000, 1800, 9000, 90, 9, 1)
+            body = bytes([LOG_RECORD.size]) + rec
+            seg += b"\xa5" + body + struct.pack("<H", crc16(body))
+            utc += 5
+        blocks.append(bytes(seg))
+    return blocks
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", nargs="?", help="serial device of the unit's console")
+    parser.add_argument("--source", choices=("track", "log"), default="log")
+    parser.add_argument("--from", dest="first", type=int, default=0, help="first sequence number, to resume")
+    parser.add_argument("--baud", type=int, default=921600, help="rate for the transfer")
+    parser.add_argument("--console-baud", type=int, default=115200)
+    parser.add_argument("-o", "--output", help="CSV file, appended to with --from (default stdout)")
+    parser.add_argument("--simulate", action="store_true",
+                        help="test against a fake unit on a pseudo-terminal")
+    args = parser.parse_args()
+
+    if args.simulate:
+        master, slave = os.openpty()
+        blocks = fake_blocks(200, 17)
+        FakeUnit(master, blocks).start()
+        args.port, args.source = os.ttyname(slave), "log"
+    elif not args.port:
+        parser.error("a serial port or --simulate is needed")
+
+    port = Port(args.port, args.console_baud)
+    out = open(args.output, "a" if args.first else "w") if args.output else sys.stdout
+    if not args.first:
+        out.write("time,lat,lon" + (",alt_m,speed_kmh,course,hdop,sats" if args.source == "log" else "") + "\n")
+    stats = dict(frames=0, missing=0, bad=0, points=0, bytes=0, seconds=0.0, next=args.first, restarts=0)
+    first, stuck = args.first, 0
+    try:
+        while first is not None:
+            previous = first
+            first = transfer(port, args.source, first, args.baud, args.console_baud, out, stats)
+            if first is not None:
+                stats["restarts"] += 1
+                stuck = stuck + 1 if first == previous else 0
+                if stuck > MAX_RESTARTS:
+                    break
+    except KeyboardInterrupt:
+        pass
+    out.flush()
+    rate = stats["bytes"] / stats["seconds"] if stats["seconds"] else 0
+    print("%d frames (%d missing on the unit, %d damaged), %d points, %d bytes in %.1f s (%.0f B/s), %d restarts"
+          % (stats["frames"], stats["missing"], stats["bad"], stats["points"], stats["bytes"],
+             stats["seconds"], rate, stats["restarts"]), file=sys.stderr)
+    if first is not None:
+        print("incomplete: continue with --from %d" % stats["next"], file=sys.stderr)
+        sys.exit(1)
+    if args.simulate:
+        expected = sum(1 for b in blocks if b) * 17
+        if stats["points"] != expected:
+            sys.exit("simulation: %d points, expected %d" % (stats["points"], expected))
+
+
+if __name__ == "__main__":
+    main()